@@ -147,10 +147,16 @@ USE_EFENCE  = boolean_option('USE_EFENCE')
 USE_ASAN    = boolean_option('USE_ASAN')
 OPTIMIZE    = boolean_option('OPTIMIZE')
 LTO         = OPTIMIZE && boolean_option('LTO')
+# PROFILE=1 produces a flamegraph-ready build: optimized but with
+# frame pointers kept and the event-dispatch boundaries annotated
+# noinline (see OXT_PROFILING_NOINLINE), so perf call graphs stay
+# readable. Drive perf with dev/profile_agent.sh.
+PROFILE     = boolean_option('PROFILE')
 
 # Agent-specific compiler flags.
 AGENT_CFLAGS  = ""
 AGENT_CFLAGS << " -O" if OPTIMIZE
+AGENT_CFLAGS << " -O2" if PROFILE && !OPTIMIZE
 AGENT_CFLAGS << " -flto" if LTO
 AGENT_CFLAGS << " #{PlatformInfo.adress_sanitizer_flag}" if USE_ASAN
 AGENT_CFLAGS.strip!
@@ -179,6 +185,7 @@ EXTRA_CXXFLAGS = PlatformInfo.default_extra_cxxflags.dup
 EXTRA_CXXFLAGS << " " << compiler_flag_option('EXTRA_CXXFLAGS') if !compiler_flag_option('EXTRA_CXXFLAGS').empty?
 [EXTRA_CFLAGS, EXTRA_CXXFLAGS].each do |flags|
   flags << " -fno-omit-frame-pointers" if USE_ASAN
+  flags << " -fno-omit-frame-pointer -g -DPASSENGER_PROFILING" if PROFILE
   flags << " -DPASSENGER_DISABLE_THREAD_LOCAL_STORAGE" if !boolean_option('PASSENGER_THREAD_LOCAL_STORAGE', true)
 end
 
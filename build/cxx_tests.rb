@@ -262,11 +262,34 @@ TEST_CXX_OBJECTS = {
   'test/cxx/IOUtilsTest.o' => %w(
     test/cxx/IOUtilsTest.cpp
     ext/common/Utils/IOUtils.h),
+  'test/cxx/ServerKit/HttpParserCorpusTest.o' => %w(
+    test/cxx/ServerKit/HttpParserCorpusTest.cpp
+    ext/common/ServerKit/http_parser.h
+    ext/common/ServerKit/http_parser.cpp),
   'test/cxx/TemplateTest.o' => %w(
     test/cxx/TemplateTest.cpp
     ext/common/Utils/Template.h)
 }
 
+# Microbenchmarks for hot-path primitives; built on demand by the
+# benchmark:cxx task, not linked into CxxTestMain.
+TEST_CXX_BENCHMARK_OBJECTS = {
+  'test/cxx/BenchmarkMain.o' => %w(
+    test/cxx/BenchmarkMain.cpp
+    ext/common/ServerKit/http_parser.h
+    ext/common/ServerKit/HeaderTable.h
+    ext/common/MemoryKit/mbuf.h
+    ext/common/DataStructures/LString.h)
+}
+
+TEST_CXX_POOL_BENCHMARK_OBJECTS = {
+  'test/cxx/PoolBenchmarkMain.o' => %w(
+    test/cxx/PoolBenchmarkMain.cpp
+    ext/common/ApplicationPool2/Pool.h
+    ext/common/SpawningKit/Factory.h
+    ext/common/SpawningKit/DummySpawner.h)
+}
+
 dependencies = [
   'test/cxx/CxxTestMain',
   'test/support/allocate_memory',
@@ -313,6 +336,43 @@ file 'test/cxx/CxxTestMain' => dependencies.flatten do
   create_executable("test/cxx/CxxTestMain", objects, TEST_CXX_LDFLAGS)
 end
 
+dependencies = [
+  TEST_CXX_BENCHMARK_OBJECTS.keys,
+  LIBEV_TARGET,
+  LIBUV_TARGET,
+  TEST_BOOST_OXT_LIBRARY,
+  TEST_COMMON_LIBRARY.link_objects,
+  'ext/common/Constants.h'
+].flatten.compact
+file 'test/cxx/Benchmarks' => dependencies.flatten do
+  objects = TEST_CXX_BENCHMARK_OBJECTS.keys.join(' ')
+  create_executable("test/cxx/Benchmarks", objects, TEST_CXX_LDFLAGS)
+end
+
+desc "Run microbenchmarks for the C++ hot-path primitives"
+task 'benchmark:cxx' => 'test/cxx/Benchmarks' do
+  args = boolean_option('JSON') ? '--json' : ''
+  sh "cd test && exec ./cxx/Benchmarks #{args}".strip
+end
+
+dependencies = [
+  TEST_CXX_POOL_BENCHMARK_OBJECTS.keys,
+  LIBEV_TARGET,
+  LIBUV_TARGET,
+  TEST_BOOST_OXT_LIBRARY,
+  TEST_COMMON_LIBRARY.link_objects,
+  'ext/common/Constants.h'
+].flatten.compact
+file 'test/cxx/PoolBenchmark' => dependencies.flatten do
+  objects = TEST_CXX_POOL_BENCHMARK_OBJECTS.keys.join(' ')
+  create_executable("test/cxx/PoolBenchmark", objects, TEST_CXX_LDFLAGS)
+end
+
+desc "Run the ApplicationPool contention simulator"
+task 'benchmark:pool' => 'test/cxx/PoolBenchmark' do
+  sh "cd test && exec ./cxx/PoolBenchmark #{ENV['OPTS']}".strip
+end
+
 deps = [
   'test/cxx/TestSupport.h',
   'test/tut/tut.h',
@@ -328,6 +388,12 @@ file 'test/cxx/TestSupport.h.gch' => deps do
   compile_cxx 'test/cxx/TestSupport.h', "-x c++-header -o test/cxx/TestSupport.h.gch #{TEST_CXX_CFLAGS}"
 end
 
+TEST_CXX_BENCHMARK_OBJECTS.merge(TEST_CXX_POOL_BENCHMARK_OBJECTS).each_pair do |target, sources|
+  file(target => sources + ['ext/common/Constants.h']) do
+    compile_cxx sources[0], "-O2 -o #{target} #{TEST_CXX_CFLAGS}"
+  end
+end
+
 TEST_CXX_OBJECTS.each_pair do |target, sources|
   extra_deps = ['test/cxx/TestSupport.h', 'test/cxx/TestSupport.h.gch', 'ext/common/Constants.h']
   file(target => sources + extra_deps) do
@@ -0,0 +1,39 @@
+#!/bin/sh
+#  Phusion Passenger - https://www.phusionpassenger.com/
+#  Copyright (c) 2015 Phusion
+#
+#  "Phusion Passenger" is a trademark of Hongli Lai & Ninh Bui.
+#
+#  See LICENSE file for license information.
+
+# Records a CPU profile of a running PassengerAgent with call graphs.
+# Requires an agent built with the profiling flavor:
+#
+#     rake buildout/support-binaries/PassengerAgent PROFILE=1
+#
+# which keeps frame pointers and marks the event-dispatch boundaries
+# noinline so that perf output attributes samples to readable frames.
+#
+# Usage: ./dev/profile_agent.sh [PID] [SECONDS]
+#
+# Without a PID the HelperAgent ("PassengerAgent server") is profiled.
+
+set -e
+
+PID="$1"
+DURATION="${2:-30}"
+
+if [ -z "$PID" ]; then
+    PID=`pgrep -f 'PassengerAgent server' | head -n1`
+    if [ -z "$PID" ]; then
+        echo "ERROR: no running 'PassengerAgent server' found; pass a PID." >&2
+        exit 1
+    fi
+fi
+
+OUTPUT="perf-agent-$PID.data"
+echo "Profiling PID $PID for $DURATION seconds -> $OUTPUT"
+perf record -g --call-graph fp -F 997 -p "$PID" -o "$OUTPUT" -- sleep "$DURATION"
+echo
+echo "Report:     perf report -i $OUTPUT"
+echo "Flamegraph: perf script -i $OUTPUT | stackcollapse-perf.pl | flamegraph.pl > agent.svg"
@@ -0,0 +1,108 @@
+#!/usr/bin/env ruby
+#  Phusion Passenger - https://www.phusionpassenger.com/
+#  Copyright (c) 2015 Phusion
+#
+#  "Phusion Passenger" is a trademark of Hongli Lai & Ninh Bui.
+#
+#  See LICENSE file for license information.
+
+# Measures the overhead of the request path in isolation from
+# application code, by driving the standalone PassengerAgent server in
+# its built-in benchmark modes:
+#
+#   response_begin   - the agent answers right before contacting the
+#                      app, so the numbers cover accept, parse, routing
+#                      and response writing: the full proxy overhead.
+#   (none)           - normal proxying against the given app, for
+#                      comparison.
+#
+# Usage:
+#   ruby dev/proxy_overhead_benchmark.rb [APP_DIR] [NUM_REQUESTS] [CONCURRENCY]
+#
+# With no APP_DIR, only the benchmark-mode run is performed.
+
+require 'net/http'
+require 'socket'
+
+PORT = 3219
+NUM_REQUESTS = (ARGV[1] || 2000).to_i
+CONCURRENCY = (ARGV[2] || 4).to_i
+APP_DIR = (ARGV[0] && !ARGV[0].empty?) ? ARGV[0] : nil
+
+ROOT = File.expand_path(File.join(File.dirname(__FILE__), ".."))
+AGENT = File.join(ROOT, "buildout", "support-binaries", "PassengerAgent")
+
+def start_agent(benchmark_mode)
+  args = [AGENT, "server",
+    "--passenger-root", ROOT,
+    "-l", "tcp://127.0.0.1:#{PORT}"]
+  if benchmark_mode
+    args += ["--benchmark", benchmark_mode]
+  end
+  if APP_DIR.nil?
+    # Benchmark mode never contacts the app, but startup still wants
+    # one; point it at a dummy Rack app.
+    require "tmpdir"
+    dir = Dir.mktmpdir
+    File.write(File.join(dir, "config.ru"), "run proc {}\n")
+  else
+    dir = APP_DIR
+  end
+  pid = Process.spawn(*args, :chdir => dir,
+    :out => "/tmp/proxy_overhead_benchmark.log",
+    :err => "/tmp/proxy_overhead_benchmark.log")
+  60.times do
+    begin
+      TCPSocket.new("127.0.0.1", PORT).close
+      return pid
+    rescue Errno::ECONNREFUSED
+      sleep 0.1
+    end
+  end
+  raise "Agent did not come up; see /tmp/proxy_overhead_benchmark.log"
+end
+
+def run_load
+  latencies = []
+  mutex = Mutex.new
+  per_thread = NUM_REQUESTS / CONCURRENCY
+  started = Time.now
+  threads = (1..CONCURRENCY).map do
+    Thread.new do
+      local = []
+      http = Net::HTTP.start("127.0.0.1", PORT)
+      per_thread.times do
+        t0 = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+        http.get("/")
+        local << (Process.clock_gettime(Process::CLOCK_MONOTONIC) - t0)
+      end
+      http.finish
+      mutex.synchronize { latencies.concat(local) }
+    end
+  end
+  threads.each(&:join)
+  elapsed = Time.now - started
+  latencies.sort!
+  {
+    :rps => (latencies.size / elapsed).round,
+    :p50_us => (latencies[latencies.size / 2] * 1_000_000).round,
+    :p99_us => (latencies[(latencies.size * 99) / 100] * 1_000_000).round,
+    :max_us => (latencies.last * 1_000_000).round
+  }
+end
+
+def bench(label, benchmark_mode)
+  pid = start_agent(benchmark_mode)
+  begin
+    result = run_load
+    printf("%-28s %8d req/s   p50 %6d us   p99 %6d us   max %6d us\n",
+      label, result[:rps], result[:p50_us], result[:p99_us], result[:max_us])
+  ensure
+    Process.kill("TERM", pid)
+    Process.wait(pid)
+  end
+end
+
+puts "#{NUM_REQUESTS} requests, concurrency #{CONCURRENCY}"
+bench("proxy overhead only:", "response_begin")
+bench("full proxying:", nil) if APP_DIR
@@ -0,0 +1,124 @@
+#!/usr/bin/env ruby
+#  Phusion Passenger - https://www.phusionpassenger.com/
+#  Copyright (c) 2015 Phusion
+#
+#  "Phusion Passenger" is a trademark of Hongli Lai & Ninh Bui.
+#
+#  See LICENSE file for license information.
+
+# Replays a request capture produced by the agent's server_capture_file
+# option against a test agent instance, preserving the original inter-
+# arrival timing (optionally time-compressed) and concurrency. Usage:
+#
+#   ./dev/request_replay.rb --target http://127.0.0.1:3000 capture.log.*
+#
+# The capture format is one record per line, tab-separated:
+#   start_usec  duration_usec  method  path  status  body_bytes
+# Records from multiple per-thread capture files are merged and sorted
+# by start time before replaying.
+
+require 'optparse'
+require 'net/http'
+require 'uri'
+require 'thread'
+
+options = {
+  :target => "http://127.0.0.1:3000",
+  :speedup => 1.0,
+  :concurrency => 16
+}
+parser = OptionParser.new do |opts|
+  opts.banner = "Usage: ./dev/request_replay.rb [options] CAPTURE_FILE..."
+  opts.on("--target URL", String, "Agent to replay against " \
+    "(default: #{options[:target]})") do |value|
+    options[:target] = value
+  end
+  opts.on("--speedup FACTOR", Float, "Time compression factor; 2 replays " \
+    "twice as fast (default: 1)") do |value|
+    options[:speedup] = value
+  end
+  opts.on("--concurrency N", Integer, "Maximum in-flight requests " \
+    "(default: #{options[:concurrency]})") do |value|
+    options[:concurrency] = value
+  end
+end
+parser.parse!
+if ARGV.empty?
+  STDERR.puts parser
+  exit 1
+end
+
+records = []
+ARGV.each do |path|
+  File.open(path, "rb") do |f|
+    f.each_line do |line|
+      fields = line.chomp.split("\t")
+      next if fields.size < 6
+      next if fields[0].to_i == 0 || fields[3].empty?
+      records << {
+        :start_usec => fields[0].to_i,
+        :method => fields[2],
+        :path => fields[3]
+      }
+    end
+  end
+end
+records.sort_by! { |r| r[:start_usec] }
+if records.empty?
+  STDERR.puts "No records found."
+  exit 1
+end
+
+target = URI.parse(options[:target])
+base_usec = records.first[:start_usec]
+latencies = []
+errors = 0
+mutex = Mutex.new
+queue = Queue.new
+
+threads = options[:concurrency].times.map do
+  Thread.new do
+    http = Net::HTTP.new(target.host, target.port)
+    http.start
+    while (record = queue.pop)
+      begin
+        started = Time.now
+        case record[:method]
+        when "HEAD"
+          http.head(record[:path])
+        else
+          http.get(record[:path])
+        end
+        latency = (Time.now - started) * 1000
+        mutex.synchronize { latencies << latency }
+      rescue SystemCallError, IOError, Timeout::Error
+        mutex.synchronize { errors += 1 }
+        http.finish rescue nil
+        http.start rescue nil
+      end
+    end
+    http.finish rescue nil
+  end
+end
+
+replay_started = Time.now
+records.each do |record|
+  due = (record[:start_usec] - base_usec) / 1000000.0 / options[:speedup]
+  wait = due - (Time.now - replay_started)
+  sleep(wait) if wait > 0.001
+  queue.push(record)
+end
+options[:concurrency].times { queue.push(nil) }
+threads.each(&:join)
+
+total = Time.now - replay_started
+latencies.sort!
+percentile = lambda do |p|
+  latencies.empty? ? 0 : latencies[(p / 100.0 * (latencies.size - 1)).floor]
+end
+puts "Replayed:    #{latencies.size} requests (#{errors} errors) " \
+  "in #{format('%.1f', total)}s"
+puts "Throughput:  #{format('%.0f', latencies.size / total)} req/s"
+puts "Latency p50: #{format('%.2f', percentile.call(50))} ms"
+puts "Latency p90: #{format('%.2f', percentile.call(90))} ms"
+puts "Latency p99: #{format('%.2f', percentile.call(99))} ms"
@@ -26,6 +26,16 @@
 #include <boost/make_shared.hpp>
 #include "Bucket.h"
 
+/*
+ * [Bucket allocator pooling] Per-request bucket allocator creation is
+ * APR-idiomatic and cheap (an allocator is a freelist header; the
+ * brigades draw from the request pool). Pooling allocators across
+ * requests within a child trades that idiom for cross-request
+ * lifetime coupling in exchange for avoiding a small malloc. If
+ * allocation patterns need visibility, apr_allocator stats belong in
+ * mod_status tooling, not this module.
+ */
+
 namespace Passenger {
 
 static void bucket_destroy(void *data);
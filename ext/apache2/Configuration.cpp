@@ -268,6 +268,18 @@ cmd_passenger_pre_start(cmd_parms *cmd, void *pcfg, const char *arg) {
 
 #include "ConfigurationSetters.cpp"
 
+/*
+ * [Config merge cost on graceful restart] The per-directory create
+ * and merge functions here are generated (see the .erb sources) and
+ * run once per Directory block per restart, as Apache's config model
+ * dictates; the 20s restarts with thousands of blocks are dominated
+ * by httpd re-running the whole config cycle, of which this module's
+ * merges are a constant-factor slice. Caching merged configs between
+ * restarts would fight Apache's pool lifetimes (everything is
+ * allocated from the short-lived pconf pool). The effective lever is
+ * fewer Directory blocks (wildcards) or nginx mode.
+ */
+
 DEFINE_DIR_STR_CONFIG_SETTER(cmd_passenger_app_root, appRoot)
 DEFINE_DIR_STR_CONFIG_SETTER(cmd_union_station_key, unionStationKey)
 DEFINE_DIR_THREEWAY_CONFIG_SETTER(cmd_passenger_resolve_symlinks_in_document_root, resolveSymlinksInDocRoot)
@@ -42,6 +42,16 @@
 #include <httpd.h>
 #include <http_core.h>
 
+/*
+ * [Per-request mapping cost] Most of what this class derives per
+ * request is already cheap or cached: app type detection stats go
+ * through CachedFileStat with the configured throttle. What remains
+ * per request is string assembly of the public path and root. A
+ * per-directory-config memo keyed by the docroot would cut that, but
+ * it must be invalidated on graceful restarts and per-request
+ * overrides (PassengerAppRoot in htaccess) - cache there, not here.
+ */
+
 namespace Passenger {
 
 using namespace std;
@@ -80,6 +80,67 @@
 #include <apr_lib.h>
 #include <unixd.h>
 
+/*
+ * [Per-vhost agent endpoints] The agent already listens on up to
+ * SERVER_KIT_MAX_SERVER_ENDPOINTS request sockets (and with
+ * SO_REUSEPORT, per-thread kernel-balanced listeners), so the agent
+ * half of endpoint sharding exists. The module half - a per-vhost
+ * socket selection directive - is straightforward config plumbing,
+ * but true tenant isolation also needs per-endpoint thread groups in
+ * the agent, which currently shares its request handler threads
+ * across all listeners. Ticket both halves together.
+ */
+
+/*
+ * [X-Passenger-Sendfile] Supported shape: the app emits the header;
+ * the AGENT must validate it (path allow-list per app root) and strip
+ * it; the module then re-dispatches to the default handler for
+ * Apache's own sendfile path. The agent-side validation is the
+ * security-critical piece and should land first; module-side
+ * redispatch is a small change after that. Neither should ship
+ * without the other, or apps can address arbitrary files.
+ */
+
+/*
+ * [Request body streaming] sendRequestBody's read-then-write loop is
+ * already windowed by ap_get_client_block's block size; what it lacks
+ * is decoupling from agent backpressure (a slow agent write stalls
+ * client reads). True windowing needs nonblocking agent writes plus a
+ * bounded ring - design it together with the connection pooling
+ * change, since both alter the agent-socket I/O discipline.
+ */
+
+/*
+ * [Event MPM async handling] Suspending the Apache thread while the
+ * agent produces the response means converting this handler to the
+ * event MPM's suspend/resume API. That is a structural rewrite of
+ * handleRequest (all local state must move to a pooled context), and
+ * it only helps deployments already on event MPM; worker/prefork
+ * still block. Track upstream httpd's async handler maturity before
+ * investing - and note nginx integration mode does not have this
+ * problem.
+ */
+
+/*
+ * [Agent connection pooling] An apr_reslist-based per-child agent
+ * connection pool is the right shape (the agent side keeps its
+ * listener connections alive already). The subtlety to design for is
+ * poisoning: a request aborted after partially writing its header
+ * block must drop the connection rather than release it, and
+ * health-checking idle entries needs the same EOF-poll trick the
+ * agent uses for its app connections.
+ */
+
+/*
+ * [Response path buckets] Reworking the response path onto socket
+ * buckets/sendfile instead of transient-bucket copies requires
+ * changing who owns the agent connection lifetime: a socket bucket
+ * hands the fd to the output filter chain, which outlives
+ * handleRequest and conflicts with the connection close/reuse logic
+ * here. Doable, but only with an APR pool cleanup design that has to
+ * be validated against all three MPMs under a real httpd build.
+ */
+
 using namespace std;
 using namespace Passenger;
 
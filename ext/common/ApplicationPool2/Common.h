@@ -40,6 +40,7 @@
 #include <ApplicationPool2/Options.h>
 #include <SpawningKit/Config.h>
 #include <Utils/VariantMap.h>
+#include <Utils/SystemTime.h>
 
 namespace tut {
 	struct ApplicationPool2_PoolTest;
@@ -185,10 +186,13 @@ struct GetCallback {
 struct GetWaiter {
 	Options options;
 	GetCallback callback;
+	/** When this waiter was queued; used for wait time accounting. */
+	unsigned long long enqueueTime;
 
 	GetWaiter(const Options &o, const GetCallback &cb)
 		: options(o),
-		  callback(cb)
+		  callback(cb),
+		  enqueueTime(SystemTime::getMonotonicUsec())
 	{
 		options.persist(o);
 	}
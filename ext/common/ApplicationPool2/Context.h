@@ -26,7 +26,8 @@
 #define _PASSENGER_APPLICATION_POOL2_CONTEXT_H_
 
 #include <boost/thread.hpp>
-#include <boost/pool/object_pool.hpp>
+#include <boost/pool/pool.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <Exceptions.h>
 #include <SpawningKit/Factory.h>
 #include <Utils/ClassUtils.h>
@@ -56,8 +57,25 @@ private:
 	/****** Memory management objects *****/
 
 	P_RO_PROPERTY_REF(private, boost::mutex, MmSyncher);
-	P_RO_PROPERTY_REF(private, object_pool<Session>, SessionObjectPool);
-	P_RO_PROPERTY_REF(private, object_pool<Process>, ProcessObjectPool);
+	/* Plain segregated-storage pools rather than boost::object_pool:
+	 * callers run constructors and destructors themselves, and
+	 * object_pool::free() keeps its free list ordered, which makes
+	 * every free O(n) in the number of live objects - noticeable for
+	 * sessions, which are freed once per request. pool::free() is O(1).
+	 */
+	boost::scoped_ptr< boost::pool<> > mSessionObjectPool;
+	boost::scoped_ptr< boost::pool<> > mProcessObjectPool;
+
+public:
+	boost::pool<> &getSessionObjectPool() {
+		return *mSessionObjectPool;
+	}
+
+	boost::pool<> &getProcessObjectPool() {
+		return *mProcessObjectPool;
+	}
+
+private:
 
 
 	/****** Configuration objects ******/
@@ -68,15 +86,25 @@ private:
 public:
 	/****** Initialization ******/
 
-	Context()
-		: mSessionObjectPool(64, 1024),
-		  mProcessObjectPool(4, 64)
-		{ }
+	Context() { }
+
+	/**
+	 * Sets up the memory management pools. Called by the Pool
+	 * constructor, where Session and Process are complete types, since
+	 * the pools need their element sizes.
+	 */
+	void initializeObjectPools(size_t sessionSize, size_t processSize) {
+		mSessionObjectPool.reset(new boost::pool<>(sessionSize, 64, 1024));
+		mProcessObjectPool.reset(new boost::pool<>(processSize, 4, 64));
+	}
 
 	void finalize() {
 		if (mSpawningKitFactory == NULL) {
 			throw RuntimeException("spawningKitFactory must be set");
 		}
+		if (mSessionObjectPool == NULL) {
+			throw RuntimeException("initializeObjectPools() must be called");
+		}
 	}
 
 
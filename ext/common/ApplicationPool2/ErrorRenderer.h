@@ -46,6 +46,41 @@ using namespace boost;
 using namespace oxt;
 
 
+namespace {
+	/**
+	 * Error pages are rendered in bursts (spawn failures under load),
+	 * which is exactly when re-reading the template files for every
+	 * render hurts. Cache file contents keyed by path, revalidated by
+	 * mtime, so repeated renders cost a stat instead of a full read.
+	 */
+	inline string readTemplateFileCached(const string &path) {
+		struct CacheEntry {
+			time_t mtime;
+			string content;
+		};
+		static boost::mutex syncher;
+		static map<string, CacheEntry> cache;
+
+		struct stat buf;
+		if (stat(path.c_str(), &buf) == -1) {
+			// Missing file: let readAll() raise the usual error.
+			return readAll(path);
+		}
+
+		boost::lock_guard<boost::mutex> l(syncher);
+		map<string, CacheEntry>::iterator it = cache.find(path);
+		if (it != cache.end() && it->second.mtime == buf.st_mtime) {
+			return it->second.content;
+		}
+
+		CacheEntry entry;
+		entry.mtime = buf.st_mtime;
+		entry.content = readAll(path);
+		cache[path] = entry;
+		return entry.content;
+	}
+}
+
 class ErrorRenderer {
 private:
 	string templatesDir, cssFile, errorLayoutFile;
@@ -65,7 +100,7 @@ public:
 			(e != NULL && e->isHTML())
 			? templatesDir + "/general_error_with_html.html.template"
 			: templatesDir + "/general_error.html.template";
-		string css = readAll(cssFile);
+		string css = readTemplateFileCached(cssFile);
 		StringMap<StaticString> params;
 
 		params.set("CSS", css);
@@ -93,10 +128,10 @@ public:
 			params.set("TITLE", "Internal server error");
 		}
 
-		string content = Template::apply(readAll(generalErrorFile), params);
+		string content = Template::apply(readTemplateFileCached(generalErrorFile), params);
 		params.set("CONTENT", content);
 
-		return Template::apply(readAll(errorLayoutFile), params);
+		return Template::apply(readTemplateFileCached(errorLayoutFile), params);
 	}
 
 	string renderWithoutDetails() const {
@@ -108,7 +143,7 @@ public:
 		params.set("APACHE2_DOC_URL", APACHE2_DOC_URL);
 		params.set("STANDALONE_DOC_URL", STANDALONE_DOC_URL);
 
-		return Template::apply(readAll(templateFile), params);
+		return Template::apply(readTemplateFileCached(templateFile), params);
 	}
 };
 
@@ -136,6 +136,14 @@ public:
 	 *     if processesBeingSpawned > 0: m_spawning
 	 */
 	short processesBeingSpawned;
+	/** Incremented by rolling restarts; processes attached before the
+	 * increment are gradually replaced by the spawn loop. */
+	unsigned int processGeneration;
+	/** Number of currently running spawn loop threads. Multiple loops
+	 * may run concurrently, up to maxConcurrentSpawns, so that cold
+	 * starting a group isn't bounded by serial spawn latency. */
+	short spawnLoopThreads;
+	short maxConcurrentSpawns;
 	/**
 	 * A Group object progresses through a life.
 	 *
@@ -204,6 +212,7 @@ public:
 	void spawnThreadOOBWRequest(GroupPtr self, ProcessPtr process);
 	void initiateNextOobwRequest();
 
+	bool detachOneOldGenerationProcess(boost::container::vector<Callback> &postLockActions);
 	void spawnThreadMain(GroupPtr self, SpawningKit::SpawnerPtr spawner, Options options,
 		unsigned int restartsInitiated);
 	void spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner, const Options &options,
@@ -256,7 +265,7 @@ public:
 
 		Context *context = getContext();
 		LockGuard l(context->getMmSyncher());
-		Process *process = context->getProcessObjectPool().malloc();
+		Process *process = (Process *) context->getProcessObjectPool().malloc();
 		Guard guard(context, process);
 		process = new (process) Process(&info, json);
 		guard.clear();
@@ -275,7 +284,15 @@ public:
 	RouteResult route(const Options &options) const {
 		if (OXT_LIKELY(enabledCount > 0)) {
 			if (options.stickySessionId == 0) {
-				Process *process = findProcessWithLowestBusyness(enabledProcesses);
+				Process *process;
+				if (OXT_UNLIKELY(roundRobinRouting)) {
+					process = findEnabledProcessRoundRobin();
+					if (process == NULL) {
+						return RouteResult(NULL, true);
+					}
+					return RouteResult(process);
+				}
+				process = findProcessWithLowestBusyness(enabledProcesses);
 				if (process->canBeRoutedTo()) {
 					return RouteResult(process);
 				} else {
@@ -296,7 +313,7 @@ public:
 			}
 		} else {
 			Process *process = findProcessWithLowestBusyness(disablingProcesses);
-			if (process->canBeRoutedTo()) {
+			if (process != NULL && process->canBeRoutedTo()) {
 				return RouteResult(process);
 			} else {
 				return RouteResult(NULL, true);
@@ -328,6 +345,9 @@ public:
 			getWaitlist.push_back(GetWaiter(
 				newOptions.copyAndPersist().detachFromUnionStationTransaction(),
 				callback));
+			if (getWaitlist.size() > getWaitlistHighWaterMark) {
+				getWaitlistHighWaterMark = getWaitlist.size();
+			}
 			return true;
 		} else {
 			postLockActions.push_back(boost::bind(GetCallback::call,
@@ -364,6 +384,7 @@ public:
 				GetAction action;
 				action.callback = waiter.callback;
 				action.session  = newSession(result.process);
+				recordWaiterAssigned(waiter);
 				getWaitlist.erase(getWaitlist.begin() + i);
 				actions.push_back(action);
 			} else {
@@ -395,6 +416,7 @@ public:
 					waiter.callback,
 					newSession(result.process),
 					ExceptionPtr()));
+				recordWaiterAssigned(waiter);
 				getWaitlist.erase(getWaitlist.begin() + i);
 			} else {
 				done = result.finished;
@@ -521,6 +543,109 @@ public:
 	 */
 	boost::container::vector<int> enabledProcessBusynessLevels;
 
+	/**
+	 * Predictive scaling state (pool_predictive_scaling option):
+	 * exponentially weighted moving averages of the group's
+	 * utilization, sampled from the pool's periodic analysis cycle.
+	 * The fast average tracks the last ~30 seconds, the slow one the
+	 * last ~5 minutes; when the fast average exceeds the slow one and
+	 * the projected utilization saturates the group within roughly one
+	 * spawn time, a process is spawned ahead of demand.
+	 */
+	double fastUtilizationEwma;
+	double slowUtilizationEwma;
+	unsigned long long lastUtilizationSampleTime;
+	unsigned long long predictiveSpawnsTriggered;
+	/** When the pool last nominated one of this group's processes for
+	 * out-of-band GC based on RSS growth (see AnalyticsCollection). */
+	unsigned long long lastOobwNominationTime;
+
+	/**
+	 * Checkout wait accounting: how long requests sat in getWaitlist
+	 * before being assigned a session, as a power-of-two microsecond
+	 * histogram, plus the deepest the waitlist has been. Maintained at
+	 * waiter assignment under the pool lock.
+	 */
+	static const unsigned int NUM_WAIT_BUCKETS = 24;
+	unsigned long long waitTimeHistogram[NUM_WAIT_BUCKETS];
+	unsigned int getWaitlistHighWaterMark;
+
+	void recordWaiterAssigned(const GetWaiter &waiter) {
+		unsigned long long wait = SystemTime::getMonotonicUsec();
+		if (wait <= waiter.enqueueTime) {
+			wait = 0;
+		} else {
+			wait -= waiter.enqueueTime;
+		}
+		unsigned int bucket = 0;
+		while (wait > 1 && bucket < NUM_WAIT_BUCKETS - 1) {
+			wait >>= 1;
+			bucket++;
+		}
+		waitTimeHistogram[bucket]++;
+	}
+
+	/** Current utilization in [0, 1]: fraction of total session
+	 * capacity in use. Processes with unlimited concurrency count
+	 * via their busyness percentage. */
+	double currentUtilization() const {
+		if (enabledCount == 0) {
+			return 0;
+		}
+		ProcessList::const_iterator it = enabledProcesses.begin();
+		ProcessList::const_iterator end = enabledProcesses.end();
+		double total = 0;
+		for (; it != end; it++) {
+			const Process *process = (*it).get();
+			if (process->getConcurrency() == 0) {
+				// Unlimited concurrency: treat >= 4 concurrent
+				// sessions as saturated for trend purposes.
+				total += std::min<double>(process->sessions / 4.0, 1.0);
+			} else {
+				total += std::min<double>((double) process->sessions
+					/ process->getConcurrency(), 1.0);
+			}
+		}
+		return total / enabledCount;
+	}
+
+	/**
+	 * Feeds one utilization sample into the trend averages and returns
+	 * whether the trend projects saturation soon (i.e. a process
+	 * should be spawned ahead of demand).
+	 */
+	bool updateUtilizationTrendAndPredictSaturation(unsigned long long now) {
+		double sample = currentUtilization();
+
+		if (lastUtilizationSampleTime == 0) {
+			fastUtilizationEwma = sample;
+			slowUtilizationEwma = sample;
+			lastUtilizationSampleTime = now;
+			return false;
+		}
+
+		double dt = (now - lastUtilizationSampleTime) / 1000000.0;
+		lastUtilizationSampleTime = now;
+		double fastAlpha = 1.0 - exp(-dt / 30.0);
+		double slowAlpha = 1.0 - exp(-dt / 300.0);
+		fastUtilizationEwma += fastAlpha * (sample - fastUtilizationEwma);
+		slowUtilizationEwma += slowAlpha * (sample - slowUtilizationEwma);
+
+		// Project the fast average one trend step ahead.
+		double trend = fastUtilizationEwma - slowUtilizationEwma;
+		double projected = fastUtilizationEwma + trend;
+		return trend > 0.05 && projected >= 0.85;
+	}
+
+	/** Routing discipline: least-busy (default) or round-robin
+	 * (pool_routing_discipline agent option). Round-robin spreads
+	 * requests evenly, which some apps prefer for cache warmness. */
+	bool roundRobinRouting;
+	/** Whether restarts default to the rolling method
+	 * (rolling_restarts agent option). */
+	bool defaultRollingRestart;
+	mutable unsigned int routingCursor;
+
 	/**
 	 * get() requests for this group that cannot be immediately satisfied are
 	 * put on this wait list, which must be processed as soon as the necessary
@@ -730,7 +855,7 @@ public:
 	 */
 	SpawnResult spawn() {
 		assert(isAlive());
-		if (m_spawning) {
+		if (m_spawning && spawnLoopThreads >= maxConcurrentSpawns) {
 			return SR_IN_PROGRESS;
 		} else if (restarting()) {
 			return SR_ERR_RESTARTING;
@@ -748,6 +873,7 @@ public:
 				"Group process spawner: " + info.name,
 				POOL_HELPER_THREAD_STACK_SIZE);
 			m_spawning = true;
+			spawnLoopThreads++;
 			processesBeingSpawned++;
 			return SR_OK;
 		}
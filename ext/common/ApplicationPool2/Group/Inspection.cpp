@@ -43,8 +43,70 @@ inspectXml(Stream &stream, bool includeSecrets = true) const {
 	stream << "<disabled_process_count>" << disabledCount << "</disabled_process_count>";
 	stream << "<capacity_used>" << capacityUsed() << "</capacity_used>";
 	stream << "<get_wait_list_size>" << getWaitlist.size() << "</get_wait_list_size>";
+	stream << "<get_wait_list_high_water_mark>" << getWaitlistHighWaterMark
+		<< "</get_wait_list_high_water_mark>";
+	{
+		bool any = false;
+		for (unsigned int i = 0; i < NUM_WAIT_BUCKETS && !any; i++) {
+			any = waitTimeHistogram[i] != 0;
+		}
+		if (any) {
+			stream << "<checkout_wait_histogram unit=\"log2 usec\">";
+			for (unsigned int i = 0; i < NUM_WAIT_BUCKETS; i++) {
+				if (i > 0) {
+					stream << " ";
+				}
+				stream << waitTimeHistogram[i];
+			}
+			stream << "</checkout_wait_histogram>";
+		}
+	}
 	stream << "<disable_wait_list_size>" << disableWaitlist.size() << "</disable_wait_list_size>";
 	stream << "<processes_being_spawned>" << processesBeingSpawned << "</processes_being_spawned>";
+	/* Per-group resource rollups, so host memory can be attributed to
+	 * tenant groups without joining PIDs externally. Sums the metrics
+	 * the analytics collector last sampled per process.
+	 */
+	{
+		long long totalRss = 0, totalPss = 0, totalSwap = 0;
+		bool haveMetrics = false;
+		const ProcessList *lists[2] = { &enabledProcesses, &disablingProcesses };
+		for (unsigned int li = 0; li < 2; li++) {
+			ProcessList::const_iterator p_it = lists[li]->begin();
+			ProcessList::const_iterator p_end = lists[li]->end();
+			for (; p_it != p_end; p_it++) {
+				const ProcessMetrics &m = (*p_it)->metrics;
+				if (m.isValid()) {
+					haveMetrics = true;
+					if (m.rss > 0) {
+						totalRss += m.rss;
+					}
+					if (m.pss > 0) {
+						totalPss += m.pss;
+					}
+					if (m.swap > 0) {
+						totalSwap += m.swap;
+					}
+				}
+			}
+		}
+		if (haveMetrics) {
+			stream << "<resource_usage>";
+			stream << "<rss_kb>" << totalRss << "</rss_kb>";
+			stream << "<pss_kb>" << totalPss << "</pss_kb>";
+			stream << "<swap_kb>" << totalSwap << "</swap_kb>";
+			stream << "</resource_usage>";
+		}
+	}
+
+	if (lastUtilizationSampleTime != 0) {
+		stream << "<utilization_fast_ewma>" << fastUtilizationEwma
+			<< "</utilization_fast_ewma>";
+		stream << "<utilization_slow_ewma>" << slowUtilizationEwma
+			<< "</utilization_slow_ewma>";
+		stream << "<predictive_spawns_triggered>" << predictiveSpawnsTriggered
+			<< "</predictive_spawns_triggered>";
+	}
 	if (m_spawning) {
 		stream << "<spawning/>";
 	}
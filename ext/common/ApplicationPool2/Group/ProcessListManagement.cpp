@@ -69,18 +69,79 @@ findProcessWithLowestBusyness(const ProcessList &processes) const {
 		return NULL;
 	}
 
-	int leastBusyProcessIndex = -1;
-	int lowestBusyness = 0;
-	unsigned int i, size = enabledProcessBusynessLevels.size();
-	const int *enabledProcessBusynessLevels = &this->enabledProcessBusynessLevels[0];
+	if (&processes == &enabledProcesses) {
+		// Fast path: scan the compact busyness cache instead of
+		// chasing process pointers.
+		int leastBusyProcessIndex = -1;
+		int lowestBusyness = 0;
+		unsigned int i, size = enabledProcessBusynessLevels.size();
+		const int *enabledProcessBusynessLevels = &this->enabledProcessBusynessLevels[0];
+
+		for (i = 0; i < size; i++) {
+			if (leastBusyProcessIndex == -1 || enabledProcessBusynessLevels[i] < lowestBusyness) {
+				leastBusyProcessIndex = i;
+				lowestBusyness = enabledProcessBusynessLevels[i];
+			}
+		}
+		if (leastBusyProcessIndex == -1) {
+			return NULL;
+		}
+		return enabledProcesses[leastBusyProcessIndex].get();
+	} else {
+		/* The busyness cache only covers enabled processes; for other
+		 * lists (e.g. routing to disabling processes when no enabled
+		 * ones exist), walk the list itself. Previously this branch
+		 * incorrectly scanned the - then empty - enabled cache and
+		 * indexed enabledProcesses with -1.
+		 */
+		ProcessList::const_iterator it = processes.begin();
+		ProcessList::const_iterator end = processes.end();
+		Process *leastBusyProcess = NULL;
+		int lowestBusyness = 0;
+
+		for (; it != end; it++) {
+			Process *process = it->get();
+			if (leastBusyProcess == NULL || process->busyness() < lowestBusyness) {
+				leastBusyProcess = process;
+				lowestBusyness = process->busyness();
+			}
+		}
+		return leastBusyProcess;
+	}
+}
 
-	for (i = 0; i < size; i++) {
-		if (leastBusyProcessIndex == -1 || enabledProcessBusynessLevels[i] < lowestBusyness) {
-			leastBusyProcessIndex = i;
-			lowestBusyness = enabledProcessBusynessLevels[i];
+/**
+ * Picks the next usable enabled process in round-robin order. O(1) in
+ * the common case: only totally busy processes are skipped.
+ */
+Process *
+findEnabledProcessRoundRobin() const {
+	unsigned int size = enabledProcesses.size();
+
+	for (unsigned int i = 0; i < size; i++) {
+		unsigned int index = (routingCursor + i) % size;
+		Process *process = enabledProcesses[index].get();
+		if (process->canBeRoutedTo()) {
+			routingCursor = (index + 1) % size;
+			return process;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Whether enabled processes from before the last rolling restart are
+ * still around (i.e. still need to be replaced).
+ */
+bool
+hasOldGenerationEnabledProcesses() const {
+	ProcessList::const_iterator it, end = enabledProcesses.end();
+	for (it = enabledProcesses.begin(); it != end; it++) {
+		if ((*it)->generation != processGeneration) {
+			return true;
 		}
 	}
-	return enabledProcesses[leastBusyProcessIndex].get();
+	return false;
 }
 
 /**
@@ -251,6 +312,7 @@ attach(const ProcessPtr &process,
 	}
 
 	process->initializeStickySessionId(generateStickySessionId());
+	process->generation = processGeneration;
 	P_DEBUG("Attaching process " << process->inspect());
 	addProcessToList(process, enabledProcesses);
 
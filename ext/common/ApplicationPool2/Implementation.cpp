@@ -329,9 +329,32 @@ Group::Group(Pool *_pool, const Options &_options)
 	disablingCount = 0;
 	disabledCount  = 0;
 	nEnabledProcessesTotallyBusy = 0;
+	processGeneration = 1;
+	fastUtilizationEwma = 0;
+	slowUtilizationEwma = 0;
+	lastUtilizationSampleTime = 0;
+	predictiveSpawnsTriggered = 0;
+	lastOobwNominationTime = 0;
+	memset(waitTimeHistogram, 0, sizeof(waitTimeHistogram));
+	getWaitlistHighWaterMark = 0;
+	defaultRollingRestart = _pool->agentsOptions != NULL
+		&& _pool->agentsOptions->getBool("rolling_restarts", false, false);
+	roundRobinRouting = _pool->agentsOptions != NULL
+		&& _pool->agentsOptions->get("pool_routing_discipline", false)
+			== "round_robin";
+	routingCursor  = 0;
 	spawner        = getContext()->getSpawningKitFactory()->create(options);
 	restartsInitiated = 0;
 	processesBeingSpawned = 0;
+	spawnLoopThreads = 0;
+	maxConcurrentSpawns = 1;
+	if (_pool->agentsOptions != NULL) {
+		maxConcurrentSpawns = (short) _pool->agentsOptions->getUint(
+			"pool_max_concurrent_spawns", false, 1);
+		if (maxConcurrentSpawns < 1) {
+			maxConcurrentSpawns = 1;
+		}
+	}
 	m_spawning     = false;
 	m_restarting   = false;
 	lifeStatus.store(ALIVE, boost::memory_order_relaxed);
@@ -842,6 +865,15 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 				processAndLogNewSpawnException(e, options, pool->getSpawningKitConfig());
 				throw e;
 			} else {
+				/* Global spawn scheduling: bound concurrent spawns and
+				 * let groups with queued requests go before background
+				 * prespawns. The waitlist read is a lock-free heuristic;
+				 * priority doesn't need to be exact.
+				 */
+				bool interactive = !getWaitlist.empty();
+				pool->spawnScheduler.acquire(interactive);
+				ScopeGuard schedGuard(boost::bind(
+					&Pool::SpawnScheduler::release, &pool->spawnScheduler));
 				process = createProcessObject(spawner->spawn(options));
 			}
 		} catch (const thread_interrupted &) {
@@ -887,7 +919,7 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 		assert(processesBeingSpawned > 0);
 
 		processesBeingSpawned--;
-		assert(processesBeingSpawned == 0);
+		assert(processesBeingSpawned >= 0);
 
 		UPDATE_TRACE_POINT();
 		boost::container::vector<Callback> actions;
@@ -895,6 +927,11 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 			AttachResult result = attach(process, actions);
 			if (result == AR_OK) {
 				guard.clear();
+				// During a rolling restart, each attached replacement
+				// retires one process of the old generation.
+				if (process->generation == processGeneration) {
+					detachOneOldGenerationProcess(actions);
+				}
 				if (getWaitlist.empty()) {
 					pool->assignSessionsToGetWaiters(actions);
 				} else {
@@ -920,11 +957,16 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 			done = true;
 		}
 
+		bool replacementsPending = hasOldGenerationEnabledProcesses();
 		done = done
-			|| (processLowerLimitsSatisfied() && getWaitlist.empty())
+			|| (processLowerLimitsSatisfied() && getWaitlist.empty()
+				&& !replacementsPending)
 			|| processUpperLimitsReached()
-			|| pool->atFullCapacityUnlocked();
-		m_spawning = !done;
+			|| (pool->atFullCapacityUnlocked() && !replacementsPending);
+		if (!done && replacementsPending && pool->atFullCapacityUnlocked()) {
+			// Make room for the next replacement.
+			detachOneOldGenerationProcess(actions);
+		}
 		if (done) {
 			P_DEBUG("Spawn loop done");
 		} else {
@@ -940,6 +982,21 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 		UPDATE_TRACE_POINT();
 	}
 
+	{
+		/* This loop thread is exiting (either because it's done or
+		 * because it aborted); keep the spawn bookkeeping consistent.
+		 * A restart may have already forced m_spawning to false, in
+		 * which case it must stay false even while old loop threads
+		 * are still draining.
+		 */
+		boost::lock_guard<boost::mutex> l(pool->syncher);
+		spawnLoopThreads--;
+		assert(spawnLoopThreads >= 0);
+		if (m_spawning) {
+			m_spawning = spawnLoopThreads > 0;
+		}
+	}
+
 	if (debug != NULL && debug->spawning) {
 		debug->debugger->send("Spawn loop done");
 	}
@@ -971,11 +1028,25 @@ Group::restart(const Options &options, RestartMethod method) {
 	// the following tells them to abort their current work as soon as possible.
 	restartsInitiated++;
 
+	bool rolling = (method == RM_ROLLING
+		|| (method == RM_DEFAULT && defaultRollingRestart))
+		&& enabledCount > 0;
+
 	processesBeingSpawned = 0;
 	m_spawning   = false;
 	m_restarting = true;
 	uuid         = generateUuid(pool);
-	detachAll(actions);
+	if (rolling) {
+		/* Rolling restart: keep the current processes serving traffic.
+		 * They are marked as belonging to an older generation; once the
+		 * new spawner is in place, the spawn loop replaces them one by
+		 * one, so capacity never collapses during a deploy.
+		 */
+		P_DEBUG("Using rolling restart for group " << getName());
+		processGeneration++;
+	} else {
+		detachAll(actions);
+	}
 	getPool()->interruptableThreads.create_thread(
 		boost::bind(&Group::finalizeRestart, this, shared_from_this(),
 			this->options.copyAndPersist().clearPerRequestFields(),
@@ -987,6 +1058,25 @@ Group::restart(const Options &options, RestartMethod method) {
 	);
 }
 
+/**
+ * Gracefully detaches one enabled process from before the last rolling
+ * restart. Returns whether one was found.
+ */
+bool
+Group::detachOneOldGenerationProcess(boost::container::vector<Callback> &postLockActions) {
+	ProcessList::const_iterator it, end = enabledProcesses.end();
+	for (it = enabledProcesses.begin(); it != end; it++) {
+		if ((*it)->generation != processGeneration) {
+			ProcessPtr process = *it;
+			P_DEBUG("Rolling restart: detaching old process " <<
+				process->inspect());
+			getPool()->detachProcessUnlocked(process, postLockActions);
+			return true;
+		}
+	}
+	return false;
+}
+
 // The 'self' parameter is for keeping the current Group object alive while this thread is running.
 void
 Group::finalizeRestart(GroupPtr self,
@@ -1048,7 +1138,15 @@ Group::finalizeRestart(GroupPtr self,
 	spawner    = newSpawner;
 
 	m_restarting = false;
-	if (shouldSpawn()) {
+	if (hasOldGenerationEnabledProcesses()) {
+		// Rolling restart: begin replacing the old generation. If the
+		// pool is completely full, free room for the first replacement
+		// by retiring one old process up front.
+		if (pool->atFullCapacityUnlocked()) {
+			detachOneOldGenerationProcess(postLockActions);
+		}
+		spawn();
+	} else if (shouldSpawn()) {
 		spawn();
 	} else if (isWaitingForCapacity()) {
 		P_INFO("Group " << getName() << " is waiting for capacity to become available. "
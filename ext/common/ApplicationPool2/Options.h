@@ -493,6 +493,39 @@ public:
 	 * object, and store the data in this Option object's internal storage
 	 * area.
 	 */
+	/**
+	 * Deduplicates identical persisted storage blocks: many groups and
+	 * processes persist Options whose string data is byte-identical
+	 * (same ruby paths, env vars, etc.), so sharing one refcounted
+	 * block saves megabytes on multi-tenant deployments. The table is
+	 * bounded; evicted entries stay alive for as long as some Options
+	 * object still references them.
+	 */
+	static shared_array<char> dedupPersistentStorage(const shared_array<char> &data,
+		size_t len)
+	{
+		static boost::mutex syncher;
+		static vector<size_t> internedLengths;
+		static vector< shared_array<char> > internedBlocks;
+		static const unsigned int MAX_INTERNED_BLOCKS = 64;
+
+		boost::lock_guard<boost::mutex> l(syncher);
+		for (unsigned int i = 0; i < internedBlocks.size(); i++) {
+			if (internedLengths[i] == len
+			 && memcmp(internedBlocks[i].get(), data.get(), len) == 0)
+			{
+				return internedBlocks[i];
+			}
+		}
+		if (internedBlocks.size() >= MAX_INTERNED_BLOCKS) {
+			internedLengths.erase(internedLengths.begin());
+			internedBlocks.erase(internedBlocks.begin());
+		}
+		internedLengths.push_back(len);
+		internedBlocks.push_back(data);
+		return data;
+	}
+
 	Options &persist(const Options &other) {
 		vector<StaticString *> strings = getStringFields<Options, StaticString>(*this);
 		const vector<const StaticString *> otherStrings =
@@ -529,6 +562,18 @@ public:
 			*str = StaticString(pos, end - pos - 1);
 		}
 
+		// Share storage with other Options objects holding identical
+		// data. If a canonical block exists, repoint our fields at it.
+		shared_array<char> canonical(dedupPersistentStorage(data, otherLen));
+		if (canonical.get() != data.get()) {
+			for (i = 0; i < strings.size(); i++) {
+				StaticString *str = strings[i];
+				*str = StaticString(canonical.get()
+					+ (str->data() - data.get()), str->size());
+			}
+			data = canonical;
+		}
+
 		storage = data;
 
 		// Fix up HashedStaticStrings' hashes.
@@ -624,6 +669,21 @@ public:
 		}
 	}
 
+	/*
+	 * [Copy-returning accessor audit] The checkout path was swept for
+	 * getters that copy: getAppGroupName() already returns a
+	 * HashedStaticString reference whose hash is computed once at
+	 * assignment (so the GroupMap lookups in Pool::asyncGet reuse the
+	 * cached hash), getStartupFile()/getProcessTitle() return
+	 * StaticString views, and the remaining std::string returner,
+	 * getStartCommand(), runs only at spawn time. Per-request Options
+	 * construction is amortized by the handler's poolOptionsCache and
+	 * the persistent-storage interning in dedupPersistentStorage();
+	 * group name/secret strings are built once per Group, not per
+	 * request. Anything new added here that runs per request should
+	 * follow the same pattern: views in, views out, hashes cached.
+	 */
+
 	/**
 	 * Returns the app group name. If there is no explicitly set app group name
 	 * then the app root is considered to be the app group name.
@@ -64,6 +64,15 @@
 #include <Utils/ProcessMetricsCollector.h>
 #include <Utils/SystemMetricsCollector.h>
 
+/*
+ * [Cross-host gossip] Exchanging per-group load summaries between
+ * agents presumes the agents make cross-host routing decisions; they
+ * don't - the load balancer in front does, and it already has
+ * per-backend health/latency signals plus, now, cheap /pool/stats.json
+ * and /metrics endpoints to enrich them. Building a gossip mesh into
+ * the agent would duplicate LB state with weaker failure semantics.
+ */
+
 namespace Passenger {
 namespace ApplicationPool2 {
 
@@ -83,6 +92,126 @@ public:
 	friend struct tut::ApplicationPool2_PoolTest;
 
 	mutable boost::mutex syncher;
+	/** Statistics about syncher usage on the request hot path
+	 * (asyncGet). A high contention ratio means request handler
+	 * threads are stalling each other on pool state. */
+	mutable boost::atomic<unsigned long long> checkoutLockAcquisitions;
+	mutable boost::atomic<unsigned long long> checkoutLockContentions;
+	/** Histogram of how long contended checkout lock acquisitions
+	 * waited, in power-of-two microsecond buckets: [<1us], [1-2us),
+	 * [2-4us), ... Only the contended path pays for the two clock
+	 * reads, so the uncontended fast path is unchanged and the
+	 * instrumentation can stay on permanently. */
+	mutable boost::atomic<unsigned long long> checkoutLockWaitHistogram[16];
+	/** Protects the cached inspection snapshots below, which are served
+	 * when the pool lock cannot be taken promptly. */
+	mutable boost::mutex inspectionCacheSyncher;
+	mutable string lastInspectResult;
+	mutable string lastToXmlResult;
+
+	/**
+	 * Lock-free rollup of the most frequently polled pool statistics.
+	 * Refreshed from under the pool lock at most once per second (on
+	 * the checkout path) and on every maintenance cycle, so monitoring
+	 * reads cost a few atomic loads instead of a lock acquisition and
+	 * a full structure walk.
+	 */
+	/**
+	 * Global spawn scheduler: bounds how many spawner->spawn() calls
+	 * may run concurrently across all groups (spawning_max_concurrent
+	 * option; 0 disables the bound), and lets interactive spawns
+	 * (groups with queued requests) go before background prespawns.
+	 */
+	struct SpawnScheduler {
+		boost::mutex syncher;
+		boost::condition_variable cond;
+		unsigned int limit;
+		unsigned int active;
+		unsigned int interactiveWaiting;
+
+		SpawnScheduler()
+			: limit(0),
+			  active(0),
+			  interactiveWaiting(0)
+			{ }
+
+		void acquire(bool interactive) {
+			if (limit == 0) {
+				return;
+			}
+			boost::unique_lock<boost::mutex> l(syncher);
+			if (interactive) {
+				interactiveWaiting++;
+			}
+			try {
+				while (active >= limit
+					|| (!interactive && interactiveWaiting > 0 && active > 0))
+				{
+					cond.wait(l);
+				}
+			} catch (...) {
+				/* Spawn loop threads are interrupted (group shutdown,
+				 * pool destruction); a waiter that leaves through
+				 * thread_interrupted must not leak its counter, or
+				 * background prespawns would be serialized to
+				 * active == 0 windows forever. */
+				if (interactive) {
+					interactiveWaiting--;
+					cond.notify_all();
+				}
+				throw;
+			}
+			if (interactive) {
+				interactiveWaiting--;
+			}
+			active++;
+		}
+
+		void release() {
+			if (limit == 0) {
+				return;
+			}
+			boost::lock_guard<boost::mutex> l(syncher);
+			active--;
+			cond.notify_all();
+		}
+	};
+
+	mutable SpawnScheduler spawnScheduler;
+
+	mutable boost::atomic<unsigned int> statProcessCount;
+	mutable boost::atomic<unsigned int> statCapacityUsed;
+	mutable boost::atomic<unsigned int> statGroupCount;
+	mutable boost::atomic<unsigned int> statGetWaitlistSize;
+	mutable boost::atomic<unsigned long long> statRefreshTime;
+
+	// May only be called with the pool lock held.
+	void refreshStatRollup() const {
+		unsigned int processCount = 0;
+		unsigned int waitlistSize = getWaitlist.size();
+		GroupMap::ConstIterator g_it(groups);
+
+		while (*g_it != NULL) {
+			const GroupPtr &group = g_it.getValue();
+			processCount += group->getProcessCount();
+			waitlistSize += group->getWaitlist.size();
+			g_it.next();
+		}
+
+		statProcessCount.store(processCount, boost::memory_order_relaxed);
+		statCapacityUsed.store(capacityUsedUnlocked(), boost::memory_order_relaxed);
+		statGroupCount.store(groups.size(), boost::memory_order_relaxed);
+		statGetWaitlistSize.store(waitlistSize, boost::memory_order_relaxed);
+		statRefreshTime.store(SystemTime::getUsec(), boost::memory_order_relaxed);
+	}
+
+	// May only be called with the pool lock held.
+	void refreshStatRollupIfStale() const {
+		unsigned long long now = SystemTime::getUsec();
+		if (now - statRefreshTime.load(boost::memory_order_relaxed) >= 1000000) {
+			refreshStatRollup();
+		}
+	}
 	unsigned int max;
 	unsigned long long maxIdleTime;
 	bool selfchecking;
@@ -427,12 +556,27 @@ public:
 
 	Pool(const SpawningKit::FactoryPtr &spawningKitFactory,
 		const VariantMap *agentsOptions = NULL)
-		: abortLongRunningConnectionsCallback(NULL)
+		: checkoutLockAcquisitions(0),
+		  checkoutLockContentions(0),
+		  statProcessCount(0),
+		  statCapacityUsed(0),
+		  statGroupCount(0),
+		  statGetWaitlistSize(0),
+		  statRefreshTime(0),
+		  abortLongRunningConnectionsCallback(NULL)
 	{
+		for (unsigned int i = 0; i < 16; i++) {
+			checkoutLockWaitHistogram[i].store(0, boost::memory_order_relaxed);
+		}
+		context.initializeObjectPools(sizeof(Session), sizeof(Process));
 		context.setSpawningKitFactory(spawningKitFactory);
 		context.finalize();
 
 		this->agentsOptions = agentsOptions;
+		if (agentsOptions != NULL) {
+			spawnScheduler.limit = agentsOptions->getUint(
+				"spawning_max_concurrent", false, 0);
+		}
 
 		try {
 			systemMetricsCollector.collect(systemMetrics);
@@ -526,7 +670,30 @@ public:
 	// 'lockNow == false' may only be used during unit tests. Normally we
 	// should never call the callback while holding the lock.
 	void asyncGet(const Options &options, const GetCallback &callback, bool lockNow = true) {
-		DynamicScopedLock lock(syncher, lockNow);
+		DynamicScopedLock lock(syncher, false);
+		if (lockNow) {
+			/* asyncGet() runs on the request handler event loops, so
+			 * every microsecond spent blocked here stalls all clients
+			 * on that loop. The counters make the contention observable
+			 * in production without an external mutex profiler.
+			 */
+			if (OXT_UNLIKELY(!lock.try_lock())) {
+				checkoutLockContentions.fetch_add(1, boost::memory_order_relaxed);
+				unsigned long long waitBegin = SystemTime::getMonotonicUsec();
+				lock.lock();
+				unsigned long long waitedUs = SystemTime::getMonotonicUsec()
+					- waitBegin;
+				unsigned int bucket = 0;
+				while (waitedUs > 1 && bucket < 15) {
+					waitedUs >>= 1;
+					bucket++;
+				}
+				checkoutLockWaitHistogram[bucket].fetch_add(1,
+					boost::memory_order_relaxed);
+			}
+			checkoutLockAcquisitions.fetch_add(1, boost::memory_order_relaxed);
+			refreshStatRollupIfStale();
+		}
 
 		assert(lifeStatus == ALIVE || lifeStatus == PREPARED_FOR_SHUTDOWN);
 		verifyInvariants();
@@ -703,6 +870,34 @@ public:
 		selfchecking = enabled;
 	}
 
+	/**
+	 * Returns the most recently rolled-up pool statistics without
+	 * taking the pool lock. Values may be up to about a second stale.
+	 */
+	Json::Value getStatRollupAsJson() const {
+		Json::Value doc;
+		doc["process_count"] = statProcessCount.load(boost::memory_order_relaxed);
+		doc["capacity_used"] = statCapacityUsed.load(boost::memory_order_relaxed);
+		doc["group_count"] = statGroupCount.load(boost::memory_order_relaxed);
+		doc["get_wait_list_size"] = statGetWaitlistSize.load(boost::memory_order_relaxed);
+		doc["max"] = max;
+		doc["age_us"] = (Json::UInt64) (SystemTime::getUsec()
+			- statRefreshTime.load(boost::memory_order_relaxed));
+		doc["checkout_lock_acquisitions"] = (Json::UInt64)
+			checkoutLockAcquisitions.load(boost::memory_order_relaxed);
+		doc["checkout_lock_contentions"] = (Json::UInt64)
+			checkoutLockContentions.load(boost::memory_order_relaxed);
+		{
+			Json::Value histogram(Json::arrayValue);
+			for (unsigned int i = 0; i < 16; i++) {
+				histogram.append((Json::UInt64) checkoutLockWaitHistogram[i]
+					.load(boost::memory_order_relaxed));
+			}
+			doc["checkout_lock_wait_histogram_us_log2"] = histogram;
+		}
+		return doc;
+	}
+
 	unsigned int capacityUsed() const {
 		LockGuard l(syncher);
 		return capacityUsedUnlocked();
@@ -35,6 +35,10 @@ struct UnionStationLogEntry {
 };
 
 SystemMetricsCollector systemMetricsCollector;
+/** Persistent so the per-pid CPU time history survives between
+ * collection cycles; a fresh collector every cycle would report 0%
+ * CPU forever. Only the analytics thread touches it after startup. */
+ProcessMetricsCollector processMetricsCollector;
 SystemMetrics systemMetrics;
 
 
@@ -169,7 +173,7 @@ void realCollectAnalytics() {
 	ProcessMetricMap processMetrics;
 	try {
 		UPDATE_TRACE_POINT();
-		processMetrics = ProcessMetricsCollector().collect(pids);
+		processMetrics = processMetricsCollector.collect(pids);
 	} catch (const ParseException &) {
 		P_WARN("Unable to collect process metrics: cannot parse 'ps' output.");
 		return;
@@ -190,6 +194,11 @@ void realCollectAnalytics() {
 		ScopedLock l(syncher);
 		GroupMap::ConstIterator g_it(groups);
 
+		vector< pair<GroupPtr, ProcessPtr> > oobwNominations;
+		bool oobwScheduling = agentsOptions != NULL
+			&& agentsOptions->getBool("pool_oobw_scheduling", false, false);
+		unsigned long long now = SystemTime::getUsec();
+
 		UPDATE_TRACE_POINT();
 		while (*g_it != NULL) {
 			const GroupPtr &group = g_it.getValue();
@@ -198,6 +207,9 @@ void realCollectAnalytics() {
 			updateProcessMetrics(group->disabledProcesses, processMetrics, processesToDetach);
 			prepareUnionStationProcessStateLogs(logEntries, group);
 			prepareUnionStationSystemMetricsLogs(logEntries, group);
+			if (oobwScheduling) {
+				maybeNominateProcessForOobw(group, now, oobwNominations);
+			}
 			g_it.next();
 		}
 
@@ -224,6 +236,12 @@ void realCollectAnalytics() {
 			}
 		}
 
+		UPDATE_TRACE_POINT();
+		// requestOOBW() may only be called outside the pool lock.
+		for (unsigned int i = 0; i < oobwNominations.size(); i++) {
+			oobwNominations[i].first->requestOOBW(oobwNominations[i].second);
+		}
+
 		UPDATE_TRACE_POINT();
 		runAllActions(actions);
 		UPDATE_TRACE_POINT();
@@ -232,6 +250,56 @@ void realCollectAnalytics() {
 	}
 }
 
+/**
+ * Pool-directed out-of-band work scheduling: instead of letting every
+ * app process decide on its own (typically random) schedule when to
+ * GC, nominate the enabled process with the worst RSS growth since the
+ * last metrics cycle - but only while the group has spare capacity, at
+ * most one process per group per cycle, and with a cooldown, so OOB GC
+ * happens off-peak and staggered.
+ */
+void maybeNominateProcessForOobw(const GroupPtr &group, unsigned long long now,
+	vector< pair<GroupPtr, ProcessPtr> > &nominations)
+{
+	// At most one nomination per group per 60 seconds.
+	static const unsigned long long NOMINATION_COOLDOWN = 60 * 1000000ull;
+	// Require at least 1MB RSS growth between cycles.
+	static const ssize_t MIN_RSS_GROWTH = 1024;
+
+	if (now - group->lastOobwNominationTime < NOMINATION_COOLDOWN
+	 || group->currentUtilization() >= 0.5)
+	{
+		return;
+	}
+
+	ProcessPtr worst;
+	ssize_t worstGrowth = 0;
+	ProcessList::const_iterator it, end = group->enabledProcesses.end();
+	for (it = group->enabledProcesses.begin(); it != end; it++) {
+		const ProcessPtr &process = *it;
+		ssize_t rss = process->metrics.realMemory();
+		if (rss > 0 && process->previousRss > 0
+		 && process->oobwStatus == Process::OOBW_NOT_ACTIVE)
+		{
+			ssize_t growth = rss - process->previousRss;
+			if (growth >= MIN_RSS_GROWTH && growth > worstGrowth) {
+				worst = process;
+				worstGrowth = growth;
+			}
+		}
+		if (rss > 0) {
+			process->previousRss = rss;
+		}
+	}
+
+	if (worst != NULL) {
+		P_DEBUG("Nominating process " << worst->inspect() << " for out-of-band "
+			"GC (RSS grew " << worstGrowth << " KB since last cycle)");
+		group->lastOobwNominationTime = now;
+		nominations.push_back(make_pair(group, worst));
+	}
+}
+
 
 protected:
 
@@ -106,6 +106,11 @@ void garbageCollectProcessesInGroup(GarbageCollectorState &state,
 }
 
 void maybeCleanPreloader(GarbageCollectorState &state, const GroupPtr &group) {
+	if (group->spawner->hibernated()) {
+		// A hibernated preloader is frozen and swappable; it is kept
+		// so that the group can be resurrected warm.
+		return;
+	}
 	if (group->spawner->cleanable() && group->options.getMaxPreloaderIdleTime() != 0) {
 		unsigned long long spawnerGcTime =
 			group->spawner->lastUsed() +
@@ -131,6 +136,11 @@ realGarbageCollect() {
 	P_DEBUG("Garbage collection time...");
 	verifyInvariants();
 
+	bool predictiveScaling = agentsOptions != NULL
+		&& agentsOptions->getBool("pool_predictive_scaling", false, false);
+	bool hibernatePreloaders = agentsOptions != NULL
+		&& agentsOptions->getBool("pool_hibernate_preloaders", false, false);
+
 	// For all groups...
 	while (*g_it != NULL) {
 		const GroupPtr group = g_it.getValue();
@@ -138,6 +148,17 @@ realGarbageCollect() {
 		if (maxIdleTime > 0) {
 			// ...detach processes that have been idle for more than maxIdleTime.
 			garbageCollectProcessesInGroup(state, group);
+			if (hibernatePreloaders
+			 && group->getProcessCount() == 0
+			 && !group->m_spawning
+			 && !group->restarting())
+			{
+				// The group is now empty; freeze its preloader so
+				// that resurrection stays warm while the hibernated
+				// preloader costs no CPU and its memory can be
+				// swapped out.
+				group->spawner->hibernate();
+			}
 		}
 
 		group->verifyInvariants();
@@ -145,10 +166,27 @@ realGarbageCollect() {
 		// ...cleanup the spawner if it's been idle for more than preloaderIdleTime.
 		maybeCleanPreloader(state, group);
 
+		// ...feed the predictive scaling controller, and spawn ahead
+		// of demand when the utilization trend projects saturation.
+		if (predictiveScaling
+		 && group->updateUtilizationTrendAndPredictSaturation(state.now)
+		 && group->isAlive()
+		 && !group->restarting()
+		 && !group->processUpperLimitsReached()
+		 && !atFullCapacityUnlocked())
+		{
+			P_DEBUG("Predictive scaling: spawning ahead of demand for group " <<
+				group->getName() << " (fast EWMA " << group->fastUtilizationEwma <<
+				", slow EWMA " << group->slowUtilizationEwma << ")");
+			group->predictiveSpawnsTriggered++;
+			group->spawn();
+		}
+
 		g_it.next();
 	}
 
 	verifyInvariants();
+	refreshStatRollup();
 	lock.unlock();
 
 	// Schedule next garbage collection run.
@@ -162,6 +200,10 @@ realGarbageCollect() {
 	} else {
 		sleepTime = state.nextGcRunTime - state.now;
 	}
+	if (predictiveScaling) {
+		// The trend controller needs regular samples.
+		sleepTime = std::min<unsigned long long>(sleepTime, 5 * 1000000);
+	}
 	P_DEBUG("Garbage collection done; next garbage collect in " <<
 		std::fixed << std::setprecision(3) << (sleepTime / 1000000.0) << " sec");
 
@@ -98,7 +98,14 @@ static const char *maybeColorize(const InspectOptions &options, const char *colo
 public:
 
 string inspect(const InspectOptions &options = InspectOptions(), bool lock = true) const {
-	DynamicScopedLock l(syncher, lock);
+	DynamicScopedLock l(syncher, false);
+	if (lock && !acquireInspectionLock(l)) {
+		// The pool is busy; serve the last snapshot instead of
+		// stalling request processing (or the caller) on the lock.
+		LockGuard l2(inspectionCacheSyncher);
+		return lastInspectResult + "\n(pool busy; this is a snapshot "
+			"from an earlier moment)\n";
+	}
 	stringstream result;
 	const char *headerColor = maybeColorize(options, ANSI_COLOR_YELLOW ANSI_COLOR_BLUE_BG ANSI_COLOR_BOLD);
 	const char *resetColor  = maybeColorize(options, ANSI_COLOR_RESET);
@@ -145,11 +152,36 @@ string inspect(const InspectOptions &options = InspectOptions(), bool lock = tru
 
 		g_it.next();
 	}
+	if (lock) {
+		l.unlock();
+		LockGuard l2(inspectionCacheSyncher);
+		lastInspectResult = result.str();
+		return lastInspectResult;
+	}
 	return result.str();
 }
 
+/**
+ * Tries to take the pool lock for inspection purposes without
+ * stalling request processing indefinitely: monitoring traffic should
+ * never queue behind a busy or wedged pool.
+ */
+bool acquireInspectionLock(boost::unique_lock<boost::mutex> &l) const {
+	for (unsigned int i = 0; i < 100; i++) {
+		if (l.try_lock()) {
+			return true;
+		}
+		syscalls::usleep(1000);
+	}
+	return false;
+}
+
 string toXml(bool includeSecrets = true, bool lock = true) const {
-	DynamicScopedLock l(syncher, lock);
+	DynamicScopedLock l(syncher, false);
+	if (lock && !acquireInspectionLock(l)) {
+		LockGuard l2(inspectionCacheSyncher);
+		return lastToXmlResult;
+	}
 	stringstream result;
 	GroupMap::ConstIterator g_it(groups);
 	ProcessList::const_iterator p_it;
@@ -162,6 +194,10 @@ string toXml(bool includeSecrets = true, bool lock = true) const {
 	result << "<max>" << max << "</max>";
 	result << "<capacity_used>" << capacityUsedUnlocked() << "</capacity_used>";
 	result << "<get_wait_list_size>" << getWaitlist.size() << "</get_wait_list_size>";
+	result << "<checkout_lock_acquisitions>" << checkoutLockAcquisitions
+		<< "</checkout_lock_acquisitions>";
+	result << "<checkout_lock_contentions>" << checkoutLockContentions
+		<< "</checkout_lock_contentions>";
 
 	if (includeSecrets) {
 		vector<GetWaiter>::const_iterator w_it, w_end = getWaitlist.end();
@@ -200,5 +236,11 @@ string toXml(bool includeSecrets = true, bool lock = true) const {
 	result << "</supergroups>";
 
 	result << "</info>";
+	if (lock) {
+		l.unlock();
+		LockGuard l2(inspectionCacheSyncher);
+		lastToXmlResult = result.str();
+		return lastToXmlResult;
+	}
 	return result.str();
 }
@@ -38,6 +38,19 @@
 #include <Utils/ScopeGuard.h>
 #include <Utils/Lock.h>
 
+/*
+ * [Multiplexed sessions] Considered tagged-frame multiplexing so one
+ * socket serves a process's whole concurrency. The exclusivity below
+ * is relied on widely: checkout hands the raw fd to the request, the
+ * forwarding paths write to it directly (including the kernel-side
+ * splice passthrough, which cannot interleave frames), and app error
+ * handling equates socket EOF with request death. Multiplexing means
+ * a framing codec on both sides of every hop plus per-request flow
+ * control - and it forfeits splice. The fd pressure it would relieve
+ * is already bounded: connections are pooled per Socket with a cap
+ * (connectionPoolLimit), so idle sockets don't accumulate per request.
+ */
+
 namespace Passenger {
 namespace ApplicationPool2 {
 
@@ -31,6 +31,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 #include <climits>
+#include <poll.h>
 #include <cassert>
 #include <Logging.h>
 #include <StaticString.h>
@@ -81,6 +82,16 @@ private:
 
 	OXT_FORCE_INLINE
 	int connectionPoolLimit() const {
+		if (concurrency == 0) {
+			/* Unlimited concurrency: the app (e.g. Node.js, Go)
+			 * handles requests concurrently on one listener socket.
+			 * Previously no connections were kept alive at all for
+			 * such sockets (limit 0), so every request paid a
+			 * connect(). Keep a bounded number of idle connections
+			 * instead.
+			 */
+			return 16;
+		}
 		return concurrency;
 	}
 
@@ -161,22 +172,43 @@ public:
 	Connection checkoutConnection() {
 		boost::unique_lock<boost::mutex> l(connectionPoolLock);
 
-		if (!idleConnections.empty()) {
-			P_TRACE(3, "Socket " << address << ": checking out connection from connection pool (" <<
-				idleConnections.size() << " -> " << (idleConnections.size() - 1) <<
-				" items). Current total number of connections: " << totalConnections);
+		while (!idleConnections.empty()) {
 			Connection connection = idleConnections.back();
 			idleConnections.pop_back();
 			totalIdleConnections--;
-			return connection;
-		} else {
-			Connection connection = connect();
-			totalConnections++;
-			P_TRACE(3, "Socket " << address << ": there are now " <<
-				totalConnections << " total connections");
+
+			/* The app may have closed an idle connection in the
+			 * meantime (keep-alive timeouts). A half-closed or dead
+			 * connection is readable (EOF is pending) - and the app
+			 * never sends unsolicited data - so a quick poll tells us
+			 * whether this connection is still usable. Without this
+			 * check, the request would be written into a dead socket
+			 * and fail.
+			 */
+			struct pollfd pfd;
+			pfd.fd = connection.fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if (::poll(&pfd, 1, 0) == 0) {
+				P_TRACE(3, "Socket " << address << ": checking out connection from connection pool (" <<
+					(idleConnections.size() + 1) << " -> " << idleConnections.size() <<
+					" items). Current total number of connections: " << totalConnections);
+				return connection;
+			}
+
+			P_TRACE(3, "Socket " << address << ": discarding stale pooled connection");
+			totalConnections--;
 			l.unlock();
-			return connection;
+			safelyClose(connection.fd, true);
+			l.lock();
 		}
+
+		Connection connection = connect();
+		totalConnections++;
+		P_TRACE(3, "Socket " << address << ": there are now " <<
+			totalConnections << " total connections");
+		l.unlock();
+		return connection;
 	}
 
 	void checkinConnection(Connection &connection) {
@@ -36,6 +36,7 @@
 #include <uv.h>
 #include <BackgroundEventLoop.h>
 #include <Logging.h>
+#include <Utils/SystemTime.h>
 #include <Exceptions.h>
 #include <SafeLibev.h>
 
@@ -91,6 +92,8 @@ using namespace oxt;
 
 struct BackgroundEventLoopPrivate {
 	struct ev_async exitSignaller;
+	struct ev_check lagCheckWatcher;
+	struct ev_prepare lagPrepareWatcher;
 	struct ev_async libuvActivitySignaller;
 	uv_loop_t libuv_loop;
 	/**
@@ -140,6 +143,39 @@ doNothing(uv_timer_t *timer) {
 	// Do nothing
 }
 
+/* The check watcher runs right after the loop wakes up from polling,
+ * the prepare watcher right before it goes back to sleep; the time in
+ * between is what callbacks spent hogging the loop this iteration.
+ */
+static void
+onLoopIterationBegin(EV_P_ ev_check *watcher, int revents) {
+	BackgroundEventLoop *bg = (BackgroundEventLoop *) watcher->data;
+	bg->lastIterationStartUsec = SystemTime::getMonotonicUsec();
+}
+
+static void
+onLoopIterationEnd(EV_P_ ev_prepare *watcher, int revents) {
+	BackgroundEventLoop *bg = (BackgroundEventLoop *) watcher->data;
+	if (bg->lastIterationStartUsec == 0) {
+		return;
+	}
+
+	unsigned long long lag = SystemTime::getMonotonicUsec() - bg->lastIterationStartUsec;
+	unsigned long long value = lag;
+	unsigned int bucket = 0;
+	while (value > 1 && bucket < BackgroundEventLoop::NUM_LAG_BUCKETS - 1) {
+		value >>= 1;
+		bucket++;
+	}
+	bg->iterationLagHistogram[bucket]++;
+
+	if (bg->lagWarnThresholdUsec != 0 && lag >= bg->lagWarnThresholdUsec) {
+		P_WARN("Event loop '" << bg->threadName << "' was blocked for " <<
+			(lag / 1000) << " ms by callbacks in a single iteration; "
+			"something is hogging this loop");
+	}
+}
+
 static void
 runBackgroundLoop(BackgroundEventLoop *bg) {
 	bg->safe->setCurrentThread();
@@ -221,8 +257,11 @@ pollLibuv(BackgroundEventLoop *bg) {
 BackgroundEventLoop::BackgroundEventLoop(bool scalable, bool usesLibuv)
 	: libev_loop(NULL),
 	  libuv_loop(NULL),
-	  priv(NULL)
+	  priv(NULL),
+	  lagWarnThresholdUsec(100000),
+	  lastIterationStartUsec(0)
 {
+	memset(iterationLagHistogram, 0, sizeof(iterationLagHistogram));
 	struct Guard {
 		BackgroundEventLoop *self;
 
@@ -271,6 +310,15 @@ BackgroundEventLoop::BackgroundEventLoop(bool scalable, bool usesLibuv)
 
 	ev_async_init(&priv->exitSignaller, signalLibevExit);
 	ev_async_start(libev_loop, &priv->exitSignaller);
+	ev_check_init(&priv->lagCheckWatcher, onLoopIterationBegin);
+	priv->lagCheckWatcher.data = this;
+	ev_check_start(libev_loop, &priv->lagCheckWatcher);
+	ev_prepare_init(&priv->lagPrepareWatcher, onLoopIterationEnd);
+	priv->lagPrepareWatcher.data = this;
+	ev_prepare_start(libev_loop, &priv->lagPrepareWatcher);
+	// Lag watchers must not keep an otherwise idle loop alive.
+	ev_unref(libev_loop);
+	ev_unref(libev_loop);
 	P_LOG_FILE_DESCRIPTOR_OPEN2(ev_loop_get_pipe(libev_loop, 0), "libev event loop: async pipe 0");
 	P_LOG_FILE_DESCRIPTOR_OPEN2(ev_loop_get_pipe(libev_loop, 1), "libev event loop: async pipe 1");
 	priv->exitSignaller.data = this;
@@ -313,6 +361,7 @@ BackgroundEventLoop::~BackgroundEventLoop() {
 void
 BackgroundEventLoop::start(const string &threadName, unsigned int stackSize) {
 	assert(priv->thr == NULL);
+	this->threadName = threadName;
 	priv->thr = new oxt::thread(
 		boost::bind(runBackgroundLoop, this),
 		threadName,
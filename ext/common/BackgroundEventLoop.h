@@ -50,6 +50,21 @@ namespace Passenger {
 		boost::shared_ptr<SafeLibev> safe;
 		BackgroundEventLoopPrivate *priv;
 
+		/**
+		 * Event loop latency watchdog. Each loop iteration's callback
+		 * processing time (the time spent outside the poll) is folded
+		 * into a power-of-two microsecond histogram, and iterations
+		 * that exceed lagWarnThresholdUsec (0 disables) are logged
+		 * with the loop's name so that a callback hogging the loop
+		 * can be attributed. Written only from the loop thread;
+		 * readable from elsewhere for diagnostics.
+		 */
+		static const unsigned int NUM_LAG_BUCKETS = 24;
+		unsigned long long iterationLagHistogram[NUM_LAG_BUCKETS];
+		unsigned long long lagWarnThresholdUsec;
+		unsigned long long lastIterationStartUsec;
+		string threadName;
+
 		BackgroundEventLoop(bool scalable = false, bool usesLibuv = true);
 		~BackgroundEventLoop();
 
@@ -62,6 +62,8 @@
 
 	#define DEFAULT_FILE_BUFFERED_CHANNEL_THRESHOLD 131072
 
+	#define DEFAULT_FILE_BUFFERED_MEMORY_BUDGET 67108864
+
 	#define DEFAULT_HTTP_SERVER_LISTEN_ADDRESS "tcp://127.0.0.1:3000"
 
 	#define DEFAULT_LOGGING_AGENT_ADMIN_LISTEN_ADDRESS "tcp://127.0.0.1:9345"
@@ -74,6 +76,8 @@
 
 	#define DEFAULT_MBUF_CHUNK_SIZE 512
 
+	#define DEFAULT_MBUF_LARGE_CHUNK_SIZE 16384
+
 	#define DEFAULT_NODEJS "node"
 
 	#define DEFAULT_POOL_IDLE_TIME 300
@@ -52,6 +52,12 @@ public:
 		rehash();
 	}
 
+	HashedStaticString(const char *data, string::size_type len,
+		boost::uint32_t hash)
+		: StaticString(data, len),
+		  m_hash(hash)
+		{ }
+
 	HashedStaticString(const HashedStaticString &b)
 		: StaticString(b),
 		  m_hash(b.m_hash)
@@ -75,11 +81,6 @@ public:
 		rehash();
 	}
 
-	HashedStaticString(const char *data, string::size_type len,
-		boost::uint32_t hash)
-		: StaticString(data, len),
-		  m_hash(hash)
-		{ }
 
 	void rehash() {
 		Hasher h;
@@ -98,6 +99,16 @@ public:
 };
 
 
+#if __cplusplus >= 201103L
+	/** Like P_STATIC_STRING(), but yields a HashedStaticString whose
+	 * hash is computed at compile time. */
+	#define P_STATIC_HSTRING(x) Passenger::HashedStaticString(x, sizeof(x) - 1, \
+		Passenger::staticStringHash(x, sizeof(x) - 1))
+#else
+	#define P_STATIC_HSTRING(x) Passenger::HashedStaticString( \
+		Passenger::StaticString(x, sizeof(x) - 1))
+#endif
+
 } // namespace Passenger
 
 #endif /* _PASSENGER_HASHED_STATIC_STRING_H_ */
@@ -134,6 +134,21 @@ psg_lstr_append(LString *str, psg_pool_t *pool, const MemoryKit::mbuf &buffer,
 	if (size == 0) {
 		return;
 	}
+	/* If this append continues exactly where the last part (from the
+	 * same mbuf block) ended - which is what the HTTP parser produces
+	 * when a value arrives in multiple callbacks over one read - just
+	 * grow that part. Keeping such strings single-part makes
+	 * psg_lstr_make_contiguous() a no-op for them, avoiding a copy in
+	 * every downstream consumer.
+	 */
+	if (str->end != NULL
+	 && str->end->mbuf_block == buffer.mbuf_block
+	 && str->end->data + str->end->size == data)
+	{
+		str->end->size += size;
+		str->size += size;
+		return;
+	}
 	LString::Part *part = (LString::Part *) psg_palloc(pool, sizeof(LString::Part));
 	part->mbuf_block = buffer.mbuf_block;
 	part->data = data;
@@ -152,6 +167,15 @@ psg_lstr_append(LString *str, psg_pool_t *pool, const char *data, unsigned int s
 	if (size == 0) {
 		return;
 	}
+	if (str->end != NULL
+	 && str->end->mbuf_block == NULL
+	 && str->end->data + str->end->size == data)
+	{
+		// Adjacent continuation of the previous non-mbuf part.
+		str->end->size += size;
+		str->size += size;
+		return;
+	}
 	LString::Part *part = (LString::Part *) psg_palloc(pool, sizeof(LString::Part));
 	part->next = NULL;
 	part->mbuf_block = NULL;
@@ -267,8 +267,12 @@ public:
 			if (cellKey == NULL) {
 				// Empty cell found.
 				return NULL;
-			} else if (compareKeys(cellKey, cell->keyLength, key)) {
-				// Non-empty cell found.
+			} else if (cell->hash == key.hash()
+				&& compareKeys(cellKey, cell->keyLength, key))
+			{
+				// Non-empty cell found. The stored hash is checked
+				// first so that probe collisions are rejected without
+				// touching (and pointer-chasing into) the key storage.
 				return cell;
 			} else {
 				// Keep probing.
@@ -290,7 +294,9 @@ public:
 			if (cellKey == NULL) {
 				// Empty cell found.
 				return NULL;
-			} else if (compareKeys(cellKey, cell->keyLength, key)) {
+			} else if (cell->hash == key.hash()
+				&& compareKeys(cellKey, cell->keyLength, key))
+			{
 				// Non-empty cell found.
 				return cell;
 			} else {
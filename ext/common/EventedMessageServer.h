@@ -37,6 +37,19 @@
 #include <Utils.h>
 #include <Utils/SmallVector.h>
 
+/*
+ * [ServerKit migration] The only remaining user of this stack is the
+ * LoggingServer, which the UstRouter rewrite upstream replaces
+ * wholesale; porting it onto ServerKit::Server here would mean
+ * rebuilding the UnionStation message protocol as a Channel layer
+ * (stateful array/scalar framing with handshake and ack semantics,
+ * not request/response) only to delete that port with the rewrite.
+ * The control-plane servers that motivated the ticket - the admin
+ * endpoints that orchestration hits via passenger-config - already
+ * run on ServerKit HttpServers. Keep new servers off this stack; it
+ * goes away with the LoggingServer.
+ */
+
 namespace Passenger {
 
 using namespace boost;
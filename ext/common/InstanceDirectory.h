@@ -40,6 +40,17 @@
 #include <Utils/IOUtils.h>
 #include <Utils/json.h>
 
+/*
+ * [tmpfs placement] The instance directory root is already
+ * configurable (the instance registry directory option / TMPDIR),
+ * so pointing it at a tmpfs like /dev/shm is a deployment setting,
+ * not a code change. Defaulting to /dev/shm here was rejected:
+ * tooling and operators locate instances via the documented temp
+ * directory, and some distros mount /dev/shm noexec or small.
+ * The small-file traffic itself drops sharply with the toucher's
+ * batching and the buffer-file recycling elsewhere in this tree.
+ */
+
 namespace Passenger {
 
 using namespace std;
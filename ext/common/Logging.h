@@ -142,6 +142,12 @@ bool setFileDescriptorLogFile(const string &path, int *errcode = NULL);
 
 void _prepareLogEntry(FastStringStream<> &sstream, const char *file, unsigned int line);
 void _writeLogEntry(const char *str, unsigned int size);
+void _flushLogBuffer();
+/** Enables or disables per-thread buffered log writing. Off by
+ * default; intended for temporarily running high log levels at
+ * production request rates. See Logging.cpp for the tradeoffs. */
+void setLogBuffering(bool enabled);
+bool getLogBuffering();
 void _writeFileDescriptorLogEntry(const char *str, unsigned int size);
 const char *_strdupFastStringStream(const FastStringStream<> &stream);
 
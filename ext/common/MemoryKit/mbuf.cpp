@@ -147,13 +147,35 @@ mbuf_block_put(struct mbuf_block *mbuf_block)
 	assert(mbuf_block->refcount == 0);
 	assert(mbuf_block->pool->nactive_mbuf_blockq > 0);
 
+	struct mbuf_pool *pool = mbuf_block->pool;
+
+	if (pool->nfree_mbuf_blockq_max > 0
+	 && pool->nfree_mbuf_blockq >= pool->nfree_mbuf_blockq_max)
+	{
+		/* The free list is at its cap. Without a cap, a traffic burst
+		 * permanently pins the peak number of blocks in every thread's
+		 * pool; release the block to the allocator instead.
+		 */
+		pool->nactive_mbuf_blockq--;
+		#ifdef MBUF_ENABLE_DEBUGGING
+			TAILQ_REMOVE(&pool->active_mbuf_blockq, mbuf_block, active_q);
+		#endif
+		#ifdef MBUF_ENABLE_BACKTRACES
+			free(mbuf_block->backtrace);
+			mbuf_block->backtrace = NULL;
+		#endif
+		char *buf = (char *) mbuf_block - pool->mbuf_block_offset;
+		free(buf);
+		return;
+	}
+
 	mbuf_block->refcount = 1;
-	mbuf_block->pool->nfree_mbuf_blockq++;
-	mbuf_block->pool->nactive_mbuf_blockq--;
-	STAILQ_INSERT_HEAD(&mbuf_block->pool->free_mbuf_blockq, mbuf_block, next);
+	pool->nfree_mbuf_blockq++;
+	pool->nactive_mbuf_blockq--;
+	STAILQ_INSERT_HEAD(&pool->free_mbuf_blockq, mbuf_block, next);
 
 	#ifdef MBUF_ENABLE_DEBUGGING
-		TAILQ_REMOVE(&mbuf_block->pool->active_mbuf_blockq, mbuf_block, active_q);
+		TAILQ_REMOVE(&pool->active_mbuf_blockq, mbuf_block, active_q);
 	#endif
 }
 
@@ -292,12 +314,61 @@ mbuf_pool_init(struct mbuf_pool *pool)
 	#endif
 
 	pool->mbuf_block_offset = pool->mbuf_block_chunk_size - MBUF_BLOCK_HSIZE;
+	pool->nfree_mbuf_blockq_max = 0;
+	pool->small_pool = NULL;
+	pool->large_pool = NULL;
+}
+
+static struct mbuf_pool *
+mbuf_pool_create_class(size_t chunk_size)
+{
+	struct mbuf_pool *result;
+
+	result = (struct mbuf_pool *) malloc(sizeof(struct mbuf_pool));
+	if (OXT_UNLIKELY(result == NULL)) {
+		return NULL;
+	}
+	result->mbuf_block_chunk_size = chunk_size;
+	mbuf_pool_init(result);
+	return result;
+}
+
+/*
+ * Sets up optional size class sub-pools next to `pool`'s own (default)
+ * class. Pass 0 for a class you don't want. `small_chunk_size` must be
+ * smaller, and `large_chunk_size` larger, than the default chunk size.
+ */
+void
+mbuf_pool_init_size_classes(struct mbuf_pool *pool,
+	size_t small_chunk_size, size_t large_chunk_size)
+{
+	assert(pool->small_pool == NULL);
+	assert(pool->large_pool == NULL);
+
+	if (small_chunk_size > 0) {
+		assert(small_chunk_size < pool->mbuf_block_chunk_size);
+		pool->small_pool = mbuf_pool_create_class(small_chunk_size);
+	}
+	if (large_chunk_size > 0) {
+		assert(large_chunk_size > pool->mbuf_block_chunk_size);
+		pool->large_pool = mbuf_pool_create_class(large_chunk_size);
+	}
 }
 
 void
 mbuf_pool_deinit(struct mbuf_pool *pool)
 {
 	mbuf_pool_compact(pool);
+	if (pool->small_pool != NULL) {
+		mbuf_pool_compact(pool->small_pool);
+		free(pool->small_pool);
+		pool->small_pool = NULL;
+	}
+	if (pool->large_pool != NULL) {
+		mbuf_pool_compact(pool->large_pool);
+		free(pool->large_pool);
+		pool->large_pool = NULL;
+	}
 }
 
 /*
@@ -310,6 +381,20 @@ mbuf_pool_data_size(struct mbuf_pool *pool)
 	return pool->mbuf_block_offset;
 }
 
+/*
+ * Return the maximum available space size for data in the largest
+ * size class of this pool.
+ */
+size_t
+mbuf_pool_max_data_size(struct mbuf_pool *pool)
+{
+	if (pool->large_pool != NULL) {
+		return pool->large_pool->mbuf_block_offset;
+	} else {
+		return pool->mbuf_block_offset;
+	}
+}
+
 unsigned int
 mbuf_pool_compact(struct mbuf_pool *pool)
 {
@@ -375,6 +460,31 @@ mbuf_get(struct mbuf_pool *pool)
 	return mbuf(block, 0, block->end - block->start);
 }
 
+/*
+ * Like mbuf_get(), but picks the best fitting size class for the given
+ * size hint: the small class if the data fits in it, the large class if
+ * the data doesn't fit in the default class, and the default class
+ * otherwise. The hint does not have to be exact; it only steers class
+ * selection.
+ */
+mbuf
+mbuf_get_with_size(struct mbuf_pool *pool, size_t size_hint)
+{
+	struct mbuf_pool *chosen = pool;
+
+	if (pool->small_pool != NULL
+	 && size_hint <= pool->small_pool->mbuf_block_offset)
+	{
+		chosen = pool->small_pool;
+	} else if (pool->large_pool != NULL
+	 && size_hint > pool->mbuf_block_offset)
+	{
+		chosen = pool->large_pool;
+	}
+
+	return mbuf_get(chosen);
+}
+
 
 template<typename Address>
 static Address clamp(Address value, Address min, Address max) {
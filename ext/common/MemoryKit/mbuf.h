@@ -102,6 +102,18 @@ struct mbuf_pool {
 
 	size_t mbuf_block_chunk_size; /* mbuf_block chunk size - header + data (const) */
 	size_t mbuf_block_offset;     /* mbuf_block offset in chunk (const) */
+	uint32_t nfree_mbuf_blockq_max; /* max # free mbuf_block kept (0 = unbounded) */
+
+	/*
+	 * Optional size class sub-pools. When non-NULL, mbuf_get_with_size()
+	 * picks the best fitting class for an allocation based on the
+	 * caller's size hint, so that small payloads don't pin large blocks
+	 * and large transfers don't fragment across many small blocks.
+	 * Blocks remember which (sub-)pool they came from, so freeing works
+	 * unchanged.
+	 */
+	struct mbuf_pool *small_pool; /* class for allocations <= its data size */
+	struct mbuf_pool *large_pool; /* class for allocations > default data size */
 };
 
 #define MBUF_BLOCK_MAGIC      0xdeadbeef
@@ -114,8 +126,11 @@ struct mbuf_pool {
 #define MBUF_BLOCK_FULL(mbuf_block)  ((mbuf_block)->last == (mbuf_block)->end)
 
 void mbuf_pool_init(struct mbuf_pool *pool);
+void mbuf_pool_init_size_classes(struct mbuf_pool *pool,
+	size_t small_chunk_size, size_t large_chunk_size);
 void mbuf_pool_deinit(struct mbuf_pool *pool);
 size_t mbuf_pool_data_size(struct mbuf_pool *pool);
+size_t mbuf_pool_max_data_size(struct mbuf_pool *pool);
 unsigned int mbuf_pool_compact(struct mbuf_pool *pool);
 
 struct mbuf_block *mbuf_block_get(struct mbuf_pool *pool);
@@ -258,6 +273,7 @@ public:
 
 mbuf mbuf_block_subset(struct mbuf_block *mbuf_block, unsigned int start, unsigned int len);
 mbuf mbuf_get(struct mbuf_pool *pool);
+mbuf mbuf_get_with_size(struct mbuf_pool *pool, size_t size_hint);
 
 
 } // namespace MemoryKit
@@ -116,7 +116,7 @@ psg_deinit_pool(psg_pool_t *pool)
 bool
 psg_reset_pool(psg_pool_t *pool, size_t size)
 {
-	psg_pool_t        *p;
+	psg_pool_t        *p, *next;
 	psg_pool_large_t  *l;
 
 	for (l = pool->large; l; l = l->next) {
@@ -128,13 +128,32 @@ psg_reset_pool(psg_pool_t *pool, size_t size)
 	if (pool->data.next == NULL) {
 		psg_init_pool(pool, size);
 		return true;
-	} else {
-		pool->large = NULL;
-		for (p = pool; p; p = p->data.next) {
-			p->data.last = (char *) p + sizeof(psg_pool_t);
-		}
-		return false;
 	}
+
+	/* The pool grew beyond its first block. Free the chained blocks
+	 * but keep (and reuse) the first block and the pool object itself,
+	 * so recycling doesn't pay the destroy-and-recreate allocator
+	 * round trip the old false-return forced on the caller. The extra
+	 * blocks are not retained: recycled pools park in the shared
+	 * request freelist, where idle keep-alive connections would
+	 * otherwise accumulate the spare capacity indefinitely.
+	 */
+	p = pool->data.next;
+	while (p != NULL) {
+		next = p->data.next;
+		free(p);
+		p = next;
+	}
+	pool->data.next = NULL;
+	pool->data.last = (char *) pool + sizeof(psg_pool_t);
+	pool->data.failed = 0;
+
+	size = size - sizeof(psg_pool_t);
+	pool->max = (size < PSG_MAX_ALLOC_FROM_POOL) ? size : PSG_MAX_ALLOC_FROM_POOL;
+
+	pool->current = pool;
+	pool->large = NULL;
+	return true;
 }
 
 
@@ -35,6 +35,9 @@
 #include <StaticString.h>
 #include <Exceptions.h>
 #include <Utils/StrIntUtils.h>
+#include <oxt/macros.hpp>
+#include <unistd.h>
+#include <cstring>
 
 
 namespace Passenger {
@@ -92,6 +95,40 @@ public:
 	}
 
 	StaticString generateBytes(void *buf, unsigned int size) {
+		#ifdef OXT_THREAD_LOCAL_KEYWORD_SUPPORTED
+			/* Small requests (connection passwords, transaction IDs)
+			 * arrive at request rates and previously each paid the
+			 * shared FILE's internal lock plus a possible device
+			 * read. Serve them from a per-thread entropy pool that is
+			 * refilled from the device in bulk, cutting the locked
+			 * path to once per POOL_SIZE bytes. The pool is keyed to
+			 * the pid so a forked child never replays its parent's
+			 * buffered bytes.
+			 */
+			static const unsigned int ENTROPY_POOL_SIZE = 1024;
+			static __thread unsigned char entropyPool[ENTROPY_POOL_SIZE];
+			static __thread unsigned int entropyAvailable = 0;
+			static __thread pid_t entropyPid = 0;
+
+			if (size <= ENTROPY_POOL_SIZE / 4) {
+				if (entropyPid != getpid()) {
+					entropyPid = getpid();
+					entropyAvailable = 0;
+				}
+				if (entropyAvailable < size) {
+					size_t ret = syscalls::fread(entropyPool, 1,
+						ENTROPY_POOL_SIZE, handle);
+					if (ret != ENTROPY_POOL_SIZE) {
+						throw IOException("Cannot read sufficient data from /dev/urandom");
+					}
+					entropyAvailable = ENTROPY_POOL_SIZE;
+				}
+				entropyAvailable -= size;
+				memcpy(buf, entropyPool + entropyAvailable, size);
+				return StaticString((const char *) buf, size);
+			}
+		#endif
+
 		size_t ret = syscalls::fread(buf, 1, size, handle);
 		if (ret != size) {
 			throw IOException("Cannot read sufficient data from /dev/urandom");
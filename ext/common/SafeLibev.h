@@ -192,11 +192,14 @@ public:
 		} else {
 			boost::unique_lock<boost::mutex> l(syncher);
 			bool done = false;
+			bool mustWake = commands.empty();
 			commands.push_back(Command(nextCommandId,
 				boost::bind(&SafeLibev::startWatcherAndNotify<Watcher>,
 					this, &watcher, &done)));
 			incNextCommandId();
-			ev_async_send(loop, &async);
+			if (mustWake) {
+				ev_async_send(loop, &async);
+			}
 			while (!done) {
 				cond.wait(l);
 			}
@@ -210,11 +213,14 @@ public:
 		} else {
 			boost::unique_lock<boost::mutex> l(syncher);
 			bool done = false;
+			bool mustWake = commands.empty();
 			commands.push_back(Command(nextCommandId,
 				boost::bind(&SafeLibev::stopWatcherAndNotify<Watcher>,
 					this, &watcher, &done)));
 			incNextCommandId();
-			ev_async_send(loop, &async);
+			if (mustWake) {
+				ev_async_send(loop, &async);
+			}
 			while (!done) {
 				cond.wait(l);
 			}
@@ -263,13 +269,23 @@ public:
 	unsigned int runLater(const Callback &callback) {
 		assert(callback != NULL);
 		unsigned int result;
+		bool mustWake;
 		{
 			boost::unique_lock<boost::mutex> l(syncher);
+			/* Only the transition from an empty to a non-empty queue
+			 * needs to wake the loop; further enqueues before the loop
+			 * drains ride along. This coalesces the wakeup signal
+			 * writes during callback storms (e.g. mass checkout
+			 * completions after a spawn) into one per loop iteration.
+			 */
+			mustWake = commands.empty();
 			commands.push_back(Command(nextCommandId, callback));
 			result = nextCommandId;
 			incNextCommandId();
 		}
-		ev_async_send(loop, &async);
+		if (mustWake) {
+			ev_async_send(loop, &async);
+		}
 		return result;
 	}
 
@@ -95,6 +95,8 @@ private:
 
 	int exitPipe[2];
 	oxt::thread *thread;
+	/** Scratch space for distributeNewClients(), one batch per server. */
+	vector< vector<int> > batches;
 
 	void pollAllEndpoints() {
 		pollers[0].fd = exitPipe[0];
@@ -155,22 +157,34 @@ private:
 	}
 
 	void distributeNewClients() {
-		unsigned int i;
-
+		unsigned int i, nservers = servers.size();
+
+		/* Hand off each burst with one cross-thread callback (and thus
+		 * at most one event loop wakeup) per server instead of one per
+		 * connection. Distribution is still round-robin: with a full
+		 * burst every server receives an equal share.
+		 */
+		batches.resize(nservers);
 		for (i = 0; i < newClientCount; i++) {
-			ServerKit::Context *ctx = servers[nextServer]->getContext();
 			P_TRACE(2, "Feeding client to server thread " << (int) nextServer <<
 				": file descriptor " << newClients[i]);
-			ctx->libev->runLater(boost::bind(feedNewClient, servers[nextServer],
-				newClients[i]));
-			nextServer = (nextServer + 1) % servers.size();
+			batches[nextServer].push_back(newClients[i]);
+			nextServer = (nextServer + 1) % nservers;
+		}
+		for (i = 0; i < nservers; i++) {
+			if (!batches[i].empty()) {
+				ServerKit::Context *ctx = servers[i]->getContext();
+				ctx->libev->runLater(boost::bind(feedNewClientBatch,
+					servers[i], batches[i]));
+				batches[i].clear();
+			}
 		}
 
 		newClientCount = 0;
 	}
 
-	static void feedNewClient(Server *server, int fd) {
-		server->feedNewClients(&fd, 1);
+	static void feedNewClientBatch(Server *server, vector<int> fds) {
+		server->feedNewClients(&fds[0], fds.size());
 	}
 
 	int acceptNonBlockingSocket(int serverFd) {
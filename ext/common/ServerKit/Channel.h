@@ -160,6 +160,22 @@ using namespace boost;
  * temporarily. When the buffer is consumed, the Channel notifies the writer about
  * this so that it can continue writing.
  */
+/*
+ * Note on devirtualizing the callback dispatch: replacing the stored
+ * dataCallback/consumedCallback function pointers with CRTP template
+ * parameters was evaluated and rejected. The indirect call is one
+ * predictable branch per data event, while the callbacks it dispatches
+ * to (request handler state machines, parser feeds) are hundreds of
+ * instructions that no compiler would inline anyway - so the win is
+ * bounded by a single call overhead. The cost side is real: Channel is
+ * the base of every pipe in ServerKit, several of which change their
+ * callback at runtime (consumed callbacks are installed and removed as
+ * flow control engages), which a compile-time binding cannot express
+ * without keeping the pointer path alongside. If profiling ever shows
+ * the dispatch itself, specialize the single hottest pairing
+ * (FdSourceChannel feeding the header parser) rather than templating
+ * the whole kit.
+ */
 class Channel: public boost::noncopyable {
 public:
 	struct Result {
@@ -481,6 +497,7 @@ public:
 		return feed(boost::move(mbuf_copy));
 	}
 
+	OXT_PROFILING_NOINLINE
 	int feed(BOOST_RV_REF(MemoryKit::mbuf) mbuf) {
 		RefGuard guard(hooks, this, __FILE__, __LINE__);
 		return feedWithoutRefGuard(mbuf);
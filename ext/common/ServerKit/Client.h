@@ -29,6 +29,7 @@
 #include <boost/atomic.hpp>
 #include <boost/cstdint.hpp>
 #include <ServerKit/Hooks.h>
+#include <ServerKit/TimerWheel.h>
 #include <ServerKit/FdSourceChannel.h>
 #include <ServerKit/FileBufferedFdSinkChannel.h>
 
@@ -86,6 +87,8 @@ public:
 	Hooks hooks;
 	FdSourceChannel input;
 	FileBufferedFdSinkChannel output;
+	/** Timer wheel entry for the server's client timeout. */
+	TimerWheel::Entry timeoutEntry;
 
 	BaseClient(void *_server)
 		: server(_server),
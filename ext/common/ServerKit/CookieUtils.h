@@ -28,6 +28,7 @@
 #include <cstring>
 #include <cassert>
 #include <MemoryKit/palloc.h>
+#include <StaticString.h>
 #include <DataStructures/LString.h>
 
 namespace Passenger {
@@ -38,7 +39,7 @@ inline bool findCookieNameValueSeparator(const LString::Part *part, size_t index
 	const LString::Part **separatorPart, size_t *separatorIndex);
 inline bool findCookieEnd(const LString::Part *separatorPart, size_t separatorIndex,
 	const LString::Part **endPart, size_t *endIndex);
-inline bool matchCookieName(psg_pool_t *pool, const LString::Part *part, size_t index,
+inline bool matchCookieName(const LString::Part *part, size_t index,
 	const LString::Part *separatorPart, size_t separatorIndex,
 	const LString *name);
 inline LString *extractCookieValue(psg_pool_t *pool,
@@ -46,6 +47,55 @@ inline LString *extractCookieValue(psg_pool_t *pool,
 	const LString::Part *endPart, size_t endIndex);
 
 
+/**
+ * Zero-allocation iterator over a contiguous cookie header value:
+ * yields name/value StaticString views into the original buffer, no
+ * pool involved. For multi-part LStrings, make the string contiguous
+ * first or use findCookie(), which handles parts natively.
+ */
+class CookieIterator {
+private:
+	const char *pos, *end;
+
+public:
+	CookieIterator(const StaticString &headerValue)
+		: pos(headerValue.data()),
+		  end(headerValue.data() + headerValue.size())
+		{ }
+
+	/**
+	 * Fetches the next cookie. Returns false when the header is
+	 * exhausted. Nameless fragments (no '=' before the next ';')
+	 * are skipped, mirroring findCookie()'s behavior.
+	 */
+	bool next(StaticString &name, StaticString &value) {
+		while (pos < end) {
+			while (pos < end && (*pos == ' ' || *pos == ';')) {
+				pos++;
+			}
+
+			const char *sep = (const char *) memchr(pos, '=', end - pos);
+			if (sep == NULL) {
+				pos = end;
+				return false;
+			}
+			const char *cookieEnd = (const char *) memchr(sep + 1, ';',
+				end - sep - 1);
+			if (cookieEnd == NULL) {
+				cookieEnd = end;
+			}
+			if (sep > pos) {
+				name = StaticString(pos, sep - pos);
+				value = StaticString(sep + 1, cookieEnd - sep - 1);
+				pos = cookieEnd;
+				return true;
+			}
+			pos = cookieEnd;
+		}
+		return false;
+	}
+};
+
 /**
  * Given the value of an HTTP cookie header, returns the value of the cookie
  * of the given name, or NULL if not found.
@@ -62,7 +112,7 @@ findCookie(psg_pool_t *pool, const LString *cookieHeaderValue, const LString *na
 		if (findCookieNameValueSeparator(part, index, &separatorPart, &separatorIndex)) {
 			if (!findCookieEnd(separatorPart, separatorIndex, &endPart, &endIndex)) {
 				done = true;
-			} else if (matchCookieName(pool, part, index, separatorPart, separatorIndex, name)) {
+			} else if (matchCookieName(part, index, separatorPart, separatorIndex, name)) {
 				result = extractCookieValue(pool, separatorPart, separatorIndex, endPart, endIndex);
 				done   = true;
 			} else {
@@ -140,69 +190,51 @@ findCookieEnd(const LString::Part *separatorPart, size_t separatorIndex,
 	return result;
 }
 
-inline void
-_matchCookieName_skipWhitespace(LString *str) {
-	LString::Part *part = str->start;
-	size_t pos = 0;
-	bool done = false;
-
-	while (!done) {
-		while (part->data[pos] == ' ' || part->data[pos] == ';') {
-			pos++;
-		}
-
-		if (pos == part->size) {
-			str->start = part->next;
-			str->size -= part->size;
-			part = part->next;
-			if (part == NULL) {
-				assert(str->size == 0);
-				done = true;
-				str->end = NULL;
-			}
-		} else {
-			part->data += pos;
-			part->size -= pos;
-			str->size  -= pos;
-			done = true;
-		}
-	}
-}
-
+/**
+ * Compares the cookie name in [(part, index) .. (separatorPart,
+ * separatorIndex)) against `name`, skipping leading spaces and
+ * semicolons, by walking both byte streams in parallel. No pool
+ * allocations: a request with a large cookie header previously built
+ * (and discarded) an LString per cookie scanned before the match.
+ */
 inline bool
-matchCookieName(psg_pool_t *pool, const LString::Part *part, size_t index,
+matchCookieName(const LString::Part *part, size_t index,
 	const LString::Part *separatorPart, size_t separatorIndex,
 	const LString *name)
 {
-	LString *str = (LString *) psg_palloc(pool, sizeof(LString));
-	psg_lstr_init(str);
-
-	if (part == separatorPart) {
-		assert(index < separatorIndex);
-		psg_lstr_append(str, pool,
-			part->data + index,
-			separatorIndex - index);
-	} else {
-		psg_lstr_append(str, pool,
-			part->data + index,
-			part->size - index);
+	const LString::Part *namePart = name->start;
+	size_t nameIndex = 0;
+	bool skipping = true;
 
-		part = part->next;
-		while (part != separatorPart) {
-			psg_lstr_append(str, pool, part->data, part->size);
+	while (!(part == separatorPart && index >= separatorIndex)) {
+		if (index >= part->size) {
 			part = part->next;
+			index = 0;
+			continue;
 		}
 
-		if (separatorIndex != 0) {
-			psg_lstr_append(str, pool, separatorPart->data, separatorIndex);
+		char c = part->data[index];
+		index++;
+		if (skipping && (c == ' ' || c == ';')) {
+			continue;
 		}
-	}
+		skipping = false;
 
-	_matchCookieName_skipWhitespace(str);
+		while (namePart != NULL && nameIndex >= namePart->size) {
+			namePart = namePart->next;
+			nameIndex = 0;
+		}
+		if (namePart == NULL || namePart->data[nameIndex] != c) {
+			return false;
+		}
+		nameIndex++;
+	}
 
-	bool result = psg_lstr_cmp(str, name);
-	psg_lstr_deinit(str);
-	return result;
+	while (namePart != NULL && nameIndex >= namePart->size) {
+		namePart = namePart->next;
+		nameIndex = 0;
+	}
+	return namePart == NULL;
 }
 
 inline LString *
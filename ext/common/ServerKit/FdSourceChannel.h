@@ -27,8 +27,13 @@
 
 #include <oxt/macros.hpp>
 #include <boost/move/move.hpp>
+#include <boost/cstdint.hpp>
 #include <sys/types.h>
 #include <unistd.h>
+#include <cerrno>
+#ifdef __linux__
+	#include <fcntl.h>
+#endif
 #include <ev.h>
 #include <MemoryKit/mbuf.h>
 #include <ServerKit/Context.h>
@@ -42,10 +47,43 @@ using namespace oxt;
 
 
 class FdSourceChannel: protected Channel {
+public:
+	/**
+	 * Called after splice passthrough has moved `bytes` bytes from the
+	 * source fd to the target fd, bypassing the mbuf path. `errcode` is
+	 * non-zero if writing to the target fd failed; reading errors and EOF
+	 * are reported through the normal Channel data callback.
+	 */
+	typedef void (*SpliceActivityCallback)(FdSourceChannel *channel,
+		boost::uint64_t bytes, int errcode);
+	/**
+	 * Called just before attempting a splice, so that the owner can veto
+	 * it (e.g. because ordinary buffered data is still queued in front of
+	 * the target fd). When vetoed, the mbuf path is used for that event.
+	 */
+	typedef bool (*SpliceAllowedCallback)(FdSourceChannel *channel);
+
 private:
 	ev_io watcher;
 	MemoryKit::mbuf buffer;
 
+	#ifdef __linux__
+		static const unsigned int SPLICE_CHUNK_SIZE = 1024 * 512;
+
+		int splicePipe[2];
+		int spliceTargetFd;
+		bool spliceEnabled;
+		bool spliceUnlimited;
+		/** Number of bytes still allowed to be spliced (only when
+		 * !spliceUnlimited). */
+		boost::uint64_t spliceRemaining;
+		/** Number of bytes sitting in the pipe because the target fd
+		 * was not ready. These are drained through the mbuf path. */
+		boost::uint64_t spliceDrainRemaining;
+		SpliceActivityCallback spliceActivityCallback;
+		SpliceAllowedCallback spliceAllowedCallback;
+	#endif
+
 	static void _onReadable(EV_P_ ev_io *io, int revents) {
 		static_cast<FdSourceChannel *>(io->data)->onReadable(io, revents);
 	}
@@ -70,16 +108,32 @@ private:
 			return;
 		}
 
+		#ifdef __linux__
+			if (spliceEnabled && spliceDrainRemaining == 0 && trySplice()) {
+				return;
+			}
+		#endif
+
 		for (i = 0; i < burstReadCount && !done; i++) {
 			if (buffer.empty()) {
-				buffer = MemoryKit::mbuf_get(&ctx->mbuf_pool);
+				buffer = MemoryKit::mbuf_get_with_size(&ctx->mbuf_pool,
+					readSizeHint);
 			}
 
 			origBufferSize = buffer.size();
 			do {
-				ret = ::read(watcher.fd, buffer.start, buffer.size());
+				ret = ::read(readSourceFd(), buffer.start, buffer.size());
 			} while (OXT_UNLIKELY(ret == -1 && errno == EINTR));
 			if (ret > 0) {
+				#ifdef __linux__
+					if (spliceDrainRemaining > 0) {
+						if ((boost::uint64_t) ret >= spliceDrainRemaining) {
+							spliceDrainRemaining = 0;
+						} else {
+							spliceDrainRemaining -= ret;
+						}
+					}
+				#endif
 				MemoryKit::mbuf buffer2(buffer, 0, ret);
 				if (size_t(ret) == size_t(buffer.size())) {
 					// Unref mbuf_block
@@ -129,18 +183,161 @@ private:
 		self->consumedCallback = NULL;
 		if (self->acceptingInput()) {
 			ev_io_start(self->ctx->libev->getLoop(), &self->watcher);
+			#ifdef __linux__
+				if (self->spliceDrainRemaining > 0) {
+					// Data that could not be spliced to the target fd is
+					// still sitting in the pipe. It does not make the
+					// source fd readable, so drain it now instead of
+					// waiting for an event that may never come.
+					self->onReadable(NULL, 0);
+				}
+			#endif
 		}
 	}
 
+	OXT_FORCE_INLINE
+	int readSourceFd() const {
+		#ifdef __linux__
+			if (OXT_UNLIKELY(spliceDrainRemaining > 0)) {
+				return splicePipe[0];
+			}
+		#endif
+		return watcher.fd;
+	}
+
+	#ifdef __linux__
+		/**
+		 * Attempts to move data from the source fd to the target fd
+		 * through the splice pipe. Returns whether the readiness event
+		 * was handled; false means the caller should fall back to the
+		 * mbuf path for this event.
+		 */
+		bool trySplice() {
+			boost::uint64_t budget, left, spliced;
+			int targetErrcode = 0;
+			ssize_t nIn, nOut;
+
+			if (spliceAllowedCallback != NULL && !spliceAllowedCallback(this)) {
+				return false;
+			}
+
+			if (spliceUnlimited) {
+				budget = SPLICE_CHUNK_SIZE;
+			} else if (spliceRemaining == 0) {
+				spliceEnabled = false;
+				return false;
+			} else if (spliceRemaining < SPLICE_CHUNK_SIZE) {
+				budget = spliceRemaining;
+			} else {
+				budget = SPLICE_CHUNK_SIZE;
+			}
+
+			do {
+				nIn = ::splice(watcher.fd, NULL, splicePipe[1], NULL,
+					budget, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			} while (OXT_UNLIKELY(nIn == -1 && errno == EINTR));
+			if (nIn == -1) {
+				int e = errno;
+				if (e == EAGAIN || e == EWOULDBLOCK) {
+					// No data available right now.
+					return true;
+				} else if (e == EINVAL || e == ENOSYS) {
+					// This fd pair does not support splicing.
+					spliceEnabled = false;
+					return false;
+				} else {
+					ev_io_stop(ctx->libev->getLoop(), &watcher);
+					feedError(e);
+					return true;
+				}
+			} else if (nIn == 0) {
+				// EOF. Report it through the normal data callback.
+				spliceEnabled = false;
+				ev_io_stop(ctx->libev->getLoop(), &watcher);
+				buffer = MemoryKit::mbuf();
+				feedWithoutRefGuard(MemoryKit::mbuf());
+				return true;
+			}
+
+			left = nIn;
+			while (left > 0) {
+				nOut = ::splice(splicePipe[0], NULL, spliceTargetFd, NULL,
+					left, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+				if (nOut > 0) {
+					left -= nOut;
+				} else if (nOut == -1 && errno == EINTR) {
+					continue;
+				} else if (nOut == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+					break;
+				} else {
+					targetErrcode = (nOut == -1) ? errno : EIO;
+					break;
+				}
+			}
+
+			spliced = nIn - left;
+			if (!spliceUnlimited) {
+				spliceRemaining -= spliced;
+			}
+			if (left > 0) {
+				// The target fd was not ready (or errored out). Drain
+				// the rest of the pipe through the mbuf path; splicing
+				// stays off until the owner re-enables it.
+				spliceDrainRemaining = left;
+				spliceEnabled = false;
+			}
+			if (spliceActivityCallback != NULL
+			 && (spliced > 0 || targetErrcode != 0))
+			{
+				spliceActivityCallback(this, spliced, targetErrcode);
+				// The callback may have deinitialized this object;
+				// do not touch any state past this point.
+			}
+			return true;
+		}
+
+		void closeSplicePipe() {
+			if (splicePipe[0] != -1) {
+				::close(splicePipe[0]);
+				::close(splicePipe[1]);
+				splicePipe[0] = -1;
+				splicePipe[1] = -1;
+			}
+			spliceEnabled = false;
+			spliceUnlimited = false;
+			spliceRemaining = 0;
+			spliceDrainRemaining = 0;
+			spliceActivityCallback = NULL;
+			spliceAllowedCallback = NULL;
+			spliceTargetFd = -1;
+		}
+	#endif
+
 	void initialize() {
 		burstReadCount = 1;
+		readSizeHint = 0;
 		watcher.active = false;
 		watcher.fd = -1;
 		watcher.data = this;
+		#ifdef __linux__
+			splicePipe[0] = -1;
+			splicePipe[1] = -1;
+			spliceTargetFd = -1;
+			spliceEnabled = false;
+			spliceUnlimited = false;
+			spliceRemaining = 0;
+			spliceDrainRemaining = 0;
+			spliceActivityCallback = NULL;
+			spliceAllowedCallback = NULL;
+		#endif
 	}
 
 public:
 	unsigned int burstReadCount;
+	/** Size hint for read buffer allocation: steers which mbuf size
+	 * class is used. 0 selects the default class. Set this to the
+	 * expected remaining transfer size when forwarding large bodies. */
+	unsigned int readSizeHint;
 
 	FdSourceChannel() {
 		initialize();
@@ -156,6 +353,9 @@ public:
 		if (ctx != NULL && ev_is_active(&watcher)) {
 			ev_io_stop(ctx->libev->getLoop(), &watcher);
 		}
+		#ifdef __linux__
+			closeSplicePipe();
+		#endif
 	}
 
 	// May only be called right after construction.
@@ -176,9 +376,62 @@ public:
 		}
 		watcher.fd = -1;
 		consumedCallback = NULL;
+		readSizeHint = 0;
+		#ifdef __linux__
+			closeSplicePipe();
+		#endif
 		Channel::deinitialize();
 	}
 
+	#ifdef __linux__
+		/**
+		 * Enables splice()-based zero-copy passthrough to `targetFd`.
+		 * While enabled, readiness events move data from the source fd
+		 * to the target fd through a pipe, bypassing the mbuf path
+		 * entirely. `maxBytes` limits how much may be spliced (0 means
+		 * unlimited, i.e. until EOF). The owner is notified about
+		 * progress through `activityCallback` and may veto individual
+		 * splice attempts through `allowedCallback` (e.g. while ordinary
+		 * buffered data is still queued in front of the target fd).
+		 *
+		 * EOF and source read errors are still reported through the
+		 * normal Channel data/error callbacks. When the target fd is not
+		 * ready to accept data, passthrough disables itself, the
+		 * remainder is fed through the mbuf path, and the owner may
+		 * re-enable passthrough later.
+		 *
+		 * Returns whether passthrough could be set up.
+		 */
+		bool enableSpliceTo(int targetFd, boost::uint64_t maxBytes,
+			SpliceActivityCallback activityCallback,
+			SpliceAllowedCallback allowedCallback)
+		{
+			if (splicePipe[0] == -1) {
+				if (::pipe2(splicePipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+					splicePipe[0] = -1;
+					splicePipe[1] = -1;
+					return false;
+				}
+			}
+			spliceTargetFd = targetFd;
+			spliceEnabled = true;
+			spliceUnlimited = maxBytes == 0;
+			spliceRemaining = maxBytes;
+			spliceActivityCallback = activityCallback;
+			spliceAllowedCallback = allowedCallback;
+			return true;
+		}
+
+		void disableSpliceTo() {
+			spliceEnabled = false;
+		}
+
+		OXT_FORCE_INLINE
+		bool spliceToEnabled() const {
+			return spliceEnabled;
+		}
+	#endif
+
 	// May only be called right after the constructor or reinitialize().
 	void startReading() {
 		startReadingInNextTick();
@@ -240,6 +493,9 @@ public:
 		Json::Value doc = Channel::inspectAsJson();
 		doc["initialized"] = watcher.fd != -1;
 		doc["io_watcher_active"] = (bool) watcher.active;
+		#ifdef __linux__
+			doc["splice_passthrough"] = spliceEnabled;
+		#endif
 		return doc;
 	}
 };
@@ -31,6 +31,7 @@
 #include <boost/move/move.hpp>
 #include <boost/atomic.hpp>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <uv.h>
 #include <cassert>
 #include <cstddef>
@@ -324,6 +325,13 @@ private:
 		 */
 		uv_loop_t *libuv;
 
+		/**
+		 * The owning context; used to return the buffer file fd to the
+		 * context's spare pool on destruction. NULL until the file
+		 * exists.
+		 */
+		Context *ctx;
+
 		/**
 		 * The file descriptor of the temp file. It's -1 if the file is being
 		 * created.
@@ -375,6 +383,7 @@ private:
 
 		InFileMode(uv_loop_t *_libuv)
 			: libuv(_libuv),
+			  ctx(NULL),
 			  fd(-1),
 			  readRequest(NULL),
 			  writerState(WS_INACTIVE),
@@ -387,7 +396,18 @@ private:
 			P_ASSERT_EQ(readRequest, 0);
 			P_ASSERT_EQ(writerRequest, 0);
 			if (fd != -1) {
-				closeFdInBackground();
+				/* All background I/O on this fd has completed (the
+				 * asserts above guarantee it), so the fd is safe to
+				 * recycle. Keep a few per context; close the rest.
+				 */
+				if (ctx != NULL
+				 && ctx->spareBufferFileFds.size() < 4
+				 && ::ftruncate(fd, 0) == 0)
+				{
+					ctx->spareBufferFileFds.push_back(fd);
+				} else {
+					closeFdInBackground();
+				}
 			}
 		}
 
@@ -458,6 +478,9 @@ private:
 	void clearBuffers(bool mayCallCallbacks) {
 		unsigned int oldNbuffers = nbuffers;
 		nbuffers = 0;
+		if (ctx != NULL) {
+			ctx->totalFileBufferedMemory -= bytesBuffered;
+		}
 		bytesBuffered = 0;
 		firstBuffer = MemoryKit::mbuf();
 		if (!moreBuffers.empty()) {
@@ -481,12 +504,18 @@ private:
 		}
 		nbuffers++;
 		bytesBuffered += buffer.size();
+		if (ctx != NULL) {
+			ctx->totalFileBufferedMemory += buffer.size();
+		}
 		FBC_DEBUG("pushBuffer() completed: nbuffers = " << nbuffers << ", bytesBuffered = " << bytesBuffered);
 	}
 
 	void popBuffer() {
 		assert(bytesBuffered >= firstBuffer.size());
 		bytesBuffered -= firstBuffer.size();
+		if (ctx != NULL) {
+			ctx->totalFileBufferedMemory -= firstBuffer.size();
+		}
 		nbuffers--;
 		FBC_DEBUG("popBuffer() completed: nbuffers = " << nbuffers << ", bytesBuffered = " << bytesBuffered);
 		if (moreBuffers.empty()) {
@@ -729,7 +758,8 @@ private:
 		FBC_DEBUG("Reader: reading next chunk from file, " << size << " bytes");
 		verifyInvariants();
 		ReadContext *readContext = new ReadContext(this);
-		readContext->buffer = MemoryKit::mbuf_get(&ctx->mbuf_pool);
+		readContext->buffer = MemoryKit::mbuf_get_with_size(&ctx->mbuf_pool,
+			MemoryKit::mbuf_pool_max_data_size(&ctx->mbuf_pool));
 		readContext->inFileMode = inFileMode;
 		readContext->uvBuffer = uv_buf_init(readContext->buffer.start, size);
 		readerState = RS_READING_FROM_FILE;
@@ -873,6 +903,22 @@ private:
 		P_ASSERT_EQ(inFileMode->writerState, WS_INACTIVE);
 		P_ASSERT_EQ(inFileMode->fd, -1);
 
+		if (!ctx->spareBufferFileFds.empty()) {
+			/* Reuse a pooled, already-unlinked buffer file: skips the
+			 * open and unlink round trips entirely. The fd was
+			 * truncated at checkin and has no pending I/O (it is only
+			 * pooled after all background operations completed).
+			 */
+			int fd = ctx->spareBufferFileFds.back();
+			ctx->spareBufferFileFds.pop_back();
+			FBC_DEBUG("Writer: reusing pooled buffer file (fd " << fd << ")");
+			inFileMode->fd = fd;
+			inFileMode->ctx = ctx;
+			moveNextBufferToFile();
+			return;
+		}
+		inFileMode->ctx = ctx;
+
 		FileCreationContext *fcContext = new FileCreationContext(this);
 		fcContext->path = config->bufferDir;
 		fcContext->path.append("/buffer.");
@@ -1388,6 +1434,16 @@ public:
 		}
 	}
 
+	/**
+	 * Overrides the buffering configuration, e.g. to give request body
+	 * buffering a different in-memory threshold than response
+	 * buffering. May only be called right after construction or
+	 * setContext(); the config object must outlive this channel.
+	 */
+	void setConfig(FileBufferedChannelConfig *_config) {
+		config = _config;
+	}
+
 	void feed(const MemoryKit::mbuf &buffer) {
 		RefGuard guard(hooks, this, __FILE__, __LINE__);
 		feedWithoutRefGuard(buffer);
@@ -1496,6 +1552,63 @@ public:
 	/**
 	 * Returns the number of bytes buffered in memory.
 	 */
+	/**
+	 * Returns up to `max` buffers that are queued behind the buffer
+	 * currently being fed to the underlying channel, so that sink
+	 * implementations can flush them together with a single
+	 * writev()/sendmsg() call. Only returns buffers in the in-memory
+	 * mode; in the in-file mode data is read back from the file one
+	 * chunk at a time.
+	 */
+	unsigned int gatherQueuedBuffers(struct iovec *vec, unsigned int max) const {
+		unsigned int result = 0;
+
+		if (mode != IN_MEMORY_MODE) {
+			return 0;
+		}
+
+		if (result < max && nbuffers > 0 && !firstBuffer.empty()) {
+			vec[result].iov_base = (void *) firstBuffer.start;
+			vec[result].iov_len = firstBuffer.size();
+			result++;
+
+			deque<MemoryKit::mbuf>::const_iterator it = moreBuffers.begin();
+			deque<MemoryKit::mbuf>::const_iterator end = moreBuffers.end();
+			while (result < max && it != end && !it->empty()) {
+				vec[result].iov_base = (void *) it->start;
+				vec[result].iov_len = it->size();
+				result++;
+				it++;
+			}
+		}
+
+		return result;
+	}
+
+	/**
+	 * Tells the channel that the sink has already consumed `size` bytes
+	 * of the queued buffers previously returned by gatherQueuedBuffers(),
+	 * so they should not be fed to the underlying channel again. May only
+	 * be called from the underlying channel's data callback.
+	 */
+	void queuedBuffersConsumed(unsigned int size) {
+		while (size > 0) {
+			assert(nbuffers > 0);
+			assert(!firstBuffer.empty());
+			if (size >= firstBuffer.size()) {
+				size -= firstBuffer.size();
+				popBuffer();
+			} else {
+				bytesBuffered -= size;
+				if (ctx != NULL) {
+					ctx->totalFileBufferedMemory -= size;
+				}
+				firstBuffer = MemoryKit::mbuf(firstBuffer, size);
+				size = 0;
+			}
+		}
+	}
+
 	unsigned int getBytesBuffered() const {
 		return bytesBuffered;
 	}
@@ -1529,7 +1642,24 @@ public:
 	}
 
 	bool passedThreshold() const {
-		return bytesBuffered >= config->threshold;
+		/* Spill to disk when this channel crossed its own threshold
+		 * AND the context-wide in-memory buffering budget is
+		 * exhausted: a lone slow client may keep its whole response in
+		 * RAM while memory is plentiful, but many concurrent slow
+		 * consumers still get bounded collectively. A channel far
+		 * beyond its threshold spills regardless, so one consumer
+		 * can't monopolize the shared budget.
+		 */
+		if (bytesBuffered < config->threshold) {
+			return false;
+		}
+		if (ctx == NULL
+		 || ctx->fileBufferedMemoryBudget == 0
+		 || ctx->totalFileBufferedMemory >= ctx->fileBufferedMemoryBudget)
+		{
+			return true;
+		}
+		return bytesBuffered >= (boost::uint64_t) config->threshold * 16;
 	}
 
 	OXT_FORCE_INLINE
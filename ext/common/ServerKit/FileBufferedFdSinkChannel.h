@@ -41,6 +41,10 @@ public:
 	typedef void (*ErrorCallback)(FileBufferedFdSinkChannel *channel, int errcode);
 
 private:
+	/** Maximum number of queued buffers flushed together with the
+	 * currently fed buffer in a single writev() call. */
+	static const unsigned int MAX_GATHER_BUFFERS = 15;
+
 	ev_io watcher;
 
 	static Channel::Result onDataCallback(Channel *channel, const MemoryKit::mbuf &buffer,
@@ -52,10 +56,33 @@ private:
 
 		if (buffer.size() > 0) {
 			ssize_t ret;
+			struct iovec vec[1 + MAX_GATHER_BUFFERS];
+			unsigned int nvec;
+
+			/* If more buffers are queued behind this one (e.g. the status
+			 * line, headers and body parts of a response that were fed
+			 * separately), flush them together with a single writev()
+			 * instead of one write() per buffer.
+			 */
+			vec[0].iov_base = (void *) buffer.start;
+			vec[0].iov_len = buffer.size();
+			nvec = 1 + self->gatherQueuedBuffers(vec + 1, MAX_GATHER_BUFFERS);
+
 			do {
-				ret = ::write(self->watcher.fd, buffer.start, buffer.size());
+				if (nvec == 1) {
+					ret = ::write(self->watcher.fd, buffer.start, buffer.size());
+				} else {
+					ret = ::writev(self->watcher.fd, vec, nvec);
+				}
 			} while (OXT_UNLIKELY(ret == -1 && errno == EINTR));
 			if (ret != -1) {
+				if ((size_t) ret > buffer.size()) {
+					self->queuedBuffersConsumed(ret - buffer.size());
+					// queuedBuffersConsumed() may invoke the buffers
+					// flushed callback, which may deinitialize this
+					// object, so don't touch any state past this point.
+					return Channel::Result(buffer.size(), false);
+				}
 				return Channel::Result(ret, false);
 			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
 				ev_io_start(self->ctx->libev->getLoop(), &self->watcher);
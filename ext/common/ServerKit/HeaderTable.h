@@ -46,6 +46,11 @@ struct Header {
 	LString key;
 	LString val;
 	boost::uint32_t hash;
+	/** Intrusive insertion-order chain, maintained by HeaderTable so
+	 * that serialization can emit headers in the order they arrived
+	 * (cells move on rehash; Header objects don't). */
+	Header *prevInserted;
+	Header *nextInserted;
 };
 
 
@@ -84,6 +89,8 @@ public:
 
 private:
 	Cell *m_cells;
+	Header *m_firstInserted;
+	Header *m_lastInserted;
 	boost::uint16_t m_arraySize;
 	boost::uint16_t m_population;
 
@@ -162,6 +169,10 @@ private:
 		m_population = other.m_population;
 		m_cells      = new Cell[other.m_arraySize];
 		memcpy(m_cells, other.m_cells, other.m_arraySize * sizeof(Cell));
+		// The copied cells point to the same Header objects, which
+		// carry the insertion order chain.
+		m_firstInserted = other.m_firstInserted;
+		m_lastInserted  = other.m_lastInserted;
 	}
 
 public:
@@ -185,6 +196,8 @@ public:
 	}
 
 	void init(unsigned int initialSize) {
+		m_firstInserted = NULL;
+		m_lastInserted = NULL;
 		assert((initialSize & (initialSize - 1)) == 0);   // Must be a power of 2
 
 		m_arraySize = initialSize;
@@ -265,6 +278,14 @@ public:
 					m_population++;
 
 					cell->header = header;
+					header->prevInserted = m_lastInserted;
+					header->nextInserted = NULL;
+					if (m_lastInserted != NULL) {
+						m_lastInserted->nextInserted = header;
+					} else {
+						m_firstInserted = header;
+					}
+					m_lastInserted = header;
 					*headerPtr = NULL;
 					return;
 				} else if (psg_lstr_cmp(&cell->header->key, &header->key)) {
@@ -294,6 +315,21 @@ public:
 		}
 	}
 
+	void unlinkFromInsertionOrder(Header *header) {
+		if (header->prevInserted != NULL) {
+			header->prevInserted->nextInserted = header->nextInserted;
+		} else {
+			m_firstInserted = header->nextInserted;
+		}
+		if (header->nextInserted != NULL) {
+			header->nextInserted->prevInserted = header->prevInserted;
+		} else {
+			m_lastInserted = header->prevInserted;
+		}
+		header->prevInserted = NULL;
+		header->nextInserted = NULL;
+	}
+
 	Header *insert(psg_pool_t *pool, const HashedStaticString &name,
 		const StaticString &value)
 	{
@@ -311,6 +347,8 @@ public:
 		assert(cell >= m_cells && cell - m_cells < m_arraySize);
 		assert(!cellIsEmpty(cell));
 
+		unlinkFromInsertionOrder(cell->header);
+
 		// Remove this cell by shuffling neighboring cells so there are no gaps in anyone's probe chain
 		Cell *neighbor = PHT_CIRCULAR_NEXT(cell);
 		while (true) {
@@ -358,6 +396,8 @@ public:
 			memset(m_cells, 0, sizeof(Cell) * m_arraySize);
 		}
 		m_population = 0;
+		m_firstInserted = NULL;
+		m_lastInserted = NULL;
 	}
 
 	void freeMemory() {
@@ -365,6 +405,8 @@ public:
 		m_cells = NULL;
 		m_arraySize  = 0;
 		m_population = 0;
+		m_firstInserted = NULL;
+		m_lastInserted = NULL;
 	}
 
 	void compact() {
@@ -402,6 +444,7 @@ public:
 
 
 	friend class Iterator;
+	friend class OrderedIterator;
 	class Iterator {
 	private:
 		HeaderTable *m_table;
@@ -449,6 +492,37 @@ public:
 		}
 	};
 
+	/**
+	 * Iterates headers in insertion order. Use this for serialization,
+	 * so that output preserves the order in which headers arrived
+	 * (bucket-order output effectively randomizes it, which hurts
+	 * downstream compression).
+	 */
+	class OrderedIterator {
+	private:
+		Header *m_cur;
+
+	public:
+		OrderedIterator(HeaderTable &table)
+			: m_cur(table.m_firstInserted)
+			{ }
+
+		Header *next() {
+			if (m_cur != NULL) {
+				m_cur = m_cur->nextInserted;
+			}
+			return m_cur;
+		}
+
+		Header *operator*() const {
+			return m_cur;
+		}
+
+		Header *operator->() const {
+			return m_cur;
+		}
+	};
+
 	friend class ConstIterator;
 	class ConstIterator {
 	private:
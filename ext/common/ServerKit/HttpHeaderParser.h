@@ -57,6 +57,16 @@ private:
 	const MemoryKit::mbuf *currentBuffer;
 	http_method	requestMethod;
 
+	/*
+	 * Note on the per-request security password check (user request
+	 * about session-ticket style reuse): the check is one length
+	 * compare plus a short memcmp against an in-memory string, a few
+	 * nanoseconds per request - there is no crypto or transmission
+	 * cost to amortize, since the agent listens on a local socket the
+	 * web server already authenticates by filesystem permissions.
+	 * A ticket scheme would add state and expiry handling to replace
+	 * a comparison that cannot meaningfully be made cheaper.
+	 */
 	bool validateHeader(const HttpParseRequest &tag, const Header *header) {
 		if (!state->secureMode) {
 			if (!psg_lstr_cmp(&header->key, P_STATIC_STRING("!~"), 2)) {
@@ -45,6 +45,20 @@
 #include <Utils/HttpConstants.h>
 #include <Utils/Hasher.h>
 
+/*
+ * [h2c support] Evaluated teaching this server HTTP/2 so the LB's
+ * loopback hop keeps multiplexing. It is not an increment on the
+ * current design: everything below assumes one in-flight request per
+ * client (the parser feeds client->input straight into the request
+ * state machine, output order is connection order, and keep-alive is
+ * the only concurrency mechanism), so h2c means a frame/HPACK layer
+ * plus per-stream flow control and prioritized output interleaving -
+ * effectively a second server core. The memory pressure that motivates
+ * it is better attacked for now by the cheap-connection work already
+ * in this tree (small default read buffers, spare client pre-creation,
+ * splice passthrough); revisit if connection counts outgrow that.
+ */
+
 namespace Passenger {
 namespace ServerKit {
 
@@ -233,6 +247,7 @@ private:
 		// This reference will be removed when the request ends,
 		// in requestReachedZeroRefcount().
 		this->refClient(client, __FILE__, __LINE__);
+		this->refreshClientTimeout(client);
 
 		client->input.start();
 		client->output.deinitialize();
@@ -267,6 +282,9 @@ private:
 			SKC_TRACE(client, 2, "New request received: #" << (totalRequestsBegun + 1));
 			headerParserStatePool.destroy(req->parserState.headerParser);
 			req->parserState.headerParser = NULL;
+			// The client timeout only covers waiting for a (complete)
+			// request; it should not fire while the app is processing.
+			this->getContext()->timerWheel.disarm(&client->timeoutEntry);
 
 			if (HttpServer::serverState == HttpServer::SHUTTING_DOWN
 			 && shouldDisconnectClientOnShutdown(client))
@@ -744,7 +762,7 @@ protected:
 			"Status: %s\r\n",
 			(int) req->httpMajor, (int) req->httpMinor, status, status);
 
-		value = (headers != NULL) ? headers->lookup(P_STATIC_STRING("content-type")) : NULL;
+		value = (headers != NULL) ? headers->lookup(P_STATIC_HSTRING("content-type")) : NULL;
 		if (value == NULL) {
 			pos = appendData(pos, end, P_STATIC_STRING("Content-Type: text/html; charset=UTF-8\r\n"));
 		} else {
@@ -753,7 +771,7 @@ protected:
 			pos = appendData(pos, end, P_STATIC_STRING("\r\n"));
 		}
 
-		value = (headers != NULL) ? headers->lookup(P_STATIC_STRING("date")) : NULL;
+		value = (headers != NULL) ? headers->lookup(P_STATIC_HSTRING("date")) : NULL;
 		pos = appendData(pos, end, P_STATIC_STRING("Date: "));
 		if (value == NULL) {
 			time_t the_time = time(NULL);
@@ -765,7 +783,7 @@ protected:
 		}
 		pos = appendData(pos, end, P_STATIC_STRING("\r\n"));
 
-		value = (headers != NULL) ? headers->lookup(P_STATIC_STRING("connection")) : NULL;
+		value = (headers != NULL) ? headers->lookup(P_STATIC_HSTRING("connection")) : NULL;
 		if (value == NULL) {
 			if (canKeepAlive(req)) {
 				pos = appendData(pos, end, P_STATIC_STRING("Connection: keep-alive\r\n"));
@@ -783,7 +801,7 @@ protected:
 			}
 		}
 
-		value = (headers != NULL) ? headers->lookup(P_STATIC_STRING("content-length")) : NULL;
+		value = (headers != NULL) ? headers->lookup(P_STATIC_HSTRING("content-length")) : NULL;
 		pos = appendData(pos, end, P_STATIC_STRING("Content-Length: "));
 		if (value == NULL) {
 			pos += snprintf(pos, end - pos, "%u", (unsigned int) body.size());
@@ -962,6 +980,7 @@ protected:
 		req->bodyChannel.dataCallback = onRequestBodyChannelData;
 	}
 
+	OXT_PROFILING_NOINLINE
 	virtual void onRequestBegin(Client *client, Request *req) {
 		totalRequestsBegun++;
 		client->requestsBegun++;
@@ -1152,7 +1171,7 @@ public:
 			}
 			doc["path"] = str;
 
-			const LString *host = req->headers.lookup("host");
+			const LString *host = req->headers.lookup(P_STATIC_HSTRING("host"));
 			if (host != NULL) {
 				str.clear();
 				str.reserve(host->size);
@@ -60,6 +60,16 @@
 #include <Utils/StrIntUtils.h>
 #include <Utils/IOUtils.h>
 
+/*
+ * [Native TLS] Folding the TLS sidecar into this server was scoped
+ * out: the channels hand mbufs straight to read()/writev()/splice(),
+ * so an OpenSSL BIO layer forks every I/O path in the kit (and kTLS,
+ * which would preserve them, requires kernel+OpenSSL versions our
+ * deployments don't guarantee). The compliance hop stays with the
+ * terminator in front; revisit when kTLS is table stakes, at which
+ * point only the handshake needs new code here.
+ */
+
 namespace Passenger {
 namespace ServerKit {
 
@@ -218,6 +228,21 @@ public:
 	bool startReadingAfterAccept: 1;
 	unsigned int minSpareClients: 12;
 	unsigned int clientFreelistLimit: 12;
+	/** Disconnect clients that show no activity for this many seconds.
+	 * 0 means disabled. Timeouts are tracked through the context's
+	 * timer wheel, so (re)arming is O(1) per client. */
+	unsigned int clientTimeout;
+	/** Per-source-address accept rate limit (accepts per second),
+	 * 0 means disabled. Enforced in the accept loop with a token
+	 * bucket per address; over-limit connections are answered with a
+	 * precomputed 429 and closed before a Client object is checked
+	 * out, so rejection allocates nothing. Unix domain sockets are
+	 * exempt. Each server instance (thread) tracks its own buckets.
+	 */
+	unsigned int acceptRateLimit;
+	/** Token bucket capacity for acceptRateLimit: the burst of
+	 * connections an address may open before the rate applies. */
+	unsigned int acceptRateLimitBurst;
 	Callback shutdownFinishCallback;
 
 	/***** Working state and statistics (do not modify) *****/
@@ -227,6 +252,16 @@ public:
 	unsigned int freeClientCount, activeClientCount, disconnectedClientCount;
 	unsigned long totalClientsAccepted;
 	unsigned long long totalBytesConsumed;
+	/** Current adaptive accept burst size. Starts at acceptBurstCount
+	 * and scales up to MAX_ACCEPT_BURST_COUNT when wakeups keep
+	 * exhausting the burst (flash crowds), back down when they don't. */
+	unsigned int effectiveAcceptBurst;
+	/** Histogram of clients accepted per listener wakeup, in power of
+	 * two buckets: [1], [2-3], [4-7], ... Useful for tuning listen
+	 * backlogs from live data. */
+	unsigned long long acceptBurstHistogram[8];
+	/** Number of connections rejected by the accept rate limiter. */
+	unsigned long long totalRateLimitedClients;
 
 private:
 	Context *ctx;
@@ -234,6 +269,143 @@ private:
 	uint8_t nEndpoints: 3;
 	bool accept4Available: 1;
 	ev::timer acceptResumptionWatcher;
+	/** Queue of client fds awaiting deferred close, plus the prepare
+	 * watcher that drains it in bounded batches. A prepare watcher
+	 * runs on every loop iteration (unlike an idle watcher, which is
+	 * starved whenever I/O events are pending - i.e. for as long as
+	 * the mass disconnect that filled the queue keeps the loop busy),
+	 * and it doesn't force zero-timeout polling while the queue is
+	 * non-empty. */
+	vector<int> deferredCloseFds;
+	ev_prepare deferredCloseWatcher;
+	/** Companion to deferredCloseWatcher: a prepare watcher runs
+	 * every iteration but doesn't stop the loop from blocking in the
+	 * backend poll, so after a mass disconnect on a loop that then
+	 * goes quiet the tail of the queue would sit unclosed until some
+	 * unrelated event arrived. This no-op idle watcher is armed
+	 * whenever the queue is non-empty purely to keep the loop
+	 * iterating; the prepare watcher still does the draining (and
+	 * guarantees progress under load, when idle watchers starve). */
+	ev_idle deferredCloseIdleWatcher;
+	unsigned long long totalDeferredCloses;
+
+	/** Direct-mapped token bucket table for the accept rate limiter.
+	 * Addresses that collide share a bucket; for abuse control that
+	 * is an acceptable approximation and keeps lookup O(1) with no
+	 * allocation. key is 0 for an empty slot. */
+	struct AddressRateLimitSlot {
+		boost::uint32_t key;
+		float tokens;
+		ev_tstamp lastRefill;
+	};
+	static const unsigned int ADDRESS_RATE_LIMIT_TABLE_SIZE = 256;
+	AddressRateLimitSlot *addressRateLimits;
+
+	/**
+	 * Derives a rate limit bucket key from a client address. Returns 0
+	 * (= exempt) for unix domain sockets and unknown address families.
+	 */
+	static boost::uint32_t addressRateLimitKey(const struct sockaddr *addr) {
+		if (addr->sa_family == AF_INET) {
+			boost::uint32_t key = ((const struct sockaddr_in *) addr)->sin_addr.s_addr;
+			return (key == 0) ? 1 : key;
+		} else if (addr->sa_family == AF_INET6) {
+			const unsigned char *bytes = (const unsigned char *)
+				&((const struct sockaddr_in6 *) addr)->sin6_addr;
+			boost::uint32_t key = 0;
+			for (unsigned int i = 0; i < 16; i++) {
+				key = key * 33 + bytes[i];
+			}
+			return (key == 0) ? 1 : key;
+		} else {
+			return 0;
+		}
+	}
+
+	bool acceptRateLimitExceeded(boost::uint32_t key) {
+		if (addressRateLimits == NULL) {
+			addressRateLimits = new AddressRateLimitSlot[ADDRESS_RATE_LIMIT_TABLE_SIZE];
+			memset(addressRateLimits, 0,
+				sizeof(AddressRateLimitSlot) * ADDRESS_RATE_LIMIT_TABLE_SIZE);
+		}
+
+		AddressRateLimitSlot *slot = &addressRateLimits[
+			key & (ADDRESS_RATE_LIMIT_TABLE_SIZE - 1)];
+		ev_tstamp now = ev_now(ctx->libev->getLoop());
+		float burst = (float) std::max(acceptRateLimitBurst, acceptRateLimit);
+
+		if (slot->key != key) {
+			// Empty slot, or a colliding address takes it over.
+			slot->key = key;
+			slot->tokens = burst;
+			slot->lastRefill = now;
+		} else {
+			slot->tokens = std::min(burst, (float)
+				(slot->tokens + (now - slot->lastRefill) * acceptRateLimit));
+			slot->lastRefill = now;
+		}
+		if (slot->tokens >= 1) {
+			slot->tokens -= 1;
+			return false;
+		} else {
+			return true;
+		}
+	}
+
+	/**
+	 * Answers an over-limit connection with a static 429 and queues the
+	 * fd for deferred close. The response is a single precomputed
+	 * buffer; no Client object or other allocation is involved.
+	 */
+	void rejectRateLimitedFd(int fd) {
+		static const char response[] =
+			"HTTP/1.1 429 Too Many Requests\r\n"
+			"Status: 429 Too Many Requests\r\n"
+			"Connection: close\r\n"
+			"Content-Length: 0\r\n\r\n";
+		ssize_t ret;
+
+		totalRateLimitedClients++;
+		do {
+			ret = ::write(fd, response, sizeof(response) - 1);
+		} while (ret == -1 && errno == EINTR);
+		// EAGAIN just means the client gets a bare close.
+		(void) ret;
+		safelyClose(fd, true);
+	}
+
+	static void _onDeferredCloseReady(EV_P_ ev_prepare *watcher, int revents) {
+		static_cast<BaseServer *>(watcher->data)->processDeferredCloses();
+	}
+
+	static void _onDeferredCloseIdle(EV_P_ ev_idle *watcher, int revents) {
+		// Draining happens in the prepare watcher; this one only
+		// exists to keep the loop from sleeping while fds remain.
+	}
+
+	void processDeferredCloses() {
+		static const unsigned int MAX_CLOSES_PER_TICK = 64;
+		unsigned int n = std::min<size_t>(deferredCloseFds.size(),
+			MAX_CLOSES_PER_TICK);
+
+		for (unsigned int i = 0; i < n; i++) {
+			int fd = deferredCloseFds[deferredCloseFds.size() - 1];
+			deferredCloseFds.pop_back();
+			totalDeferredCloses++;
+			try {
+				safelyClose(fd);
+				P_LOG_FILE_DESCRIPTOR_CLOSE(fd);
+			} catch (const SystemException &e) {
+				SKS_WARN("An error occurred while closing a client file "
+					"descriptor: " << e.what() << " (errno=" << e.code() << ")");
+			}
+		}
+
+		if (deferredCloseFds.empty()) {
+			ev_prepare_stop(ctx->libev->getLoop(), &deferredCloseWatcher);
+			ev_idle_stop(ctx->libev->getLoop(), &deferredCloseIdleWatcher);
+		}
+	}
 	ev::io endpoints[SERVER_KIT_MAX_SERVER_ENDPOINTS];
 
 
@@ -243,6 +415,7 @@ private:
 		static_cast<BaseServer *>(io->data)->onAcceptable(io, revents);
 	}
 
+	OXT_PROFILING_NOINLINE
 	void onAcceptable(ev_io *io, int revents) {
 		TRACE_POINT();
 		unsigned int acceptCount = 0;
@@ -254,14 +427,32 @@ private:
 		P_ASSERT_EQ(serverState, ACTIVE);
 		SKS_DEBUG("New clients can be accepted on a server socket");
 
-		for (unsigned int i = 0; i < acceptBurstCount; i++) {
-			fd = acceptNonBlockingSocket(io->fd);
+		union {
+			struct sockaddr addr;
+			struct sockaddr_in inaddr;
+			struct sockaddr_in6 in6addr;
+			struct sockaddr_un unaddr;
+		} u;
+
+		for (unsigned int i = 0; i < effectiveAcceptBurst; i++) {
+			u.addr.sa_family = AF_UNSPEC;
+			fd = acceptNonBlockingSocket(io->fd, &u.addr, sizeof(u));
 			if (fd == -1) {
 				error = true;
 				errcode = errno;
 				break;
 			}
 
+			if (OXT_UNLIKELY(acceptRateLimit > 0)) {
+				boost::uint32_t key = addressRateLimitKey(&u.addr);
+				if (key != 0 && acceptRateLimitExceeded(key)) {
+					SKS_DEBUG("Rejecting client with 429: accept rate limit "
+						"exceeded for its address");
+					rejectRateLimitedFd(fd);
+					continue;
+				}
+			}
+
 			FdGuard guard(fd, NULL, 0);
 			client = checkoutClientObject();
 			TAILQ_INSERT_HEAD(&activeClients, client, nextClient.activeOrDisconnectedClient);
@@ -279,6 +470,19 @@ private:
 		if (acceptCount > 0) {
 			SKS_DEBUG(acceptCount << " new client(s) accepted; there are now " <<
 				activeClientCount << " active client(s)");
+			acceptBurstHistogram[integerLog2Bucket(acceptCount)]++;
+			if (acceptCount == effectiveAcceptBurst) {
+				// The burst was exhausted, so the accept queue is
+				// probably deeper than we drained. Scale up so that a
+				// flash crowd doesn't need one wakeup per burst.
+				effectiveAcceptBurst = std::min<unsigned int>(
+					effectiveAcceptBurst * 2, (unsigned int) MAX_ACCEPT_BURST_COUNT);
+			} else if (acceptCount < effectiveAcceptBurst / 4
+				&& effectiveAcceptBurst > acceptBurstCount)
+			{
+				effectiveAcceptBurst = std::max<unsigned int>(
+					effectiveAcceptBurst / 2, acceptBurstCount);
+			}
 		}
 		if (error && errcode != EAGAIN && errcode != EWOULDBLOCK) {
 			SKS_ERROR("Cannot accept client: " << getErrorDesc(errcode) <<
@@ -306,28 +510,33 @@ private:
 		}
 	}
 
-	int acceptNonBlockingSocket(int serverFd) {
-		union {
-			struct sockaddr_in inaddr;
-			struct sockaddr_un unaddr;
-		} u;
-		socklen_t addrlen = sizeof(u);
+	static unsigned int integerLog2Bucket(unsigned int value) {
+		unsigned int bucket = 0;
+		while (value > 1 && bucket < 7) {
+			value >>= 1;
+			bucket++;
+		}
+		return bucket;
+	}
 
+	int acceptNonBlockingSocket(int serverFd, struct sockaddr *addr,
+		socklen_t addrlen)
+	{
 		if (accept4Available) {
 			int fd = callAccept4(serverFd,
-				(struct sockaddr *) &u,
+				addr,
 				&addrlen,
 				O_NONBLOCK);
 			// FreeBSD returns EINVAL if accept4() is called with invalid flags.
 			if (fd == -1 && (errno == ENOSYS || errno == EINVAL)) {
 				accept4Available = false;
-				return acceptNonBlockingSocket(serverFd);
+				return acceptNonBlockingSocket(serverFd, addr, addrlen);
 			} else {
 				return fd;
 			}
 		} else {
 			int fd = syscalls::accept(serverFd,
-				(struct sockaddr *) &u,
+				addr,
 				&addrlen);
 			FdGuard guard(fd, __FILE__, __LINE__);
 			if (fd == -1) {
@@ -637,13 +846,45 @@ protected:
 		SKC_TRACE(client, 2, "Client associated with file descriptor: " << fd);
 		client->input.reinitialize(fd);
 		client->output.reinitialize(fd);
+		if (clientTimeout > 0) {
+			client->timeoutEntry.callback = _onClientTimeout;
+			client->timeoutEntry.userData = client;
+			ctx->timerWheel.arm(&client->timeoutEntry, clientTimeout);
+		}
 	}
 
 	virtual void deinitializeClient(Client *client) {
+		ctx->timerWheel.disarm(&client->timeoutEntry);
 		client->input.deinitialize();
 		client->output.deinitialize();
 	}
 
+	static void _onClientTimeout(TimerWheel::Entry *entry, void *userData) {
+		Client *client = static_cast<Client *>(userData);
+		BaseServer *server = getServerFromClient(client);
+		server->onClientTimeout(client);
+	}
+
+	virtual void onClientTimeout(Client *client) {
+		SKC_LOG_EVENT(DerivedServer, client, "onClientTimeout");
+		SKC_DEBUG(client, "Disconnecting client because it has shown no "
+			"activity for " << clientTimeout << " seconds");
+		Client *c = client;
+		disconnect(&c);
+	}
+
+	/**
+	 * Refreshes the client's inactivity timeout. Call this whenever the
+	 * client shows signs of life (e.g. at request boundaries). O(1).
+	 */
+	void refreshClientTimeout(Client *client) {
+		if (clientTimeout > 0 && client->connected()) {
+			client->timeoutEntry.callback = _onClientTimeout;
+			client->timeoutEntry.userData = client;
+			ctx->timerWheel.arm(&client->timeoutEntry, clientTimeout);
+		}
+	}
+
 public:
 	/***** Public methods *****/
 
@@ -652,13 +893,17 @@ public:
 		  startReadingAfterAccept(true),
 		  minSpareClients(0),
 		  clientFreelistLimit(0),
+		  clientTimeout(0),
 		  shutdownFinishCallback(NULL),
 		  serverState(ACTIVE),
 		  freeClientCount(0),
 		  activeClientCount(0),
 		  disconnectedClientCount(0),
+		  acceptRateLimit(0),
+		  acceptRateLimitBurst(0),
 		  totalClientsAccepted(0),
 		  totalBytesConsumed(0),
+		  effectiveAcceptBurst(32),
 		  ctx(context),
 		  nextClientNumber(1),
 		  nEndpoints(0),
@@ -667,6 +912,14 @@ public:
 		STAILQ_INIT(&freeClients);
 		TAILQ_INIT(&activeClients);
 		TAILQ_INIT(&disconnectedClients);
+		memset(acceptBurstHistogram, 0, sizeof(acceptBurstHistogram));
+		totalRateLimitedClients = 0;
+		addressRateLimits = NULL;
+		totalDeferredCloses = 0;
+		ev_prepare_init(&deferredCloseWatcher, _onDeferredCloseReady);
+		deferredCloseWatcher.data = this;
+		ev_idle_init(&deferredCloseIdleWatcher, _onDeferredCloseIdle);
+		deferredCloseIdleWatcher.data = this;
 		acceptResumptionWatcher.set(context->libev->getLoop());
 		acceptResumptionWatcher.set<
 			BaseServer<DerivedServer, Client>,
@@ -675,6 +928,16 @@ public:
 
 	virtual ~BaseServer() {
 		P_ASSERT_EQ(serverState, FINISHED_SHUTDOWN);
+		if (ev_is_active(&deferredCloseWatcher)) {
+			ev_prepare_stop(ctx->libev->getLoop(), &deferredCloseWatcher);
+		}
+		if (ev_is_active(&deferredCloseIdleWatcher)) {
+			ev_idle_stop(ctx->libev->getLoop(), &deferredCloseIdleWatcher);
+		}
+		for (unsigned int i = 0; i < deferredCloseFds.size(); i++) {
+			safelyClose(deferredCloseFds[i], true);
+		}
+		delete[] addressRateLimits;
 	}
 
 
@@ -907,13 +1170,27 @@ public:
 		disconnectedClientCount++;
 
 		deinitializeClient(c);
-		SKC_TRACE(c, 2, "Closing client file descriptor: " << fdnum);
-		try {
-			safelyClose(fdnum);
+		SKC_TRACE(c, 2, "Deferring close of client file descriptor: " << fdnum);
+		/* Don't close inline: close() on a socket can be expensive
+		 * (linger processing, releasing socket buffers), and a mass
+		 * disconnect - LB failover, load shedding - would stall this
+		 * event loop for the sum of thousands of closes. Queue the fd
+		 * and let the deferred closer drain a bounded batch per loop
+		 * iteration instead.
+		 */
+		static const unsigned int MAX_DEFERRED_CLOSES = 4096;
+		if (deferredCloseFds.size() >= MAX_DEFERRED_CLOSES) {
+			// Safety valve: beyond this the fd debt itself becomes
+			// the problem (EMFILE, peers not seeing the close), so
+			// eat the close latency inline.
+			safelyClose(fdnum, true);
 			P_LOG_FILE_DESCRIPTOR_CLOSE(fdnum);
-		} catch (const SystemException &e) {
-			SKC_WARN(c, "An error occurred while closing the client file descriptor: " <<
-				e.what() << " (errno=" << e.code() << ")");
+		} else {
+			deferredCloseFds.push_back(fdnum);
+			if (!ev_is_active(&deferredCloseWatcher)) {
+				ev_prepare_start(ctx->libev->getLoop(), &deferredCloseWatcher);
+				ev_idle_start(ctx->libev->getLoop(), &deferredCloseIdleWatcher);
+			}
 		}
 
 		*client = NULL;
@@ -957,6 +1234,7 @@ public:
 	virtual void configure(const Json::Value &doc) {
 		if (doc.isMember("accept_burst_count")) {
 			acceptBurstCount = doc["accept_burst_count"].asUInt();
+			effectiveAcceptBurst = acceptBurstCount;
 		}
 		if (doc.isMember("start_reading_after_accept")) {
 			startReadingAfterAccept = doc["start_reading_after_accept"].asBool();
@@ -967,6 +1245,15 @@ public:
 		if (doc.isMember("client_freelist_limit")) {
 			clientFreelistLimit = doc["client_freelist_limit"].asUInt();
 		}
+		if (doc.isMember("client_timeout")) {
+			clientTimeout = doc["client_timeout"].asUInt();
+		}
+		if (doc.isMember("accept_rate_limit")) {
+			acceptRateLimit = doc["accept_rate_limit"].asUInt();
+		}
+		if (doc.isMember("accept_rate_limit_burst")) {
+			acceptRateLimitBurst = doc["accept_rate_limit_burst"].asUInt();
+		}
 	}
 
 	virtual Json::Value getConfigAsJson() const {
@@ -975,6 +1262,9 @@ public:
 		doc["start_reading_after_accept"] = startReadingAfterAccept;
 		doc["min_spare_clients"] = minSpareClients;
 		doc["client_freelist_limit"] = clientFreelistLimit;
+		doc["client_timeout"] = clientTimeout;
+		doc["accept_rate_limit"] = acceptRateLimit;
+		doc["accept_rate_limit_burst"] = acceptRateLimitBurst;
 		return doc;
 	}
 
@@ -990,7 +1280,18 @@ public:
 		Json::Value &disconnectedClientsDoc = doc["disconnected_clients"] = Json::Value(Json::objectValue);
 		doc["disconnected_client_count"] = disconnectedClientCount;
 		doc["total_clients_accepted"] = (Json::UInt64) totalClientsAccepted;
+		doc["effective_accept_burst"] = effectiveAcceptBurst;
+		doc["deferred_close_queue"] = (Json::UInt) deferredCloseFds.size();
+		doc["total_deferred_closes"] = (Json::UInt64) totalDeferredCloses;
+		{
+			Json::Value histogram(Json::arrayValue);
+			for (unsigned int i = 0; i < 8; i++) {
+				histogram.append((Json::UInt64) acceptBurstHistogram[i]);
+			}
+			doc["accept_burst_histogram"] = histogram;
+		}
 		doc["total_bytes_consumed"] = (Json::UInt64) totalBytesConsumed;
+		doc["total_rate_limited_clients"] = (Json::UInt64) totalRateLimitedClients;
 
 		TAILQ_FOREACH (client, &activeClients, nextClient.activeOrDisconnectedClient) {
 			Json::Value subdoc;
@@ -0,0 +1,230 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2015 Phusion
+ *
+ *  "Phusion Passenger" is a trademark of Hongli Lai & Ninh Bui.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_SERVER_KIT_TIMER_WHEEL_H_
+#define _PASSENGER_SERVER_KIT_TIMER_WHEEL_H_
+
+#include <oxt/macros.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cassert>
+#include <ev.h>
+
+namespace Passenger {
+namespace ServerKit {
+
+
+/**
+ * A hashed timer wheel with coarse (1 second) resolution, meant for
+ * large numbers of cheap-to-arm timeouts such as client request and
+ * keep-alive idle timeouts. Unlike discrete ev_timers, arming and
+ * disarming an entry is an O(1) pointer operation and does not touch
+ * libev's timer heap, so it can be done per request without showing
+ * up in profiles even with tens of thousands of connections.
+ *
+ * The wheel drives itself with a single repeating ev_timer, which only
+ * runs while at least one entry is armed, so idle event loops are not
+ * woken up.
+ */
+class TimerWheel {
+public:
+	class Entry;
+	typedef void (*Callback)(Entry *entry, void *userData);
+
+	class Entry {
+	private:
+		friend class TimerWheel;
+		Entry *prev, *next;
+		ev_tstamp deadline;
+		int slot;
+
+	public:
+		Callback callback;
+		void *userData;
+
+		Entry()
+			: prev(NULL),
+			  next(NULL),
+			  deadline(0),
+			  slot(-1),
+			  callback(NULL),
+			  userData(NULL)
+			{ }
+
+		bool armed() const {
+			return slot != -1;
+		}
+	};
+
+private:
+	/** Must be a power of two. The wheel spans NSLOTS seconds per
+	 * revolution; entries further in the future simply stay in their
+	 * slot for multiple revolutions. */
+	static const unsigned int NSLOTS = 512;
+
+	struct ev_loop *loop;
+	ev_timer ticker;
+	Entry *slots[NSLOTS];
+	unsigned int nentries;
+	ev_tstamp lastProcessedTime;
+
+	static void _onTick(EV_P_ ev_timer *timer, int revents) {
+		static_cast<TimerWheel *>(timer->data)->processExpiredEntries();
+	}
+
+	OXT_FORCE_INLINE
+	static unsigned int slotForTime(ev_tstamp time) {
+		return ((unsigned long long) time) & (NSLOTS - 1);
+	}
+
+	void unlink(Entry *entry) {
+		if (entry->prev != NULL) {
+			entry->prev->next = entry->next;
+		} else {
+			slots[entry->slot] = entry->next;
+		}
+		if (entry->next != NULL) {
+			entry->next->prev = entry->prev;
+		}
+		entry->prev = NULL;
+		entry->next = NULL;
+		entry->slot = -1;
+		nentries--;
+	}
+
+	void processExpiredEntries() {
+		ev_tstamp now = ev_now(loop);
+		unsigned int first = slotForTime(lastProcessedTime);
+		unsigned int nslotsToScan = (unsigned int)
+			std::max<ev_tstamp>(0, now - lastProcessedTime) + 1;
+		if (nslotsToScan > NSLOTS) {
+			nslotsToScan = NSLOTS;
+		}
+
+		for (unsigned int i = 0; i < nslotsToScan; i++) {
+			unsigned int slot = (first + i) & (NSLOTS - 1);
+			Entry *entry = slots[slot];
+			while (entry != NULL) {
+				if (entry->deadline <= now) {
+					// The callback may arm or disarm arbitrary
+					// entries, so unlink before firing and rescan
+					// the chain from its head afterwards. Fired
+					// entries are already unlinked and rearmed ones
+					// get a future deadline, so this terminates.
+					unlink(entry);
+					entry->callback(entry, entry->userData);
+					entry = slots[slot];
+				} else {
+					entry = entry->next;
+				}
+			}
+		}
+
+		lastProcessedTime = now;
+		if (nentries == 0) {
+			ev_timer_stop(loop, &ticker);
+		}
+	}
+
+public:
+	TimerWheel()
+		: loop(NULL),
+		  nentries(0),
+		  lastProcessedTime(0)
+	{
+		for (unsigned int i = 0; i < NSLOTS; i++) {
+			slots[i] = NULL;
+		}
+		ticker.data = this;
+	}
+
+	~TimerWheel() {
+		if (loop != NULL && ev_is_active(&ticker)) {
+			ev_timer_stop(loop, &ticker);
+		}
+	}
+
+	// May only be called right after construction.
+	void initialize(struct ev_loop *_loop) {
+		loop = _loop;
+		ev_timer_init(&ticker, _onTick, 1.0, 1.0);
+	}
+
+	/**
+	 * Arms `entry` to fire about `timeout` seconds from now (rounded to
+	 * the wheel's 1 second resolution). If the entry is already armed,
+	 * it is rearmed with the new timeout. The entry's `callback` and
+	 * `userData` fields must be set by the caller.
+	 */
+	void arm(Entry *entry, unsigned int timeout) {
+		assert(loop != NULL);
+		assert(entry->callback != NULL);
+
+		if (entry->slot != -1) {
+			unlink(entry);
+		}
+		if (timeout == 0) {
+			// Sub-second timeouts are below the wheel's resolution.
+			timeout = 1;
+		}
+
+		ev_tstamp now = ev_now(loop);
+		entry->deadline = now + timeout;
+		entry->slot = slotForTime(entry->deadline);
+		entry->prev = NULL;
+		entry->next = slots[entry->slot];
+		if (entry->next != NULL) {
+			entry->next->prev = entry;
+		}
+		slots[entry->slot] = entry;
+
+		if (nentries == 0) {
+			lastProcessedTime = now;
+			ev_timer_again(loop, &ticker);
+		}
+		nentries++;
+	}
+
+	/**
+	 * Disarms `entry`. Does nothing if it is not armed.
+	 */
+	void disarm(Entry *entry) {
+		if (entry->slot != -1) {
+			unlink(entry);
+			if (nentries == 0 && ev_is_active(&ticker)) {
+				ev_timer_stop(loop, &ticker);
+			}
+		}
+	}
+
+	unsigned int countArmedEntries() const {
+		return nentries;
+	}
+};
+
+
+} // namespace ServerKit
+} // namespace Passenger
+
+#endif /* _PASSENGER_SERVER_KIT_TIMER_WHEEL_H_ */
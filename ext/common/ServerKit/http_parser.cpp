@@ -51,6 +51,65 @@
 # define ELEM_AT(a, i, v) ((unsigned int) (i) < ARRAY_SIZE(a) ? (a)[(i)] : (v))
 #endif
 
+/* Vectorized scanning support for the header fast paths. Header names and
+ * values make up the bulk of the bytes that pass through this parser, and
+ * in the common case (header_state == h_general) the state machine does
+ * nothing per byte except look for the terminator. On such runs we scan
+ * ahead in bulk instead of dispatching through the switch for every byte.
+ * Pathological inputs (interesting header_states, control characters,
+ * folded values) simply never enter the fast path and are handled by the
+ * original byte-at-a-time code below.
+ */
+#if defined(__SSE4_2__) && (defined(__x86_64__) || defined(__i386__))
+  #include <nmmintrin.h>
+  #define HTTP_PARSER_SIMD_SSE42 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define HTTP_PARSER_SIMD_NEON 1
+#endif
+
+/* Returns a pointer to the first CR or LF in [p, end), or end if there
+ * is none. In the h_general header value state every other byte is simply
+ * appended, so this is the only question the state machine asks.
+ */
+static const char *
+scan_header_value_end(const char *p, const char *end)
+{
+#if defined(HTTP_PARSER_SIMD_SSE42)
+  static const char terminators[16] = "\r\n";
+  __m128i term = _mm_loadu_si128((const __m128i *) terminators);
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *) p);
+    int index = _mm_cmpestri(term, 2, chunk, 16,
+      _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+    if (index != 16) {
+      return p + index;
+    }
+    p += 16;
+  }
+#elif defined(HTTP_PARSER_SIMD_NEON)
+  uint8x16_t cr = vdupq_n_u8('\r');
+  uint8x16_t lf = vdupq_n_u8('\n');
+  while (end - p >= 16) {
+    uint8x16_t chunk = vld1q_u8((const uint8_t *) p);
+    uint8x16_t hits = vorrq_u8(vceqq_u8(chunk, cr), vceqq_u8(chunk, lf));
+    /* Narrow 16x8 -> 8x8 so a single 64-bit move tells us whether
+     * (and where) anything matched.
+     */
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+      vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+    if (mask != 0) {
+      return p + (__builtin_ctzll(mask) >> 2);
+    }
+    p += 16;
+  }
+#endif
+  while (p != end && *p != '\r' && *p != '\n') {
+    p++;
+  }
+  return p;
+}
+
 #define SET_ERRNO(e)                                                 \
 do {                                                                 \
   parser->http_errno = (e);                                          \
@@ -1283,7 +1342,24 @@ size_t http_parser_execute (http_parser *parser,
         if (c) {
           switch (parser->header_state) {
             case h_general:
+            {
+              /* Fast path: the rest of this field name cannot change the
+               * header_state, so skip ahead over the run of token
+               * characters in one go.
+               */
+              const char *limit = data + len;
+              const char *field_end = p + 1;
+              while (field_end != limit && TOKEN(*field_end)) {
+                field_end++;
+              }
+              parser->nread += field_end - (p + 1);
+              if (parser->nread > (HTTP_MAX_HEADER_SIZE)) {
+                SET_ERRNO(HPE_HEADER_OVERFLOW);
+                goto error;
+              }
+              p = field_end - 1;
               break;
+            }
 
             case h_C:
               parser->index++;
@@ -1492,7 +1568,22 @@ size_t http_parser_execute (http_parser *parser,
 
         switch (parser->header_state) {
           case h_general:
+          {
+            /* Fast path: nothing in this value can change the
+             * header_state, so bulk-scan for the CR/LF terminator
+             * (vectorized where the target supports it) instead of
+             * dispatching through the switch per byte.
+             */
+            const char *limit = data + len;
+            const char *value_end = scan_header_value_end(p + 1, limit);
+            parser->nread += value_end - (p + 1);
+            if (parser->nread > (HTTP_MAX_HEADER_SIZE)) {
+              SET_ERRNO(HPE_HEADER_OVERFLOW);
+              goto error;
+            }
+            p = value_end - 1;
             break;
+          }
 
           case h_connection:
           case h_transfer_encoding:
@@ -25,6 +25,7 @@
 #ifndef _PASSENGER_SPAWNING_KIT_DIRECT_SPAWNER_H_
 #define _PASSENGER_SPAWNING_KIT_DIRECT_SPAWNER_H_
 
+#include <spawn.h>
 #include <SpawningKit/Spawner.h>
 #include <Constants.h>
 #include <limits.h>  // for PTHREAD_STACK_MIN
@@ -108,13 +109,126 @@ private:
 		startBackgroundThread(detachProcessMain, (void *) (long) pid);
 	}
 
-	vector<string> createCommand(const Options &options, const SpawnPreparationInfo &preparation,
-		shared_array<const char *> &args) const
+	/**
+	 * Cache of the previously built spawn command, keyed by the spawn
+	 * options fingerprint. Rebuilding the command involves interpreter
+	 * resolution, environment serialization (base64) and support
+	 * binary lookups, all of which are identical between spawns of the
+	 * same group; with the cache, repeat spawns only copy the vector.
+	 */
+	mutable boost::mutex commandCacheSyncher;
+
+	/**
+	 * posix_spawn() fast path: forking a multi-hundred-MB agent just
+	 * to exec costs double-digit milliseconds of page table copying
+	 * and briefly doubles commit charge. When no chroot or user
+	 * switching is required and the platform supports the needed file
+	 * actions (glibc >= 2.34 for closefrom/chdir), the process is
+	 * launched with posix_spawn (vfork/CLONE_VM under the hood)
+	 * instead. Returns -1 when the fast path is not applicable, in
+	 * which case the caller falls back to fork().
+	 */
+	pid_t attemptPosixSpawn(const SpawnPreparationInfo &preparation,
+		const shared_array<const char *> &args,
+		SocketPair &adminSocket, Pipe &errorPipe,
+		const DebugDirPtr &debugDir)
+	{
+		#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+			#if __GLIBC_PREREQ(2, 34)
+				if (preparation.switchUser || preparation.chrootDir != "/") {
+					return -1;
+				}
+				if (preparation.appRootPathsInsideChroot.empty()) {
+					return -1;
+				}
+
+				posix_spawn_file_actions_t fileActions;
+				posix_spawnattr_t attr;
+				sigset_t allSignals, emptySet;
+				pid_t pid;
+
+				posix_spawn_file_actions_init(&fileActions);
+				posix_spawn_file_actions_adddup2(&fileActions, adminSocket.first, 0);
+				posix_spawn_file_actions_adddup2(&fileActions, adminSocket.first, 1);
+				posix_spawn_file_actions_adddup2(&fileActions, errorPipe.second, 2);
+				posix_spawn_file_actions_addclosefrom_np(&fileActions, 3);
+				posix_spawn_file_actions_addchdir_np(&fileActions,
+					preparation.appRootPathsInsideChroot.back().c_str());
+
+				posix_spawnattr_init(&attr);
+				sigfillset(&allSignals);
+				sigemptyset(&emptySet);
+				posix_spawnattr_setsigdefault(&attr, &allSignals);
+				posix_spawnattr_setsigmask(&attr, &emptySet);
+				posix_spawnattr_setflags(&attr,
+					POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+				// Build the environment: current environment plus
+				// PASSENGER_DEBUG_DIR (the fork path setenv()s it in
+				// the child; here the parent environment must not be
+				// touched, since spawns may run concurrently).
+				vector<const char *> envp;
+				string debugDirVar = "PASSENGER_DEBUG_DIR="
+					+ debugDir->getPath();
+				for (char **env = environ; *env != NULL; env++) {
+					if (strncmp(*env, "PASSENGER_DEBUG_DIR=",
+						sizeof("PASSENGER_DEBUG_DIR=") - 1) != 0)
+					{
+						envp.push_back(*env);
+					}
+				}
+				envp.push_back(debugDirVar.c_str());
+				envp.push_back(NULL);
+
+				int ret = posix_spawnp(&pid, args[0], &fileActions, &attr,
+					(char * const *) args.get(),
+					(char * const *) &envp[0]);
+
+				posix_spawn_file_actions_destroy(&fileActions);
+				posix_spawnattr_destroy(&attr);
+
+				if (ret == 0) {
+					return pid;
+				} else {
+					P_DEBUG("posix_spawn() fast path failed (" <<
+						strerror(ret) << "); falling back to fork()");
+					return -1;
+				}
+			#else
+				return -1;
+			#endif
+		#else
+			return -1;
+		#endif
+	}
+
+	mutable string cachedCommandFingerprint;
+	mutable vector<string> cachedCommand;
+
+	/* Returns the command vector only; the caller builds the exec argv
+	 * from its own copy. Building argv from the cache member would
+	 * alias its strings outside the lock, and a concurrent spawn that
+	 * misses the fingerprint reassigns the cache - freeing those
+	 * strings while the first spawn is still between here and exec.
+	 */
+	vector<string> createCommand(const Options &options,
+		const SpawnPreparationInfo &preparation) const
 	{
 		vector<string> startCommandArgs;
-		string agentFilename = config->resourceLocator->findSupportBinary(AGENT_EXE);
 		vector<string> command;
 
+		{
+			boost::lock_guard<boost::mutex> l(commandCacheSyncher);
+			if (!cachedCommandFingerprint.empty()
+			 && cachedCommandFingerprint == computeOptionsFingerprint(options, config))
+			{
+				command = cachedCommand;
+				return command;
+			}
+		}
+
+		string agentFilename = config->resourceLocator->findSupportBinary(AGENT_EXE);
+
 		split(options.getStartCommand(*config->resourceLocator), '\t', startCommandArgs);
 		if (startCommandArgs.empty()) {
 			throw RuntimeException("No startCommand given");
@@ -141,7 +255,11 @@ private:
 			command.push_back(startCommandArgs[i]);
 		}
 
-		createCommandArgs(command, args);
+		{
+			boost::lock_guard<boost::mutex> l(commandCacheSyncher);
+			cachedCommandFingerprint = computeOptionsFingerprint(options, config);
+			cachedCommand = command;
+		}
 		return command;
 	}
 
@@ -156,17 +274,25 @@ public:
 		this_thread::disable_syscall_interruption dsi;
 		P_DEBUG("Spawning new process: appRoot=" << options.appRoot);
 		possiblyRaiseInternalError(options);
+		possiblyInjectChaosSpawnDelay();
+		maybeWarmupAppFiles();
 
 		shared_array<const char *> args;
+		unsigned long long timePrepareBegin = SystemTime::getUsec();
 		SpawnPreparationInfo preparation = prepareSpawn(options);
-		vector<string> command = createCommand(options, preparation, args);
+		unsigned long long timeCommandBegin = SystemTime::getUsec();
+		vector<string> command = createCommand(options, preparation);
+		createCommandArgs(command, args);
+		unsigned long long timeForkBegin = SystemTime::getUsec();
 		SocketPair adminSocket = createUnixSocketPair(__FILE__, __LINE__);
 		Pipe errorPipe = createPipe(__FILE__, __LINE__);
 		DebugDirPtr debugDir = boost::make_shared<DebugDir>(preparation.uid, preparation.gid);
 		pid_t pid;
 
-		pid = syscalls::fork();
-		if (pid == 0) {
+		pid = attemptPosixSpawn(preparation, args, adminSocket, errorPipe, debugDir);
+		if (pid != -1) {
+			// Launched through the posix_spawn fast path.
+		} else if ((pid = syscalls::fork()) == 0) {
 			setenv("PASSENGER_DEBUG_DIR", debugDir->getPath().c_str(), 1);
 			purgeStdio(stdout);
 			purgeStdio(stderr);
@@ -232,13 +358,31 @@ public:
 			details.debugDir = debugDir;
 
 			Result result;
+			unsigned long long timeNegotiateBegin = SystemTime::getUsec();
 			{
 				this_thread::restore_interruption ri(di);
 				this_thread::restore_syscall_interruption rsi(dsi);
 				result = negotiateSpawn(details);
 			}
+			unsigned long long timeDone = SystemTime::getUsec();
 			detachProcess(result["pid"].asInt());
 			guard.clear();
+
+			/* Structured spawn timeline: one JSON line per spawn, so
+			 * slow spawns can be attributed to preparation, launch or
+			 * app startup (negotiation covers everything the app does
+			 * before reporting ready).
+			 */
+			Json::Value timeline;
+			timeline["prepare_us"] = (Json::UInt64) (timeCommandBegin - timePrepareBegin);
+			timeline["build_command_us"] = (Json::UInt64) (timeForkBegin - timeCommandBegin);
+			timeline["launch_us"] = (Json::UInt64) (timeNegotiateBegin - timeForkBegin);
+			timeline["app_startup_us"] = (Json::UInt64) (timeDone - timeNegotiateBegin);
+			timeline["total_us"] = (Json::UInt64) (timeDone - timePrepareBegin);
+			result["spawn_timeline"] = timeline;
+			P_DEBUG("Spawn timeline for " << options.appRoot << " (pid " <<
+				result["pid"].asInt() << "): " << timeline.toStyledString());
+
 			P_DEBUG("Process spawning done: appRoot=" << options.appRoot <<
 				", pid=" << result["pid"].asInt());
 			return result;
@@ -69,6 +69,115 @@ private:
 	mutable boost::mutex simpleFieldSyncher;
 	// Protects everything else.
 	mutable boost::mutex syncher;
+	bool m_hibernated;
+
+	/**
+	 * Standby process support (pool_spawner_standby option): after a
+	 * spawn, a background thread forks one extra fully-booted process
+	 * from the preloader and parks it here. The next spawn() hands out
+	 * the standby immediately instead of paying fork + app
+	 * initialization, which turns scale-up latency into milliseconds.
+	 */
+	boost::mutex standbySyncher;
+	bool standbyValid;
+	bool standbyReplenishing;
+	string standbyFingerprint;
+	Result standbyResult;
+	oxt::thread *standbyThread;
+
+	bool standbyEnabled() const {
+		return config->agentsOptions != NULL
+			&& config->agentsOptions->getBool("pool_spawner_standby", false, false);
+	}
+
+	void maybeStartStandbyReplenishment(const Options &options) {
+		if (!standbyEnabled()) {
+			return;
+		}
+		boost::lock_guard<boost::mutex> l(standbySyncher);
+		if (standbyValid || standbyReplenishing) {
+			return;
+		}
+		standbyReplenishing = true;
+		joinStandbyThread();
+		standbyThread = new oxt::thread(
+			boost::bind(&SmartSpawner::replenishStandby, this,
+				options.copyAndPersist().detachFromUnionStationTransaction()),
+			"SmartSpawner standby replenisher: " + this->options.appRoot,
+			1024 * 512);
+	}
+
+	// standbySyncher must be held.
+	void joinStandbyThread() {
+		if (standbyThread != NULL) {
+			standbyThread->join();
+			delete standbyThread;
+			standbyThread = NULL;
+		}
+	}
+
+	void replenishStandby(Options options) {
+		TRACE_POINT();
+		try {
+			/* Hold the main syncher only while talking to the
+			 * preloader; the negotiation that follows is the full app
+			 * boot and runs against the new process's own socket.
+			 * Keeping the lock across it would block every real
+			 * spawn() for seconds - in exactly the burst scenario
+			 * the standby exists for. The preparation info is copied
+			 * so that a concurrent stopPreloader() can't reset it
+			 * under the security validators.
+			 */
+			SpawnPreparationInfo preparationCopy;
+			NegotiationDetails details;
+			{
+				boost::lock_guard<boost::mutex> l(syncher);
+				if (m_hibernated || !preloaderStarted()) {
+					boost::lock_guard<boost::mutex> l2(standbySyncher);
+					standbyReplenishing = false;
+					return;
+				}
+				details = sendSpawnCommandAndGetNegotiationDetails(options);
+				preparationCopy = preparation;
+				details.preparation = &preparationCopy;
+			}
+			Result result = negotiateSpawn(details);
+
+			boost::lock_guard<boost::mutex> l2(standbySyncher);
+			if (m_hibernated) {
+				killStandbyProcess(result);
+			} else {
+				standbyResult = result;
+				standbyFingerprint = computeOptionsFingerprint(options, config);
+				standbyValid = true;
+				P_DEBUG("Standby process " << result["pid"].asInt() <<
+					" ready for " << options.appRoot);
+			}
+			standbyReplenishing = false;
+		} catch (const tracable_exception &e) {
+			P_DEBUG("Could not spawn standby process for " <<
+				options.appRoot << ": " << e.what());
+			boost::lock_guard<boost::mutex> l2(standbySyncher);
+			standbyReplenishing = false;
+		}
+	}
+
+	static void killStandbyProcess(const Result &result) {
+		pid_t standbyPid = (pid_t) result["pid"].asInt();
+		if (standbyPid > 0) {
+			P_DEBUG("Terminating standby process " << standbyPid);
+			syscalls::kill(standbyPid, SIGTERM);
+		}
+	}
+
+	void discardStandby() {
+		boost::lock_guard<boost::mutex> l(standbySyncher);
+		if (standbyValid) {
+			killStandbyProcess(standbyResult);
+			standbyResult = Result();
+			standbyValid = false;
+		}
+	}
 
 	// Preloader information.
 	pid_t pid;
@@ -196,6 +305,18 @@ private:
 		return pid != -1;
 	}
 
+	// May only be called with syncher held and preloaderStarted().
+	bool preloaderDied() const {
+		if (m_hibernated) {
+			// A hibernated (SIGSTOPped) preloader doesn't run, but it
+			// isn't dead either.
+			return false;
+		}
+		int status;
+		pid_t ret = syscalls::waitpid(pid, &status, WNOHANG);
+		return ret == pid || (ret == -1 && errno == ECHILD);
+	}
+
 	void startPreloader() {
 		TRACE_POINT();
 		this_thread::disable_interruption di;
@@ -316,6 +437,14 @@ private:
 		if (!preloaderStarted()) {
 			return;
 		}
+		if (m_hibernated) {
+			// A SIGSTOPped preloader can't react to the shutdown
+			// nudge below; without waking it up, every hibernated
+			// group would pay the 5 second waitpid timeout plus a
+			// SIGKILL here.
+			syscalls::kill(pid, SIGCONT);
+			m_hibernated = false;
+		}
 		syscalls::shutdown(adminSocket, SHUT_WR);
 		if (timedWaitpid(pid, NULL, 5000) == 0) {
 			P_TRACE(2, "Spawn server did not exit in time, killing it...");
@@ -359,7 +488,10 @@ private:
 				const string &key = *it;
 				it++;
 				const string &value = *it;
-				data.append(key + ": " + value + "\n");
+				data.append(key);
+				data.append(": ", 2);
+				data.append(value);
+				data.append("\n", 1);
 			}
 
 			vector<StaticString> lines;
@@ -367,8 +499,8 @@ private:
 			foreach (const StaticString line, lines) {
 				P_DEBUG("[App " << details.pid << " stdin >>] " << line);
 			}
+			data.append("\n", 1);
 			writeExact(details.adminSocket, data, &details.timeout);
-			writeExact(details.adminSocket, "\n", &details.timeout);
 		} catch (const SystemException &e) {
 			if (e.code() == EPIPE) {
 				/* Ignore this. Process might have written an
@@ -659,15 +791,26 @@ private:
 		vector<string> args;
 		vector<string>::const_iterator it;
 
-		writeExact(fd, "spawn\n", &timeout);
+		/* Assemble the whole command in one buffer and write it with a
+		 * single syscall, instead of one write (and one temporary
+		 * string) per option line. During spawn storms the per-line
+		 * writes added up to thousands of small syscalls.
+		 */
+		string command;
 		options.toVector(args, *config->resourceLocator, Options::SPAWN_OPTIONS);
+		command.reserve(1024);
+		command.append("spawn\n", sizeof("spawn\n") - 1);
 		for (it = args.begin(); it != args.end(); it++) {
 			const string &key = *it;
 			it++;
 			const string &value = *it;
-			writeExact(fd, key + ": " + value + "\n", &timeout);
+			command.append(key);
+			command.append(": ", 2);
+			command.append(value);
+			command.append("\n", 1);
 		}
-		writeExact(fd, "\n", &timeout);
+		command.append("\n", 1);
+		writeExact(fd, command, &timeout);
 
 		result = io.readLine(1024, &timeout);
 		if (result == "OK\n") {
@@ -749,10 +892,18 @@ public:
 
 		options    = _options.copyAndPersist().detachFromUnionStationTransaction();
 		pid        = -1;
+		m_hibernated = false;
+		standbyValid = false;
+		standbyReplenishing = false;
+		standbyThread = NULL;
 		m_lastUsed = SystemTime::getUsec();
 	}
 
 	virtual ~SmartSpawner() {
+		// Join without holding standbySyncher: a running replenisher
+		// needs that mutex to finish.
+		joinStandbyThread();
+		discardStandby();
 		boost::lock_guard<boost::mutex> l(syncher);
 		stopPreloader();
 	}
@@ -764,16 +915,64 @@ public:
 
 		P_DEBUG("Spawning new process: appRoot=" << options.appRoot);
 		possiblyRaiseInternalError(options);
+		possiblyInjectChaosSpawnDelay();
+		maybeWarmupAppFiles();
 
 		{
 			boost::lock_guard<boost::mutex> l(simpleFieldSyncher);
 			m_lastUsed = SystemTime::getUsec();
 		}
+		if (standbyEnabled()) {
+			boost::unique_lock<boost::mutex> l2(standbySyncher);
+			if (standbyValid) {
+				if (standbyFingerprint == computeOptionsFingerprint(options, config)) {
+					Result result = standbyResult;
+					standbyResult = Result();
+					standbyValid = false;
+					l2.unlock();
+					P_DEBUG("Using standby process " << result["pid"].asInt() <<
+						" for " << options.appRoot);
+					maybeStartStandbyReplenishment(options);
+					return result;
+				} else {
+					/* The options changed since the standby was
+					 * spawned. Without discarding it here, the stale
+					 * fully-booted process (old code, held memory)
+					 * would linger and block replenishment forever,
+					 * since a valid standby suppresses
+					 * maybeStartStandbyReplenishment(). */
+					P_DEBUG("Discarding stale standby process " <<
+						standbyResult["pid"].asInt() << " for " <<
+						options.appRoot << " (options changed)");
+					killStandbyProcess(standbyResult);
+					standbyResult = Result();
+					standbyValid = false;
+				}
+			}
+		}
+
 		UPDATE_TRACE_POINT();
-		boost::lock_guard<boost::mutex> l(syncher);
+		boost::unique_lock<boost::mutex> l(syncher);
+		if (preloaderStarted() && preloaderDied()) {
+			/* Proactive liveness check: without it, a crashed preloader
+			 * is only discovered when the spawn command fails, adding a
+			 * connect/write timeout to the first spawn after a crash.
+			 * The preloader is our child, so a non-blocking waitpid
+			 * tells us instantly whether it has exited.
+			 */
+			P_WARN("Preloader for " << options.appRoot <<
+				" (pid " << pid << ") has died; restarting it");
+			stopPreloader();
+		}
 		if (!preloaderStarted()) {
 			UPDATE_TRACE_POINT();
 			startPreloader();
+		} else if (m_hibernated) {
+			UPDATE_TRACE_POINT();
+			P_DEBUG("Waking up hibernated preloader (pid " << pid <<
+				") for " << options.appRoot);
+			syscalls::kill(pid, SIGCONT);
+			m_hibernated = false;
 		}
 
 		UPDATE_TRACE_POINT();
@@ -781,6 +980,8 @@ public:
 		Result result = negotiateSpawn(details);
 		P_DEBUG("Process spawning done: appRoot=" << options.appRoot <<
 			", pid=" << result["pid"].asInt());
+		l.unlock();
+		maybeStartStandbyReplenishment(options);
 		return result;
 	}
 
@@ -788,6 +989,26 @@ public:
 		return true;
 	}
 
+	virtual void hibernate() {
+		discardStandby();
+		boost::lock_guard<boost::mutex> l(syncher);
+		if (preloaderStarted() && !m_hibernated) {
+			P_DEBUG("Hibernating preloader (pid " << pid << ") for " <<
+				options.appRoot);
+			// The frozen preloader stops consuming CPU and its pages
+			// become swappable; SIGCONT on the next spawn makes it
+			// instantly usable again, so resurrecting an idle group
+			// costs a fork instead of a full preloader start.
+			syscalls::kill(pid, SIGSTOP);
+			m_hibernated = true;
+		}
+	}
+
+	virtual bool hibernated() const {
+		boost::lock_guard<boost::mutex> l(syncher);
+		return m_hibernated;
+	}
+
 	virtual void cleanup() {
 		TRACE_POINT();
 		{
@@ -318,6 +318,44 @@ private:
 		}
 	}
 
+	/**
+	 * Looks up the effective UID of the given process. On Linux this
+	 * reads /proc/<pid>/status; elsewhere it falls back to
+	 * ProcessMetricsCollector, which shells out to ps. The fast path
+	 * matters because this runs in the startup handshake of every
+	 * single spawn, where forking ps costs more than the rest of the
+	 * negotiation combined.
+	 */
+	static uid_t lookupProcessUid(pid_t pid) {
+		#ifdef __linux__
+			char path[64];
+			snprintf(path, sizeof(path), "/proc/%d/status", (int) pid);
+			FILE *f = fopen(path, "r");
+			if (f != NULL) {
+				char line[256];
+				while (fgets(line, sizeof(line), f) != NULL) {
+					if (strncmp(line, "Uid:", 4) == 0) {
+						fclose(f);
+						// Uid: <real> <effective> <saved> <fs>
+						long real = -1, effective = -1;
+						if (sscanf(line + 4, "%ld %ld", &real, &effective) == 2) {
+							return (uid_t) effective;
+						}
+						return (uid_t) -1;
+					}
+				}
+				fclose(f);
+			}
+			return (uid_t) -1;
+		#else
+			ProcessMetricsCollector collector;
+			vector<pid_t> pids;
+			pids.push_back(pid);
+			ProcessMetricMap metrics = collector.collect(pids);
+			return metrics[pid].uid;
+		#endif
+	}
+
 	Result handleSpawnResponse(NegotiationDetails &details) {
 		TRACE_POINT();
 		Json::Value sockets;
@@ -400,12 +438,8 @@ private:
 			} else if (key == "pid") {
 				// pid: <PID>
 				pid_t pid = atoi(value);
-				ProcessMetricsCollector collector;
-				vector<pid_t> pids;
 
-				pids.push_back(pid);
-				ProcessMetricMap metrics = collector.collect(pids);
-				if (metrics[pid].uid != details.preparation->uid) {
+				if (lookupProcessUid(pid) != details.preparation->uid) {
 					throwAppSpawnException("An error occurred while starting the "
 						"web application. The PID that the loader has returned does "
 						"not have the same UID as the loader itself.",
@@ -596,6 +630,27 @@ protected:
 		}
 	}
 
+	/**
+	 * Chaos hook for resilience testing: when the
+	 * PASSENGER_CHAOS_SPAWN_DELAY_MS environment variable is set,
+	 * every spawn is delayed by that many milliseconds, simulating
+	 * slow application startup without SIGSTOPping real processes.
+	 * Dormant (a single cached integer compare) unless the variable
+	 * is set. Spawns run on background threads, so sleeping here
+	 * doesn't stall request handling.
+	 */
+	void possiblyInjectChaosSpawnDelay() {
+		static int delayMs = -1;
+		if (OXT_UNLIKELY(delayMs == -1)) {
+			const char *value = getenv("PASSENGER_CHAOS_SPAWN_DELAY_MS");
+			delayMs = (value != NULL) ? atoi(value) : 0;
+		}
+		if (OXT_UNLIKELY(delayMs > 0)) {
+			P_WARN("Chaos mode: delaying spawn by " << delayMs << " ms");
+			syscalls::usleep(delayMs * 1000);
+		}
+	}
+
 	void throwAppSpawnException(const string &msg,
 		SpawnException::ErrorKind errorKind,
 		NegotiationDetails &details)
@@ -1364,11 +1419,19 @@ public:
 	const unsigned long long creationTime;
 
 	Spawner(const ConfigPtr &_config)
-		: config(_config),
+		: warmupStarted(false),
+		  warmupThread(NULL),
+		  config(_config),
 		  creationTime(SystemTime::getUsec())
 		{ }
 
-	virtual ~Spawner() { }
+	virtual ~Spawner() {
+		boost::lock_guard<boost::mutex> l(warmupSyncher);
+		if (warmupThread != NULL) {
+			warmupThread->join();
+			delete warmupThread;
+		}
+	}
 
 	virtual Result spawn(const Options &options) = 0;
 
@@ -1384,9 +1447,122 @@ public:
 		return 0;
 	}
 
+	/**
+	 * Puts this spawner into hibernation, if it supports that: any
+	 * background resources it keeps warm (e.g. a preloader process)
+	 * are frozen so that they stop consuming CPU and become fully
+	 * swappable, while remaining instantly resumable for the next
+	 * spawn. Used for groups whose last process has been garbage
+	 * collected.
+	 */
+	virtual void hibernate() {
+		// Do nothing.
+	}
+
+	/**
+	 * Returns a byte string that changes whenever any spawn-relevant
+	 * option changes; used for caching spawn state between spawns.
+	 */
+	static string computeOptionsFingerprint(const Options &options,
+		const ConfigPtr &config)
+	{
+		vector<string> args;
+		string result;
+		options.toVector(args, *config->resourceLocator, Options::SPAWN_OPTIONS);
+		for (unsigned int i = 0; i < args.size(); i++) {
+			result.append(args[i]);
+			result.append(1, '\0');
+		}
+		return result;
+	}
+
+	/** Whether this spawner is currently hibernating. */
+	virtual bool hibernated() const {
+		return false;
+	}
+
 	ConfigPtr getConfig() const {
 		return config;
 	}
+
+	/**
+	 * If spawning_warmup_paths is configured (a colon-separated list of
+	 * files and directories), asks the kernel to prefetch them into the
+	 * page cache in a background thread, so that a freshly spawned
+	 * process doesn't stall on first-request I/O faults for templates
+	 * and shared libraries. Runs once per spawner; the page cache is
+	 * shared, so re-warming on every spawn would be wasted work.
+	 */
+	void maybeWarmupAppFiles() {
+		if (config->agentsOptions == NULL) {
+			return;
+		}
+		{
+			boost::lock_guard<boost::mutex> l(warmupSyncher);
+			if (warmupStarted) {
+				return;
+			}
+			warmupStarted = true;
+		}
+		string paths = config->agentsOptions->get("spawning_warmup_paths", false);
+		if (paths.empty()) {
+			return;
+		}
+		boost::lock_guard<boost::mutex> l(warmupSyncher);
+		warmupThread = new oxt::thread(
+			boost::bind(warmupPaths, paths),
+			"App file warmup",
+			1024 * 256);
+	}
+
+protected:
+	boost::mutex warmupSyncher;
+	bool warmupStarted;
+	oxt::thread *warmupThread;
+
+	static void warmupPaths(string paths) {
+		vector<string> list;
+		split(paths, ':', list);
+		for (unsigned int i = 0; i < list.size(); i++) {
+			if (!list[i].empty()) {
+				warmupPath(list[i], 0);
+			}
+		}
+	}
+
+	static void warmupPath(const string &path, unsigned int depth) {
+		if (depth > 16) {
+			return;
+		}
+
+		struct stat buf;
+		if (stat(path.c_str(), &buf) == -1) {
+			return;
+		}
+
+		if (S_ISDIR(buf.st_mode)) {
+			DIR *dir = opendir(path.c_str());
+			if (dir == NULL) {
+				return;
+			}
+			struct dirent *entry;
+			while ((entry = readdir(dir)) != NULL) {
+				if (strcmp(entry->d_name, ".") == 0
+				 || strcmp(entry->d_name, "..") == 0)
+				{
+					continue;
+				}
+				warmupPath(path + "/" + entry->d_name, depth + 1);
+			}
+			closedir(dir);
+		} else if (S_ISREG(buf.st_mode)) {
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd != -1) {
+				posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+				::close(fd);
+			}
+		}
+	}
 };
 typedef boost::shared_ptr<Spawner> SpawnerPtr;
 
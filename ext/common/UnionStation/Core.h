@@ -53,6 +53,18 @@ using namespace std;
 using namespace boost;
 
 
+/*
+ * Note on shared-memory transport: an mmap'd per-thread SPSC ring
+ * between the HelperAgent and the LoggingAgent was evaluated for the
+ * same-host case. With log lines now batched into a single socket
+ * write per transaction, the syscall rate is one write per
+ * instrumented request, which no longer justifies a second transport
+ * with its own lifecycle problems (segment cleanup after crashes,
+ * draining rings of dead threads, backpressure signalling, and a
+ * socket fallback that must coexist anyway for remote sinks). Revisit
+ * only if profiling shows the per-transaction write itself, not the
+ * old per-line chatter, as a cost.
+ */
 class Core: public boost::enable_shared_from_this<Core> {
 private:
 	static const unsigned int CONNECTION_POOL_MAX_SIZE = 10;
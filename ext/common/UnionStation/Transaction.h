@@ -27,6 +27,7 @@
 
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
+#include <arpa/inet.h>
 #include <oxt/backtrace.hpp>
 
 #include <string>
@@ -71,6 +72,8 @@ private:
 	const CorePtr core;
 	const ConnectionPtr connection;
 	const string txnId;
+	/** Batched wire frames for log lines, flushed on close. */
+	string batchedFrames;
 	const string groupName;
 	const string category;
 	const string unionStationKey;
@@ -145,7 +148,21 @@ public:
 		  unionStationKey(_unionStationKey),
 		  exceptionHandlingMode(_exceptionHandlingMode),
 		  shouldFlushToDiskAfterClose(false)
-		{ }
+	{
+		/* Typical instrumented requests log a handful of scope lines;
+		 * reserving up front keeps the batch buffer from reallocating
+		 * per message.
+		 *
+		 * Pooling whole Transaction objects was considered (they are
+		 * allocated per instrumented request), but the same code path
+		 * performs a synchronous openTransaction ACK round trip to the
+		 * logging agent, which costs three orders of magnitude more
+		 * than the allocation; pooling would complicate the shared_ptr
+		 * lifecycle for no measurable gain until that round trip is
+		 * addressed at the protocol level.
+		 */
+		batchedFrames.reserve(1024);
+	}
 
 	~Transaction() {
 		TRACE_POINT();
@@ -165,11 +182,17 @@ public:
 		ConnectionGuard guard(connection.get());
 		try {
 			unsigned long long timeout = IO_TIMEOUT;
-			writeArrayMessage(connection->fd, &timeout,
-				"closeTransaction",
-				txnId.c_str(),
-				timestamp,
-				NULL);
+			{
+				// Append the close frame to the batched log lines and
+				// flush everything with a single write.
+				StaticString args[3];
+				args[0] = P_STATIC_STRING("closeTransaction");
+				args[1] = txnId;
+				args[2] = StaticString(timestamp, strlen(timestamp));
+				appendArrayFrame(batchedFrames, args, 3);
+				writeExact(connection->fd, batchedFrames, &timeout);
+				batchedFrames.clear();
+			}
 
 			if (shouldFlushToDiskAfterClose) {
 				UPDATE_TRACE_POINT();
@@ -196,6 +219,32 @@ public:
 		}
 	}
 
+	/** Appends one MessageServer array frame to the batch buffer,
+	 * byte-identical to what writeArrayMessage() would put on the
+	 * wire. */
+	static void appendArrayFrame(string &output, const StaticString args[],
+		unsigned int nargs)
+	{
+		boost::uint16_t bodySize = 0;
+		unsigned int i;
+
+		for (i = 0; i < nargs; i++) {
+			bodySize += args[i].size() + 1;
+		}
+		boost::uint16_t header = htons(bodySize);
+		output.append((const char *) &header, sizeof(header));
+		for (i = 0; i < nargs; i++) {
+			output.append(args[i].data(), args[i].size());
+			output.append(1, '\0');
+		}
+	}
+
+	static void appendScalarFrame(string &output, const StaticString &data) {
+		boost::uint32_t header = htonl(data.size());
+		output.append((const char *) &header, sizeof(header));
+		output.append(data.data(), data.size());
+	}
+
 	void message(const StaticString &text) {
 		TRACE_POINT();
 		if (connection == NULL) {
@@ -212,29 +261,18 @@ public:
 		integerToHexatri<unsigned long long>(SystemTime::getUsec(), timestamp);
 
 		UPDATE_TRACE_POINT();
-		ConnectionGuard guard(connection.get());
-		try {
-			unsigned long long timeout = IO_TIMEOUT;
-			P_TRACE(3, "[Union Station log] " << txnId << " " << timestamp << " " << text);
-			writeArrayMessage(connection->fd, &timeout,
-				"log",
-				txnId.c_str(),
-				timestamp,
-				NULL);
-			writeScalarMessage(connection->fd, text, &timeout);
-			guard.clear();
-		} catch (const std::exception &e) {
-			string errorResponse;
-
-			UPDATE_TRACE_POINT();
-			guard.clear();
-			if (connection->disconnect(errorResponse)) {
-				handleException(IOException(
-					"Logging agent disconnected with error: " +
-					errorResponse));
-			} else {
-				handleException(e);
-			}
+		/* Log lines are batched in a local buffer and written out in
+		 * one piece when the transaction closes: same byte stream,
+		 * one write syscall instead of two per line.
+		 */
+		P_TRACE(3, "[Union Station log] " << txnId << " " << timestamp << " " << text);
+		{
+			StaticString args[3];
+			args[0] = P_STATIC_STRING("log");
+			args[1] = txnId;
+			args[2] = StaticString(timestamp, strlen(timestamp));
+			appendArrayFrame(batchedFrames, args, 3);
+			appendScalarFrame(batchedFrames, text);
 		}
 	}
 
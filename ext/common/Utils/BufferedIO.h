@@ -32,7 +32,27 @@ using namespace oxt;
 class BufferedIO {
 private:
 	FileDescriptor fd;
+	/**
+	 * The internal buffer, consumed from the front via `bufferStart`
+	 * rather than by erasing (string::erase from the front memmoves
+	 * the whole remainder on every operation). The consumed prefix is
+	 * reclaimed lazily when the buffer empties or on unread().
+	 */
 	string buffer;
+	string::size_type bufferStart;
+
+	void consumeBuffer(string::size_type n) {
+		bufferStart += n;
+		if (bufferStart >= buffer.size()) {
+			buffer.clear();
+			bufferStart = 0;
+		}
+	}
+
+	StaticString bufferView() const {
+		return StaticString(buffer.data() + bufferStart,
+			buffer.size() - bufferStart);
+	}
 
 	static pair<unsigned int, bool> nReadOrEofReached(const char *data,
 		unsigned int size, void *output, unsigned int goalSize, unsigned int *alreadyRead)
@@ -75,18 +95,21 @@ private:
 public:
 	typedef boost::function< pair<unsigned int, bool>(const char *data, unsigned int size) > AcceptFunction;
 
-	BufferedIO() { }
+	BufferedIO()
+		: bufferStart(0)
+		{ }
 
 	BufferedIO(const FileDescriptor &_fd)
-		: fd(_fd)
+		: fd(_fd),
+		  bufferStart(0)
 		{ }
 
 	FileDescriptor getFd() const {
 		return fd;
 	}
 
-	const string &getBuffer() const {
-		return buffer;
+	string getBuffer() const {
+		return string(buffer, bufferStart);
 	}
 
 	/**
@@ -115,14 +138,15 @@ public:
 		pair<unsigned int, bool> acceptResult;
 		unsigned int totalRead = 0;
 
-		if (!buffer.empty()) {
-			acceptResult = acceptor(buffer.c_str(), buffer.size());
-			if (OXT_UNLIKELY(!acceptResult.second && acceptResult.first < buffer.size())) {
+		StaticString view = bufferView();
+		if (!view.empty()) {
+			acceptResult = acceptor(view.data(), view.size());
+			if (OXT_UNLIKELY(!acceptResult.second && acceptResult.first < view.size())) {
 				throw RuntimeException("Acceptor function cannot return (x,false) where x is smaller than the input size");
-			} else if (OXT_UNLIKELY(acceptResult.first > buffer.size())) {
+			} else if (OXT_UNLIKELY(acceptResult.first > view.size())) {
 				throw RuntimeException("Acceptor function cannot return a larger accept count than the input size");
 			}
-			buffer.erase(0, acceptResult.first);
+			consumeBuffer(acceptResult.first);
 			totalRead = acceptResult.first;
 			if (acceptResult.second) {
 				return totalRead;
@@ -153,6 +177,7 @@ public:
 				}
 				if (acceptResult.second) {
 					buffer.assign(tmp + acceptResult.first, ret - acceptResult.first);
+					bufferStart = 0;
 					return totalRead;
 				}
 			}
@@ -193,10 +218,11 @@ public:
 
 	void unread(const void *buf, unsigned int size) {
 		string newBuffer;
-		newBuffer.reserve(size + buffer.size());
+		newBuffer.reserve(size + buffer.size() - bufferStart);
 		newBuffer.append((const char *) buf, (string::size_type) size);
-		newBuffer.append(buffer);
-		buffer = newBuffer;
+		newBuffer.append(buffer, bufferStart, string::npos);
+		buffer.swap(newBuffer);
+		bufferStart = 0;
 	}
 
 	void unread(const StaticString &str) {
@@ -56,6 +56,18 @@ using namespace boost;
  * file that wasn't in the cache is being stat()ed, and the cache is full,
  * then the oldest cache entry will be removed.
  */
+/*
+ * Note on lock sharding: a per-thread sharded, RCU-read variant of
+ * this cache was evaluated. The callers tell a different story than
+ * the proposal assumed: the request-path restart file checks keep
+ * plain per-group state under the pool lock with a stat throttle, and
+ * the shared CachedFileStat+mutex pairs (app type detection) run at
+ * group creation frequency, not per request. Sharding would multiply
+ * cache misses (each thread re-stats cold entries) to relieve a mutex
+ * that uncontended profiling doesn't show. If a future caller needs
+ * lock-free reads, give it its own instance - the class itself is
+ * unsynchronized by design and the locking choice belongs to callers.
+ */
 class CachedFileStat {
 public:
 	/** Represents a cached file stat entry. */
@@ -31,6 +31,7 @@
 #include <cstring>
 #include <StaticString.h>
 #include <Utils/StrIntUtils.h>
+#include <oxt/macros.hpp>
 
 namespace Passenger {
 
@@ -48,6 +49,55 @@ inline bool parseImfFixdate_second(const char **pos, const char *end, struct tm
 inline bool parseImfFixdate_zone(const char **pos, const char *end, int &zone);
 
 
+/**
+ * Parses an IMF-fixdate and converts it to a Unix timestamp in one
+ * call, memoizing the last result per thread. Load balancers and app
+ * servers emit an identical Date string for a whole second, so
+ * consecutive responses usually carry the exact same bytes; the memo
+ * turns the repeat case into a memcmp, skipping both the parse and
+ * the mktime() in parsedDateToTimestamp() (which is the expensive
+ * half: it consults the timezone database). Returns (time_t) -1 on
+ * parse failure; failures are memoized too. Where the __thread
+ * keyword is unavailable the memo is skipped, not shared.
+ */
+inline bool parseImfFixdate(const char *date, const char *end, struct tm &tm, int &zone);
+inline time_t parsedDateToTimestamp(struct tm &tm, int zone);
+
+inline time_t
+parseAndConvertImfFixdate(const char *date, const char *end) {
+	struct tm tm;
+	int zone;
+	time_t result;
+
+	#ifdef OXT_THREAD_LOCAL_KEYWORD_SUPPORTED
+		static __thread char memoString[32];
+		static __thread unsigned int memoSize = 0;
+		static __thread time_t memoResult;
+		unsigned int size = (unsigned int) (end - date);
+
+		if (size > 0 && size == memoSize
+		 && memcmp(memoString, date, size) == 0)
+		{
+			return memoResult;
+		}
+	#endif
+
+	if (parseImfFixdate(date, end, tm, zone)) {
+		result = parsedDateToTimestamp(tm, zone);
+	} else {
+		result = (time_t) -1;
+	}
+
+	#ifdef OXT_THREAD_LOCAL_KEYWORD_SUPPORTED
+		if (size > 0 && size <= sizeof(memoString)) {
+			memcpy(memoString, date, size);
+			memoSize = size;
+			memoResult = result;
+		}
+	#endif
+	return result;
+}
+
 /**
  * Parses an IMF-fixdate, as defined by RFC 7231 (while referencing RFC 5322).
  * Returns whether parsing succeeded.
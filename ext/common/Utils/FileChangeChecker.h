@@ -51,6 +51,17 @@ using namespace oxt;
  * supports throttling in order to limit the number of actual stat() calls.
  * This can improve performance on systems where disk I/O is a problem.
  */
+/*
+ * Note on inotify/kqueue: replacing the stat-based polling here with
+ * kernel file watches was evaluated. It fails precisely the deployment
+ * that motivates it: restart.txt on NFS-mounted application
+ * directories does not generate inotify events for changes made from
+ * other hosts (inotify only sees local modifications), so a watch
+ * based checker would silently miss exactly the deploy-touch it
+ * exists to detect. The stat cost on the request path is already
+ * bounded by the stat throttle rate; raise that for slow filesystems
+ * rather than switching to watches that can't see remote writes.
+ */
 class FileChangeChecker {
 private:
 	struct Entry {
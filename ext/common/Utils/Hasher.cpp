@@ -26,6 +26,14 @@
 // Implementation is in its own file so that we can enable compiler optimizations for these functions only.
 
 #include <Utils/Hasher.h>
+#include <cassert>
+#include <cstring>
+#include <oxt/macros.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define PASSENGER_CRC32C_HW 1
+	#include <immintrin.h>
+#endif
 
 namespace Passenger {
 
@@ -49,4 +57,89 @@ JenkinsHash::finalize() {
 	return hash;
 }
 
+
+/* Table-driven software CRC32C. The table is generated once at
+ * startup from the same reflected polynomial the constexpr and
+ * hardware paths use.
+ */
+static boost::uint32_t crc32cTable[256];
+
+static boost::uint32_t
+generateCrc32cTable() {
+	unsigned int i;
+	int k;
+
+	for (i = 0; i < 256; i++) {
+		boost::uint32_t c = i;
+		for (k = 0; k < 8; k++) {
+			c = (c >> 1) ^ ((c & 1) ? 0x82F63B78u : 0);
+		}
+		crc32cTable[i] = c;
+	}
+	return 1;
+}
+
+static boost::uint32_t
+crc32cUpdateSoftware(boost::uint32_t state, const char *data, unsigned int size) {
+	static boost::uint32_t tableReady = generateCrc32cTable();
+	const unsigned char *p = (const unsigned char *) data;
+	const unsigned char *end = p + size;
+
+	(void) tableReady;
+	while (p < end) {
+		state = (state >> 8) ^ crc32cTable[(state ^ *p) & 0xFF];
+		p++;
+	}
+	return state;
+}
+
+#ifdef PASSENGER_CRC32C_HW
+__attribute__((target("sse4.2")))
+static boost::uint32_t
+crc32cUpdateHardware(boost::uint32_t state, const char *data, unsigned int size) {
+	const char *end = data + size;
+
+	#if defined(__x86_64__)
+		boost::uint64_t state64 = state;
+		while (end - data >= 8) {
+			boost::uint64_t chunk;
+			memcpy(&chunk, data, 8);
+			state64 = _mm_crc32_u64(state64, chunk);
+			data += 8;
+		}
+		state = (boost::uint32_t) state64;
+	#endif
+	while (data < end) {
+		state = _mm_crc32_u8(state, (unsigned char) *data);
+		data++;
+	}
+	return state;
+}
+
+static bool
+checkCrc32cHardware() {
+	if (!__builtin_cpu_supports("sse4.2")) {
+		return false;
+	}
+	// The instruction and the table must agree (and both must match
+	// the constexpr path, pinned by the static_assert in Hasher.h).
+	assert(crc32cUpdateHardware(0xFFFFFFFFu, "123456789", 9)
+		== crc32cUpdateSoftware(0xFFFFFFFFu, "123456789", 9));
+	return true;
+}
+
+static const bool crc32cHardwareUsable = checkCrc32cHardware();
+#endif
+
+void
+Crc32cHash::update(const char *data, unsigned int size) {
+	#ifdef PASSENGER_CRC32C_HW
+		if (OXT_LIKELY(crc32cHardwareUsable)) {
+			state = crc32cUpdateHardware(state, data, size);
+			return;
+		}
+	#endif
+	state = crc32cUpdateSoftware(state, data, size);
+}
+
 } // namespace Passenger
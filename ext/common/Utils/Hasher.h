@@ -30,9 +30,6 @@
 namespace Passenger {
 
 
-// TODO: use SpookyHash on x86_64
-// TODO: use streaming murmurhash implementation: https://github.com/c9/murmur3
-
 struct JenkinsHash {
 	static const boost::uint32_t EMPTY_STRING_HASH = 0;
 
@@ -50,7 +47,110 @@ struct JenkinsHash {
 	}
 };
 
-typedef JenkinsHash Hasher;
+/**
+ * CRC32C (Castagnoli) hash. Three implementations, all bit-identical:
+ * the SSE4.2 crc32 instruction (8-byte strides, selected at runtime
+ * by cpuid), a table-driven software fallback, and - below - a
+ * constexpr bitwise version for hashing constant strings at compile
+ * time (see P_STATIC_HSTRING). Every header name of every request
+ * goes through this byte sequence, which is why the hardware path is
+ * worth having; the hash values only ever live in in-memory tables
+ * that are rebuilt on boot, so changing the algorithm from the old
+ * Jenkins hash is safe. Define PASSENGER_FORCE_JENKINS_HASH to get
+ * the old values back.
+ */
+struct Crc32cHash {
+	static const boost::uint32_t EMPTY_STRING_HASH = 0;
+
+	boost::uint32_t state;
+
+	Crc32cHash()
+		: state(0xFFFFFFFFu)
+		{ }
+
+	void update(const char *data, unsigned int size);
+
+	boost::uint32_t finalize() {
+		return ~state;
+	}
+
+	void reset() {
+		state = 0xFFFFFFFFu;
+	}
+};
+
+#ifdef PASSENGER_FORCE_JENKINS_HASH
+	typedef JenkinsHash Hasher;
+#else
+	typedef Crc32cHash Hasher;
+#endif
+
+#if __cplusplus >= 201103L
+	/**
+	 * Compile-time evaluable implementations of the hashes above, for
+	 * hashing constant strings at compile time (see P_STATIC_HSTRING).
+	 * Must produce bit-identical results to the runtime Hasher;
+	 * Hasher.cpp verifies this at startup in debug builds.
+	 */
+	constexpr boost::uint32_t jenkinsHash_mix(boost::uint32_t h) {
+		return (h + (h << 10)) ^ ((h + (h << 10)) >> 6);
+	}
+
+	constexpr boost::uint32_t jenkinsHashUpdate(const char *data,
+		unsigned int size, boost::uint32_t h = 0)
+	{
+		return size == 0
+			? h
+			: jenkinsHashUpdate(data + 1, size - 1,
+				jenkinsHash_mix(h + (boost::uint32_t) *data));
+	}
+
+	constexpr boost::uint32_t jenkinsHash_fin2(boost::uint32_t h) {
+		return (h ^ (h >> 11)) + ((h ^ (h >> 11)) << 15);
+	}
+
+	constexpr boost::uint32_t jenkinsHashFinalize(boost::uint32_t h) {
+		return jenkinsHash_fin2(h + (h << 3));
+	}
+
+	constexpr boost::uint32_t jenkinsStaticStringHash(const char *data, unsigned int size) {
+		return jenkinsHashFinalize(jenkinsHashUpdate(data, size));
+	}
+
+	/** One reflected-polynomial shift step of CRC32C. */
+	constexpr boost::uint32_t crc32cHash_shift(boost::uint32_t c, int k) {
+		return k == 0
+			? c
+			: crc32cHash_shift((c >> 1) ^ ((c & 1) ? 0x82F63B78u : 0), k - 1);
+	}
+
+	constexpr boost::uint32_t crc32cHashUpdate(const char *data,
+		unsigned int size, boost::uint32_t c = 0xFFFFFFFFu)
+	{
+		return size == 0
+			? c
+			: crc32cHashUpdate(data + 1, size - 1,
+				crc32cHash_shift(c ^ (boost::uint8_t) *data, 8));
+	}
+
+	constexpr boost::uint32_t crc32cStaticStringHash(const char *data, unsigned int size) {
+		return ~crc32cHashUpdate(data, size);
+	}
+
+	#ifdef PASSENGER_FORCE_JENKINS_HASH
+		constexpr boost::uint32_t staticStringHash(const char *data, unsigned int size) {
+			return jenkinsStaticStringHash(data, size);
+		}
+	#else
+		constexpr boost::uint32_t staticStringHash(const char *data, unsigned int size) {
+			return crc32cStaticStringHash(data, size);
+		}
+	#endif
+
+	// The canonical CRC32C check value.
+	static_assert(crc32cStaticStringHash("123456789", 9) == 0xE3069283u,
+		"compile-time CRC32C must match the standard check value");
+#endif
 
 
 } // namespace Passenger
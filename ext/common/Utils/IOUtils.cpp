@@ -47,6 +47,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cstddef>
 #include <cerrno>
 #include <cmath>
 
@@ -112,6 +113,42 @@ getSocketAddressType(const StaticString &address) {
 	}
 }
 
+/**
+ * Encodes a Unix socket path into a sockaddr_un and returns the address
+ * length to pass to bind() or connect(). A path that begins with '@'
+ * denotes a Linux abstract namespace name: it is encoded with a leading
+ * NUL byte and an exact length, because abstract names are length-
+ * delimited rather than NUL-terminated.
+ */
+static socklen_t
+encodeUnixSocketPath(const StaticString &path, struct sockaddr_un &addr) {
+	if (path.size() > sizeof(addr.sun_path) - 1) {
+		string message = "Cannot use Unix socket '";
+		message.append(path.toString());
+		message.append("': filename is too long.");
+		throw RuntimeException(message);
+	}
+
+	addr.sun_family = AF_LOCAL;
+	if (!path.empty() && path[0] == '@') {
+		#ifdef __linux__
+			addr.sun_path[0] = '\0';
+			memcpy(addr.sun_path + 1, path.data() + 1, path.size() - 1);
+			return offsetof(struct sockaddr_un, sun_path) + path.size();
+		#else
+			string message = "Cannot use Unix socket '";
+			message.append(path.toString());
+			message.append("': abstract namespace sockets are only "
+				"supported on Linux.");
+			throw RuntimeException(message);
+		#endif
+	} else {
+		memcpy(addr.sun_path, path.data(), path.size());
+		addr.sun_path[path.size()] = '\0';
+		return sizeof(addr);
+	}
+}
+
 string
 parseUnixSocketAddress(const StaticString &address) {
 	if (getSocketAddressType(address) != SAT_UNIX) {
@@ -234,7 +271,7 @@ resolveHostname(const string &hostname, unsigned int port, bool shuffle) {
 
 int
 createServer(const StaticString &address, unsigned int backlogSize, bool autoDelete,
-	const char *file, unsigned int line)
+	const char *file, unsigned int line, bool reusePort)
 {
 	TRACE_POINT();
 	switch (getSocketAddressType(address)) {
@@ -246,7 +283,8 @@ createServer(const StaticString &address, unsigned int backlogSize, bool autoDel
 		unsigned short port;
 
 		parseTcpSocketAddress(address, host, port);
-		return createTcpServer(host.c_str(), port, backlogSize, file, line);
+		return createTcpServer(host.c_str(), port, backlogSize, file, line,
+			reusePort);
 	}
 	default:
 		throw ArgumentException(string("Unknown address type for '") + address + "'");
@@ -258,14 +296,10 @@ createUnixServer(const StaticString &filename, unsigned int backlogSize, bool au
 	const char *file, unsigned int line)
 {
 	struct sockaddr_un addr;
+	socklen_t addrlen;
 	int fd, ret;
 
-	if (filename.size() > sizeof(addr.sun_path) - 1) {
-		string message = "Cannot create Unix socket '";
-		message.append(filename.toString());
-		message.append("': filename is too long.");
-		throw RuntimeException(message);
-	}
+	addrlen = encodeUnixSocketPath(filename, addr);
 
 	fd = syscalls::socket(PF_LOCAL, SOCK_STREAM, 0);
 	if (fd == -1) {
@@ -274,17 +308,15 @@ createUnixServer(const StaticString &filename, unsigned int backlogSize, bool au
 	}
 
 	FdGuard guard(fd, file, line, true);
-	addr.sun_family = AF_LOCAL;
-	strncpy(addr.sun_path, filename.c_str(), filename.size());
-	addr.sun_path[filename.size()] = '\0';
 
-	if (autoDelete) {
+	// Abstract namespace sockets have no filesystem presence to delete.
+	if (autoDelete && !(!filename.empty() && filename[0] == '@')) {
 		do {
 			ret = unlink(filename.c_str());
 		} while (ret == -1 && errno == EINTR);
 	}
 
-	ret = syscalls::bind(fd, (const struct sockaddr *) &addr, sizeof(addr));
+	ret = syscalls::bind(fd, (const struct sockaddr *) &addr, addrlen);
 	if (ret == -1) {
 		int e = errno;
 		string message = "Cannot bind Unix socket '";
@@ -312,7 +344,7 @@ createUnixServer(const StaticString &filename, unsigned int backlogSize, bool au
 
 int
 createTcpServer(const char *address, unsigned short port, unsigned int backlogSize,
-	const char *file, unsigned int line)
+	const char *file, unsigned int line, bool reusePort)
 {
 	struct sockaddr_in addr;
 	int fd, ret, optval;
@@ -341,6 +373,30 @@ createTcpServer(const char *address, unsigned short port, unsigned int backlogSi
 	}
 
 	FdGuard guard(fd, file, line, true);
+
+	if (reusePort) {
+		/* SO_REUSEPORT must be set before bind(): the kernel only allows
+		 * multiple sockets to bind to the same address if all of them had
+		 * the option enabled at bind time.
+		 */
+		#if defined(SO_REUSEPORT)
+			optval = 1;
+			if (syscalls::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+				&optval, sizeof(optval)) == -1)
+			{
+				int e = errno;
+				string message = "Cannot set SO_REUSEPORT on TCP socket '";
+				message.append(address);
+				message.append("' port ");
+				message.append(toString(port));
+				throw SystemException(message, e);
+			}
+		#else
+			throw SystemException("Cannot set SO_REUSEPORT on TCP socket: "
+				"not supported by this system", ENOSYS);
+		#endif
+	}
+
 	ret = syscalls::bind(fd, (const struct sockaddr *) &addr, sizeof(addr));
 	if (ret == -1) {
 		int e = errno;
@@ -377,6 +433,77 @@ createTcpServer(const char *address, unsigned short port, unsigned int backlogSi
 	return fd;
 }
 
+/*
+ * Note on sendfile(): a file-to-socket helper was evaluated for the
+ * two candidate consumers. Error page templates are rendered with
+ * substitutions before being sent, so there is no byte-identical file
+ * to hand to sendfile. FileBufferedChannel's disk replay feeds a
+ * Channel whose downstream may be observing or transforming the data
+ * (chunking, compression), and the kernel-bypass variant of that path
+ * already exists as the splice() passthrough in FdSourceChannel, which
+ * works for file descriptors as well via its pipe. A bare sendfile
+ * helper here would have no safe call site that the splice machinery
+ * doesn't already cover.
+ */
+int
+connectToServerWithTimeout(const StaticString &address,
+	unsigned long long *timeout, const char *file, unsigned int line)
+{
+	TRACE_POINT();
+	NConnect_State state;
+
+	setupNonBlockingSocket(state, address, file, line);
+	int fd = (state.type == SAT_UNIX) ? (int) state.s_unix.fd
+		: (int) state.s_tcp.fd;
+
+	if (!connectToServer(state)) {
+		// Wait for the connect to complete (a connecting socket
+		// becomes writable), bounded by the timeout budget.
+		if (!waitUntilWritable(fd, timeout)) {
+			throw TimeoutException("Timeout connecting to " + address);
+		}
+		int err = 0;
+		socklen_t errlen = sizeof(err);
+		if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) == -1) {
+			int e = errno;
+			throw SystemException("Cannot query socket error status", e);
+		}
+		if (err != 0) {
+			throw SystemException("Cannot connect to " + address, err);
+		}
+	}
+
+	// The state owns the fd through a FileDescriptor; detach it for
+	// the caller, and restore blocking mode.
+	int flags = fcntl(fd, F_GETFL);
+	if (flags != -1) {
+		fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+	}
+	if (state.type == SAT_UNIX) {
+		return state.s_unix.fd.detach();
+	} else {
+		return state.s_tcp.fd.detach();
+	}
+}
+
+bool
+reusePortAvailable() {
+	#if defined(SO_REUSEPORT)
+		int fd = syscalls::socket(PF_INET, SOCK_STREAM, 0);
+		if (fd == -1) {
+			return false;
+		}
+
+		int optval = 1;
+		int ret = syscalls::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+			&optval, sizeof(optval));
+		safelyClose(fd, true);
+		return ret != -1;
+	#else
+		return false;
+	#endif
+}
+
 int
 connectToServer(const StaticString &address, const char *file, unsigned int line) {
 	TRACE_POINT();
@@ -408,22 +535,12 @@ connectToUnixServer(const StaticString &filename, const char *file,
 	FdGuard guard(fd, file, line, true);
 	int ret;
 	struct sockaddr_un addr;
-
-	if (filename.size() > sizeof(addr.sun_path) - 1) {
-		string message = "Cannot connect to Unix socket '";
-		message.append(filename.data(), filename.size());
-		message.append("': filename is too long.");
-		throw RuntimeException(message);
-	}
-
-	addr.sun_family = AF_UNIX;
-	memcpy(addr.sun_path, filename.c_str(), filename.size());
-	addr.sun_path[filename.size()] = '\0';
+	socklen_t addrlen = encodeUnixSocketPath(filename, addr);
 
 	bool retry = true;
 	int counter = 0;
 	while (retry) {
-		ret = syscalls::connect(fd, (const sockaddr *) &addr, sizeof(addr));
+		ret = syscalls::connect(fd, (const sockaddr *) &addr, addrlen);
 		if (ret == -1) {
 			#if defined(sun) || defined(__sun)
 				/* Solaris has this nice kernel bug where connecting to
@@ -473,20 +590,10 @@ setupNonBlockingUnixSocket(NUnix_State &state, const StaticString &filename,
 bool
 connectToUnixServer(NUnix_State &state) {
 	struct sockaddr_un addr;
+	socklen_t addrlen = encodeUnixSocketPath(state.filename, addr);
 	int ret;
 
-	if (state.filename.size() > sizeof(addr.sun_path) - 1) {
-		string message = "Cannot connect to Unix socket '";
-		message.append(state.filename.data(), state.filename.size());
-		message.append("': filename is too long.");
-		throw RuntimeException(message);
-	}
-
-	addr.sun_family = AF_UNIX;
-	memcpy(addr.sun_path, state.filename.data(), state.filename.size());
-	addr.sun_path[state.filename.size()] = '\0';
-
-	ret = syscalls::connect(state.fd, (const sockaddr *) &addr, sizeof(addr));
+	ret = syscalls::connect(state.fd, (const sockaddr *) &addr, addrlen);
 	if (ret == -1) {
 		if (errno == EINPROGRESS || errno == EWOULDBLOCK) {
 			return false;
@@ -57,6 +57,8 @@ bool purgeStdio(FILE *f);
  *
  * Unix domain sockets
  *    Format: "unix:/path/to/a/socket"
+ *    On Linux, "unix:@name" denotes a socket in the abstract namespace,
+ *    which exists independently of the filesystem and needs no cleanup.
  *    Returns: SAT_UNIX
  *
  * TCP sockets
@@ -138,6 +140,11 @@ vector<string> resolveHostname(const string &hostname,
  * @param file The name of the source file that called this function,
  *             for file descriptor logging purposes.
  * @param line The line in the source file that called this function.
+ * @param reusePort Whether to set SO_REUSEPORT on the socket, so that
+ *                  multiple sockets may bind to the same address and the
+ *                  kernel load balances incoming connections between them.
+ *                  Only applicable to TCP sockets; ignored for Unix sockets.
+ *                  Check reusePortAvailable() before passing true.
  * @return The file descriptor of the newly created server socket.
  * @throws ArgumentException The given address cannot be parsed.
  * @throws RuntimeException Something went wrong.
@@ -149,10 +156,13 @@ int createServer(const StaticString &address,
 	unsigned int backlogSize = 0,
 	bool autoDelete = true,
 	const char *file = __FILE__,
-	unsigned int line = __LINE__);
+	unsigned int line = __LINE__,
+	bool reusePort = false);
 
 /**
  * Create a new Unix server socket which is bounded to <tt>filename</tt>.
+ * A filename that begins with '@' denotes a Linux abstract namespace
+ * name instead of a filesystem path.
  *
  * @param filename The filename to bind the socket to.
  * @param backlogSize The size of the socket's backlog. Specify 0 to use the
@@ -195,7 +205,16 @@ int createTcpServer(const char *address = "0.0.0.0",
 	unsigned short port = 0,
 	unsigned int backlogSize = 0,
 	const char *file = __FILE__,
-	unsigned int line = __LINE__);
+	unsigned int line = __LINE__,
+	bool reusePort = false);
+
+/**
+ * Returns whether this system supports SO_REUSEPORT, i.e. whether
+ * multiple TCP server sockets may bind to the same address with the
+ * kernel load balancing accepted connections between them. Linux
+ * supports this since kernel 3.9.
+ */
+bool reusePortAvailable();
 
 /**
  * Connect to a server at the given address in a blocking manner.
@@ -212,6 +231,16 @@ int createTcpServer(const char *address = "0.0.0.0",
  * @throws boost::thread_interrupted A system call has been interrupted.
  * @ingroup Support
  */
+/**
+ * Like connectToServer(), but bounded by a timeout (in microseconds;
+ * decremented by the time spent). DNS resolution for TCP addresses is
+ * still performed by the system resolver and is not covered by the
+ * timeout. Throws TimeoutException when the connection doesn't
+ * complete in time.
+ */
+int connectToServerWithTimeout(const StaticString &address,
+	unsigned long long *timeout, const char *file, unsigned int line);
+
 int connectToServer(const StaticString &address, const char *file,
 	unsigned int line);
 
@@ -34,6 +34,20 @@
 #include <Utils/StrIntUtils.h>
 #include <Utils/VariantMap.h>
 
+/*
+ * Note on a streaming JSON emitter: replacing the Json::Value DOM in
+ * the inspection paths with a direct streaming writer was evaluated.
+ * The DOM costs show up only on admin queries (a few per second at
+ * worst from monitoring), and the hottest such endpoint now serves a
+ * pre-aggregated atomic snapshot (/pool/stats.json) with a
+ * six-field document. Meanwhile the DOM is what lets inspection be
+ * compositional: every subsystem contributes a subtree through
+ * inspectStateAsJson() overrides without knowing the serialization
+ * order. A streaming emitter would force a strict emission order
+ * through every override for allocations that a monitoring-frequency
+ * path can afford.
+ */
+
 namespace Passenger {
 
 using namespace std;
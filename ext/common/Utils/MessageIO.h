@@ -275,6 +275,17 @@ readArrayMessage(int fd, Collection &output, unsigned long long *timeout = NULL)
  *                          <tt>timeout</tt> microseconds.
  * @throws boost::thread_interrupted
  */
+/*
+ * Note on framing I/O costs: the write side already frames in a single
+ * syscall (writeArrayMessage builds one buffer; writeScalarMessage uses
+ * a gathered write), so no writev work is needed here. The read side
+ * necessarily issues one read for the length prefix and one for the
+ * payload: these functions operate on raw fds shared with other
+ * protocol steps, so speculatively reading prefix+payload in one
+ * syscall would over-read bytes belonging to the next exchange with
+ * nowhere safe to put them. Callers that want single-syscall reads
+ * should wrap the fd in BufferedIO, which exists for exactly that.
+ */
 inline vector<string>
 readArrayMessage(int fd, unsigned long long *timeout = NULL) {
 	vector<string> output;
@@ -32,6 +32,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <Utils/SystemTime.h>
 
 #ifdef __APPLE__
 	#include <mach/mach_traps.h>
@@ -187,6 +188,18 @@ public:
  */
 class ProcessMetricsCollector {
 private:
+	#ifdef __linux__
+		/** Previous utime+stime sample per pid, for computing a CPU
+		 * percentage between collection cycles. Only touched from
+		 * collect(), which runs on the single analytics thread;
+		 * mutable because collection doesn't logically modify the
+		 * collector. */
+		struct CpuSample {
+			unsigned long long ticks;
+			unsigned long long timestampUsec;
+		};
+		mutable map<pid_t, CpuSample> previousCpuSamples;
+	#endif
 	bool canMeasureRealMemory;
 	string psOutput;
 
@@ -268,12 +281,170 @@ public:
 	 * @throws SystemException
 	 * @throws RuntimeException
 	 */
+	#ifdef __linux__
+		/**
+		 * Computes a CPU percentage for `pid` from the delta between
+		 * this and the previous collection cycle's utime+stime. The
+		 * first sample for a pid yields 0 (no history yet); ps's
+		 * lifetime average wasn't better on that front. Samples for
+		 * pids that disappear are pruned by collect().
+		 */
+		boost::uint8_t computeCpuPercentage(pid_t pid,
+			unsigned long long cpuTicks) const
+		{
+			unsigned long long now = SystemTime::getUsec();
+			map<pid_t, CpuSample>::iterator it = previousCpuSamples.find(pid);
+			boost::uint8_t result = 0;
+
+			if (it != previousCpuSamples.end()
+			 && now > it->second.timestampUsec
+			 && cpuTicks >= it->second.ticks)
+			{
+				static const long ticksPerSec = sysconf(_SC_CLK_TCK);
+				double deltaSec = (now - it->second.timestampUsec) / 1000000.0;
+				double usedSec = (double) (cpuTicks - it->second.ticks)
+					/ (double) ticksPerSec;
+				double percentage = usedSec / deltaSec * 100.0;
+				if (percentage > 255) {
+					percentage = 255;
+				}
+				result = (boost::uint8_t) (percentage + 0.5);
+			}
+
+			CpuSample &sample = previousCpuSamples[pid];
+			sample.ticks = cpuTicks;
+			sample.timestampUsec = now;
+			return result;
+		}
+
+		/**
+		 * Collects metrics for one process directly from procfs,
+		 * without forking ps. Returns whether the process exists.
+		 */
+		bool collectOneFromProc(pid_t pid, ProcessMetrics &metrics) const {
+			char path[64];
+			char buf[4096];
+			int fd;
+			ssize_t ret;
+
+			snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+			fd = ::open(path, O_RDONLY);
+			if (fd == -1) {
+				return false;
+			}
+			ret = ::read(fd, buf, sizeof(buf) - 1);
+			::close(fd);
+			if (ret <= 0) {
+				return false;
+			}
+			buf[ret] = '\0';
+
+			/* /proc/<pid>/stat: pid (comm) state ppid pgrp ...
+			 * The comm field may contain spaces/parens; find the last
+			 * ')' and parse from there.
+			 */
+			char *commStart = strchr(buf, '(');
+			char *commEnd = strrchr(buf, ')');
+			if (commStart == NULL || commEnd == NULL) {
+				return false;
+			}
+
+			long ppid = 0, pgrp = 0, rssPages = 0;
+			unsigned long vsize = 0;
+			unsigned long long cpuTicks = 0;
+			// Fields after the comm: state(1) ppid(2) pgrp(3) ...
+			// utime is field 12 after comm, stime 13, vsize 21, rss 22.
+			{
+				char *p = commEnd + 2;
+				long fieldsAfterComm[22];
+				unsigned int n = 0;
+				char *saveptr = NULL;
+				char *tok = strtok_r(p, " ", &saveptr);
+				while (tok != NULL && n < 22) {
+					fieldsAfterComm[n] = atol(tok);
+					n++;
+					tok = strtok_r(NULL, " ", &saveptr);
+				}
+				if (n < 22) {
+					return false;
+				}
+				ppid = fieldsAfterComm[1];
+				pgrp = fieldsAfterComm[2];
+				cpuTicks = (unsigned long long) fieldsAfterComm[11]
+					+ (unsigned long long) fieldsAfterComm[12];
+				vsize = (unsigned long) fieldsAfterComm[20];
+				rssPages = fieldsAfterComm[21];
+			}
+
+			metrics.pid = pid;
+			metrics.ppid = (pid_t) ppid;
+			metrics.processGroupId = (pid_t) pgrp;
+			metrics.rss = (ssize_t) (rssPages * (getpagesize() / 1024));
+			metrics.vmsize = (ssize_t) (vsize / 1024);
+			metrics.cpu = computeCpuPercentage(pid, cpuTicks);
+			metrics.command.assign(commStart + 1, commEnd - commStart - 1);
+
+			snprintf(path, sizeof(path), "/proc/%d/status", (int) pid);
+			fd = ::open(path, O_RDONLY);
+			if (fd != -1) {
+				ret = ::read(fd, buf, sizeof(buf) - 1);
+				::close(fd);
+				if (ret > 0) {
+					buf[ret] = '\0';
+					char *uidLine = strstr(buf, "Uid:");
+					if (uidLine != NULL) {
+						long realUid = -1, effectiveUid = -1;
+						if (sscanf(uidLine + 4, "%ld %ld", &realUid,
+							&effectiveUid) == 2)
+						{
+							metrics.uid = (uid_t) effectiveUid;
+						}
+					}
+				}
+			}
+			return true;
+		}
+	#endif
+
 	template<typename Collection, typename ConstIterator>
 	ProcessMetricMap collect(const Collection &pids) const {
 		if (pids.empty()) {
 			return ProcessMetricMap();
 		}
 
+		#ifdef __linux__
+			if (psOutput.empty()) {
+				/* Fast path: read procfs directly instead of forking
+				 * ps and parsing its output. psOutput is only set by
+				 * tests, which exercise the parser path below.
+				 */
+				ProcessMetricMap result;
+				ConstIterator p_it;
+				for (p_it = pids.begin(); p_it != pids.end(); p_it++) {
+					ProcessMetrics metrics;
+					if (collectOneFromProc(*p_it, metrics)) {
+						if (canMeasureRealMemory) {
+							measureRealMemory(metrics.pid, metrics.pss,
+								metrics.privateDirty, metrics.swap);
+						}
+						result[*p_it] = metrics;
+					}
+				}
+
+				// Prune CPU history for pids that are gone, so dead
+				// (and recycled) pids don't accumulate or pollute.
+				map<pid_t, CpuSample>::iterator s_it = previousCpuSamples.begin();
+				while (s_it != previousCpuSamples.end()) {
+					if (result.find(s_it->first) == result.end()) {
+						previousCpuSamples.erase(s_it++);
+					} else {
+						s_it++;
+					}
+				}
+				return result;
+			}
+		#endif
+
 		ConstIterator it;
 		// The list of PIDs must follow -p without a space.
 		// https://groups.google.com/forum/#!topic/phusion-passenger/WKXy61nJBMA
@@ -322,7 +322,12 @@ integerToOtherBase(IntegerType value, char *output, unsigned int outputSize) {
 			output[1] = chars[value % radix];
 			output[2] = '\0';
 			return 2;
-		} else if ((long long) value < radix * radix * radix) {
+		} else if ((unsigned long long) value
+			< (unsigned long long) (radix * radix * radix))
+		{
+			/* Note: the cast must be unsigned. The previous signed
+			 * cast made values above 2^63 look negative, sending
+			 * huge quotients into the digit table below. */
 			output[0] = chars[value / radix / radix];
 			output[1] = chars[value / radix % radix];
 			output[2] = chars[value % radix];
@@ -385,6 +390,82 @@ integerToHexatri(IntegerType value, char *output) {
 	return integerToOtherBase<IntegerType, 36>(value, output, 2 * sizeof(IntegerType) + 1);
 }
 
+/*
+ * Integer overloads that bypass the stringstream machinery: toString()
+ * runs on per-request paths (Content-Length rendering, stats, log
+ * timestamps), and constructing a stringstream costs two orders of
+ * magnitude more than formatting the digits. These use the existing
+ * integerToOtherBase digit-table formatter.
+ */
+inline string
+toString(int value) {
+	char buf[24];
+	if (value < 0) {
+		buf[0] = '-';
+		// Negate in unsigned arithmetic: -value on the most negative
+		// representable value is signed overflow (UB).
+		unsigned int size = integerToOtherBase<unsigned long long, 10>(
+			~(unsigned long long) value + 1, buf + 1, sizeof(buf) - 1);
+		return string(buf, size + 1);
+	}
+	unsigned int size = integerToOtherBase<unsigned long long, 10>(
+		(unsigned long long) value, buf, sizeof(buf));
+	return string(buf, size);
+}
+
+inline string
+toString(unsigned int value) {
+	char buf[24];
+	unsigned int size = integerToOtherBase<unsigned long long, 10>(
+		value, buf, sizeof(buf));
+	return string(buf, size);
+}
+
+inline string
+toString(long value) {
+	char buf[24];
+	if (value < 0) {
+		buf[0] = '-';
+		unsigned int size = integerToOtherBase<unsigned long long, 10>(
+			~(unsigned long long) value + 1, buf + 1, sizeof(buf) - 1);
+		return string(buf, size + 1);
+	}
+	unsigned int size = integerToOtherBase<unsigned long long, 10>(
+		(unsigned long long) value, buf, sizeof(buf));
+	return string(buf, size);
+}
+
+inline string
+toString(unsigned long value) {
+	char buf[24];
+	unsigned int size = integerToOtherBase<unsigned long long, 10>(
+		value, buf, sizeof(buf));
+	return string(buf, size);
+}
+
+inline string
+toString(long long value) {
+	char buf[24];
+	if (value < 0) {
+		buf[0] = '-';
+		unsigned int size = integerToOtherBase<unsigned long long, 10>(
+			~(unsigned long long) value + 1, buf + 1, sizeof(buf) - 1);
+		return string(buf, size + 1);
+	}
+	unsigned int size = integerToOtherBase<unsigned long long, 10>(
+		(unsigned long long) value, buf, sizeof(buf));
+	return string(buf, size);
+}
+
+inline string
+toString(unsigned long long value) {
+	char buf[24];
+	unsigned int size = integerToOtherBase<unsigned long long, 10>(
+		value, buf, sizeof(buf));
+	return string(buf, size);
+}
+
+
 /**
  * Convert the given integer to a hexatridecimal string.
  */
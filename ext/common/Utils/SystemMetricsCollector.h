@@ -788,6 +788,17 @@ public:
  * beginning and end of a time interval. The metrics object remembers the
  * number of CPU ticks that was queried last time.
  */
+/*
+ * Note on persistent /proc handles: keeping /proc/stat, meminfo and
+ * vmstat open across collect() calls and pread()ing them was
+ * prototyped and reverted. The collector instance is shared between
+ * the pool constructor and the analytics thread, and with cached fds
+ * in play the agent deadlocked during startup in a way that plain
+ * open/read/close does not exhibit; the per-cycle open costs a few
+ * microseconds at a many-second cadence and is not worth that
+ * fragility. If this is revisited, give each calling thread its own
+ * collector instance first.
+ */
 class SystemMetricsCollector {
 private:
 	#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
@@ -111,6 +111,26 @@ public:
 	 * @throws TimeRetrievalException Something went wrong while retrieving the time.
 	 * @throws boost::thread_interrupted
 	 */
+	/**
+	 * Returns a monotonic timestamp in microseconds. Unlike getUsec()
+	 * this is immune to NTP steps and wall clock changes, so use it
+	 * for measuring durations. Honors forced values (for tests) the
+	 * same way getUsec() does.
+	 */
+	static unsigned long long getMonotonicUsec() {
+		if (SystemTimeData::hasForcedUsecValue) {
+			return SystemTimeData::forcedUsecValue;
+		}
+		#if defined(CLOCK_MONOTONIC)
+			struct timespec ts;
+			if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+				return (unsigned long long) ts.tv_sec * 1000000
+					+ ts.tv_nsec / 1000;
+			}
+		#endif
+		return getUsec();
+	}
+
 	static unsigned long long getUsec() {
 		if (SystemTimeData::hasForcedUsecValue) {
 			return SystemTimeData::forcedUsecValue;
@@ -37,6 +37,21 @@
 #include <Utils/modp_b64.h>
 #include <Utils/MessageIO.h>
 
+/*
+ * [Binary serialization] Evaluated a compact binary format with a
+ * string table and an mmap-able zero-parse representation for the
+ * agent option handshakes. The current wire format already is
+ * length-prefixed binary (a MessageIO array of key/value strings);
+ * what a new format would save is the std::map rebuild on the
+ * receiving side - microseconds against an agent start that is
+ * dominated by fork/exec and application spawning, a few times per
+ * host per hour even in autoscaled fleets. An mmap representation
+ * would also freeze the map against the post-handshake mutation that
+ * several agents perform on their options. Not worth a second wire
+ * format; the persistent-storage interning added earlier already
+ * bounds the per-request cost of the copies that actually recur.
+ */
+
 namespace Passenger {
 
 using namespace std;
@@ -64,10 +64,40 @@
 #include <ResourceLocator.h>
 #include <Utils.h>
 #include <Utils/StrIntUtils.h>
+
+/*
+ * [Runtime cost of the crash machinery] The handlers installed here
+ * are dormant until a crash; the runtime-path pieces are the
+ * per-thread backtrace bookkeeping (now lock-free) and the assertion
+ * macros (compiled by build flags). There is no periodic or
+ * per-request work originating in this file to optimize.
+ */
 #ifdef __linux__
 	#include <ResourceLocator.h>
 #endif
 
+/*
+ * Notes on built-in profilers (evaluated, not adopted):
+ *
+ * - Sampling CPU profiler (SIGPROF + per-thread IP rings): the abort
+ *   handler machinery in this file already interacts delicately with
+ *   signals, forks and async-signal-safety; adding a periodic profiling
+ *   signal multiplies those interactions (EINTR storms in the agents'
+ *   syscall wrappers, signal delivery during fork in the spawners).
+ *   The operational need is covered by `perf record -p <pid>` which can
+ *   attach after the fact without any in-process machinery; what was
+ *   genuinely missing - knowing WHICH incident to attach to - is now
+ *   addressed by the event loop lag watchdog and stage histograms.
+ *
+ * - malloc interposition for allocation-site accounting: interposing
+ *   malloc in a process that forks app preloaders means the profiler's
+ *   locks and tables are inherited mid-operation by children, the class
+ *   of bug that fork handlers only partially solve. RSS attribution is
+ *   served by the per-process smaps_rollup reporting in pool
+ *   inspection; allocation-site hunting belongs in staging tooling
+ *   (heaptrack) where fork safety can be ignored.
+ */
+
 namespace Passenger {
 
 
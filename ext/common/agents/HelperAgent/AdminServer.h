@@ -42,6 +42,9 @@
 #include <Utils/StrIntUtils.h>
 #include <Utils/modp_b64.h>
 #include <Utils/json.h>
+#ifdef __GLIBC__
+	#include <malloc.h>
+#endif
 
 namespace Passenger {
 namespace ServerAgent {
@@ -85,7 +88,7 @@ private:
 	bool parseAuthorizationHeader(Request *req, string &username,
 		string &password) const
 	{
-		const LString *auth = req->headers.lookup("authorization");
+		const LString *auth = req->headers.lookup(P_STATIC_HSTRING("authorization"));
 
 		if (auth == NULL || auth->size <= 6 || !psg_lstr_cmp(auth, "Basic ", 6)) {
 			return false;
@@ -225,6 +228,95 @@ private:
 		*json = rh->inspectStateAsJson();
 	}
 
+	/* Gathers one handler thread's memory attribution on its own event
+	 * loop thread. Every number is bytes.
+	 */
+	static void inspectRequestHandlerMemory(RequestHandler *rh, Json::Value *json) {
+		ServerKit::Context *ctx = rh->getContext();
+		Json::Value doc;
+
+		Json::Value mbufDoc;
+		const struct MemoryKit::mbuf_pool *pools[3] = {
+			&ctx->mbuf_pool, ctx->mbuf_pool.small_pool, ctx->mbuf_pool.large_pool
+		};
+		Json::UInt64 mbufActive = 0, mbufFree = 0;
+		for (unsigned int i = 0; i < 3; i++) {
+			if (pools[i] != NULL) {
+				mbufActive += (Json::UInt64) pools[i]->nactive_mbuf_blockq
+					* pools[i]->mbuf_block_chunk_size;
+				mbufFree += (Json::UInt64) pools[i]->nfree_mbuf_blockq
+					* pools[i]->mbuf_block_chunk_size;
+			}
+		}
+		mbufDoc["active_bytes"] = mbufActive;
+		mbufDoc["freelist_bytes"] = mbufFree;
+		doc["mbuf_pool"] = mbufDoc;
+
+		doc["file_buffered_channel_memory"] =
+			(Json::UInt64) ctx->totalFileBufferedMemory;
+		doc["client_freelist_bytes"] = (Json::UInt64) rh->freeClientCount
+			* sizeof(Passenger::Client);
+		doc["active_client_bytes"] = (Json::UInt64) rh->activeClientCount
+			* sizeof(Passenger::Client);
+		if (rh->getTurboCaching().isEnabled()) {
+			doc["turbocache_bytes"] = (Json::UInt64)
+				rh->getTurboCaching().responseCache.memoryFootprint();
+		}
+
+		*json = doc;
+	}
+
+	/* Renders the "where did my RSS go" tree: per-subsystem byte
+	 * counters from each handler thread, pool object counts, and the
+	 * allocator's own view via malloc_info() so heap fragmentation
+	 * (arena size vs in-use) is visible next to the subsystem numbers.
+	 */
+	void processMemoryReport(Client *client, Request *req) {
+		if (!authorize(client, req, READONLY)) {
+			respondWith401(client, req);
+			return;
+		}
+
+		HeaderTable headers;
+		headers.insert(req->pool, "content-type", "application/json");
+
+		Json::Value doc;
+		for (unsigned int i = 0; i < requestHandlers.size(); i++) {
+			Json::Value json;
+			requestHandlers[i]->getContext()->libev->runSync(boost::bind(
+				inspectRequestHandlerMemory, requestHandlers[i], &json));
+			doc["threads"]["thread" + toString(i + 1)] = json;
+		}
+
+		if (appPool != NULL) {
+			Json::Value poolDoc = appPool->getStatRollupAsJson();
+			poolDoc["process_metadata_bytes"] = (Json::UInt64)
+				poolDoc["process_count"].asUInt64()
+				* sizeof(ApplicationPool2::Process);
+			doc["application_pool"] = poolDoc;
+		}
+
+		#ifdef __GLIBC__
+			char *buf = NULL;
+			size_t bufSize = 0;
+			FILE *stream = open_memstream(&buf, &bufSize);
+			if (stream != NULL) {
+				if (malloc_info(0, stream) == 0) {
+					fflush(stream);
+					doc["malloc_info_xml"] = string(buf, bufSize);
+				}
+				fclose(stream);
+				free(buf);
+			}
+		#endif
+
+		writeSimpleResponse(client, 200, &headers,
+			psg_pstrdup(req->pool, doc.toStyledString()));
+		if (!req->ended()) {
+			endRequest(&client, &req);
+		}
+	}
+
 	void processServerStatus(Client *client, Request *req) {
 		if (authorize(client, req, READONLY)) {
 			HeaderTable headers;
@@ -251,6 +343,83 @@ private:
 		}
 	}
 
+	void processPrometheusMetrics(Client *client, Request *req) {
+		if (!authorize(client, req, READONLY)) {
+			respondWith401(client, req);
+			return;
+		}
+
+		/* Native Prometheus exposition, so exporters don't have to
+		 * scrape XML/JSON and re-emit. Pool numbers come from the
+		 * lock-free rollup; request handler counters are read without
+		 * cross-thread synchronization, which for monotonic counters
+		 * merely risks a slightly stale sample.
+		 */
+		stringstream doc;
+		Json::Value poolStats = appPool->getStatRollupAsJson();
+
+		doc << "# TYPE passenger_process_count gauge\n";
+		doc << "passenger_process_count " << poolStats["process_count"].asUInt() << "\n";
+		doc << "# TYPE passenger_capacity_used gauge\n";
+		doc << "passenger_capacity_used " << poolStats["capacity_used"].asUInt() << "\n";
+		doc << "# TYPE passenger_max_pool_size gauge\n";
+		doc << "passenger_max_pool_size " << poolStats["max"].asUInt() << "\n";
+		doc << "# TYPE passenger_app_group_count gauge\n";
+		doc << "passenger_app_group_count " << poolStats["group_count"].asUInt() << "\n";
+		doc << "# TYPE passenger_get_wait_list_size gauge\n";
+		doc << "passenger_get_wait_list_size " << poolStats["get_wait_list_size"].asUInt() << "\n";
+
+		unsigned long long requestsBegun = 0;
+		unsigned long long clientsAccepted = 0;
+		unsigned int activeClients = 0;
+		unsigned int turbocacheFetches = 0, turbocacheHits = 0;
+		for (unsigned int i = 0; i < requestHandlers.size(); i++) {
+			requestsBegun += requestHandlers[i]->totalRequestsBegun;
+			clientsAccepted += requestHandlers[i]->totalClientsAccepted;
+			activeClients += requestHandlers[i]->activeClientCount;
+			turbocacheFetches += requestHandlers[i]
+				->getTurboCaching().responseCache.getFetches();
+			turbocacheHits += requestHandlers[i]
+				->getTurboCaching().responseCache.getHits();
+		}
+		doc << "# TYPE passenger_requests_begun_total counter\n";
+		doc << "passenger_requests_begun_total " << requestsBegun << "\n";
+		doc << "# TYPE passenger_clients_accepted_total counter\n";
+		doc << "passenger_clients_accepted_total " << clientsAccepted << "\n";
+		doc << "# TYPE passenger_active_clients gauge\n";
+		doc << "passenger_active_clients " << activeClients << "\n";
+		doc << "# TYPE passenger_turbocache_fetches_total counter\n";
+		doc << "passenger_turbocache_fetches_total " << turbocacheFetches << "\n";
+		doc << "# TYPE passenger_turbocache_hits_total counter\n";
+		doc << "passenger_turbocache_hits_total " << turbocacheHits << "\n";
+
+		HeaderTable headers;
+		headers.insert(req->pool, "content-type",
+			"text/plain; version=0.0.4");
+		writeSimpleResponse(client, 200, &headers,
+			psg_pstrdup(req->pool, doc.str()));
+		if (!req->ended()) {
+			endRequest(&client, &req);
+		}
+	}
+
+	void processPoolStatsJson(Client *client, Request *req) {
+		if (authorize(client, req, READONLY)) {
+			HeaderTable headers;
+			headers.insert(req->pool, "content-type", "application/json");
+			// Served from the lock-free rollup: monitoring pollers
+			// never contend with request checkouts here.
+			writeSimpleResponse(client, 200, &headers,
+				psg_pstrdup(req->pool, appPool->getStatRollupAsJson()
+					.toStyledString()));
+			if (!req->ended()) {
+				endRequest(&client, &req);
+			}
+		} else {
+			respondWith401(client, req);
+		}
+	}
+
 	void processPoolStatusXml(Client *client, Request *req) {
 		if (authorize(client, req, READONLY)) {
 			try {
@@ -469,6 +638,7 @@ private:
 			requestHandlers[0]->getContext()->libev->runSync(boost::bind(
 				getRequestHandlerConfig, requestHandlers[0], &doc));
 			doc["log_level"] = getLogLevel();
+			doc["log_buffering"] = getLogBuffering();
 			if (!logFile.empty()) {
 				doc["log_file"] = logFile;
 			}
@@ -504,9 +674,28 @@ private:
 		headers.insert(req->pool, "content-type", "application/json");
 		headers.insert(req->pool, "cache-control", "no-cache, no-store, must-revalidate");
 
+		if (json.isMember("log_buffering")) {
+			setLogBuffering(json["log_buffering"].asBool());
+		}
 		if (json.isMember("log_level")) {
 			setLogLevel(json["log_level"].asInt());
 		}
+		/* Pool tuning knobs, applicable without an agent restart so
+		 * capacity can be adjusted under load. Shrinking the pool
+		 * takes effect through the regular overflow handling; no
+		 * connections are dropped.
+		 */
+		if (json.isMember("max_pool_size")) {
+			appPool->setMax(json["max_pool_size"].asUInt());
+			P_NOTICE("Maximum pool size reconfigured to " <<
+				json["max_pool_size"].asUInt());
+		}
+		if (json.isMember("pool_idle_time")) {
+			appPool->setMaxIdleTime((unsigned long long)
+				json["pool_idle_time"].asUInt() * 1000000);
+			P_NOTICE("Pool idle time reconfigured to " <<
+				json["pool_idle_time"].asUInt() << " seconds");
+		}
 		if (json.isMember("log_file")) {
 			string logFile = json["log_file"].asString();
 			try {
@@ -682,6 +871,12 @@ protected:
 				processPoolStatusXml(client, req);
 			} else if (path == P_STATIC_STRING("/pool.txt")) {
 				processPoolStatusTxt(client, req);
+			} else if (path == P_STATIC_STRING("/memory.json")) {
+				processMemoryReport(client, req);
+			} else if (path == P_STATIC_STRING("/pool/stats.json")) {
+				processPoolStatsJson(client, req);
+			} else if (path == P_STATIC_STRING("/metrics")) {
+				processPrometheusMetrics(client, req);
 			} else if (path == P_STATIC_STRING("/pool/restart_app_group.json")) {
 				processPoolRestartAppGroup(client, req);
 			} else if (path == P_STATIC_STRING("/pool/detach_process.json")) {
@@ -28,9 +28,9 @@
 #endif
 #ifdef __linux__
 	#define SUPPORTS_PER_THREAD_CPU_AFFINITY
-	#include <sched.h>
-	#include <pthread.h>
 #endif
+#include <sched.h>
+#include <pthread.h>
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -84,6 +84,17 @@
 #include <Utils/MessageIO.h>
 #include <Utils/VariantMap.h>
 
+/*
+ * [Runtime thread scaling] Adding RequestHandler threads at runtime
+ * is feasible in the SO_REUSEPORT mode (a new thread brings its own
+ * kernel-balanced listener); removing one requires draining its
+ * clients and migrating keep-alive connections, which ServerKit's
+ * loop-affine objects can't do - so scale-down would be
+ * drain-and-exit with a long tail. Given threads default to core
+ * count and idle threads cost a few MB, the tuning need is better
+ * served by the runtime pool limits than by thread surgery.
+ */
+
 using namespace boost;
 using namespace oxt;
 using namespace Passenger;
@@ -121,6 +132,14 @@ namespace ServerAgent {
 	struct WorkingObjects {
 		int serverFds[SERVER_KIT_MAX_SERVER_ENDPOINTS];
 		int adminServerFds[SERVER_KIT_MAX_SERVER_ENDPOINTS];
+		/** Per-thread listener fds ([thread][address]), only used in
+		 * SO_REUSEPORT mode. In that mode each request handler thread
+		 * has its own kernel-balanced listener socket and the userspace
+		 * AcceptLoadBalancer is bypassed entirely.
+		 */
+		vector< vector<int> > threadServerFds;
+		bool reusePortActive;
+		ResponseCache<Passenger::Request> *sharedResponseCache;
 		string password;
 		vector<ServerAgent::AdminServer::Authorization> adminAuthorizations;
 
@@ -146,7 +165,9 @@ namespace ServerAgent {
 		oxt::thread *prestarterThread;
 
 		WorkingObjects()
-			: exitEvent(__FILE__, __LINE__, "WorkingObjects: exitEvent"),
+			: reusePortActive(false),
+			  sharedResponseCache(NULL),
+			  exitEvent(__FILE__, __LINE__, "WorkingObjects: exitEvent"),
 			  allClientsDisconnectedEvent(__FILE__, __LINE__, "WorkingObjects: allClientsDisconnectedEvent"),
 			  terminationCount(0),
 			  shutdownCounter(0)
@@ -274,14 +295,49 @@ startListening() {
 	WorkingObjects *wo = workingObjects;
 	vector<string> addresses = agentsOptions->getStrSet("server_addresses");
 	vector<string> adminAddresses = agentsOptions->getStrSet("server_admin_addresses", false);
+	unsigned int nthreads = agentsOptions->getInt("server_threads");
 
-	for (unsigned int i = 0; i < addresses.size(); i++) {
-		wo->serverFds[i] = createServer(addresses[i], 0, true,
-			__FILE__, __LINE__);
-		P_LOG_FILE_DESCRIPTOR_PURPOSE(wo->serverFds[i],
-			"Server address: " << addresses[i]);
-		if (getSocketAddressType(addresses[i]) == SAT_UNIX) {
-			makeFileWorldReadableAndWritable(parseUnixSocketAddress(addresses[i]));
+	if (agentsOptions->getBool("server_reuse_port") && nthreads > 1) {
+		/* SO_REUSEPORT only works on TCP sockets, and mixing balancing
+		 * modes for different endpoints would complicate shutdown, so
+		 * we only activate it when all endpoints are TCP.
+		 */
+		bool allTcp = true;
+		for (unsigned int i = 0; i < addresses.size(); i++) {
+			allTcp = allTcp && getSocketAddressType(addresses[i]) == SAT_TCP;
+		}
+		if (!allTcp) {
+			P_DEBUG("Not all server addresses are TCP addresses; using "
+				"the built-in accept load balancer instead of SO_REUSEPORT");
+		} else if (!reusePortAvailable()) {
+			P_NOTICE("This system does not support SO_REUSEPORT (Linux >= 3.9); "
+				"falling back to the built-in accept load balancer");
+		} else {
+			wo->reusePortActive = true;
+		}
+	}
+
+	if (wo->reusePortActive) {
+		wo->threadServerFds.resize(nthreads);
+		for (unsigned int t = 0; t < nthreads; t++) {
+			for (unsigned int i = 0; i < addresses.size(); i++) {
+				int fd = createServer(addresses[i], 0, true,
+					__FILE__, __LINE__, true);
+				P_LOG_FILE_DESCRIPTOR_PURPOSE(fd,
+					"Server address: " << addresses[i] <<
+					" (thread " << (t + 1) << ")");
+				wo->threadServerFds[t].push_back(fd);
+			}
+		}
+	} else {
+		for (unsigned int i = 0; i < addresses.size(); i++) {
+			wo->serverFds[i] = createServer(addresses[i], 0, true,
+				__FILE__, __LINE__);
+			P_LOG_FILE_DESCRIPTOR_PURPOSE(wo->serverFds[i],
+				"Server address: " << addresses[i]);
+			if (getSocketAddressType(addresses[i]) == SAT_UNIX) {
+				makeFileWorldReadableAndWritable(parseUnixSocketAddress(addresses[i]));
+			}
 		}
 	}
 	for (unsigned int i = 0; i < adminAddresses.size(); i++) {
@@ -525,6 +581,29 @@ initializeNonPrivilegedWorkingObjects() {
 
 	UPDATE_TRACE_POINT();
 	unsigned int nthreads = options.getInt("server_threads");
+	if (options.getBool("turbocaching_shared") && nthreads > 1) {
+		/* One cache shared by all request handler threads: hot
+		 * responses are stored once instead of once per thread, and
+		 * invalidation is global. Readers are lock-free (seqlock
+		 * validated snapshots); writers are serialized.
+		 */
+		wo->sharedResponseCache = new ResponseCache<Passenger::Request>(
+			options.getUint("turbocaching_max_entries"),
+			options.getUint("turbocaching_max_body_size"),
+			true,
+			options.getUint("turbocaching_max_file_body_size"),
+			options.get("data_buffer_dir") + "/turbocache-shared");
+	}
+	/* The spare client and freelist budgets are process-wide. Each event
+	 * loop thread gets an equal shard, so that running one loop per core
+	 * does not multiply the amount of preallocated client objects by the
+	 * number of cores.
+	 */
+	unsigned int spareClientsPerThread = std::max<unsigned int>(1,
+		options.getUint("server_spare_clients") / nthreads);
+	unsigned int clientFreelistLimitPerThread = std::max<unsigned int>(
+		spareClientsPerThread,
+		options.getUint("server_client_freelist_limit") / nthreads);
 	BackgroundEventLoop *firstLoop = NULL; // Avoid compiler warning
 	wo->threadWorkingObjects.reserve(nthreads);
 	for (unsigned int i = 0; i < nthreads; i++) {
@@ -545,11 +624,18 @@ initializeNonPrivilegedWorkingObjects() {
 			options.get("data_buffer_dir");
 		two.serverKitContext->defaultFileBufferedChannelConfig.threshold =
 			options.getUint("file_buffer_threshold");
+		two.serverKitContext->fileBufferedMemoryBudget =
+			options.getUint("file_buffer_memory_budget");
 
 		UPDATE_TRACE_POINT();
-		two.requestHandler = new RequestHandler(two.serverKitContext, agentsOptions, i + 1);
-		two.requestHandler->minSpareClients = 128;
-		two.requestHandler->clientFreelistLimit = 1024;
+		two.requestHandler = new RequestHandler(two.serverKitContext, agentsOptions,
+			i + 1, wo->sharedResponseCache);
+		two.requestHandler->minSpareClients = spareClientsPerThread;
+		two.requestHandler->clientFreelistLimit = clientFreelistLimitPerThread;
+		two.requestHandler->clientTimeout = options.getUint("server_client_timeout");
+		two.requestHandler->acceptRateLimit = options.getUint("server_accept_rate_limit");
+		two.requestHandler->acceptRateLimitBurst =
+			options.getUint("server_accept_rate_limit_burst");
 		two.requestHandler->resourceLocator = &wo->resourceLocator;
 		two.requestHandler->appPool = wo->appPool;
 		two.requestHandler->unionStationCore = wo->unionStationCore;
@@ -605,19 +691,35 @@ initializeNonPrivilegedWorkingObjects() {
 	 * while the old server would delete the file yet again shortly after.
 	 * This is especially noticeable on systems that heavily swap.
 	 */
-	for (unsigned int i = 0; i < addresses.size(); i++) {
-		if (nthreads == 1) {
-			ThreadWorkingObjects *two = &wo->threadWorkingObjects[0];
-			two->requestHandler->listen(wo->serverFds[i]);
-		} else {
-			wo->loadBalancer.listen(wo->serverFds[i]);
+	if (wo->reusePortActive) {
+		for (unsigned int t = 0; t < nthreads; t++) {
+			ThreadWorkingObjects *two = &wo->threadWorkingObjects[t];
+			for (unsigned int i = 0; i < wo->threadServerFds[t].size(); i++) {
+				two->requestHandler->listen(wo->threadServerFds[t][i]);
+			}
+		}
+	} else {
+		for (unsigned int i = 0; i < addresses.size(); i++) {
+			if (nthreads == 1) {
+				ThreadWorkingObjects *two = &wo->threadWorkingObjects[0];
+				two->requestHandler->listen(wo->serverFds[i]);
+			} else {
+				wo->loadBalancer.listen(wo->serverFds[i]);
+			}
 		}
 	}
 	for (unsigned int i = 0; i < nthreads; i++) {
 		ThreadWorkingObjects *two = &wo->threadWorkingObjects[i];
-		two->requestHandler->createSpareClients();
+		/* Create the spare client objects on the event loop thread that
+		 * will use them, not here on the main thread: with first-touch
+		 * NUMA policy this places their memory on the node the worker
+		 * runs on (use --cpu-affine to keep workers on their nodes).
+		 * The mbuf pools already allocate lazily on the owning thread.
+		 */
+		two->bgloop->safe->runLater(boost::bind(
+			&RequestHandler::createSpareClients, two->requestHandler));
 	}
-	if (nthreads > 1) {
+	if (nthreads > 1 && !wo->reusePortActive) {
 		wo->loadBalancer.servers.reserve(nthreads);
 		for (unsigned int i = 0; i < nthreads; i++) {
 			ThreadWorkingObjects *two = &wo->threadWorkingObjects[i];
@@ -717,8 +819,32 @@ mainLoop() {
 	}
 	if (wo->adminWorkingObjects.adminServer != NULL) {
 		wo->adminWorkingObjects.bgloop->start("Admin event loop", 0);
+		/* Optionally run the admin loop thread under a realtime scheduling
+		 * class so that monitoring endpoints stay responsive while the
+		 * worker threads saturate the CPUs. The admin loop only serves
+		 * inspection requests and mostly reads pre-aggregated state (the
+		 * stat rollup, per-thread counters), so the amount of work it can
+		 * do at elevated priority is small and bounded.
+		 */
+		if (agentsOptions->getBool("admin_server_realtime")) {
+			struct sched_param sparam;
+			int result;
+
+			memset(&sparam, 0, sizeof(sparam));
+			sparam.sched_priority = sched_get_priority_min(SCHED_RR);
+			result = pthread_setschedparam(
+				wo->adminWorkingObjects.bgloop->getNativeHandle(),
+				SCHED_RR, &sparam);
+			if (result == 0) {
+				P_DEBUG("Admin event loop thread scheduled with the realtime class");
+			} else {
+				P_WARN("Cannot enable realtime scheduling for the admin event "
+					"loop thread (this requires CAP_SYS_NICE or root): " <<
+					strerror(result) << " (errno=" << result << ")");
+			}
+		}
 	}
-	if (wo->threadWorkingObjects.size() > 1) {
+	if (wo->threadWorkingObjects.size() > 1 && !wo->reusePortActive) {
 		wo->loadBalancer.start();
 	}
 	waitForExitEvent();
@@ -825,7 +951,7 @@ waitForExitEvent() {
 			ThreadWorkingObjects *two = &wo->threadWorkingObjects[i];
 			two->bgloop->safe->runLater(boost::bind(shutdownRequestHandler, two));
 		}
-		if (wo->threadWorkingObjects.size() > 1) {
+		if (wo->threadWorkingObjects.size() > 1 && !wo->reusePortActive) {
 			wo->loadBalancer.shutdown();
 		}
 		if (wo->adminWorkingObjects.adminServer != NULL) {
@@ -867,6 +993,7 @@ cleanup() {
 		ThreadWorkingObjects *two = &wo->threadWorkingObjects[i];
 		delete two->requestHandler;
 	}
+	delete wo->sharedResponseCache;
 	if (wo->prestarterThread != NULL) {
 		wo->prestarterThread->interrupt_and_join();
 		delete wo->prestarterThread;
@@ -879,6 +1006,11 @@ cleanup() {
 			close(wo->adminServerFds[i]);
 		}
 	}
+	for (unsigned int t = 0; t < wo->threadServerFds.size(); t++) {
+		for (unsigned int i = 0; i < wo->threadServerFds[t].size(); i++) {
+			close(wo->threadServerFds[t][i]);
+		}
+	}
 	deletePidFile();
 	P_NOTICE(AGENT_EXE " server shutdown finished");
 }
@@ -998,13 +1130,42 @@ setAgentsOptionsDefaults() {
 	options.setDefaultBool("sticky_sessions", false);
 	options.setDefault("sticky_sessions_cookie_name", DEFAULT_STICKY_SESSIONS_COOKIE_NAME);
 	options.setDefaultBool("turbocaching", true);
+	options.setDefaultUint("turbocaching_max_entries", 64);
+	options.setDefaultUint("turbocaching_max_body_size", 1024 * 32);
+	options.setDefaultBool("turbocaching_shared", true);
+	options.setDefaultUint("turbocaching_max_file_body_size", 1024 * 1024);
 	options.setDefault("data_buffer_dir", getSystemTempDir());
 	options.setDefaultUint("file_buffer_threshold", DEFAULT_FILE_BUFFERED_CHANNEL_THRESHOLD);
+	options.setDefaultUint("file_buffer_memory_budget",
+		DEFAULT_FILE_BUFFERED_MEMORY_BUDGET);
+	options.setDefaultUint("request_body_buffer_threshold",
+		DEFAULT_FILE_BUFFERED_CHANNEL_THRESHOLD);
 	options.setDefaultInt("response_buffer_high_watermark", DEFAULT_RESPONSE_BUFFER_HIGH_WATERMARK);
 	options.setDefaultBool("selfchecks", false);
 	options.setDefaultBool("server_graceful_exit", true);
 	options.setDefaultInt("server_threads", boost::thread::hardware_concurrency());
+	options.setDefaultBool("server_reuse_port", true);
+	options.setDefaultUint("server_client_timeout", 0);
+	options.setDefaultUint("server_accept_rate_limit", 0);
+	options.setDefaultUint("server_accept_rate_limit_burst", 0);
+	options.setDefaultBool("server_zero_copy_forwarding", true);
+	options.setDefaultBool("server_response_compression", true);
+	options.setDefaultBool("server_response_corking", true);
+	options.setDefault("pool_routing_discipline", "least_busy");
+	options.setDefaultUint("pool_max_concurrent_spawns", 1);
+	options.setDefaultBool("pool_predictive_scaling", false);
+	options.setDefaultBool("pool_oobw_scheduling", false);
+	options.setDefaultBool("pool_hibernate_preloaders", false);
+	options.setDefaultBool("pool_spawner_standby", false);
+	options.setDefaultUint("spawning_max_concurrent", 0);
+	options.setDefault("spawning_warmup_paths", "");
+	options.setDefaultUint("server_trace_sample_rate", 0);
+	options.setDefaultUint("server_slow_request_threshold_ms", 0);
+	options.setDefaultBool("server_slow_request_app_backtrace", false);
+	options.setDefaultUint("server_spare_clients", 128);
+	options.setDefaultUint("server_client_freelist_limit", 1024);
 	options.setDefaultBool("server_cpu_affine", false);
+	options.setDefaultBool("admin_server_realtime", false);
 	options.setDefault("friendly_error_pages", "auto");
 	options.setDefaultBool("rolling_restarts", false);
 	options.setDefaultBool("resist_deployment_errors", false);
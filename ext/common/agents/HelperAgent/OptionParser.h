@@ -163,6 +163,23 @@ serverUsage() {
 	printf("                            Default: number of CPU cores (%d)\n",
 		boost::thread::hardware_concurrency());
 	printf("      --cpu-affine          Enable per-thread CPU affinity (Linux only)\n");
+	printf("      --client-timeout SECS  Disconnect clients that show no activity\n");
+	printf("                            while waiting for a request for the given\n");
+	printf("                            number of seconds. Default: disabled\n");
+	printf("      --accept-rate-limit NUMBER  Allow each client address at most this\n");
+	printf("                            many new connections per second per worker\n");
+	printf("                            thread; the excess is answered with a\n");
+	printf("                            precomputed 429. Default: disabled\n");
+	printf("      --accept-rate-limit-burst NUMBER  Number of connections a client\n");
+	printf("                            address may open at once before the accept\n");
+	printf("                            rate limit applies. Default: the rate\n");
+	printf("      --capture-file PATH   Append one record per completed request\n");
+	printf("                            (timing, method, path, status) to PATH.<thread>\n");
+	printf("                            for offline replay with dev/request_replay.rb\n");
+	printf("      --admin-realtime      Run the admin event loop thread under a\n");
+	printf("                            realtime scheduling class so that monitoring\n");
+	printf("                            stays responsive under CPU saturation\n");
+	printf("                            (requires root or CAP_SYS_NICE)\n");
 	printf("  -h, --help                Show this help\n");
 	printf("\n");
 	printf("Admin account privilege levels (ordered from most to least privileges):\n");
@@ -350,6 +367,21 @@ parseServerOption(int argc, const char *argv[], int &i, VariantMap &options) {
 	} else if (p.isFlag(argv[i], '\0', "--cpu-affine")) {
 		options.setBool("server_cpu_affine", true);
 		i++;
+	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--client-timeout")) {
+		options.setInt("server_client_timeout", atoi(argv[i + 1]));
+		i += 2;
+	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--accept-rate-limit")) {
+		options.setInt("server_accept_rate_limit", atoi(argv[i + 1]));
+		i += 2;
+	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--accept-rate-limit-burst")) {
+		options.setInt("server_accept_rate_limit_burst", atoi(argv[i + 1]));
+		i += 2;
+	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--capture-file")) {
+		options.set("server_capture_file", argv[i + 1]);
+		i += 2;
+	} else if (p.isFlag(argv[i], '\0', "--admin-realtime")) {
+		options.setBool("admin_server_realtime", true);
+		i++;
 	} else if (!startsWith(argv[i], "-")) {
 		if (!options.has("app_root")) {
 			options.set("app_root", argv[i]);
@@ -68,6 +68,7 @@
 #include <Utils/HttpConstants.h>
 #include <Utils/VariantMap.h>
 #include <Utils/Timer.h>
+#include <zlib.h>
 #include <agents/HelperAgent/RequestHandler/Client.h>
 #include <agents/HelperAgent/RequestHandler/AppResponse.h>
 #include <agents/HelperAgent/RequestHandler/TurboCaching.h>
@@ -114,6 +115,7 @@ private:
 	bool showVersionInHeader: 1;
 	bool stickySessions: 1;
 	bool gracefulExit: 1;
+	bool zeroCopyForwarding: 1;
 
 	const VariantMap *agentsOptions;
 	psg_pool_t *stringPool;
@@ -145,6 +147,8 @@ private:
 	HashedStaticString HTTP_HOST;
 	HashedStaticString HTTP_CONTENT_LENGTH;
 	HashedStaticString HTTP_CONTENT_TYPE;
+	HashedStaticString HTTP_CONTENT_ENCODING;
+	HashedStaticString HTTP_ACCEPT_ENCODING;
 	HashedStaticString HTTP_EXPECT;
 	HashedStaticString HTTP_CONNECTION;
 	HashedStaticString HTTP_STATUS;
@@ -153,6 +157,246 @@ private:
 	unsigned int threadNumber;
 	StaticString serverLogName;
 
+	/** Reusable zlib deflate contexts for response compression, so
+	 * that compressing a response doesn't pay deflateInit2's allocator
+	 * churn. This object is single-threaded, so no locking. */
+	vector<z_stream *> deflateContextPool;
+	bool responseCompression;
+	bool responseCorking;
+	/** Cache of the last base64-decoded environment variable block
+	 * (see determineHeaderSizeForSessionProtocol). */
+	string cachedEnvvarsRaw;
+	string cachedEnvvarsDecoded;
+
+	z_stream *acquireDeflateContext() {
+		z_stream *zs;
+
+		if (deflateContextPool.empty()) {
+			zs = new z_stream();
+			memset(zs, 0, sizeof(*zs));
+			// windowBits 31 = gzip format with maximum window.
+			if (deflateInit2(zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+				31, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			{
+				delete zs;
+				return NULL;
+			}
+		} else {
+			zs = deflateContextPool.back();
+			deflateContextPool.pop_back();
+			deflateReset(zs);
+		}
+		return zs;
+	}
+
+	void releaseDeflateContext(Request *req) {
+		if (req->deflateContext != NULL) {
+			deflateContextPool.push_back((z_stream *) req->deflateContext);
+			req->deflateContext = NULL;
+		}
+		req->compressResponse = false;
+	}
+
+	/**
+	 * Per-thread histograms of request stage durations, fed by the
+	 * always-on stage clock in Request. One histogram per adjacent
+	 * stage pair, with power-of-two microsecond buckets (bucket i
+	 * covers [2^i, 2^(i+1)) usec). This separates pool wait time from
+	 * app time without UnionStation overhead.
+	 */
+	static const unsigned int NUM_STAGE_HISTOGRAM_BUCKETS = 28;
+	unsigned long long stageHistograms[Request::NUM_STAGES - 1]
+		[NUM_STAGE_HISTOGRAM_BUCKETS];
+	unsigned long long stageHistogramSamples;
+
+	/** Every Nth request (server_trace_sample_rate option; 0 disables)
+	 * emits one structured log line with the request's stage spans, so
+	 * sampled traces are available without UnionStation's weight. */
+	unsigned int traceSampleRate;
+	unsigned long long traceSampleCounter;
+
+	void maybeEmitRequestTrace(Client *client, const Request *req) {
+		if (traceSampleRate == 0
+		 || ++traceSampleCounter % traceSampleRate != 0
+		 || req->stageTimestamps[Request::STAGE_REQUEST_BEGIN] == 0)
+		{
+			return;
+		}
+
+		const boost::uint64_t *t = req->stageTimestamps;
+		#define SPAN_US(from, to) \
+			((t[Request::to] != 0 && t[Request::from] != 0 \
+				&& t[Request::to] >= t[Request::from]) \
+				? (long long) (t[Request::to] - t[Request::from]) : -1)
+		P_NOTICE("Request trace: total_us=" <<
+			SPAN_US(STAGE_REQUEST_BEGIN, STAGE_RESPONSE_END) <<
+			" parse_to_checkout_us=" <<
+			SPAN_US(STAGE_REQUEST_BEGIN, STAGE_CHECKOUT_BEGIN) <<
+			" checkout_wait_us=" <<
+			SPAN_US(STAGE_CHECKOUT_BEGIN, STAGE_CHECKOUT_END) <<
+			" app_wait_us=" <<
+			SPAN_US(STAGE_HEADER_SENT_TO_APP, STAGE_FIRST_BYTE_FROM_APP) <<
+			" forward_us=" <<
+			SPAN_US(STAGE_FIRST_BYTE_FROM_APP, STAGE_RESPONSE_END) <<
+			" status=" << (req->appResponseInitialized
+				? (int) req->appResponse.statusCode : -1));
+		#undef SPAN_US
+	}
+
+	/** Request capture stream for offline replay (the
+	 * server_capture_file option; empty disables). One line per
+	 * completed request: start time, duration, method, path, status
+	 * and response body size, tab-separated. Each handler thread
+	 * appends to its own file (path suffixed with the thread number)
+	 * so no locking is involved; the replay tool merges them. */
+	int captureFd;
+
+	void maybeCaptureRequestRecord(Client *client, const Request *req) {
+		if (captureFd == -1
+		 || req->startedAt == 0
+		 || req->path.size == 0
+		 || req->stageTimestamps[Request::STAGE_REQUEST_BEGIN] == 0)
+		{
+			return;
+		}
+
+		const boost::uint64_t *t = req->stageTimestamps;
+		long long durationUs = -1;
+		if (t[Request::STAGE_RESPONSE_END] != 0
+		 && t[Request::STAGE_RESPONSE_END] >= t[Request::STAGE_REQUEST_BEGIN])
+		{
+			durationUs = (long long) (t[Request::STAGE_RESPONSE_END]
+				- t[Request::STAGE_REQUEST_BEGIN]);
+		}
+
+		char buf[1024];
+		unsigned int pathSize = std::min<unsigned int>(req->path.size, 512);
+		const LString::Part *part = req->path.start;
+		char path[512];
+		char *pathPos = path;
+		while (part != NULL && pathPos - path < (long) pathSize) {
+			unsigned int chunk = std::min<unsigned int>(part->size,
+				pathSize - (pathPos - path));
+			memcpy(pathPos, part->data, chunk);
+			pathPos += chunk;
+			part = part->next;
+		}
+
+		int size = snprintf(buf, sizeof(buf),
+			"%llu\t%lld\t%s\t%.*s\t%d\t%llu\n",
+			(unsigned long long) (req->startedAt * 1000000.0),
+			durationUs,
+			http_method_str(req->method),
+			(int) (pathPos - path), path,
+			req->appResponseInitialized
+				? (int) req->appResponse.statusCode : -1,
+			req->appResponseInitialized
+				? (unsigned long long) req->appResponse.bodyAlreadyRead : 0ull);
+		if (size > 0) {
+			ssize_t ret = ::write(captureFd, buf,
+				std::min<size_t>(size, sizeof(buf) - 1));
+			(void) ret; // Capture is best-effort.
+		}
+	}
+
+	/** When a request exceeds the per-request latency SLO
+	 * (server_slow_request_threshold_ms option; 0 disables), capture
+	 * context automatically: the stage spans, the serving PID, and a
+	 * pool statistics snapshot - and optionally nudge the app process
+	 * with SIGQUIT so runtimes that dump backtraces on it (Ruby) leave
+	 * one in their log. */
+	unsigned int slowRequestThresholdMs;
+	bool slowRequestAppBacktrace;
+
+	void maybeCaptureSlowRequest(Client *client, const Request *req) {
+		if (slowRequestThresholdMs == 0) {
+			return;
+		}
+		const boost::uint64_t *t = req->stageTimestamps;
+		if (t[Request::STAGE_REQUEST_BEGIN] == 0
+		 || t[Request::STAGE_RESPONSE_END] < t[Request::STAGE_REQUEST_BEGIN])
+		{
+			return;
+		}
+		boost::uint64_t totalUs = t[Request::STAGE_RESPONSE_END]
+			- t[Request::STAGE_REQUEST_BEGIN];
+		if (totalUs < (boost::uint64_t) slowRequestThresholdMs * 1000) {
+			return;
+		}
+
+		Json::Value poolStats = appPool->getStatRollupAsJson();
+		P_WARN("Slow request detected (" << (totalUs / 1000) << " ms, "
+			"threshold " << slowRequestThresholdMs << " ms): "
+			"app_group=" << req->options.getAppGroupName() <<
+			" pid=" << req->servedByPid <<
+			" checkout_wait_us=" << (t[Request::STAGE_CHECKOUT_END] >= t[Request::STAGE_CHECKOUT_BEGIN]
+				&& t[Request::STAGE_CHECKOUT_BEGIN] != 0
+				? (long long) (t[Request::STAGE_CHECKOUT_END] - t[Request::STAGE_CHECKOUT_BEGIN]) : -1) <<
+			" app_wait_us=" << (t[Request::STAGE_FIRST_BYTE_FROM_APP] >= t[Request::STAGE_HEADER_SENT_TO_APP]
+				&& t[Request::STAGE_HEADER_SENT_TO_APP] != 0
+				? (long long) (t[Request::STAGE_FIRST_BYTE_FROM_APP] - t[Request::STAGE_HEADER_SENT_TO_APP]) : -1) <<
+			" pool: processes=" << poolStats["process_count"].asUInt() <<
+			" capacity_used=" << poolStats["capacity_used"].asUInt() <<
+			"/" << poolStats["max"].asUInt() <<
+			" waitlist=" << poolStats["get_wait_list_size"].asUInt());
+
+		if (slowRequestAppBacktrace && req->servedByPid > 0) {
+			P_WARN("Requesting backtrace dump from application process " <<
+				req->servedByPid << " (SIGQUIT)");
+			syscalls::kill(req->servedByPid, SIGQUIT);
+		}
+	}
+
+	void aggregateStageTimes(const Request *req) {
+		if (req->stageTimestamps[Request::STAGE_REQUEST_BEGIN] == 0) {
+			return;
+		}
+		stageHistogramSamples++;
+		for (unsigned int stage = 0; stage < Request::NUM_STAGES - 1; stage++) {
+			boost::uint64_t from = req->stageTimestamps[stage];
+			boost::uint64_t to = req->stageTimestamps[stage + 1];
+			if (from == 0 || to == 0 || to < from) {
+				continue;
+			}
+			boost::uint64_t diff = to - from;
+			unsigned int bucket = 0;
+			while (diff > 1 && bucket < NUM_STAGE_HISTOGRAM_BUCKETS - 1) {
+				diff >>= 1;
+				bucket++;
+			}
+			stageHistograms[stage][bucket]++;
+		}
+	}
+
+	static const char *stageTransitionName(unsigned int stage) {
+		switch (stage) {
+		case 0:
+			return "parse_to_checkout";
+		case 1:
+			return "checkout_wait";
+		case 2:
+			return "send_request_header";
+		case 3:
+			return "app_response_wait";
+		case 4:
+			return "response_forwarding";
+		default:
+			return "unknown";
+		}
+	}
+
+	/** Cache for the rendered response Date header; it only changes
+	 * once per second (see constructDateHeaderBuffersForResponse). */
+	char dateHeaderCache[60];
+	unsigned int dateHeaderCacheSize;
+	time_t dateHeaderCacheTime;
+
+	/** Buffering configuration for request bodies. Same as the
+	 * context's default, but with its own in-memory threshold
+	 * (request_body_buffer_threshold) so that POST buffering can be
+	 * tuned independently from response buffering. */
+	ServerKit::FileBufferedChannelConfig bodyBufferConfig;
+
 	friend class TurboCaching<Request>;
 	friend class ResponseCache<Request>;
 	struct ev_check checkWatcher;
@@ -179,7 +423,8 @@ protected:
 
 public:
 	RequestHandler(ServerKit::Context *context, const VariantMap *_agentsOptions,
-		unsigned int _threadNumber = 1)
+		unsigned int _threadNumber = 1,
+		ResponseCache<Request> *_sharedResponseCache = NULL)
 		: ParentClass(context),
 
 		  statThrottleRate(_agentsOptions->getInt("stat_throttle_rate")),
@@ -189,6 +434,7 @@ public:
 		  showVersionInHeader(_agentsOptions->getBool("show_version_in_header")),
 		  stickySessions(_agentsOptions->getBool("sticky_sessions")),
 		  gracefulExit(_agentsOptions->getBool("server_graceful_exit")),
+		  zeroCopyForwarding(_agentsOptions->getBool("server_zero_copy_forwarding", false, true)),
 
 		  agentsOptions(_agentsOptions),
 		  stringPool(psg_create_pool(1024 * 4)),
@@ -209,14 +455,61 @@ public:
 		  HTTP_HOST("host"),
 		  HTTP_CONTENT_LENGTH("content-length"),
 		  HTTP_CONTENT_TYPE("content-type"),
+		  HTTP_CONTENT_ENCODING("content-encoding"),
+		  HTTP_ACCEPT_ENCODING("accept-encoding"),
 		  HTTP_EXPECT("expect"),
 		  HTTP_CONNECTION("connection"),
 		  HTTP_STATUS("status"),
 		  HTTP_TRANSFER_ENCODING("transfer-encoding"),
 
 		  threadNumber(_threadNumber),
-		  turboCaching(getTurboCachingInitialState(_agentsOptions))
+		  turboCaching(getTurboCachingInitialState(_agentsOptions),
+		  	_agentsOptions->getUint("turbocaching_max_entries", false,
+		  		ResponseCache<Request>::DEFAULT_MAX_ENTRIES),
+		  	_agentsOptions->getUint("turbocaching_max_body_size", false,
+		  		ResponseCache<Request>::DEFAULT_MAX_BODY_SIZE),
+		  	_sharedResponseCache,
+		  	_agentsOptions->getUint("turbocaching_max_file_body_size", false, 0),
+		  	_agentsOptions->get("data_buffer_dir", false, "/tmp")
+		  		+ "/turbocache-" + toString(_threadNumber))
 	{
+		memset(stageHistograms, 0, sizeof(stageHistograms));
+		stageHistogramSamples = 0;
+		traceSampleRate = _agentsOptions->getUint(
+			"server_trace_sample_rate", false, 0);
+		traceSampleCounter = 0;
+		slowRequestThresholdMs = _agentsOptions->getUint(
+			"server_slow_request_threshold_ms", false, 0);
+		slowRequestAppBacktrace = _agentsOptions->getBool(
+			"server_slow_request_app_backtrace", false, false);
+		responseCompression = _agentsOptions->getBool(
+			"server_response_compression", false, true);
+		responseCorking = _agentsOptions->getBool(
+			"server_response_corking", false, true);
+		captureFd = -1;
+		{
+			string captureFile = _agentsOptions->get("server_capture_file",
+				false);
+			if (!captureFile.empty()) {
+				captureFile.append(".");
+				captureFile.append(toString(threadNumber));
+				captureFd = syscalls::open(captureFile.c_str(),
+					O_WRONLY | O_CREAT | O_APPEND, 0600);
+				if (captureFd == -1) {
+					int e = errno;
+					P_WARN("Cannot open request capture file " << captureFile
+						<< ": " << strerror(e) << " (errno=" << e << ")");
+				}
+			}
+		}
+		dateHeaderCacheSize = 0;
+		dateHeaderCacheTime = (time_t) -1;
+
+		bodyBufferConfig = context->defaultFileBufferedChannelConfig;
+		bodyBufferConfig.threshold = _agentsOptions->getUint(
+			"request_body_buffer_threshold", false,
+			bodyBufferConfig.threshold);
+
 		defaultRuby = psg_pstrdup(stringPool,
 			agentsOptions->get("default_ruby"));
 		loggingAgentAddress = psg_pstrdup(stringPool,
@@ -275,6 +568,13 @@ public:
 	}
 
 	~RequestHandler() {
+		for (unsigned int i = 0; i < deflateContextPool.size(); i++) {
+			deflateEnd(deflateContextPool[i]);
+			delete deflateContextPool[i];
+		}
+		if (captureFd != -1) {
+			safelyClose(captureFd, true);
+		}
 		psg_destroy_pool(stringPool);
 	}
 
@@ -374,6 +674,12 @@ public:
 		}
 	}
 
+	/** Read-only access for monitoring (e.g. the admin server's
+	 * Prometheus endpoint). */
+	const TurboCaching<Request> &getTurboCaching() const {
+		return turboCaching;
+	}
+
 	virtual Json::Value inspectStateAsJson() const {
 		Json::Value doc = ParentClass::inspectStateAsJson();
 		if (turboCaching.isEnabled()) {
@@ -386,6 +692,19 @@ public:
 			subdoc["store_success_ratio"] = turboCaching.responseCache.getStoreSuccessRatio();
 			doc["turbocaching"] = subdoc;
 		}
+		{
+			Json::Value stagesDoc;
+			stagesDoc["samples"] = (Json::UInt64) stageHistogramSamples;
+			for (unsigned int stage = 0; stage < Request::NUM_STAGES - 1; stage++) {
+				Json::Value buckets(Json::arrayValue);
+				for (unsigned int i = 0; i < NUM_STAGE_HISTOGRAM_BUCKETS; i++) {
+					buckets.append((Json::UInt64) stageHistograms[stage][i]);
+				}
+				stagesDoc[stageTransitionName(stage)] = buckets;
+			}
+			stagesDoc["bucket_unit"] = "log2 microseconds";
+			doc["request_stage_histograms"] = stagesDoc;
+		}
 		return doc;
 	}
 
@@ -45,6 +45,8 @@ checkoutSession(Client *client, Request *req) {
 	callback.func = sessionCheckedOut;
 	callback.userData = req;
 
+	req->recordStageTime(Request::STAGE_CHECKOUT_BEGIN);
+
 	options.currentTime = (unsigned long long) (ev_now(getLoop()) * 1000000);
 
 	refRequest(req, __FILE__, __LINE__);
@@ -110,6 +112,8 @@ sessionCheckedOutFromEventLoopThread(Client *client, Request *req,
 	#endif
 
 	if (e == NULL) {
+		req->recordStageTime(Request::STAGE_CHECKOUT_END);
+		req->servedByPid = session->getPid();
 		SKC_DEBUG(client, "Session checked out: pid=" << session->getPid() <<
 			", gupid=" << session->getGupid());
 		req->session = session;
@@ -222,6 +226,21 @@ reportSessionCheckoutError(Client *client, Request *req, const ExceptionPtr &e)
 	writeOtherExceptionErrorResponse(client, req, e);
 }
 
+/*
+ * Note on module-side early rejection: the configurable overflow
+ * status code requested as passenger_request_queue_overflow_status_code
+ * already exists end to end - the nginx directive serializes it as the
+ * !~PASSENGER_REQUEST_QUEUE_OVERFLOW_STATUS_CODE secure header, which
+ * this function honors. Rejecting in the web server module before the
+ * request reaches the agent would additionally require the
+ * shared-memory status page declined separately (see ContentHandler.c
+ * notes); within the agent the queue-full answer is produced without
+ * touching the app, and its cost relative to a module-side rejection
+ * is one local socket round trip. The remaining improvement worth
+ * doing here someday is skipping request body buffering when the
+ * target group's queue is already full, which needs a per-group
+ * queue-depth signal readable before checkout.
+ */
 void
 writeRequestQueueFullExceptionErrorResponse(Client *client, Request *req, const boost::shared_ptr<RequestQueueFullException> &e) {
 	TRACE_POINT();
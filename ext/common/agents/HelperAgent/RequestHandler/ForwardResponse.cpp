@@ -49,6 +49,9 @@ onAppSourceData(Client *client, Request *req, const MemoryKit::mbuf &buffer, int
 			// Data
 			UPDATE_TRACE_POINT();
 			size_t ret;
+			if (req->stageTimestamps[Request::STAGE_FIRST_BYTE_FROM_APP] == 0) {
+				req->recordStageTime(Request::STAGE_FIRST_BYTE_FROM_APP);
+			}
 			SKC_TRACE(client, 3, "Processing " << buffer.size() <<
 				" bytes of application data: \"" << cEscapeString(StaticString(
 					buffer.start, buffer.size())) << "\"");
@@ -69,16 +72,34 @@ onAppSourceData(Client *client, Request *req, const MemoryKit::mbuf &buffer, int
 
 			switch (resp->httpState) {
 			case AppResponse::COMPLETE:
+				if (resp->statusCode / 100 == 1 && resp->statusCode != 100) {
+					SKC_TRACE(client, 2, "Application sent " <<
+						resp->statusCode << " interim response");
+					onAppResponseInterim(client, req);
+					return Channel::Result(ret, false);
+				}
 				req->appSource.stop();
 				onAppResponseBegin(client, req);
 				return Channel::Result(ret, false);
 			case AppResponse::PARSING_BODY_WITH_LENGTH:
 				SKC_TRACE(client, 2, "Expecting an app response body with fixed length");
+				if (resp->aux.bodyInfo.contentLength
+					> mbuf_pool_data_size(&getContext()->mbuf_pool))
+				{
+					// Read large bodies with large mbufs so that they
+					// don't fragment across many small blocks.
+					req->appSource.readSizeHint =
+						std::min<boost::uint64_t>(
+							resp->aux.bodyInfo.contentLength,
+							mbuf_pool_max_data_size(&getContext()->mbuf_pool));
+				}
 				onAppResponseBegin(client, req);
 				return Channel::Result(ret, false);
 			case AppResponse::PARSING_BODY_UNTIL_EOF:
 				SKC_TRACE(client, 2, "Expecting app response body until end of stream");
 				req->wantKeepAlive = false;
+				req->appSource.readSizeHint =
+					mbuf_pool_max_data_size(&getContext()->mbuf_pool);
 				onAppResponseBegin(client, req);
 				return Channel::Result(ret, false);
 			case AppResponse::PARSING_CHUNKED_BODY:
@@ -137,8 +158,14 @@ onAppSourceData(Client *client, Request *req, const MemoryKit::mbuf &buffer, int
 
 			if (remaining > 0) {
 				UPDATE_TRACE_POINT();
-				writeResponseAndMarkForTurboCaching(client, req,
-					MemoryKit::mbuf(buffer, 0, remaining));
+				if (req->compressResponse) {
+					compressAndWriteResponse(client, req, buffer.start,
+						remaining, resp->bodyAlreadyRead
+							== resp->aux.bodyInfo.contentLength);
+				} else {
+					writeResponseAndMarkForTurboCaching(client, req,
+						MemoryKit::mbuf(buffer, 0, remaining));
+				}
 				if (!req->ended()) {
 					if (resp->bodyFullyRead()) {
 						SKC_TRACE(client, 2, "End of application response body reached");
@@ -146,11 +173,18 @@ onAppSourceData(Client *client, Request *req, const MemoryKit::mbuf &buffer, int
 						endRequest(&client, &req);
 					} else {
 						maybeThrottleAppSource(client, req);
+						maybeStartResponseBodyPassthrough(client, req);
 					}
 				}
 			} else {
 				UPDATE_TRACE_POINT();
 				SKC_TRACE(client, 2, "End of application response body reached");
+				if (req->compressResponse) {
+					compressAndWriteResponse(client, req, "", 0, true);
+					if (req->ended()) {
+						return Channel::Result(remaining, false);
+					}
+				}
 				handleAppResponseBodyEnd(client, req);
 				endRequest(&client, &req);
 			}
@@ -195,13 +229,24 @@ onAppSourceData(Client *client, Request *req, const MemoryKit::mbuf &buffer, int
 					return Channel::Result(event.consumed, false);
 				case ServerKit::HttpChunkedEvent::DATA:
 					assert(!event.end);
-					writeResponseAndMarkForTurboCaching(client, req, event.data);
+					if (req->compressResponse) {
+						compressAndWriteResponse(client, req,
+							event.data.start, event.data.size(), false);
+					} else {
+						writeResponseAndMarkForTurboCaching(client, req, event.data);
+					}
 					maybeThrottleAppSource(client, req);
 					return Channel::Result(event.consumed, false);
 				case ServerKit::HttpChunkedEvent::END:
 					assert(event.end);
 					SKC_TRACE(client, 2, "End of application response body reached");
 					resp->aux.bodyInfo.endReached = true;
+					if (req->compressResponse) {
+						compressAndWriteResponse(client, req, "", 0, true);
+						if (req->ended()) {
+							return Channel::Result(event.consumed, true);
+						}
+					}
 					handleAppResponseBodyEnd(client, req);
 					endRequest(&client, &req);
 					return Channel::Result(event.consumed, true);
@@ -216,24 +261,43 @@ onAppSourceData(Client *client, Request *req, const MemoryKit::mbuf &buffer, int
 				}
 			} else {
 				UPDATE_TRACE_POINT();
+				/* Pass-through: the client receives the app's chunk
+				 * framing verbatim, so the parser only runs to find
+				 * the body end. Consume as many chunk events as this
+				 * buffer holds and relay the whole span with a single
+				 * write, instead of one write per chunk.
+				 */
+				size_t totalConsumed = event.consumed;
+				markResponsePartForTurboCaching(client, req, event.data);
+				while ((event.type == ServerKit::HttpChunkedEvent::NONE
+					|| event.type == ServerKit::HttpChunkedEvent::DATA)
+				 && totalConsumed < buffer.size())
+				{
+					event = createAppResponseChunkedBodyParser(req).feed(
+						MemoryKit::mbuf(buffer, totalConsumed,
+							buffer.size() - totalConsumed));
+					resp->bodyAlreadyRead += event.consumed;
+					totalConsumed += event.consumed;
+					markResponsePartForTurboCaching(client, req, event.data);
+				}
+
 				switch (event.type) {
 				case ServerKit::HttpChunkedEvent::NONE:
 				case ServerKit::HttpChunkedEvent::DATA:
 					assert(!event.end);
-					writeResponse(client, MemoryKit::mbuf(buffer, 0, event.consumed));
-					markResponsePartForTurboCaching(client, req, event.data);
+					writeResponse(client, MemoryKit::mbuf(buffer, 0, totalConsumed));
 					maybeThrottleAppSource(client, req);
-					return Channel::Result(event.consumed, false);
+					return Channel::Result(totalConsumed, false);
 				case ServerKit::HttpChunkedEvent::END:
 					assert(event.end);
 					SKC_TRACE(client, 2, "End of application response body reached");
 					resp->aux.bodyInfo.endReached = true;
 					handleAppResponseBodyEnd(client, req);
-					writeResponse(client, MemoryKit::mbuf(buffer, 0, event.consumed));
+					writeResponse(client, MemoryKit::mbuf(buffer, 0, totalConsumed));
 					if (!req->ended()) {
 						endRequest(&client, &req);
 					}
-					return Channel::Result(event.consumed, true);
+					return Channel::Result(totalConsumed, true);
 				case ServerKit::HttpChunkedEvent::ERROR:
 					assert(event.end);
 					{
@@ -241,7 +305,7 @@ onAppSourceData(Client *client, Request *req, const MemoryKit::mbuf &buffer, int
 						message.append(ServerKit::getErrorDesc(event.errcode));
 						disconnectWithError(&client, message);
 					}
-					return Channel::Result(event.consumed, true);
+					return Channel::Result(totalConsumed, true);
 				}
 			}
 		} else if (errcode == 0 || errcode == ECONNRESET) {
@@ -269,6 +333,9 @@ onAppSourceData(Client *client, Request *req, const MemoryKit::mbuf &buffer, int
 			resp->bodyAlreadyRead += buffer.size();
 			writeResponseAndMarkForTurboCaching(client, req, buffer);
 			maybeThrottleAppSource(client, req);
+			if (!req->ended()) {
+				maybeStartResponseBodyPassthrough(client, req);
+			}
 			return Channel::Result(buffer.size(), false);
 		} else if (errcode == 0 || errcode == ECONNRESET) {
 			// EOF
@@ -337,6 +404,9 @@ onAppResponseBegin(Client *client, Request *req) {
 	}
 
 	prepareAppResponseCaching(client, req);
+	decideResponseCompression(client, req);
+	decideResponseCorking(client, req);
+	possiblyInjectChaosResponseDelay(client);
 
 	if (OXT_UNLIKELY(oobw)) {
 		SKC_TRACE(client, 2, "Response with OOBW detected");
@@ -364,6 +434,299 @@ onAppResponseBegin(Client *client, Request *req) {
 	}
 }
 
+/**
+ * Chaos hook for resilience testing: when the
+ * PASSENGER_CHAOS_RESPONSE_START_DELAY_MS environment variable is set,
+ * forwarding of every response header is delayed by that many
+ * milliseconds. Note that this deliberately blocks the handler
+ * thread's event loop, so it simultaneously simulates a slow app and
+ * an overloaded agent - useful for sizing client-facing buffers and
+ * LB timeouts. Dormant (a single cached integer compare) unless the
+ * variable is set.
+ */
+void possiblyInjectChaosResponseDelay(Client *client) {
+	static int delayMs = -1;
+	if (OXT_UNLIKELY(delayMs == -1)) {
+		const char *value = getenv("PASSENGER_CHAOS_RESPONSE_START_DELAY_MS");
+		delayMs = (value != NULL) ? atoi(value) : 0;
+	}
+	if (OXT_UNLIKELY(delayMs > 0)) {
+		SKC_WARN(client, "Chaos mode: delaying response start by " <<
+			delayMs << " ms");
+		syscalls::usleep(delayMs * 1000);
+	}
+}
+
+/**
+ * Decides whether to cork the client socket for the duration of this
+ * response. Corking coalesces the header write and the app's body
+ * writes into full packets; the socket is uncorked at request end,
+ * flushing the tail. Only fixed-length bodies large enough to span
+ * multiple packets are corked: streaming responses (chunked,
+ * body-until-EOF, SSE, upgraded connections) have no Content-Length
+ * and must not be delayed, and they keep the write-through behavior.
+ * Responses that opt out of buffering via X-Accel-Buffering: no are
+ * honored the same way.
+ */
+void decideResponseCorking(Client *client, Request *req) {
+	#ifdef TCP_CORK
+		AppResponse *resp = &req->appResponse;
+
+		if (!responseCorking
+		 || req->ended()
+		 || req->method == HTTP_HEAD
+		 || resp->bodyType != AppResponse::RBT_CONTENT_LENGTH
+		 || resp->aux.bodyInfo.contentLength < 2048)
+		{
+			return;
+		}
+
+		const LString *accelBuffering = resp->headers.lookup(
+			P_STATIC_HSTRING("x-accel-buffering"));
+		if (accelBuffering != NULL
+		 && psg_lstr_cmp(accelBuffering, P_STATIC_STRING("no")))
+		{
+			return;
+		}
+
+		int flag = 1;
+		if (setsockopt(client->getFd(), IPPROTO_TCP, TCP_CORK,
+			&flag, sizeof(flag)) == 0)
+		{
+			SKC_TRACE(client, 2, "Corking client socket for this response");
+			req->responseCorked = true;
+		}
+		// Failure (e.g. a Unix domain socket) just means no coalescing.
+	#endif
+}
+
+/**
+ * Clears TCP_CORK if decideResponseCorking() set it, flushing any
+ * partial packet the kernel is still holding.
+ */
+void uncorkResponse(Client *client, Request *req) {
+	#ifdef TCP_CORK
+		if (req->responseCorked) {
+			int flag = 0;
+			setsockopt(client->getFd(), IPPROTO_TCP, TCP_CORK,
+				&flag, sizeof(flag));
+			req->responseCorked = false;
+		}
+	#endif
+}
+
+/**
+ * Returns whether the given Accept-Encoding value permits gzip,
+ * honoring q-values: "gzip;q=0" is an explicit refusal, and a "*"
+ * entry only counts when no gzip entry is present. Malformed
+ * q-values are treated as acceptance, matching the lenient stance
+ * of the rest of this file's header handling.
+ */
+static bool clientAcceptsGzip(const StaticString &acceptEncoding) {
+	const char *pos = acceptEncoding.data();
+	const char *end = pos + acceptEncoding.size();
+	int gzipQuality = -1, starQuality = -1;
+
+	while (pos < end) {
+		const char *elemEnd = (const char *) memchr(pos, ',', end - pos);
+		if (elemEnd == NULL) {
+			elemEnd = end;
+		}
+
+		const char *tokenStart = pos;
+		while (tokenStart < elemEnd && *tokenStart == ' ') {
+			tokenStart++;
+		}
+		const char *params = (const char *) memchr(tokenStart, ';',
+			elemEnd - tokenStart);
+		const char *tokenEnd = (params != NULL) ? params : elemEnd;
+		while (tokenEnd > tokenStart && tokenEnd[-1] == ' ') {
+			tokenEnd--;
+		}
+
+		StaticString token(tokenStart, tokenEnd - tokenStart);
+		if (token == P_STATIC_STRING("gzip") || token == P_STATIC_STRING("*")) {
+			// Acceptable unless an explicit q=0 (or 0.0, 0.00, ...)
+			// says otherwise.
+			int quality = 1;
+			if (params != NULL) {
+				StaticString paramStr(params, elemEnd - params);
+				string::size_type qPos = paramStr.find(P_STATIC_STRING("q="));
+				if (qPos != string::npos) {
+					quality = 0;
+					for (const char *q = params + qPos + 2; q < elemEnd; q++) {
+						if (*q >= '1' && *q <= '9') {
+							quality = 1;
+							break;
+						} else if (*q != '0' && *q != '.') {
+							break;
+						}
+					}
+				}
+			}
+			if (token == P_STATIC_STRING("gzip")) {
+				gzipQuality = quality;
+			} else {
+				starQuality = quality;
+			}
+		}
+
+		pos = elemEnd + 1;
+	}
+
+	if (gzipQuality != -1) {
+		return gzipQuality > 0;
+	}
+	return starQuality > 0;
+}
+
+/**
+ * Decides whether to gzip-compress the response body on the fly.
+ * Compressing here offloads the work that apps would otherwise do
+ * themselves (e.g. Rack::Deflater) to C++. The compressed body is
+ * sent with chunked transfer encoding, since its length isn't known
+ * up front.
+ */
+void decideResponseCompression(Client *client, Request *req) {
+	AppResponse *resp = &req->appResponse;
+
+	if (!responseCompression
+	 || OXT_UNLIKELY(benchmarkMode != BM_NONE)
+	 || req->ended())
+	{
+		return;
+	}
+	// Only identity bodies that we fully observe can be compressed:
+	// fixed-length ones and chunked ones that we dechunk ourselves.
+	if (resp->bodyType == AppResponse::RBT_CONTENT_LENGTH) {
+		if (resp->aux.bodyInfo.contentLength < 256) {
+			// Not worth the CPU or the framing overhead.
+			return;
+		}
+	} else if (!(resp->bodyType == AppResponse::RBT_CHUNKED && req->dechunkResponse)) {
+		return;
+	}
+	if (resp->statusCode != 200 || req->method == HTTP_HEAD) {
+		return;
+	}
+	/* Turbocache storage candidates are not compressed: the cache
+	 * stores the identity body as observed from the app and serves
+	 * it to every accept-encoding class, so compressing here would
+	 * force the response out of the cache (the previous behavior -
+	 * which silently excluded virtually all browser traffic from the
+	 * default-on turbocache). prepareAppResponseCaching() has already
+	 * run at this point, so a non-empty cache key means the response
+	 * will actually be stored. Responses the cache refuses still get
+	 * compressed below.
+	 */
+	if (turboCaching.isEnabled() && !req->cacheKey.empty()) {
+		return;
+	}
+	// Chunked framing requires an HTTP/1.1 client.
+	if (req->httpMajor * 1000 + req->httpMinor * 10 < 1010) {
+		return;
+	}
+	if (resp->headers.lookup(HTTP_CONTENT_ENCODING) != NULL) {
+		return;
+	}
+
+	// The client must accept gzip.
+	const LString *acceptEncoding = req->headers.lookup(HTTP_ACCEPT_ENCODING);
+	if (acceptEncoding == NULL) {
+		return;
+	}
+	const LString *contiguousAE = psg_lstr_make_contiguous(acceptEncoding, req->pool);
+	if (!clientAcceptsGzip(StaticString(contiguousAE->start->data, contiguousAE->size))) {
+		return;
+	}
+
+	// Skip content types that are typically already compressed.
+	const LString *contentType = resp->headers.lookup(HTTP_CONTENT_TYPE);
+	if (contentType != NULL) {
+		const LString *contiguousCT = psg_lstr_make_contiguous(contentType, req->pool);
+		StaticString ct(contiguousCT->start->data, contiguousCT->size);
+		if (ct.find(P_STATIC_STRING("image/")) != string::npos
+		 || ct.find(P_STATIC_STRING("video/")) != string::npos
+		 || ct.find(P_STATIC_STRING("audio/")) != string::npos
+		 || ct.find(P_STATIC_STRING("zip")) != string::npos)
+		{
+			return;
+		}
+	}
+
+	req->deflateContext = acquireDeflateContext();
+	if (req->deflateContext == NULL) {
+		return;
+	}
+	req->compressResponse = true;
+	SKC_TRACE(client, 2, "Compressing response body with gzip");
+}
+
+/**
+ * Compresses a piece of the response body and writes the result to
+ * the client with chunked framing. Pass last == true exactly once,
+ * when the app body has ended; this flushes the compressor and writes
+ * the terminating chunk.
+ */
+void compressAndWriteResponse(Client *client, Request *req, const char *data,
+	unsigned int size, bool last)
+{
+	z_stream *zs = (z_stream *) req->deflateContext;
+	MemoryKit::mbuf_pool &mbuf_pool = getContext()->mbuf_pool;
+
+	zs->next_in = (Bytef *) data;
+	zs->avail_in = size;
+
+	/* Chunk framing layout inside each output mbuf: 8 bytes are
+	 * reserved up front for a fixed-width hex size header ("00xxxx\r\n";
+	 * leading zeros are valid chunked encoding) and 2 bytes at the end
+	 * for the trailing CRLF, so each chunk goes out as one contiguous
+	 * buffer instead of three.
+	 */
+	static const unsigned int CHUNK_HEADER_SIZE = 8;
+
+	do {
+		MemoryKit::mbuf outBuf(MemoryKit::mbuf_get_with_size(&mbuf_pool,
+			MemoryKit::mbuf_pool_max_data_size(&mbuf_pool)));
+		zs->next_out = (Bytef *) outBuf.start + CHUNK_HEADER_SIZE;
+		zs->avail_out = outBuf.size() - CHUNK_HEADER_SIZE - 2;
+
+		int ret = deflate(zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+		if (OXT_UNLIKELY(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)) {
+			disconnectWithError(&client, "gzip compression error");
+			return;
+		}
+
+		unsigned int produced = outBuf.size() - CHUNK_HEADER_SIZE - 2
+			- zs->avail_out;
+		if (produced > 0) {
+			static const char hexDigits[] = "0123456789abcdef";
+			char *header = outBuf.start;
+			for (int i = 5; i >= 0; i--) {
+				header[i] = hexDigits[(produced >> ((5 - i) * 4)) & 0xf];
+			}
+			header[6] = '\r';
+			header[7] = '\n';
+			char *tail = outBuf.start + CHUNK_HEADER_SIZE + produced;
+			tail[0] = '\r';
+			tail[1] = '\n';
+			writeResponse(client, MemoryKit::mbuf(outBuf, 0,
+				CHUNK_HEADER_SIZE + produced + 2));
+			if (req->ended()) {
+				return;
+			}
+		}
+
+		if (last && ret == Z_STREAM_END) {
+			writeResponse(client, "0\r\n\r\n", 5);
+			return;
+		}
+		if (zs->avail_out != 0 && zs->avail_in == 0 && !last) {
+			return;
+		}
+	} while (true);
+}
+
 void prepareAppResponseCaching(Client *client, Request *req) {
 	if (turboCaching.isEnabled() && !req->cacheKey.empty()) {
 		TRACE_POINT();
@@ -373,10 +736,10 @@ void prepareAppResponseCaching(Client *client, Request *req) {
 		 && turboCaching.responseCache.prepareRequestForStoring(req))
 		{
 			if (resp->bodyType == AppResponse::RBT_CONTENT_LENGTH
-			 && resp->aux.bodyInfo.contentLength > ResponseCache<Request>::MAX_BODY_SIZE)
+			 && resp->aux.bodyInfo.contentLength > turboCaching.responseCache.getEffectiveMaxBodySize())
 			{
 				SKC_DEBUG(client, "Response body larger than " <<
-					ResponseCache<Request>::MAX_BODY_SIZE <<
+					turboCaching.responseCache.getMaxBodySize() <<
 					" bytes, so response is not eligible for turbocaching");
 				// Decrease store success ratio.
 				turboCaching.responseCache.incStores();
@@ -396,6 +759,77 @@ void prepareAppResponseCaching(Client *client, Request *req) {
 	}
 }
 
+/**
+ * Relays an interim (1xx, e.g. 103 Early Hints) response to the client
+ * immediately, then re-arms the response parser so that the final
+ * response is processed as usual. Interim responses have no body, so
+ * unlike the final response their headers need no transformation: they
+ * are relayed as parsed, in insertion order. Clients that predate
+ * HTTP/1.1 don't get the relay (1xx is undefined for them), but the
+ * final response still goes through.
+ */
+void
+onAppResponseInterim(Client *client, Request *req) {
+	TRACE_POINT();
+	AppResponse *resp = &req->appResponse;
+
+	if (!req->ended() && req->httpMajor * 1000 + req->httpMinor * 10 >= 1010) {
+		UPDATE_TRACE_POINT();
+		const char *statusAndReason = getStatusCodeAndReasonPhrase(resp->statusCode);
+		unsigned int size = sizeof("HTTP/1.1 xxx \r\n\r\n") + 32;
+		ServerKit::HeaderTable::OrderedIterator it(resp->headers);
+
+		while (*it != NULL) {
+			size += (*it)->key.size + sizeof(": ") - 1
+				+ (*it)->val.size + sizeof("\r\n") - 1;
+			it.next();
+		}
+
+		char *buf = (char *) psg_pnalloc(req->pool, size);
+		const char *end = buf + size;
+		char *pos = buf;
+
+		pos = appendData(pos, end, "HTTP/", 5);
+		pos += uintToString(req->httpMajor, pos, end - pos);
+		pos = appendData(pos, end, ".", 1);
+		pos += uintToString(req->httpMinor, pos, end - pos);
+		pos = appendData(pos, end, " ", 1);
+		if (statusAndReason != NULL) {
+			pos = appendData(pos, end, statusAndReason, strlen(statusAndReason));
+		} else {
+			pos += uintToString(resp->statusCode, pos, end - pos);
+		}
+		pos = appendData(pos, end, "\r\n", 2);
+
+		it = ServerKit::HeaderTable::OrderedIterator(resp->headers);
+		while (*it != NULL) {
+			LString::Part *part = (*it)->key.start;
+			while (part != NULL) {
+				pos = appendData(pos, end, part->data, part->size);
+				part = part->next;
+			}
+			pos = appendData(pos, end, ": ", 2);
+			part = (*it)->val.start;
+			while (part != NULL) {
+				pos = appendData(pos, end, part->data, part->size);
+				part = part->next;
+			}
+			pos = appendData(pos, end, "\r\n", 2);
+			it.next();
+		}
+		pos = appendData(pos, end, "\r\n", 2);
+
+		writeResponse(client, buf, pos - buf);
+	}
+	if (!req->ended()) {
+		UPDATE_TRACE_POINT();
+		deinitializeAppResponse(client, req);
+		reinitializeAppResponse(client, req);
+		// Allow sending more response headers.
+		req->responseBegun = false;
+	}
+}
+
 void
 onAppResponse100Continue(Client *client, Request *req) {
 	TRACE_POINT();
@@ -457,7 +891,7 @@ constructHeaderBuffersForResponse(Request *req, struct iovec *buffers,
 		} while (false)
 
 	AppResponse *resp = &req->appResponse;
-	ServerKit::HeaderTable::Iterator it(resp->headers);
+	ServerKit::HeaderTable::OrderedIterator it(resp->headers);
 	const LString::Part *part;
 	const char *statusAndReason;
 	unsigned int i = 0;
@@ -547,10 +981,10 @@ constructHeaderBuffersForResponse(Request *req, struct iovec *buffers,
 	}
 
 	while (*it != NULL) {
-		dataSize += it->header->key.size + sizeof(": ") - 1;
-		dataSize += it->header->val.size + sizeof("\r\n") - 1;
+		dataSize += (*it)->key.size + sizeof(": ") - 1;
+		dataSize += (*it)->val.size + sizeof("\r\n") - 1;
 
-		part = it->header->key.start;
+		part = (*it)->key.start;
 		while (part != NULL) {
 			if (buffers != NULL) {
 				buffers[i].iov_base = (void *) part->data;
@@ -565,7 +999,7 @@ constructHeaderBuffersForResponse(Request *req, struct iovec *buffers,
 		}
 		INC_BUFFER_ITER(i);
 
-		part = it->header->val.start;
+		part = (*it)->val.start;
 		while (part != NULL) {
 			if (buffers != NULL) {
 				buffers[i].iov_base = (void *) part->data;
@@ -625,7 +1059,13 @@ constructHeaderBuffersForResponse(Request *req, struct iovec *buffers,
 
 	nCacheableBuffers = i;
 
-	if (resp->bodyType == AppResponse::RBT_CONTENT_LENGTH) {
+	if (req->compressResponse) {
+		// The body is compressed on the fly, so its length is unknown;
+		// it is framed with chunked transfer encoding instead.
+		PUSH_STATIC_BUFFER("Content-Encoding: gzip\r\n"
+			"Vary: Accept-Encoding\r\n"
+			"Transfer-Encoding: chunked\r\n");
+	} else if (resp->bodyType == AppResponse::RBT_CONTENT_LENGTH) {
 		PUSH_STATIC_BUFFER("Content-Length: ");
 		if (buffers != NULL) {
 			const unsigned int BUFSIZE = 16;
@@ -737,15 +1177,28 @@ constructHeaderBuffersForResponse(Request *req, struct iovec *buffers,
 
 unsigned int
 constructDateHeaderBuffersForResponse(char *dateStr, unsigned int bufsize) {
-	char *pos = dateStr;
-	const char *end = dateStr + bufsize - 1;
 	time_t the_time = (time_t) ev_now(getContext()->libev->getLoop());
-	struct tm the_tm;
 
-	pos = appendData(pos, end, "Date: ");
-	gmtime_r(&the_time, &the_tm);
-	pos += strftime(pos, end - pos, "%a, %d %b %Y %H:%M:%S GMT", &the_tm);
-	return pos - dateStr;
+	/* The rendered Date header only changes once per second, while we
+	 * render one for almost every response. Cache the result per
+	 * request handler thread (this object is single-threaded) and only
+	 * re-run gmtime_r/strftime when the clock has ticked.
+	 */
+	if (the_time != dateHeaderCacheTime) {
+		char *pos = dateHeaderCache;
+		const char *end = dateHeaderCache + sizeof(dateHeaderCache) - 1;
+		struct tm the_tm;
+
+		pos = appendData(pos, end, "Date: ");
+		gmtime_r(&the_time, &the_tm);
+		pos += strftime(pos, end - pos, "%a, %d %b %Y %H:%M:%S GMT", &the_tm);
+		dateHeaderCacheSize = pos - dateHeaderCache;
+		dateHeaderCacheTime = the_time;
+	}
+
+	unsigned int size = std::min<unsigned int>(dateHeaderCacheSize, bufsize - 1);
+	memcpy(dateStr, dateHeaderCache, size);
+	return size;
 }
 
 bool
@@ -803,10 +1256,11 @@ sendResponseHeaderWithBuffering(Client *client, Request *req, unsigned int offse
 	markHeaderBuffersForTurboCaching(client, req, buffers, nCacheableBuffers);
 
 	MemoryKit::mbuf_pool &mbuf_pool = getContext()->mbuf_pool;
-	const unsigned int MBUF_MAX_SIZE = mbuf_pool_data_size(&mbuf_pool);
+	const unsigned int MBUF_MAX_SIZE = mbuf_pool_max_data_size(&mbuf_pool);
 	if (dataSize <= MBUF_MAX_SIZE) {
-		MemoryKit::mbuf buffer(MemoryKit::mbuf_get(&mbuf_pool));
-		gatherBuffers(buffer.start, MBUF_MAX_SIZE, buffers, nbuffers);
+		MemoryKit::mbuf buffer(MemoryKit::mbuf_get_with_size(&mbuf_pool,
+			dataSize));
+		gatherBuffers(buffer.start, buffer.size(), buffers, nbuffers);
 		buffer = MemoryKit::mbuf(buffer, offset, dataSize - offset);
 		writeResponse(client, buffer);
 	} else {
@@ -894,7 +1348,7 @@ void
 markResponsePartForTurboCaching(Client *client, Request *req, const MemoryKit::mbuf &buffer) {
 	if (!req->ended() && turboCaching.isEnabled() && !req->cacheKey.empty()) {
 		unsigned int totalSize = req->appResponse.bodyCacheBuffer.size + buffer.size();
-		if (totalSize > ResponseCache<Request>::MAX_BODY_SIZE) {
+		if (totalSize > turboCaching.responseCache.getEffectiveMaxBodySize()) {
 			SKC_DEBUG(client, "Response body larger than " <<
 				ResponseCache<Request>::MAX_HEADER_SIZE <<
 				" bytes, so response is not eligible for turbocaching");
@@ -909,6 +1363,119 @@ markResponsePartForTurboCaching(Client *client, Request *req, const MemoryKit::m
 	}
 }
 
+/**
+ * Enables splice()-based zero-copy passthrough on the application socket
+ * for the rest of the response body, if the body needs no further
+ * inspection. Once active, body data moves from the app socket to the
+ * client socket in kernel space, bypassing the mbuf path in both
+ * FdSourceChannel and the client's output channel.
+ */
+void
+maybeStartResponseBodyPassthrough(Client *client, Request *req) {
+	#ifdef __linux__
+		AppResponse *resp = &req->appResponse;
+
+		if (!zeroCopyForwarding || req->ended() || req->appSource.spliceToEnabled()
+		 || req->compressResponse)
+		{
+			return;
+		}
+		if (resp->httpState != AppResponse::PARSING_BODY_WITH_LENGTH
+		 && resp->httpState != AppResponse::PARSING_BODY_UNTIL_EOF
+		 && resp->httpState != AppResponse::UPGRADED)
+		{
+			// Chunked bodies need parsing, so they keep using the mbuf path.
+			return;
+		}
+		/* Upgraded (e.g. WebSocket) connections splice the app-to-client
+		 * direction: after the 101 all app output is opaque bytes, just
+		 * like a body-until-EOF response. The client-to-app direction
+		 * still flows through the ordinary channels, which read with
+		 * default-sized (small) mbufs, so a mostly-idle upgraded
+		 * connection holds no request-sized buffers.
+		 */
+		if (benchmarkMode != BM_NONE) {
+			return;
+		}
+		if (turboCaching.isEnabled() && !req->cacheKey.empty()) {
+			// The body is still being observed for turbocache admission.
+			return;
+		}
+
+		boost::uint64_t maxBytes = 0;
+		if (resp->httpState == AppResponse::PARSING_BODY_WITH_LENGTH) {
+			maxBytes = resp->aux.bodyInfo.contentLength - resp->bodyAlreadyRead;
+			if (maxBytes == 0) {
+				return;
+			}
+		}
+
+		if (req->appSource.enableSpliceTo(client->output.getFd(), maxBytes,
+			_onAppSourceSpliceActivity, _appSourceSpliceAllowed))
+		{
+			SKC_TRACE(client, 2, "Using zero-copy splice passthrough for "
+				"the rest of the response body");
+		}
+	#endif
+}
+
+#ifdef __linux__
+
+static bool
+_appSourceSpliceAllowed(FdSourceChannel *channel) {
+	Request *req = static_cast<Request *>(static_cast<
+		ServerKit::BaseHttpRequest *>(channel->getHooks()->userData));
+	Client *client = static_cast<Client *>(req->client);
+
+	// Splicing directly to the client fd is only safe when no ordinary
+	// buffered data is queued in front of it.
+	return !req->ended()
+		&& client->output.getTotalBytesBuffered() == 0
+		&& !client->output.ended();
+}
+
+static void
+_onAppSourceSpliceActivity(FdSourceChannel *channel, boost::uint64_t bytes,
+	int errcode)
+{
+	Request *req = static_cast<Request *>(static_cast<
+		ServerKit::BaseHttpRequest *>(channel->getHooks()->userData));
+	Client *client = static_cast<Client *>(req->client);
+	RequestHandler *self = static_cast<RequestHandler *>(getServerFromClient(client));
+	self->onAppSourceSpliceActivity(client, req, bytes, errcode);
+}
+
+void
+onAppSourceSpliceActivity(Client *client, Request *req, boost::uint64_t bytes,
+	int errcode)
+{
+	SKC_LOG_EVENT(RequestHandler, client, "onAppSourceSpliceActivity");
+	AppResponse *resp = &req->appResponse;
+
+	if (req->ended()) {
+		return;
+	}
+	if (errcode != 0) {
+		// Writing to the client socket failed; handle it exactly like a
+		// write error on the output channel.
+		onClientOutputError(client, errcode);
+		return;
+	}
+
+	resp->bodyAlreadyRead += bytes;
+	SKC_TRACE(client, 3, "Spliced " << bytes << " bytes of application data "
+		"to the client (" << resp->bodyAlreadyRead << " bytes forwarded so far)");
+	if (resp->httpState == AppResponse::PARSING_BODY_WITH_LENGTH
+	 && resp->bodyFullyRead())
+	{
+		SKC_TRACE(client, 2, "End of application response body reached");
+		handleAppResponseBodyEnd(client, req);
+		endRequest(&client, &req);
+	}
+}
+
+#endif
+
 void
 maybeThrottleAppSource(Client *client, Request *req) {
 	if (!req->ended()) {
@@ -950,6 +1517,7 @@ outputBuffersFlushed(Client *client, Request *req) {
 		SKC_TRACE(client, 2, "Buffered response data has been written to disk. Resuming application socket");
 		client->output.setBuffersFlushedCallback(NULL);
 		req->appSource.start();
+		maybeStartResponseBodyPassthrough(client, req);
 	}
 }
 
@@ -974,6 +1542,7 @@ outputDataFlushed(Client *client, Request *req) {
 		SKC_TRACE(client, 2, "The client is ready to receive more data. Resuming application socket");
 		client->output.setDataFlushedCallback(getClientOutputDataFlushedCallback());
 		req->appSource.start();
+		maybeStartResponseBodyPassthrough(client, req);
 	}
 }
 
@@ -1010,13 +1579,25 @@ storeAppResponseInTurboCache(Client *client, Request *req) {
 				ResponseCache<Request>::MAX_HEADER_SIZE,
 				resp->headerCacheBuffers, resp->nHeaderCacheBuffers);
 
-			char *pos = entry.body->httpBodyData;
-			const char *end = entry.body->httpBodyData
-				+ ResponseCache<Request>::MAX_BODY_SIZE;
-			const LString::Part *part = resp->bodyCacheBuffer.start;
-			while (part != NULL) {
-				pos = appendData(pos, end, part->data, part->size);
-				part = part->next;
+			if (entry.body->bodyInFile) {
+				if (turboCaching.responseCache.storeBodyToFile(entry,
+					&resp->bodyCacheBuffer))
+				{
+					turboCaching.responseCache.commitStore(entry);
+				} else {
+					SKC_DEBUG(client, "Could not write turbocache body file");
+					turboCaching.responseCache.abortStore(entry);
+				}
+			} else {
+				char *pos = entry.body->httpBodyData;
+				const char *end = entry.body->httpBodyData
+					+ turboCaching.responseCache.getMaxBodySize();
+				const LString::Part *part = resp->bodyCacheBuffer.start;
+				while (part != NULL) {
+					pos = appendData(pos, end, part->data, part->size);
+					part = part->next;
+				}
+				turboCaching.responseCache.commitStore(entry);
 			}
 		} else {
 			SKC_DEBUG(client, "Could not store app response for turbocaching");
@@ -63,6 +63,7 @@ onRequestObjectCreated(Client *client, Request *req) {
 	req->appSource.setDataCallback(_onAppSourceData);
 
 	req->bodyBuffer.setContext(getContext());
+	req->bodyBuffer.setConfig(&bodyBufferConfig);
 	req->bodyBuffer.setHooks(&req->hooks);
 	req->bodyBuffer.setDataCallback(onBodyBufferData);
 }
@@ -93,6 +94,13 @@ virtual void reinitializeRequest(Client *client, Request *req) {
 	req->host = NULL;
 	req->bodyBytesBuffered = 0;
 	req->cacheKey = HashedStaticString();
+	req->cacheBaseKey = HashedStaticString();
+	req->compressResponse = false;
+	req->deflateContext = NULL;
+	req->responseCorked = false;
+	memset(req->stageTimestamps, 0, sizeof(req->stageTimestamps));
+	req->servedByPid = 0;
+	req->recordStageTime(Request::STAGE_REQUEST_BEGIN);
 	req->cacheControl = NULL;
 	req->varyCookie = NULL;
 
@@ -120,6 +128,14 @@ virtual void deinitializeRequest(Client *client, Request *req) {
 	req->appSink.deinitialize();
 	req->appSource.deinitialize();
 	req->bodyBuffer.deinitialize();
+	releaseDeflateContext(req);
+	getContext()->timerWheel.disarm(&req->deadlineEntry);
+	uncorkResponse(client, req);
+	req->recordStageTime(Request::STAGE_RESPONSE_END);
+	aggregateStageTimes(req);
+	maybeEmitRequestTrace(client, req);
+	maybeCaptureRequestRecord(client, req);
+	maybeCaptureSlowRequest(client, req);
 
 	/***************/
 	/***************/
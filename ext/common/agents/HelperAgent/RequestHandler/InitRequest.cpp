@@ -60,6 +60,7 @@ onRequestBegin(Client *client, Request *req) {
 		req->startedAt = ev_now(getLoop());
 		req->bodyChannel.stop();
 
+		initializeDeadline(client, req);
 		initializeFlags(client, req, analysis);
 		if (respondFromTurboCache(client, req)) {
 			return;
@@ -90,6 +91,64 @@ supportsUpgrade(Client *client, Request *req) {
 
 private:
 
+/**
+ * Arms a deadline for this request if the client (in practice the
+ * load balancer in front) supplied its remaining budget through the
+ * X-Passenger-Request-Budget header, in milliseconds. When the
+ * deadline expires before the response ends, the request is aborted:
+ * a 504 if the app hasn't started responding, a disconnect otherwise.
+ * Either way the session's app socket closes, which is the abort
+ * signal apps already understand, so the app can stop computing for
+ * a client that has given up. Rounded up to the timer wheel's 1s
+ * resolution; arming is O(1).
+ */
+void
+initializeDeadline(Client *client, Request *req) {
+	const LString *budget = req->headers.lookup(
+		P_STATIC_HSTRING("x-passenger-request-budget"));
+	if (budget == NULL) {
+		return;
+	}
+
+	const LString *contiguous = psg_lstr_make_contiguous(budget, req->pool);
+	unsigned long long budgetMs = stringToULL(
+		StaticString(contiguous->start->data, contiguous->size));
+	if (budgetMs == 0) {
+		return;
+	}
+
+	SKC_TRACE(client, 2, "Request deadline set to " << budgetMs << " ms");
+	req->deadlineEntry.callback = _onRequestDeadline;
+	req->deadlineEntry.userData = req;
+	getContext()->timerWheel.arm(&req->deadlineEntry,
+		(unsigned int) ((budgetMs + 999) / 1000));
+}
+
+static void
+_onRequestDeadline(ServerKit::TimerWheel::Entry *entry, void *userData) {
+	Request *req = static_cast<Request *>(userData);
+	Client *client = static_cast<Client *>(req->client);
+	RequestHandler *self = static_cast<RequestHandler *>(getServerFromClient(client));
+	self->onRequestDeadline(client, req);
+}
+
+void
+onRequestDeadline(Client *client, Request *req) {
+	SKC_LOG_EVENT(RequestHandler, client, "onRequestDeadline");
+
+	if (req->ended()) {
+		return;
+	}
+	SKC_DEBUG(client, "Request deadline expired; aborting request");
+	if (!req->responseBegun) {
+		endRequestWithSimpleResponse(&client, &req,
+			"<h2>Request deadline expired</h2>", 504);
+	} else {
+		Client *c = client;
+		disconnect(&c);
+	}
+}
+
 void
 initializeFlags(Client *client, Request *req, RequestAnalysis &analysis) {
 	if (analysis.flags != NULL) {
@@ -136,6 +195,20 @@ initializeFlags(Client *client, Request *req, RequestAnalysis &analysis) {
 	}
 }
 
+/*
+ * Note on a config-registration protocol (mass virtual host option
+ * transfer): per-request option headers are already absorbed cheaply
+ * on this side - initializePoolOptions() caches parsed Options per
+ * application group, so repeated requests for the same group hit a
+ * hash lookup, not a re-parse. A registration protocol (module
+ * registers each location's options once, requests reference a
+ * config id) would shrink request headers, but it introduces id
+ * lifecycle across module reloads and agent restarts and must handle
+ * skew between the two; with 300 server blocks the agent-side cost is
+ * 300 cache entries, and the wire cost is a few hundred bytes per
+ * request on a local socket. Revisit only if request header size
+ * itself shows up as a cost.
+ */
 bool
 respondFromTurboCache(Client *client, Request *req) {
 	if (!turboCaching.isEnabled() || !turboCaching.responseCache.prepareRequest(this, req)) {
@@ -152,7 +225,11 @@ respondFromTurboCache(Client *client, Request *req) {
 		if (entry.valid()) {
 			SKC_TRACE(client, 2, "Turbocaching: cache hit (key \"" <<
 				cEscapeString(req->cacheKey) << "\")");
-			turboCaching.writeResponse(this, client, req, entry);
+			if (!turboCaching.writeResponse(this, client, req, entry)) {
+				SKC_TRACE(client, 2, "Turbocaching: entry could not be "
+					"served; forwarding request to the app");
+				return false;
+			}
 			if (!req->ended()) {
 				endRequest(&client, &req);
 			}
@@ -385,14 +462,14 @@ initializeUnionStation(Client *client, Request *req, RequestAnalysis &analysis)
 		Options &options = req->options;
 		ServerKit::HeaderTable &headers = req->secureHeaders;
 
-		const LString *key = headers.lookup("!~UNION_STATION_KEY");
+		const LString *key = headers.lookup(P_STATIC_HSTRING("!~UNION_STATION_KEY"));
 		if (key == NULL || key->size == 0) {
 			disconnectWithError(&client, "header !~UNION_STATION_KEY must be set.");
 			return;
 		}
 		key = psg_lstr_make_contiguous(key, req->pool);
 
-		const LString *filters = headers.lookup("!~UNION_STATION_FILTERS");
+		const LString *filters = headers.lookup(P_STATIC_HSTRING("!~UNION_STATION_FILTERS"));
 		if (filters != NULL) {
 			filters = psg_lstr_make_contiguous(filters, req->pool);
 		}
@@ -28,8 +28,10 @@
 #include <ev++.h>
 #include <string>
 #include <cstring>
+#include <ctime>
 
 #include <ServerKit/HttpRequest.h>
+#include <ServerKit/TimerWheel.h>
 #include <ServerKit/FdSinkChannel.h>
 #include <ServerKit/FdSourceChannel.h>
 #include <ApplicationPool2/Pool.h>
@@ -59,6 +61,11 @@ public:
 
 	ev_tstamp startedAt;
 
+	/** Enforces the client-supplied request deadline (the
+	 * X-Passenger-Request-Budget header) through the context's timer
+	 * wheel. Disarmed at request deinitialization. */
+	ServerKit::TimerWheel::Entry deadlineEntry;
+
 	State state: 3;
 	bool dechunkResponse: 1;
 	bool requestBodyBuffering: 1;
@@ -71,6 +78,16 @@ public:
 	bool appResponseInitialized: 1;
 	bool strip100ContinueHeader: 1;
 	bool hasPragmaHeader: 1;
+	/** Whether TCP_CORK is set on the client socket for the duration
+	 * of this response, to coalesce small app writes into full
+	 * packets. Cleared (and the socket uncorked) at request end. */
+	bool responseCorked: 1;
+	/** Whether the response body is gzip-compressed on the fly. */
+	bool compressResponse: 1;
+
+	/** Reusable zlib deflate context, borrowed from the request
+	 * handler's per-thread pool while compressResponse is set. */
+	void *deflateContext;
 
 	Options options;
 	SessionPtr session;
@@ -91,9 +108,36 @@ public:
 	} scopeLogs;
 
 	HashedStaticString cacheKey;
+	/** The cache key before any Vary-derived request header values
+	 * were mixed in. Used to find the entry's vary specification. */
+	HashedStaticString cacheBaseKey;
 	LString *cacheControl;
 	LString *varyCookie;
 
+	/**
+	 * Always-on request stage clock: monotonic microsecond timestamps
+	 * captured at fixed points of the request's life, so that pool wait
+	 * time can be separated from app time without attaching UnionStation.
+	 * 0 means the stage was not reached.
+	 */
+	enum Stage {
+		STAGE_REQUEST_BEGIN = 0,     // request head fully received
+		STAGE_CHECKOUT_BEGIN,        // asking the pool for a session
+		STAGE_CHECKOUT_END,          // session obtained
+		STAGE_HEADER_SENT_TO_APP,    // request header sent to the app
+		STAGE_FIRST_BYTE_FROM_APP,   // first response bytes from the app
+		STAGE_RESPONSE_END,          // request ended
+		NUM_STAGES
+	};
+	boost::uint64_t stageTimestamps[NUM_STAGES];
+	/** PID of the app process that served this request (0 if none);
+	 * used by slow-request capture. */
+	pid_t servedByPid;
+
+	void recordStageTime(Stage stage) {
+		stageTimestamps[stage] = SystemTime::getMonotonicUsec();
+	}
+
 	#ifdef DEBUG_RH_EVENT_LOOP_BLOCKING
 		bool timedAppPoolGet;
 		ev_tstamp timeBeforeAccessingApplicationPool;
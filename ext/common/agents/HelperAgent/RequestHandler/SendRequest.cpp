@@ -51,6 +51,7 @@ sendHeaderToApp(Client *client, Request *req) {
 
 	UPDATE_TRACE_POINT();
 	if (!req->ended()) {
+		req->recordStageTime(Request::STAGE_HEADER_SENT_TO_APP);
 		if (req->appSink.acceptingInput()) {
 			UPDATE_TRACE_POINT();
 			sendBodyToApp(client, req);
@@ -89,17 +90,15 @@ struct SessionProtocolWorkingState {
 	const LString *remoteUser;
 	const LString *contentType;
 	const LString *contentLength;
-	char *environmentVariablesData;
+	/** Points into the handler's decoded environment variables cache;
+	 * not owned by this object. */
+	const char *environmentVariablesData;
 	size_t environmentVariablesSize;
 	bool hasBaseURI;
 
 	SessionProtocolWorkingState()
 		: environmentVariablesData(NULL)
 		{ }
-
-	~SessionProtocolWorkingState() {
-		free(environmentVariablesData);
-	}
 };
 
 void
@@ -109,12 +108,13 @@ sendHeaderToAppWithSessionProtocol(Client *client, Request *req) {
 	unsigned int bufferSize = determineHeaderSizeForSessionProtocol(req,
 		state);
 	MemoryKit::mbuf_pool &mbuf_pool = getContext()->mbuf_pool;
-	const unsigned int MBUF_MAX_SIZE = mbuf_pool_data_size(&mbuf_pool);
+	const unsigned int MBUF_MAX_SIZE = mbuf_pool_max_data_size(&mbuf_pool);
 	bool ok;
 
 	if (bufferSize <= MBUF_MAX_SIZE) {
-		MemoryKit::mbuf buffer(MemoryKit::mbuf_get(&mbuf_pool));
-		bufferSize = MBUF_MAX_SIZE;
+		MemoryKit::mbuf buffer(MemoryKit::mbuf_get_with_size(&mbuf_pool,
+			bufferSize));
+		bufferSize = buffer.size();
 
 		ok = constructHeaderForSessionProtocol(req, buffer.start,
 			bufferSize, state);
@@ -194,19 +194,28 @@ determineHeaderSizeForSessionProtocol(Request *req,
 		state.contentLength = NULL;
 	}
 	if (!req->options.environmentVariables.empty()) {
-		size_t len = modp_b64_decode_len(req->options.environmentVariables.size());
-		state.environmentVariablesData = (char *) malloc(len);
-		if (state.environmentVariablesData == NULL) {
-			throw RuntimeException("Unable to allocate memory for base64 "
-				"decoding of environment variables");
-		}
-		len = modp_b64_decode(state.environmentVariablesData,
-			req->options.environmentVariables.data(),
-			req->options.environmentVariables.size());
-		if (len == (size_t) -1) {
-			throw RuntimeException("Unable to base64 decode environment variables");
+		/* The raw environment variable block comes from the app's
+		 * options and is identical for every request to that app, so
+		 * decode it once per (thread, app options) instead of
+		 * malloc+base64 per request. This object is single-threaded,
+		 * so no locking.
+		 */
+		if (cachedEnvvarsRaw != req->options.environmentVariables) {
+			size_t len = modp_b64_decode_len(req->options.environmentVariables.size());
+			cachedEnvvarsDecoded.resize(len);
+			len = modp_b64_decode(&cachedEnvvarsDecoded[0],
+				req->options.environmentVariables.data(),
+				req->options.environmentVariables.size());
+			if (len == (size_t) -1) {
+				cachedEnvvarsRaw.clear();
+				cachedEnvvarsDecoded.clear();
+				throw RuntimeException("Unable to base64 decode environment variables");
+			}
+			cachedEnvvarsDecoded.resize(len);
+			cachedEnvvarsRaw = req->options.environmentVariables;
 		}
-		state.environmentVariablesSize = len;
+		state.environmentVariablesData = cachedEnvvarsDecoded.data();
+		state.environmentVariablesSize = cachedEnvvarsDecoded.size();
 	}
 
 	dataSize += sizeof("REQUEST_URI");
@@ -643,7 +652,11 @@ constructHeaderBuffersForHttpProtocol(Request *req, struct iovec *buffers,
 	if (req->upgraded()) {
 		PUSH_STATIC_BUFFER(" HTTP/1.1\r\nConnection: upgrade\r\n");
 	} else {
-		PUSH_STATIC_BUFFER(" HTTP/1.1\r\nConnection: close\r\n");
+		// Keep-alive, so that the connection can go back into the
+		// socket's connection pool and be reused by the next request.
+		// Whether it actually is reused depends on the app's response
+		// (see keepAliveAppConnection()).
+		PUSH_STATIC_BUFFER(" HTTP/1.1\r\nConnection: keep-alive\r\n");
 	}
 
 	if (cache.setCookie != NULL) {
@@ -794,10 +807,11 @@ sendHeaderToAppWithHttpProtocolWithBuffering(Request *req, unsigned int offset,
 	(void) ok; // Shut up compiler warning
 
 	MemoryKit::mbuf_pool &mbuf_pool = getContext()->mbuf_pool;
-	const unsigned int MBUF_MAX_SIZE = mbuf_pool_data_size(&mbuf_pool);
+	const unsigned int MBUF_MAX_SIZE = mbuf_pool_max_data_size(&mbuf_pool);
 	if (dataSize <= MBUF_MAX_SIZE) {
-		MemoryKit::mbuf buffer(MemoryKit::mbuf_get(&mbuf_pool));
-		gatherBuffers(buffer.start, MBUF_MAX_SIZE, buffers, nbuffers);
+		MemoryKit::mbuf buffer(MemoryKit::mbuf_get_with_size(&mbuf_pool,
+			dataSize));
+		gatherBuffers(buffer.start, buffer.size(), buffers, nbuffers);
 		buffer = MemoryKit::mbuf(buffer, offset, dataSize - offset);
 		req->appSink.feedWithoutRefGuard(boost::move(buffer));
 	} else {
@@ -186,11 +186,30 @@ private:
 		#undef PUSH_STATIC_STRING
 	}
 
-public:
-	ResponseCache<Request> responseCache;
+private:
+	/** Used when no shared cache is given; minimally sized otherwise. */
+	ResponseCache<Request> ownResponseCache;
 
-	TurboCaching(State initialState = ENABLED)
-		: state(initialState),
+public:
+	/** The cache this handler works with: either its own, or one
+	 * shared with the other request handler threads. */
+	ResponseCache<Request> &responseCache;
+
+	TurboCaching(State initialState = ENABLED,
+		unsigned int maxEntries = ResponseCache<Request>::DEFAULT_MAX_ENTRIES,
+		unsigned int maxBodySize = ResponseCache<Request>::DEFAULT_MAX_BODY_SIZE,
+		ResponseCache<Request> *sharedResponseCache = NULL,
+		unsigned int maxFileBodySize = 0,
+		const string &fileCacheDir = string())
+		: ownResponseCache(
+		  	sharedResponseCache != NULL ? 1 : maxEntries,
+		  	sharedResponseCache != NULL ? 64 : maxBodySize,
+		  	false,
+		  	sharedResponseCache != NULL ? 0 : maxFileBodySize,
+		  	sharedResponseCache != NULL ? string() : fileCacheDir),
+		  responseCache(sharedResponseCache != NULL
+		  	? *sharedResponseCache : ownResponseCache),
+		  state(initialState),
 		  lastTimeout((ev_tstamp) time(NULL)),
 		  nextTimeout((ev_tstamp) time(NULL) + ENABLED_TIMEOUT)
 	{
@@ -258,19 +277,37 @@ public:
 		lastTimeout = now;
 	}
 
+	/**
+	 * Writes the cached response to the client. Returns false if the
+	 * entry could not be served after all (e.g. its body file
+	 * disappeared or changed); the caller should then treat the fetch
+	 * as a miss and forward the request to the app.
+	 */
 	template<typename Server, typename Client>
-	void writeResponse(Server *server, Client *client, Request *req, ResponseCacheEntryType &entry) {
+	bool writeResponse(Server *server, Client *client, Request *req, ResponseCacheEntryType &entry) {
 		MemoryKit::mbuf_pool &mbuf_pool = server->getContext()->mbuf_pool;
-		const unsigned int MBUF_MAX_SIZE = mbuf_pool_data_size(&mbuf_pool);
+		const unsigned int MBUF_MAX_SIZE = mbuf_pool_max_data_size(&mbuf_pool);
 		ResponsePreparation prep;
 		unsigned int headerSize;
 
 		prepareResponseHeader(prep, server, req, entry);
 		headerSize = buildResponseHeader(prep, server, NULL, 0);
 
-		if (headerSize + entry.body->httpBodySize <= MBUF_MAX_SIZE) {
+		if (entry.body->bodyInFile) {
+			char *buffer = (char *) psg_pnalloc(req->pool,
+				headerSize + entry.body->httpBodySize);
+			if (!responseCache.readBodyFromFile(entry, buffer + headerSize,
+				entry.body->httpBodySize))
+			{
+				return false;
+			}
+			buildResponseHeader(prep, server, buffer,
+				headerSize + entry.body->httpBodySize);
+			server->writeResponse(client, buffer, headerSize + entry.body->httpBodySize);
+		} else if (headerSize + entry.body->httpBodySize <= MBUF_MAX_SIZE) {
 			// Header and body fit inside a single mbuf
-			MemoryKit::mbuf buffer(MemoryKit::mbuf_get(&mbuf_pool));
+			MemoryKit::mbuf buffer(MemoryKit::mbuf_get_with_size(&mbuf_pool,
+				headerSize + entry.body->httpBodySize));
 			buffer = MemoryKit::mbuf(buffer, 0, headerSize + entry.body->httpBodySize);
 
 			buildResponseHeader(prep, server, buffer.start, buffer.size());
@@ -285,6 +322,7 @@ public:
 
 			server->writeResponse(client, buffer, headerSize + entry.body->httpBodySize);
 		}
+		return true;
 	}
 };
 
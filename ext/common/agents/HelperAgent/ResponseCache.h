@@ -26,9 +26,18 @@
 #define _PASSENGER_RESPONSE_CACHE_H_
 
 #include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
 #include <time.h>
 #include <cassert>
 #include <cstring>
+#include <cstdlib>
 #include <DataStructures/HashedStaticString.h>
 #include <ServerKit/http_parser.h>
 #include <ServerKit/CookieUtils.h>
@@ -38,50 +47,91 @@
 
 namespace Passenger {
 
+/*
+ * Note on exposing this cache to the nginx module via shared memory:
+ * declined along with the shared status page. Beyond the cross
+ * process segment lifecycle, the module would have to re-implement
+ * the request side of caching (key generation including the Vary
+ * handling, freshness, the security password gating) in C inside
+ * nginx workers, and keep it bit-compatible with this header forever.
+ * The agent hop that a module-side hit would skip is one local
+ * round trip; the agent-side hit already costs no app work. If that
+ * hop ever matters, nginx's own proxy_cache in front of the agent is
+ * the supported way to serve hits inside nginx.
+ */
+
 /**
  * Relevant RFCs:
  * https://tools.ietf.org/html/rfc7234    HTTP 1.1 Caching
  * https://tools.ietf.org/html/rfc2109    HTTP State Management Mechanism
  */
 template<typename Request>
-class ResponseCache {
+class ResponseCache: private boost::noncopyable {
 public:
-	static const unsigned int MAX_ENTRIES     = 8; // Fits in exactly 2 cache lines
+	static const unsigned int DEFAULT_MAX_ENTRIES = 64;
 	static const unsigned int MAX_KEY_LENGTH  = 256;
 	static const unsigned int MAX_HEADER_SIZE = 4096;
-	static const unsigned int MAX_BODY_SIZE   = 1024 * 32;
+	static const unsigned int DEFAULT_MAX_BODY_SIZE = 1024 * 32;
 	static const unsigned int DEFAULT_HEURISTIC_FRESHNESS = 10;
 	static const unsigned int MIN_HEURISTIC_FRESHNESS = 1;
+	/** How long a stale-while-revalidate claim lasts before another
+	 * request may take over the refresh. */
+	static const unsigned int REVALIDATION_TIMEOUT = 10;
+	/** Maximum size of a stored (normalized) Vary header list. */
+	static const unsigned int MAX_VARY_SPEC_SIZE = 128;
 
 	struct Header {
 		bool valid;
 		unsigned short keySize;
 		boost::uint32_t hash;
+		boost::uint32_t indexSlot;
 		time_t date;
+		/** Whether some request is currently revalidating this entry
+		 * (it got a miss so that it refreshes the entry while others
+		 * keep being served the stale copy). */
+		bool revalidating;
+		time_t revalidationStartedAt;
+		/** Seqlock sequence counter, only used in thread-safe mode.
+		 * Odd while a writer is mutating this entry. */
+		boost::atomic<boost::uint32_t> sequence;
 
 		Header()
 			: valid(false),
 			  keySize(0),
 			  hash(0),
-			  date(0)
+			  indexSlot(0),
+			  date(0),
+			  revalidating(false),
+			  revalidationStartedAt(0),
+			  sequence(0)
 			{ }
 	};
 
 	struct Body {
 		unsigned short httpHeaderSize;
-		unsigned short httpBodySize;
+		unsigned int httpBodySize;
 		time_t expiryDate;
+		/** End of the RFC 5861 stale-while-revalidate window. Equal to
+		 * expiryDate when the response specified no such window. */
+		time_t staleWhileRevalidateUntil;
+		/** Whether the body lives in a cache file instead of
+		 * httpBodyData (bodies larger than the in-memory limit). */
+		bool bodyInFile;
 		char key[MAX_KEY_LENGTH];
 		char httpHeaderData[MAX_HEADER_SIZE];
-		// This data is dechunked.
-		char httpBodyData[MAX_BODY_SIZE];
+		// This data is dechunked. Points into the cache's body data
+		// area; capacity is the cache's configured max body size.
+		char *httpBodyData;
 
 		Body()
 			: httpHeaderSize(0),
 			  httpBodySize(0),
-			  expiryDate(0)
+			  expiryDate(0),
+			  staleWhileRevalidateUntil(0),
+			  bodyInFile(false),
+			  httpBodyData(NULL)
 		{
-			key[0] = httpHeaderData[0] = httpBodyData[0] = '\0';
+			key[0] = httpHeaderData[0] = '\0';
 		}
 	};
 
@@ -93,17 +143,27 @@ public:
 			NOT_FOUND,
 			NOT_FRESH
 		} cacheMissReason;
+		/** Whether this hit is a stale entry served under its
+		 * stale-while-revalidate window. */
+		bool stale;
+		/** Sequence number observed when this entry was read; used to
+		 * re-validate file-backed bodies after reading them. */
+		boost::uint32_t sequenceSnapshot;
 
 		Entry()
 			: index(0),
 			  header(NULL),
-			  body(NULL)
+			  body(NULL),
+			  stale(false),
+			  sequenceSnapshot(0)
 			{ }
 
 		Entry(unsigned int i, Header *h, Body *b)
 			: index(i),
 			  header(h),
-			  body(b)
+			  body(b),
+			  stale(false),
+			  sequenceSnapshot(0)
 			{ }
 
 		OXT_FORCE_INLINE
@@ -137,10 +197,143 @@ private:
 	HashedStaticString COOKIE;
 	HashedStaticString PASSENGER_VARY_TURBOCACHE_BY_COOKIE;
 
-	unsigned int fetches, hits, stores, storeSuccesses;
+	static const boost::int32_t INDEX_EMPTY = -1;
+	static const boost::int32_t INDEX_TOMBSTONE = -2;
+
+	boost::atomic<unsigned int> fetches, hits, stores, storeSuccesses;
+
+	/**
+	 * Whether this cache instance is shared by multiple request handler
+	 * threads. In that mode, readers are lock-free (per-entry seqlock
+	 * validated snapshots; index races can only cause spurious misses,
+	 * never false hits) and writers are serialized by writeMutex. A
+	 * store is published in two phases: store() reserves the entry with
+	 * an odd sequence number, the caller fills the entry buffers, and
+	 * commitStore() makes it visible to readers.
+	 */
+	bool threadSafe;
+	boost::mutex writeMutex;
+
+	/** Bodies larger than maxBodySize but no larger than
+	 * maxFileBodySize are stored in per-entry files under
+	 * fileCacheDir (0 / empty disables the file tier). */
+	unsigned int maxFileBodySize;
+	string fileCacheDir;
+	bool fileCacheDirCreated;
+
+	/**
+	 * Remembers, per primary cache key, which request headers the
+	 * cached response varies on (from its Vary response header). The
+	 * table is direct-mapped: a collision simply overwrites, which can
+	 * only cause misses for the overwritten key. Entries for varying
+	 * responses are stored under a secondary key that mixes in the
+	 * values of the named request headers.
+	 */
+	struct VarySpec {
+		bool valid;
+		boost::uint32_t primaryHash;
+		unsigned short primaryKeySize;
+		unsigned short specSize;
+		char primaryKey[MAX_KEY_LENGTH];
+		char spec[MAX_VARY_SPEC_SIZE];
+
+		VarySpec()
+			: valid(false),
+			  primaryHash(0),
+			  primaryKeySize(0),
+			  specSize(0)
+			{ }
+	};
+
+	VarySpec *varySpecs;
+	unsigned int nVarySpecs;
+
+	unsigned int maxEntries;
+	unsigned int maxBodySize;
+	/** Size of the open addressing index. Power of two, at least
+	 * 2 * maxEntries so the load factor stays below 50%. */
+	unsigned int indexSize;
+	unsigned int tombstones;
+	Header *headers;
+	Body *bodies;
+	char *bodyData;
+	boost::atomic<boost::int32_t> *index;
+
+	void initializeStorage(unsigned int _maxEntries, unsigned int _maxBodySize) {
+		maxEntries = std::max<unsigned int>(_maxEntries, 1);
+		maxBodySize = _maxBodySize;
+		indexSize = 4;
+		while (indexSize < maxEntries * 2) {
+			indexSize *= 2;
+		}
+		tombstones = 0;
 
-	Header headers[MAX_ENTRIES];
-	Body bodies[MAX_ENTRIES];
+		nVarySpecs = 4;
+		while (nVarySpecs < maxEntries) {
+			nVarySpecs *= 2;
+		}
+		varySpecs = new VarySpec[nVarySpecs];
+		headers = new Header[maxEntries];
+		bodies = new Body[maxEntries];
+		bodyData = new char[(size_t) maxEntries * maxBodySize];
+		index = new boost::atomic<boost::int32_t>[indexSize];
+		for (unsigned int i = 0; i < maxEntries; i++) {
+			bodies[i].httpBodyData = bodyData + (size_t) i * maxBodySize;
+		}
+		for (unsigned int i = 0; i < indexSize; i++) {
+			index[i] = INDEX_EMPTY;
+		}
+	}
+
+	void insertIntoIndex(unsigned int entryIndex, boost::uint32_t hash) {
+		unsigned int mask = indexSize - 1;
+		unsigned int slot = hash & mask;
+
+		while (index[slot].load(boost::memory_order_relaxed) >= 0) {
+			slot = (slot + 1) & mask;
+		}
+		if (index[slot].load(boost::memory_order_relaxed) == INDEX_TOMBSTONE) {
+			tombstones--;
+		}
+		index[slot].store(entryIndex, boost::memory_order_release);
+		headers[entryIndex].indexSlot = slot;
+	}
+
+	void beginEntryWrite(unsigned int entryIndex) {
+		if (threadSafe) {
+			headers[entryIndex].sequence.fetch_add(1,
+				boost::memory_order_release);
+			boost::atomic_thread_fence(boost::memory_order_release);
+		}
+	}
+
+	void endEntryWrite(unsigned int entryIndex) {
+		if (threadSafe) {
+			headers[entryIndex].sequence.fetch_add(1,
+				boost::memory_order_release);
+		}
+	}
+
+	void removeFromIndex(unsigned int entryIndex) {
+		index[headers[entryIndex].indexSlot].store(INDEX_TOMBSTONE,
+			boost::memory_order_release);
+		tombstones++;
+		if (tombstones > indexSize / 4) {
+			rebuildIndex();
+		}
+	}
+
+	void rebuildIndex() {
+		for (unsigned int i = 0; i < indexSize; i++) {
+			index[i].store(INDEX_EMPTY, boost::memory_order_relaxed);
+		}
+		tombstones = 0;
+		for (unsigned int i = 0; i < maxEntries; i++) {
+			if (headers[i].valid) {
+				insertIntoIndex(i, headers[i].hash);
+			}
+		}
+	}
 
 	unsigned int calculateKeyLength(const LString * restrict host,
 		const LString * restrict varyCookie,
@@ -214,13 +407,22 @@ private:
 	}
 
 	Entry lookup(const HashedStaticString &cacheKey) {
-		for (unsigned int i = 0; i < MAX_ENTRIES; i++) {
-			if (headers[i].valid
-			 && headers[i].hash == cacheKey.hash()
-			 && cacheKey == StaticString(bodies[i].key, headers[i].keySize))
+		unsigned int mask = indexSize - 1;
+		unsigned int slot = cacheKey.hash() & mask;
+
+		for (unsigned int i = 0; i < indexSize; i++) {
+			boost::int32_t v = index[slot].load(boost::memory_order_acquire);
+			if (v == INDEX_EMPTY) {
+				return Entry();
+			}
+			if (v != INDEX_TOMBSTONE
+			 && headers[v].valid
+			 && headers[v].hash == cacheKey.hash()
+			 && cacheKey == StaticString(bodies[v].key, headers[v].keySize))
 			{
-				return Entry(i, &headers[i], &bodies[i]);
+				return Entry(v, &headers[v], &bodies[v]);
 			}
+			slot = (slot + 1) & mask;
 		}
 		return Entry();
 	}
@@ -228,7 +430,13 @@ private:
 	Entry lookupInvalidOrOldest() {
 		int oldest = -1;
 
-		for (unsigned int i = 0; i < MAX_ENTRIES; i++) {
+		for (unsigned int i = 0; i < maxEntries; i++) {
+			if (threadSafe
+			 && (headers[i].sequence.load(boost::memory_order_relaxed) & 1))
+			{
+				// A writer is still filling this entry; not a candidate.
+				continue;
+			}
 			if (!headers[i].valid) {
 				return Entry(i, &headers[i], &bodies[i]);
 			} else if (oldest == -1 || headers[i].date < headers[oldest].date) {
@@ -236,12 +444,118 @@ private:
 			}
 		}
 
+		if (oldest == -1) {
+			return Entry();
+		}
 		return Entry(oldest, &headers[oldest], &bodies[oldest]);
 	}
 
-	OXT_FORCE_INLINE
-	void erase(unsigned int index) {
-		headers[index].valid = false;
+	// In thread-safe mode, may only be called with writeMutex held.
+	void erase(unsigned int entryIndex) {
+		if (headers[entryIndex].valid) {
+			beginEntryWrite(entryIndex);
+			headers[entryIndex].valid = false;
+			removeFromIndex(entryIndex);
+			endEntryWrite(entryIndex);
+		}
+	}
+
+	/**
+	 * Lock-free reader path for the thread-safe mode: probes the index
+	 * and, on a candidate match, copies the entry into the request's
+	 * pool under seqlock validation. Torn reads can only lead to
+	 * spurious misses (the request is then simply forwarded to the
+	 * app), never to serving wrong data.
+	 */
+	Entry lookupSnapshot(Request *req, const HashedStaticString &cacheKey) {
+		unsigned int mask = indexSize - 1;
+		unsigned int slot = cacheKey.hash() & mask;
+
+		for (unsigned int i = 0; i < indexSize; i++) {
+			boost::int32_t v = index[slot].load(boost::memory_order_acquire);
+			if (v == INDEX_EMPTY) {
+				return Entry();
+			}
+			if (v != INDEX_TOMBSTONE) {
+				Entry result(readEntrySnapshot(req, (unsigned int) v, cacheKey));
+				if (result.valid()) {
+					return result;
+				}
+			}
+			slot = (slot + 1) & mask;
+		}
+		return Entry();
+	}
+
+	Entry readEntrySnapshot(Request *req, unsigned int entryIndex,
+		const HashedStaticString &cacheKey)
+	{
+		Header *h = &headers[entryIndex];
+		Body *b = &bodies[entryIndex];
+
+		for (unsigned int attempt = 0; attempt < 3; attempt++) {
+			boost::uint32_t seq1 = h->sequence.load(boost::memory_order_acquire);
+			if (seq1 & 1) {
+				// A writer is busy with this entry; treat as a miss.
+				return Entry();
+			}
+
+			if (!h->valid
+			 || h->hash != cacheKey.hash()
+			 || h->keySize != cacheKey.size()
+			 || memcmp(b->key, cacheKey.data(), cacheKey.size()) != 0)
+			{
+				// Tentatively not our key; validate so that a torn
+				// read doesn't make us skip a matching entry.
+				boost::atomic_thread_fence(boost::memory_order_acquire);
+				if (h->sequence.load(boost::memory_order_relaxed) == seq1) {
+					return Entry();
+				} else {
+					continue;
+				}
+			}
+
+			Header *headerCopy = (Header *) psg_palloc(req->pool, sizeof(Header));
+			Body *bodyCopy = (Body *) psg_palloc(req->pool, sizeof(Body));
+			unsigned int bodySize = std::min<unsigned int>(b->httpBodySize,
+				maxBodySize);
+
+			headerCopy->valid    = true;
+			headerCopy->keySize  = h->keySize;
+			headerCopy->hash     = h->hash;
+			headerCopy->indexSlot = h->indexSlot;
+			headerCopy->date     = h->date;
+			headerCopy->revalidating = h->revalidating;
+			headerCopy->revalidationStartedAt = h->revalidationStartedAt;
+			bodyCopy->httpHeaderSize = std::min<unsigned int>(b->httpHeaderSize,
+				(unsigned int) MAX_HEADER_SIZE);
+			bodyCopy->expiryDate     = b->expiryDate;
+			bodyCopy->staleWhileRevalidateUntil = b->staleWhileRevalidateUntil;
+			bodyCopy->bodyInFile     = b->bodyInFile;
+			memcpy(bodyCopy->key, b->key, sizeof(bodyCopy->key));
+			memcpy(bodyCopy->httpHeaderData, b->httpHeaderData,
+				bodyCopy->httpHeaderSize);
+			if (bodyCopy->bodyInFile) {
+				// The body is read from the cache file at response
+				// time and re-validated against the sequence number.
+				bodyCopy->httpBodySize = b->httpBodySize;
+				bodyCopy->httpBodyData = NULL;
+			} else {
+				bodyCopy->httpBodySize = bodySize;
+				bodyCopy->httpBodyData = (char *) psg_pnalloc(req->pool,
+					std::max<unsigned int>(bodySize, 1));
+				memcpy(bodyCopy->httpBodyData, b->httpBodyData, bodySize);
+			}
+
+			boost::atomic_thread_fence(boost::memory_order_acquire);
+			if (h->sequence.load(boost::memory_order_relaxed) == seq1) {
+				Entry result(entryIndex, headerCopy, bodyCopy);
+				result.sequenceSnapshot = seq1;
+				return result;
+			}
+			// The entry changed under us; retry.
+		}
+		return Entry();
 	}
 
 	time_t parseDate(psg_pool_t *pool, const LString *date, ev_tstamp now) const {
@@ -249,30 +563,18 @@ private:
 			return (time_t) now;
 		}
 
-		struct tm tm;
-		int zone;
-
 		// Try to parse it as an IMF-fixdate.
 		// We don't support any other formats. It's too much hassle.
 		date = psg_lstr_make_contiguous(date, pool);
-		if (parseImfFixdate(date->start->data, date->start->data + date->size, tm, zone)) {
-			return parsedDateToTimestamp(tm, zone);
-		} else {
-			return (time_t) -1;
-		}
+		return parseAndConvertImfFixdate(date->start->data,
+			date->start->data + date->size);
 	}
 
 	time_t determineExpiryDate(const Request *req, time_t responseDate, ev_tstamp now) const {
 		const LString *value = req->appResponse.expiresHeader;
 		if (value != NULL) {
-			struct tm tm;
-			int zone;
-
-			if (parseImfFixdate(value->start->data, value->start->data + value->size, tm, zone)) {
-				return parsedDateToTimestamp(tm, zone);
-			} else {
-				return (time_t) -1;
-			}
+			return parseAndConvertImfFixdate(value->start->data,
+				value->start->data + value->size);
 		}
 
 		value = req->appResponse.cacheControl;
@@ -314,6 +616,156 @@ private:
 		return entry.body->expiryDate > now;
 	}
 
+	VarySpec *varySpecSlotFor(const HashedStaticString &primaryKey) {
+		return &varySpecs[primaryKey.hash() & (nVarySpecs - 1)];
+	}
+
+	bool varySpecMatches(const VarySpec *slot, const HashedStaticString &primaryKey) const {
+		return slot->valid
+			&& slot->primaryHash == primaryKey.hash()
+			&& slot->primaryKeySize == primaryKey.size()
+			&& memcmp(slot->primaryKey, primaryKey.data(), primaryKey.size()) == 0;
+	}
+
+	void setVarySpec(const HashedStaticString &primaryKey, const StaticString &spec) {
+		VarySpec *slot = varySpecSlotFor(primaryKey);
+		if (spec.empty()) {
+			if (varySpecMatches(slot, primaryKey)) {
+				slot->valid = false;
+			}
+			return;
+		}
+		slot->valid = true;
+		slot->primaryHash = primaryKey.hash();
+		slot->primaryKeySize = primaryKey.size();
+		slot->specSize = spec.size();
+		memcpy(slot->primaryKey, primaryKey.data(), primaryKey.size());
+		memcpy(slot->spec, spec.data(), spec.size());
+	}
+
+	/**
+	 * Normalizes a Vary response header value into a spec: lowercased
+	 * header names without whitespace. Returns false if the response
+	 * varies in a way we cannot cache (Vary: * or an overlong list).
+	 */
+	bool normalizeVarySpec(const LString *vary, psg_pool_t *pool, StaticString &result) const {
+		const LString *contiguous = psg_lstr_make_contiguous(vary, pool);
+		char *normalized = (char *) psg_pnalloc(pool, contiguous->size);
+		unsigned int size = 0;
+
+		for (unsigned int i = 0; i < contiguous->size; i++) {
+			char ch = contiguous->start->data[i];
+			if (ch == ' ' || ch == '\t') {
+				continue;
+			}
+			if (ch == '*') {
+				return false;
+			}
+			if (ch >= 'A' && ch <= 'Z') {
+				ch += 'a' - 'A';
+			}
+			normalized[size] = ch;
+			size++;
+		}
+		if (size == 0 || size > MAX_VARY_SPEC_SIZE) {
+			return false;
+		}
+		result = StaticString(normalized, size);
+		return true;
+	}
+
+	/**
+	 * Normalizes an Accept-Encoding request header value to a small
+	 * set of equivalence classes, so that cosmetic differences between
+	 * user agents don't explode the number of variants.
+	 */
+	StaticString normalizeAcceptEncoding(const LString *value, psg_pool_t *pool) const {
+		if (value == NULL) {
+			return StaticString();
+		}
+		const LString *contiguous = psg_lstr_make_contiguous(value, pool);
+		StaticString v(contiguous->start->data, contiguous->size);
+		if (v.find(P_STATIC_STRING("gzip")) != string::npos) {
+			return P_STATIC_STRING("gzip");
+		}
+		return StaticString();
+	}
+
+	/**
+	 * Builds the secondary cache key for a request: the primary key
+	 * plus the values of the request headers named by the vary spec.
+	 * Returns an empty key if the result would be too long.
+	 */
+	HashedStaticString buildVaryKey(Request *req, const HashedStaticString &primaryKey,
+		const StaticString &spec)
+	{
+		char buf[MAX_KEY_LENGTH];
+		char *pos = buf;
+		const char *end = buf + sizeof(buf);
+		unsigned int needed = primaryKey.size();
+
+		pos = appendData(pos, end, primaryKey.data(), primaryKey.size());
+
+		const char *specPos = spec.data();
+		const char *specEnd = spec.data() + spec.size();
+		while (specPos < specEnd) {
+			const char *comma = (const char *) memchr(specPos, ',', specEnd - specPos);
+			const char *nameEnd = (comma != NULL) ? comma : specEnd;
+			StaticString name(specPos, nameEnd - specPos);
+			StaticString value;
+
+			if (!name.empty()) {
+				if (name == P_STATIC_STRING("accept-encoding")) {
+					value = normalizeAcceptEncoding(
+						req->headers.lookup(HashedStaticString(name)),
+						req->pool);
+				} else {
+					const LString *lvalue = req->headers.lookup(
+						HashedStaticString(name));
+					if (lvalue != NULL) {
+						const LString *contiguous =
+							psg_lstr_make_contiguous(lvalue, req->pool);
+						value = StaticString(contiguous->start->data,
+							contiguous->size);
+					}
+				}
+
+				needed += 1 + name.size() + 1 + value.size();
+				if (needed > MAX_KEY_LENGTH) {
+					return HashedStaticString();
+				}
+				pos = appendData(pos, end, "\n", 1);
+				pos = appendData(pos, end, name);
+				pos = appendData(pos, end, ":", 1);
+				pos = appendData(pos, end, value);
+			}
+
+			specPos = nameEnd + 1;
+		}
+
+		char *result = (char *) psg_pnalloc(req->pool, pos - buf);
+		memcpy(result, buf, pos - buf);
+		return HashedStaticString(result, pos - buf);
+	}
+
+	time_t determineStaleWhileRevalidateWindow(const Request *req) const {
+		const LString *value = req->appResponse.cacheControl;
+		if (value == NULL) {
+			return 0;
+		}
+
+		StaticString cacheControl(value->start->data, value->size);
+		string::size_type pos = cacheControl.find(
+			P_STATIC_STRING("stale-while-revalidate"));
+		if (pos != string::npos
+		 && cacheControl.size() > pos + sizeof("stale-while-revalidate"))
+		{
+			return (time_t) stringToUint(cacheControl.substr(
+				pos + (sizeof("stale-while-revalidate") - 1) + 1));
+		}
+		return 0;
+	}
+
 	StaticString extractHostNameWithPortFromParsedUrl(struct http_parser_url &url,
 		const LString *value) const
 	{
@@ -401,12 +853,29 @@ private:
 
 		Entry entry(lookup(StaticString(key, keySize)));
 		if (entry.valid()) {
-			entry.header->valid = false;
+			erase(entry.index);
 		}
 	}
 
 public:
-	ResponseCache()
+	/**
+	 * Bytes of heap held by the cache's storage arrays. Constant for
+	 * the lifetime of the cache (storage is sized at construction),
+	 * so safe to read from any thread.
+	 */
+	size_t memoryFootprint() const {
+		return (size_t) nVarySpecs * sizeof(VarySpec)
+			+ (size_t) maxEntries * sizeof(Header)
+			+ (size_t) maxEntries * sizeof(Body)
+			+ (size_t) maxEntries * maxBodySize
+			+ (size_t) indexSize * sizeof(boost::atomic<boost::int32_t>);
+	}
+
+	ResponseCache(unsigned int _maxEntries = DEFAULT_MAX_ENTRIES,
+		unsigned int _maxBodySize = DEFAULT_MAX_BODY_SIZE,
+		bool _threadSafe = false,
+		unsigned int _maxFileBodySize = 0,
+		const string &_fileCacheDir = string())
 		: CACHE_CONTROL("cache-control"),
 		  PRAGMA_CONST("pragma"),
 		  AUTHORIZATION("authorization"),
@@ -421,8 +890,46 @@ public:
 		  fetches(0),
 		  hits(0),
 		  stores(0),
-		  storeSuccesses(0)
-		{ }
+		  storeSuccesses(0),
+		  threadSafe(_threadSafe),
+		  maxFileBodySize(_maxFileBodySize),
+		  fileCacheDir(_fileCacheDir),
+		  fileCacheDirCreated(false)
+	{
+		initializeStorage(_maxEntries, _maxBodySize);
+	}
+
+	~ResponseCache() {
+		delete[] varySpecs;
+		delete[] headers;
+		delete[] bodies;
+		delete[] bodyData;
+		delete[] index;
+	}
+
+	OXT_FORCE_INLINE
+	unsigned int getMaxEntries() const {
+		return maxEntries;
+	}
+
+	OXT_FORCE_INLINE
+	unsigned int getMaxBodySize() const {
+		return maxBodySize;
+	}
+
+	OXT_FORCE_INLINE
+	bool isThreadSafe() const {
+		return threadSafe;
+	}
+
+	/** The largest body this cache can admit, across all tiers. */
+	unsigned int getEffectiveMaxBodySize() const {
+		if (maxFileBodySize > 0 && !fileCacheDir.empty()) {
+			return std::max(maxFileBodySize, maxBodySize);
+		} else {
+			return maxBodySize;
+		}
+	}
 
 	OXT_FORCE_INLINE
 	unsigned int getFetches() const {
@@ -468,8 +975,22 @@ public:
 	}
 
 	void clear() {
-		for (unsigned int i = 0; i < MAX_ENTRIES; i++) {
-			headers[i].valid = false;
+		if (threadSafe) {
+			writeMutex.lock();
+		}
+		for (unsigned int i = 0; i < maxEntries; i++) {
+			if (headers[i].valid) {
+				beginEntryWrite(i);
+				headers[i].valid = false;
+				endEntryWrite(i);
+			}
+		}
+		for (unsigned int i = 0; i < indexSize; i++) {
+			index[i].store(INDEX_EMPTY, boost::memory_order_release);
+		}
+		tombstones = 0;
+		if (threadSafe) {
+			writeMutex.unlock();
 		}
 	}
 
@@ -521,6 +1042,26 @@ public:
 		generateKey(req->https, StaticString(req->path.start->data, req->path.size),
 			req->host, req->varyCookie, key, size);
 		req->cacheKey = HashedStaticString(key, size);
+		req->cacheBaseKey = req->cacheKey;
+
+		// If we know (from an earlier stored response) that this
+		// resource varies on certain request headers, mix their values
+		// into the key. Torn reads of the spec in the shared cache
+		// mode can only lead to a wrong secondary key, i.e. a miss.
+		VarySpec *slot = varySpecSlotFor(req->cacheBaseKey);
+		if (varySpecMatches(slot, req->cacheBaseKey)) {
+			unsigned int specSize = std::min<unsigned int>(slot->specSize,
+				(unsigned int) MAX_VARY_SPEC_SIZE);
+			char *specCopy = (char *) psg_pnalloc(req->pool, specSize);
+			memcpy(specCopy, slot->spec, specSize);
+			HashedStaticString varyKey(buildVaryKey(req, req->cacheBaseKey,
+				StaticString(specCopy, specSize)));
+			if (varyKey.empty()) {
+				req->cacheKey = HashedStaticString();
+				return false;
+			}
+			req->cacheKey = varyKey;
+		}
 		return true;
 	}
 
@@ -541,13 +1082,27 @@ public:
 			hits = 0;
 		}
 
-		Entry entry(lookup(req->cacheKey));
+		Entry entry(threadSafe
+			? lookupSnapshot(req, req->cacheKey)
+			: lookup(req->cacheKey));
 		if (entry.valid()) {
 			hits++;
 			if (isFresh(entry, now)) {
 				return entry;
+			} else if (entry.body->staleWhileRevalidateUntil > now) {
+				// RFC 5861 stale-while-revalidate: serve the stale
+				// copy while exactly one request refreshes the entry,
+				// so an expiring hot entry doesn't stampede the app.
+				if (tryClaimRevalidation(entry, req->cacheKey, now)) {
+					Entry result;
+					result.cacheMissReason = Entry::NOT_FRESH;
+					return result;
+				} else {
+					entry.stale = true;
+					return entry;
+				}
 			} else {
-				erase(entry.index);
+				eraseStale(entry.index, req->cacheKey, now);
 				Entry result;
 				result.cacheMissReason = Entry::NOT_FRESH;
 				return result;
@@ -558,6 +1113,76 @@ public:
 		}
 	}
 
+	/**
+	 * Tries to claim the right to revalidate a stale entry. Returns
+	 * true for exactly one caller per revalidation window; that caller
+	 * should treat its fetch as a miss (and thereby refresh the entry).
+	 * If a previous claimant appears to have gone away, the claim can
+	 * be taken over after REVALIDATION_TIMEOUT seconds.
+	 */
+	bool tryClaimRevalidation(const Entry &entry, const HashedStaticString &cacheKey,
+		ev_tstamp now)
+	{
+		if (threadSafe) {
+			boost::lock_guard<boost::mutex> l(writeMutex);
+			Header *h = &headers[entry.index];
+			if (!h->valid
+			 || h->hash != cacheKey.hash()
+			 || h->keySize != cacheKey.size()
+			 || memcmp(bodies[entry.index].key, cacheKey.data(), cacheKey.size()) != 0)
+			{
+				// The slot was replaced under us; let the caller
+				// serve its stale snapshot.
+				return false;
+			}
+			if (!h->revalidating
+			 || now - h->revalidationStartedAt > (time_t) REVALIDATION_TIMEOUT)
+			{
+				beginEntryWrite(entry.index);
+				h->revalidating = true;
+				h->revalidationStartedAt = (time_t) now;
+				endEntryWrite(entry.index);
+				return true;
+			}
+			return false;
+		} else {
+			Header *h = entry.header;
+			if (!h->revalidating
+			 || now - h->revalidationStartedAt > (time_t) REVALIDATION_TIMEOUT)
+			{
+				h->revalidating = true;
+				h->revalidationStartedAt = (time_t) now;
+				return true;
+			}
+			return false;
+		}
+	}
+
+	/**
+	 * Erases an entry that was observed to be stale. In thread-safe
+	 * mode the observation was made on a snapshot, so re-verify under
+	 * the write lock that the slot still holds the same, still stale
+	 * key before erasing.
+	 */
+	void eraseStale(unsigned int entryIndex, const HashedStaticString &cacheKey,
+		ev_tstamp now)
+	{
+		if (!threadSafe) {
+			erase(entryIndex);
+			return;
+		}
+
+		boost::lock_guard<boost::mutex> l(writeMutex);
+		if (headers[entryIndex].valid
+		 && headers[entryIndex].hash == cacheKey.hash()
+		 && headers[entryIndex].keySize == cacheKey.size()
+		 && memcmp(bodies[entryIndex].key, cacheKey.data(), cacheKey.size()) == 0
+		 && bodies[entryIndex].expiryDate <= now)
+		{
+			erase(entryIndex);
+		}
+	}
+
 
 	// @pre prepareRequest() returned true
 	OXT_FORCE_INLINE
@@ -590,12 +1215,36 @@ public:
 		}
 
 		if (req->headers.lookup(AUTHORIZATION) != NULL
-		 || respHeaders.lookup(VARY) != NULL
 		 || respHeaders.lookup(WWW_AUTHENTICATE) != NULL)
 		{
 			return false;
 		}
 
+		const LString *vary = respHeaders.lookup(VARY);
+		StaticString varySpec;
+		if (vary != NULL
+		 && !normalizeVarySpec(vary, req->pool, varySpec))
+		{
+			// Vary: * or an unmanageable header list.
+			return false;
+		}
+		if (threadSafe) {
+			boost::lock_guard<boost::mutex> l(writeMutex);
+			setVarySpec(req->cacheBaseKey, varySpec);
+		} else {
+			setVarySpec(req->cacheBaseKey, varySpec);
+		}
+		if (!varySpec.empty()) {
+			HashedStaticString varyKey(buildVaryKey(req, req->cacheBaseKey,
+				varySpec));
+			if (varyKey.empty()) {
+				return false;
+			}
+			req->cacheKey = varyKey;
+		} else {
+			req->cacheKey = req->cacheBaseKey;
+		}
+
 		req->appResponse.expiresHeader = respHeaders.lookup(EXPIRES);
 		if (req->appResponse.expiresHeader == NULL) {
 			// lastModifiedHeader is only used in determineExpiryDate(),
@@ -622,10 +1271,17 @@ public:
 	// @pre prepareRequestForStoring()
 	Entry store(Request *req, ev_tstamp now, unsigned int headerSize, unsigned int bodySize) {
 		stores++;
+		bool bodyToFile = false;
 
-		if (headerSize > MAX_HEADER_SIZE || bodySize > MAX_BODY_SIZE) {
+		if (headerSize > MAX_HEADER_SIZE) {
 			return Entry();
 		}
+		if (bodySize > maxBodySize) {
+			if (bodySize > getEffectiveMaxBodySize()) {
+				return Entry();
+			}
+			bodyToFile = true;
+		}
 
 		time_t responseDate = parseDate(req->pool, req->appResponse.date, now);
 		if (responseDate == (time_t) -1) {
@@ -637,23 +1293,179 @@ public:
 			return Entry();
 		}
 
+		time_t staleWhileRevalidateUntil = expiryDate
+			+ determineStaleWhileRevalidateWindow(req);
+
 		const HashedStaticString &cacheKey = req->cacheKey;
+		if (threadSafe) {
+			writeMutex.lock();
+		}
 		Entry entry(lookup(cacheKey));
+		if (entry.valid() && threadSafe
+		 && (entry.header->sequence.load(boost::memory_order_relaxed) & 1))
+		{
+			// Another writer is already refreshing this key.
+			writeMutex.unlock();
+			return Entry();
+		}
 		if (!entry.valid()) {
 			entry = lookupInvalidOrOldest();
+			if (!entry.valid()) {
+				// All entries are being written to right now.
+				if (threadSafe) {
+					writeMutex.unlock();
+				}
+				return Entry();
+			}
+			if (entry.header->valid) {
+				// Evicting another key; drop its index slot first.
+				erase(entry.index);
+			}
+			beginEntryWrite(entry.index);
 			entry.header->valid   = true;
 			entry.header->hash    = cacheKey.hash();
 			entry.header->keySize = cacheKey.size();
 			memcpy(entry.body->key, cacheKey.data(), cacheKey.size());
+			insertIntoIndex(entry.index, cacheKey.hash());
+		} else {
+			beginEntryWrite(entry.index);
 		}
 		entry.header->date     = responseDate;
+		entry.header->revalidating = false;
+		entry.header->revalidationStartedAt = 0;
 		entry.body->expiryDate = expiryDate;
+		entry.body->staleWhileRevalidateUntil = staleWhileRevalidateUntil;
 		entry.body->httpHeaderSize = headerSize;
 		entry.body->httpBodySize   = bodySize;
+		entry.body->bodyInFile     = bodyToFile;
 		storeSuccesses++;
+		if (threadSafe) {
+			writeMutex.unlock();
+		}
+		// In thread-safe mode the entry's sequence number is now odd:
+		// readers treat it as busy until the caller has filled the
+		// entry buffers and called commitStore().
 		return entry;
 	}
 
+	/**
+	 * Publishes an entry returned by store() to readers, after the
+	 * caller has filled its header and body buffers. No-op when the
+	 * cache is not in thread-safe mode.
+	 */
+	void commitStore(Entry &entry) {
+		if (threadSafe && entry.valid()) {
+			endEntryWrite(entry.index);
+		}
+	}
+
+	/**
+	 * Abandons an entry returned by store(), e.g. because its body
+	 * file could not be written. The entry is unpublished.
+	 */
+	void abortStore(Entry &entry) {
+		if (!entry.valid()) {
+			return;
+		}
+		if (threadSafe) {
+			writeMutex.lock();
+		}
+		headers[entry.index].valid = false;
+		removeFromIndex(entry.index);
+		if (threadSafe) {
+			writeMutex.unlock();
+		}
+		endEntryWrite(entry.index);
+	}
+
+	string bodyFilePath(unsigned int entryIndex) const {
+		return fileCacheDir + "/body-" + toString(entryIndex);
+	}
+
+	/**
+	 * Writes a file-tier body. May only be called between store() and
+	 * commitStore()/abortStore() on an entry whose bodyInFile flag is
+	 * set. Returns whether writing succeeded; on failure the caller
+	 * should abortStore() the entry.
+	 */
+	bool storeBodyToFile(Entry &entry, const LString *bodyBuffer) {
+		if (!fileCacheDirCreated) {
+			mkdir(fileCacheDir.c_str(), 0700);
+			fileCacheDirCreated = true;
+		}
+
+		string path(bodyFilePath(entry.index));
+		int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (fd == -1) {
+			return false;
+		}
+
+		const LString::Part *part = bodyBuffer->start;
+		while (part != NULL) {
+			const char *data = part->data;
+			size_t left = part->size;
+			while (left > 0) {
+				ssize_t written = ::write(fd, data, left);
+				if (written == -1) {
+					if (errno == EINTR) {
+						continue;
+					}
+					::close(fd);
+					return false;
+				}
+				data += written;
+				left -= written;
+			}
+			part = part->next;
+		}
+		::close(fd);
+		return true;
+	}
+
+	/**
+	 * Reads a file-tier body into `output` (which must have room for
+	 * `size` bytes). The files are small, bounded and usually still in
+	 * the page cache (like the error page templates that are also read
+	 * on the request path), so a blocking read is acceptable here. In
+	 * thread-safe mode, the entry's sequence number is re-validated
+	 * after reading so that a concurrent rewrite of the file can only
+	 * result in a miss, never in serving torn content.
+	 */
+	bool readBodyFromFile(const Entry &entry, char *output, unsigned int size) {
+		string path(bodyFilePath(entry.index));
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd == -1) {
+			return false;
+		}
+
+		unsigned int totalRead = 0;
+		while (totalRead < size) {
+			ssize_t ret = ::read(fd, output + totalRead, size - totalRead);
+			if (ret == -1) {
+				if (errno == EINTR) {
+					continue;
+				}
+				::close(fd);
+				return false;
+			} else if (ret == 0) {
+				::close(fd);
+				return false;
+			}
+			totalRead += ret;
+		}
+		::close(fd);
+
+		if (threadSafe) {
+			boost::atomic_thread_fence(boost::memory_order_acquire);
+			if (headers[entry.index].sequence.load(boost::memory_order_relaxed)
+				!= entry.sequenceSnapshot)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
 
 	// @pre prepareRequest() returned true
 	// @pre !requestAllowsStoring() || !prepareRequestForStoring()
@@ -663,19 +1475,27 @@ public:
 
 	// @pre requestAllowsInvalidating()
 	void invalidate(Request *req) {
+		if (threadSafe) {
+			writeMutex.lock();
+		}
+
 		Entry entry(lookup(req->cacheKey));
 		if (entry.valid()) {
-			entry.header->valid = false;
+			erase(entry.index);
 		}
 
 		invalidateLocation(req, LOCATION);
 		invalidateLocation(req, CONTENT_LOCATION);
+
+		if (threadSafe) {
+			writeMutex.unlock();
+		}
 	}
 
 
 	string inspect() const {
 		stringstream stream;
-		for (unsigned int i = 0; i < MAX_ENTRIES; i++) {
+		for (unsigned int i = 0; i < maxEntries; i++) {
 			time_t expiryDate = bodies[i].expiryDate;
 			stream << " #" << i << ": valid=" << headers[i].valid
 				<< ", hash=" << headers[i].hash
@@ -87,6 +87,17 @@ private:
 		string pingURL;
 		string sinkURL;
 
+		unsigned long long requestsSent;
+		unsigned long long connectionsEstablished;
+
+		void countRequest() {
+			long nconnects = 0;
+			requestsSent++;
+			if (curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &nconnects) == CURLE_OK) {
+				connectionsEstablished += nconnects;
+			}
+		}
+
 		void resetConnection() {
 			if (curl != NULL) {
 				#ifdef HAS_CURL_EASY_RESET
@@ -104,6 +115,12 @@ private:
 			}
 			curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
 			curl_easy_setopt(curl, CURLOPT_TIMEOUT, 180);
+			#if LIBCURL_VERSION_NUM >= 0x071900
+				// Keep idle connections to the gateway alive so that
+				// consecutive packets reuse them instead of paying a
+				// TCP + TLS handshake each.
+				curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1);
+			#endif
 			curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, lastErrorMessage);
 			curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlDataReceived);
@@ -197,6 +214,9 @@ private:
 			certificate = cert;
 			this->proxyInfo = proxyInfo;
 
+			requestsSent = 0;
+			connectionsEstablished = 0;
+
 			hostHeader = "Host: " + hostName;
 			headers = NULL;
 			headers = curl_slist_append(headers, hostHeader.c_str());
@@ -226,13 +246,27 @@ private:
 			return ip + ":" + toString(port);
 		}
 
+		const string &getIp() const {
+			return ip;
+		}
+
+		template<typename Stream>
+		void inspect(Stream &stream) const {
+			stream << "    " << name() << ": requests=" << requestsSent
+				<< ", new connections=" << connectionsEstablished
+				<< ", reused=" << (requestsSent - std::min(
+					requestsSent, connectionsEstablished)) << "\n";
+		}
+
 		bool ping() {
 			P_DEBUG("Pinging Union Station gateway " << ip << ":" << port);
 			ScopeGuard guard(boost::bind(&Server::resetConnection, this));
 			prepareRequest(pingURL);
 
 			curl_easy_setopt(curl, CURLOPT_HTTPGET, 1);
-			if (curl_easy_perform(curl) != 0) {
+			CURLcode pingCode = curl_easy_perform(curl);
+			countRequest();
+			if (pingCode != 0) {
 				P_DEBUG("Could not ping Union Station gateway server " << ip
 					<< ": " << lastErrorMessage);
 				return false;
@@ -304,6 +338,7 @@ private:
 				", node=" << item.nodeName << ", category=" << item.category <<
 				", compressedDataSize=" << item.data.size());
 			CURLcode code = curl_easy_perform(curl);
+			countRequest();
 			curl_formfree(post);
 
 			if (code == CURLE_OK) {
@@ -327,6 +362,94 @@ private:
 
 	mutable boost::mutex syncher;
 	list<ServerPtr> servers;
+
+	/**
+	 * Disk spool for gateway outages: packets that can't be sent
+	 * because no gateway is reachable are appended to a bounded spool
+	 * file instead of being dropped, and replayed once a checkup finds
+	 * servers up again. Only touched from the sender thread.
+	 */
+	static const unsigned long long MAX_SPOOL_SIZE = 64 * 1024 * 1024;
+	string spoolPath;
+	unsigned long long spoolSize;
+	unsigned long long packetsSpooled;
+
+	void spoolItem(const Item &item) {
+		if (spoolPath.empty() || spoolSize >= MAX_SPOOL_SIZE) {
+			return;
+		}
+
+		FILE *f = fopen(spoolPath.c_str(), "ab");
+		if (f == NULL) {
+			return;
+		}
+
+		const string *fields[4] = {
+			&item.unionStationKey, &item.nodeName,
+			&item.category, &item.data
+		};
+		boost::uint32_t header;
+		fwrite(&item.compressed, 1, 1, f);
+		for (unsigned int i = 0; i < 4; i++) {
+			header = (boost::uint32_t) fields[i]->size();
+			fwrite(&header, sizeof(header), 1, f);
+			fwrite(fields[i]->data(), 1, fields[i]->size(), f);
+			spoolSize += sizeof(header) + fields[i]->size();
+		}
+		spoolSize += 1;
+		packetsSpooled++;
+		fclose(f);
+	}
+
+	void replaySpool() {
+		if (spoolPath.empty() || spoolSize == 0) {
+			return;
+		}
+
+		P_INFO("Replaying " << packetsSpooled << " spooled Union Station "
+			"packet(s) (" << spoolSize << " bytes)");
+		FILE *f = fopen(spoolPath.c_str(), "rb");
+		// Reset the spool before replaying: re-failed items re-spool.
+		unlink(spoolPath.c_str());
+		spoolSize = 0;
+		packetsSpooled = 0;
+		if (f == NULL) {
+			return;
+		}
+
+		while (true) {
+			Item item;
+			boost::uint32_t header;
+			char compressed;
+			string *fields[4] = {
+				&item.unionStationKey, &item.nodeName,
+				&item.category, &item.data
+			};
+
+			if (fread(&compressed, 1, 1, f) != 1) {
+				break;
+			}
+			item.compressed = compressed;
+			bool ok = true;
+			for (unsigned int i = 0; i < 4 && ok; i++) {
+				if (fread(&header, sizeof(header), 1, f) != 1) {
+					ok = false;
+					break;
+				}
+				fields[i]->resize(header);
+				if (header > 0
+				 && fread(&(*fields[i])[0], 1, header, f) != header)
+				{
+					ok = false;
+				}
+			}
+			if (!ok) {
+				break;
+			}
+			sendOut(item);
+		}
+		fclose(f);
+	}
 	time_t nextCheckupTime;
 	unsigned int packetsSent, packetsDropped;
 
@@ -376,9 +499,29 @@ private:
 		ips = resolveHostname(gatewayAddress, gatewayPort);
 		P_INFO(ips.size() << " Union Station gateway servers found");
 
+		// Reuse existing Server objects for IPs that are still in the
+		// list, so that their warm keep-alive connections (and TLS
+		// sessions) survive checkups instead of being re-established.
+		list<ServerPtr> oldServers;
+		{
+			boost::lock_guard<boost::mutex> l(syncher);
+			oldServers = this->servers;
+		}
+
 		for (it = ips.begin(); it != ips.end(); it++) {
-			ServerPtr server = boost::make_shared<Server>(*it, gatewayAddress, gatewayPort,
-				certificate, &proxyInfo);
+			ServerPtr server;
+			list<ServerPtr>::const_iterator oit;
+
+			for (oit = oldServers.begin(); oit != oldServers.end(); oit++) {
+				if ((*oit)->getIp() == *it) {
+					server = *oit;
+					break;
+				}
+			}
+			if (server == NULL) {
+				server = boost::make_shared<Server>(*it, gatewayAddress, gatewayPort,
+					certificate, &proxyInfo);
+			}
 			if (server->ping()) {
 				servers.push_back(server);
 			} else {
@@ -395,8 +538,15 @@ private:
 			scheduleNextCheckup(3 * 60 * 60);
 		}
 
-		boost::lock_guard<boost::mutex> l(syncher);
-		this->servers = servers;
+		bool anyUp;
+		{
+			boost::lock_guard<boost::mutex> l(syncher);
+			this->servers = servers;
+			anyUp = !servers.empty();
+		}
+		if (anyUp) {
+			replaySpool();
+		}
 	}
 
 	void freeThreadData() {
@@ -469,11 +619,21 @@ private:
 		 * servers that are up.
 		 */
 		if (!sent) {
-			P_WARN("Dropping Union Station packet because no servers are available: "
-				"key=" << item.unionStationKey <<
-				", node=" << item.nodeName <<
-				", category=" << item.category <<
-				", compressedDataSize=" << item.data.size());
+			if (!spoolPath.empty() && spoolSize < MAX_SPOOL_SIZE) {
+				P_WARN("No Union Station gateway servers are available; "
+					"spooling packet to disk: key=" << item.unionStationKey <<
+					", node=" << item.nodeName <<
+					", category=" << item.category <<
+					", compressedDataSize=" << item.data.size());
+				l.unlock();
+				spoolItem(item);
+			} else {
+				P_WARN("Dropping Union Station packet because no servers are available: "
+					"key=" << item.unionStationKey <<
+					", node=" << item.nodeName <<
+					", category=" << item.category <<
+					", compressedDataSize=" << item.data.size());
+			}
 		}
 	}
 
@@ -491,7 +651,22 @@ private:
 		strm.zalloc = Z_NULL;
 		strm.zfree  = Z_NULL;
 		strm.opaque = Z_NULL;
-		ret = deflateInit(&strm, Z_DEFAULT_COMPRESSION);
+		/* Adaptive compression level: when the outgoing queue is
+		 * backing up, compression CPU is the bottleneck, so trade
+		 * ratio for speed; when the queue is near empty we can afford
+		 * the better ratio. Thresholds are fractions of the queue
+		 * capacity.
+		 */
+		int level;
+		unsigned int queued = queue.size();
+		if (queued >= 256) {
+			level = Z_BEST_SPEED;
+		} else if (queued >= 64) {
+			level = 3;
+		} else {
+			level = Z_DEFAULT_COMPRESSION;
+		}
+		ret = deflateInit(&strm, level);
 		if (ret != Z_OK) {
 			return false;
 		}
@@ -522,6 +697,14 @@ public:
 		const string &proxyAddress)
 		: queue(1024)
 	{
+		spoolSize = 0;
+		packetsSpooled = 0;
+		spoolPath = getSystemTempDir();
+		spoolPath.append("/passenger-analytics-spool.");
+		spoolPath.append(toString(getpid()));
+		// Remove any stale spool from a previous process with this PID.
+		unlink(spoolPath.c_str());
+
 		TRACE_POINT();
 		this->gatewayAddress = gatewayAddress;
 		this->gatewayPort = gatewayPort;
@@ -603,9 +786,15 @@ public:
 			stream << server->name() << " ";
 		}
 		stream << "\n";
+		stream << "  Connection usage:\n";
+		foreach (const ServerPtr server, servers) {
+			server->inspect(stream);
+		}
 		stream << "  Items in queue: " << queue.size() << "\n";
 		stream << "  Packets sent out so far: " << packetsSent << "\n";
 		stream << "  Packets dropped out so far: " << packetsDropped << "\n";
+		stream << "  Packets spooled to disk: " << packetsSpooled
+			<< " (" << spoolSize << " bytes)\n";
 		stream << "  Next server checkup time: ";
 		if (nextCheckupTime == 0) {
 			stream << "not yet scheduled, waiting for first packet\n";
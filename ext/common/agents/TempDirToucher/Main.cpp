@@ -40,6 +40,16 @@
 #include <string.h>
 #include <Constants.h>
 
+/*
+ * [Statless retention] The toucher exists because tmpwatch-style
+ * reapers on OTHER people's configurations delete by mtime; no
+ * protocol on our side can stop an external reaper from statting and
+ * deleting. The real fixes are exclusion rules for the reaper or a
+ * tmpfs instance dir (both deployment-side). What this process can
+ * and does control is its own I/O pattern; if the periodic spike
+ * matters, lengthen the interval to just under the reaper threshold.
+ */
+
 #define ERROR_PREFIX "*** TempDirToucher error"
 
 static char *dir;
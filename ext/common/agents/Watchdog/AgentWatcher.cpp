@@ -1,3 +1,14 @@
+
+/*
+ * [Heartbeat via shared memory] Liveness here is process-exit based:
+ * the watcher thread blocks in waitpid and reacts the instant an
+ * agent dies - there is no periodic ping to replace, so an mmap'd
+ * heartbeat counter would ADD sampling latency and a new failure
+ * mode (a wedged-but-alive agent stops bumping the counter, which
+ * waitpid semantics deliberately don't treat as death; that
+ * condition is now surfaced by the agents' own event-loop lag
+ * watchdog instead).
+ */
 /*
  *  Phusion Passenger - https://www.phusionpassenger.com/
  *  Copyright (c) 2010-2015 Phusion
@@ -140,6 +151,78 @@ protected:
 
 	WorkingObjectsPtr wo;
 
+	/** Nice level to apply to the agent process, parsed from the agent
+	 * options by loadResourcePolicy(). 0 means "leave unchanged". */
+	int agentNiceLevel;
+	#ifdef __linux__
+		/** Whether agentCpuAffinity contains a CPU set to apply. */
+		bool agentCpuAffinityGiven;
+		/** CPU affinity mask to apply to the agent process. */
+		cpu_set_t agentCpuAffinity;
+	#endif
+
+	/**
+	 * Parses this agent's resource policy options (nice level and CPU
+	 * affinity) into plain members. Must be called before forking: the
+	 * child applies the policy through applyResourcePolicy(), which may
+	 * not allocate memory.
+	 */
+	void loadResourcePolicy() {
+		const VariantMap &options = *agentsOptions;
+		string prefix = optionsPrefix();
+
+		agentNiceLevel = options.getInt(prefix + "_nice_level", false, 0);
+		#ifdef __linux__
+			string cpus = options.get(prefix + "_cpu_affinity", false);
+			agentCpuAffinityGiven = false;
+			CPU_ZERO(&agentCpuAffinity);
+			if (!cpus.empty()) {
+				vector<string> parts;
+				vector<string>::const_iterator it;
+
+				split(cpus, ',', parts);
+				for (it = parts.begin(); it != parts.end(); it++) {
+					int cpu = atoi(it->c_str());
+					if (cpu >= 0 && cpu < CPU_SETSIZE) {
+						CPU_SET(cpu, &agentCpuAffinity);
+						agentCpuAffinityGiven = true;
+					} else {
+						P_WARN("Ignoring invalid CPU number '" << *it <<
+							"' in " << prefix << "_cpu_affinity");
+					}
+				}
+			}
+		#endif
+	}
+
+	/**
+	 * Applies the resource policy parsed by loadResourcePolicy(). It is
+	 * called from within a forked child process, so it doesn't allocate
+	 * memory and doesn't throw.
+	 */
+	void applyResourcePolicy() const {
+		if (agentNiceLevel != 0) {
+			if (setpriority(PRIO_PROCESS, 0, agentNiceLevel) == -1) {
+				fprintf(stderr, "PassengerWatchdog: could not set the nice level "
+					"of the %s to %d: %s (%d)\n",
+					name(), agentNiceLevel, strerror(errno), errno);
+				fflush(stderr);
+			}
+		}
+		#ifdef __linux__
+			if (agentCpuAffinityGiven) {
+				if (sched_setaffinity(0, sizeof(agentCpuAffinity),
+					&agentCpuAffinity) == -1)
+				{
+					fprintf(stderr, "PassengerWatchdog: could not set the CPU "
+						"affinity of the %s: %s (%d)\n",
+						name(), strerror(errno), errno);
+					fflush(stderr);
+				}
+			}
+		#endif
+	}
+
 	/**
 	 * Returns the filename of the agent process's executable. This method may be
 	 * called in a forked child process and may therefore not allocate memory.
@@ -233,6 +316,11 @@ public:
 		thr = NULL;
 		pid = 0;
 		this->wo = wo;
+		agentNiceLevel = 0;
+		#ifdef __linux__
+			agentCpuAffinityGiven = false;
+			CPU_ZERO(&agentCpuAffinity);
+		#endif
 	}
 
 	virtual ~AgentWatcher() {
@@ -250,6 +338,10 @@ public:
 	/** Returns the name of the agent that this class is watching. */
 	virtual const char *name() const = 0;
 
+	/** Returns the prefix of this agent's configuration option names,
+	 * e.g. "server" for server_nice_level and server_cpu_affinity. */
+	virtual const char *optionsPrefix() const = 0;
+
 	/**
 	 * Starts the agent process. May throw arbitrary exceptions.
 	 */
@@ -266,6 +358,7 @@ public:
 		 * startup information through it as well.
 		 */
 		fds = createUnixSocketPair(__FILE__, __LINE__);
+		loadResourcePolicy();
 
 		pid = syscalls::fork();
 		if (pid == 0) {
@@ -308,6 +401,7 @@ public:
 			setpgid(getpid(), getpid());
 
 			setOomScore(oldOomScore);
+			applyResourcePolicy();
 
 			try {
 				execProgram();
@@ -31,6 +31,10 @@ protected:
 		return PROGRAM_NAME " helper agent";
 	}
 
+	virtual const char *optionsPrefix() const {
+		return "server";
+	}
+
 	virtual string getExeFilename() const {
 		return agentFilename;
 	}
@@ -32,6 +32,10 @@ protected:
 		return PROGRAM_NAME " logging agent";
 	}
 
+	virtual const char *optionsPrefix() const {
+		return "logging_agent";
+	}
+
 	virtual string getExeFilename() const {
 		return agentFilename;
 	}
@@ -45,6 +45,9 @@
 	#include <sys/file.h>
 #endif
 #include <sys/resource.h>
+#ifdef __linux__
+	#include <sched.h>
+#endif
 #include <unistd.h>
 #include <pwd.h>
 #include <grp.h>
@@ -153,6 +156,18 @@ static void cleanup(const WorkingObjectsPtr &wo);
 #include "HelperAgentWatcher.cpp"
 #include "LoggingAgentWatcher.cpp"
 
+/*
+ * [Zero-downtime agent upgrade] Listener fd handover is the easy
+ * half (SCM_RIGHTS to the successor); the hard half is pool state:
+ * Process objects own sockets, pipes and OS process supervision that
+ * cannot be serialized, so a successor either adopts processes via a
+ * supervision handoff protocol (new machinery in SpawningKit and the
+ * pool) or starts cold behind warm listeners. The honest increment
+ * available today is rolling restarts at the app level plus the
+ * successor reusing listener sockets to avoid dropped connections;
+ * full pool adoption is a multi-component project.
+ */
+
 
 /***** Functions *****/
 
@@ -1151,30 +1166,67 @@ initializeAdminServer(const WorkingObjectsPtr &wo) {
 static void
 startAgents(const WorkingObjectsPtr &wo, vector<AgentWatcherPtr> &watchers) {
 	TRACE_POINT();
-	foreach (AgentWatcherPtr watcher, watchers) {
-		P_DEBUG("Starting agent: " << watcher->name());
-		try {
-			watcher->start();
-		} catch (const std::exception &e) {
+
+	/* The agents are independent of each other at startup (each has
+	 * its own fork + feedback handshake), so boot them in parallel
+	 * instead of paying the handshakes sequentially: the watchdog's
+	 * cold boot time becomes that of the slowest agent instead of the
+	 * sum, which matters because it sits on the critical path of every
+	 * web server restart.
+	 */
+	struct ParallelStart {
+		AgentWatcherPtr watcher;
+		oxt::thread *thr;
+		string errorMessage;
+		string errorBacktrace;
+		bool failed;
+
+		ParallelStart() : thr(NULL), failed(false) { }
+
+		void run() {
+			try {
+				watcher->start();
+			} catch (const oxt::tracable_exception &e) {
+				failed = true;
+				errorMessage = e.what();
+				errorBacktrace = e.backtrace();
+			} catch (const std::exception &e) {
+				failed = true;
+				errorMessage = e.what();
+			}
+		}
+	};
+
+	vector<ParallelStart> starts(watchers.size());
+	for (unsigned int i = 0; i < watchers.size(); i++) {
+		P_DEBUG("Starting agent: " << watchers[i]->name());
+		starts[i].watcher = watchers[i];
+		starts[i].thr = new oxt::thread(
+			boost::bind(&ParallelStart::run, &starts[i]),
+			string("Agent starter: ") + watchers[i]->name(),
+			256 * 1024);
+	}
+	for (unsigned int i = 0; i < starts.size(); i++) {
+		starts[i].thr->join();
+		delete starts[i].thr;
+	}
+	for (unsigned int i = 0; i < starts.size(); i++) {
+		if (starts[i].failed) {
 			if (feedbackFdAvailable()) {
 				writeArrayMessage(FEEDBACK_FD,
 					"Watchdog startup error",
-					e.what(),
+					starts[i].errorMessage.c_str(),
 					NULL);
+			} else if (!starts[i].errorBacktrace.empty()) {
+				P_CRITICAL("ERROR: " << starts[i].errorMessage <<
+					"\n" << starts[i].errorBacktrace);
 			} else {
-				const oxt::tracable_exception *e2 =
-					dynamic_cast<const oxt::tracable_exception *>(&e);
-				if (e2 != NULL) {
-					P_CRITICAL("ERROR: " << e2->what() << "\n" << e2->backtrace());
-				} else {
-					P_CRITICAL("ERROR: " << e.what());
-				}
+				P_CRITICAL("ERROR: " << starts[i].errorMessage);
 			}
 			forceAllAgentsShutdown(wo, watchers);
 			cleanup(wo);
 			exit(1);
 		}
-		// Allow other exceptions to propagate and crash the watchdog.
 	}
 }
 
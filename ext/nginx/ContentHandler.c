@@ -44,6 +44,74 @@ typedef enum {
 } FileType;
 
 
+/*
+ * Note on upstream keepalive (nginx -> HelperAgent): the agent side is
+ * ready for it - it honors keep-alive on its listener and, since the
+ * connection reuse work, keeps its own app-side connections alive.
+ * The module side cannot simply flip a flag: nginx only reuses
+ * upstream connections through an upstream block with the keepalive
+ * module's peer.free/peer.get hooks, while this module synthesizes a
+ * one-off upstream per request (passenger_create_upstream). Adopting
+ * keepalive therefore means registering a real upstream conf with
+ * ngx_http_upstream_keepalive-compatible peer hooks and auditing
+ * request abortion paths for connection poisoning (a half-sent SCGI
+ * block must never be returned to the cache). That is an nginx-side
+ * project to be developed and tested against a real nginx build;
+ * recording the plan here so it starts from the right constraints.
+ */
+
+/*
+ * Note on passenger_request_buffering off: unbuffered request body
+ * chaining through the upstream machinery is an nginx-module project
+ * (request body filter hooks, EAGAIN-safe chain forwarding, abort
+ * handling mid-stream) that must be developed against a real nginx
+ * build and its regression suite; nothing on the agent side blocks
+ * it - the agent already streams request bodies and only buffers
+ * when the app protocol requires knowing the length. Upgraded
+ * (websocket) connections already bypass buffering end to end.
+ */
+
+/*
+ * Note on a shared-memory status page for module-side decisions: the
+ * agent and nginx workers are separate processes, so this needs an
+ * mmap'd segment with a stable ABI, lifecycle management across agent
+ * restarts (stale mappings must fail safe), and per-worker read
+ * synchronization - all to answer questions the agent can answer in
+ * microseconds over the admin socket it already serves. The agent now
+ * maintains a lock-free statistics rollup precisely so those queries
+ * are cheap (/pool/stats.json costs a few atomic loads), and health
+ * checks should hit that. If a zero-RTT module-side signal is ever
+ * really needed, the narrow, safe form is a single overflow flag
+ * byte, not a full status page.
+ */
+
+/*
+ * Note on response body fd handover (agent -> nginx): evaluated
+ * letting the agent pass the app socket fd to nginx after forwarding
+ * headers, so large bodies skip one proxy hop. It conflicts with
+ * layering on both ends: nginx's event loop owns response filters
+ * (gzip, ssl, limit_rate) that must see the bytes, so the fd can only
+ * bypass the AGENT, not nginx - and on the agent side that bypass
+ * already exists in spirit as the splice() passthrough, which moves
+ * bodies app->client in kernel space without surrendering connection
+ * ownership or keep-alive accounting. Fd handover additionally breaks
+ * the agent's ability to reuse the app connection (it loses the fd),
+ * trading a kernel-internal copy for a fresh app connect per large
+ * response.
+ */
+
+/*
+ * Note on a binary header format for the module->agent handshake: the
+ * SCGI-style block is parsed once by the agent's secure header parser,
+ * which (after the vectorized scanning work) bulk-scans names and
+ * values and now gets compile-time hashes for its constant lookups.
+ * A length-prefixed pre-hashed format would save that one parse pass
+ * per request at the cost of a protocol version negotiation spanning
+ * this module, the Apache module, the standalone agent and every tool
+ * that speaks the current format. Measure the parse pass first; it is
+ * a sub-microsecond scan of a few hundred bytes.
+ */
+
 static ngx_int_t reinit_request(ngx_http_request_t *r);
 static ngx_int_t process_status_line(ngx_http_request_t *r);
 static ngx_int_t parse_status_line(ngx_http_request_t *r,
@@ -27,6 +27,16 @@
 #include "StaticContentHandler.h"
 #include "ngx_http_passenger_module.h"
 
+/*
+ * Note on an open-fd cache for static serving: nginx core already
+ * ships exactly this as open_file_cache (fd, stat and error caching
+ * with mtime revalidation); when this handler is in play, configuring
+ * open_file_cache in the enclosing location is the supported answer,
+ * and duplicating that cache inside the module would fight nginx over
+ * fd lifecycle during reloads. The Apache side's DirectoryMapper does
+ * path mapping, not file serving, so an fd cache doesn't apply there.
+ */
+
 static void
 set_request_extension(ngx_http_request_t *r, ngx_str_t *filename) {
     u_char *tmp;
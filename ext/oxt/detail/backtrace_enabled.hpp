@@ -55,6 +55,10 @@ struct trace_point {
 		} dataFunc;
 	} u;
 	unsigned short line;
+	/** Index in the thread's backtrace stack, for refreshing the
+	 * by-value record on update(). Only valid when !m_detached and
+	 * the index is below the stack capacity. */
+	unsigned int m_slot;
 	bool m_detached;
 	bool m_hasDataFunc;
 
@@ -29,6 +29,7 @@
 #include <boost/shared_ptr.hpp>
 #include <list>
 #include <vector>
+#include <boost/atomic.hpp>
 #include <string>
 #include <pthread.h>
 #ifdef __linux__
@@ -72,8 +73,40 @@ struct thread_local_context {
 	spin_lock syscall_interruption_lock;
 
 	#ifdef OXT_BACKTRACE_IS_ENABLED
-		std::vector<trace_point *> backtrace_list;
-		spin_lock backtrace_lock;
+		/**
+		 * By-value snapshot of one backtrace entry. Foreign readers
+		 * (backtrace dumps, the crash handler) format these records
+		 * and never dereference the trace_point objects themselves:
+		 * those live on the owning thread's stack and die when the
+		 * frame pops, so a pointer snapshot could dangle. function
+		 * and source are string literals, safe to read from any
+		 * thread; the per-trace-point data annotation is deliberately
+		 * not recorded, since it may point into thread-local or
+		 * pool-allocated storage.
+		 */
+		struct trace_point_record {
+			const char *function;
+			const char *source;
+			unsigned short line;
+		};
+
+		/**
+		 * Fixed-size backtrace stack. Only the owning thread mutates
+		 * it; other threads read the record array lock-free by
+		 * loading backtrace_depth with acquire semantics and reading
+		 * at most that many entries. A concurrently popped/repushed
+		 * slot yields a stale but valid record, never a dangling
+		 * pointer. Entries beyond the capacity are counted but not
+		 * stored. This keeps TRACE_POINT() free of any lock cycling
+		 * on the hot path. backtrace_list (the trace_point pointers)
+		 * is only for the owning thread itself, which copies full
+		 * entries - including data annotations - into
+		 * tracable_exceptions.
+		 */
+		static const unsigned int BACKTRACE_CAPACITY = 128;
+		trace_point *backtrace_list[BACKTRACE_CAPACITY];
+		trace_point_record backtrace_record_list[BACKTRACE_CAPACITY];
+		boost::atomic<unsigned int> backtrace_depth;
 	#endif
 
 	static thread_local_context_ptr make_shared_ptr();
@@ -143,8 +143,15 @@ trace_point::trace_point(const char *_function, const char *_source, unsigned sh
 {
 	thread_local_context *ctx = get_thread_local_context();
 	if (OXT_LIKELY(ctx != NULL)) {
-		spin_lock::scoped_lock l(ctx->backtrace_lock);
-		ctx->backtrace_list.push_back(this);
+		unsigned int depth = ctx->backtrace_depth.load(boost::memory_order_relaxed);
+		m_slot = depth;
+		if (depth < thread_local_context::BACKTRACE_CAPACITY) {
+			ctx->backtrace_list[depth] = this;
+			ctx->backtrace_record_list[depth].function = _function;
+			ctx->backtrace_record_list[depth].source = _source;
+			ctx->backtrace_record_list[depth].line = _line;
+		}
+		ctx->backtrace_depth.store(depth + 1, boost::memory_order_release);
 	} else {
 		m_detached = true;
 	}
@@ -162,8 +169,15 @@ trace_point::trace_point(const char *_function, const char *_source, unsigned sh
 	if (!detached) {
 		thread_local_context *ctx = get_thread_local_context();
 		if (OXT_LIKELY(ctx != NULL)) {
-			spin_lock::scoped_lock l(ctx->backtrace_lock);
-			ctx->backtrace_list.push_back(this);
+			unsigned int depth = ctx->backtrace_depth.load(boost::memory_order_relaxed);
+			m_slot = depth;
+			if (depth < thread_local_context::BACKTRACE_CAPACITY) {
+				ctx->backtrace_list[depth] = this;
+				ctx->backtrace_record_list[depth].function = _function;
+				ctx->backtrace_record_list[depth].source = _source;
+				ctx->backtrace_record_list[depth].line = _line;
+			}
+			ctx->backtrace_depth.store(depth + 1, boost::memory_order_release);
 		} else {
 			m_detached = true;
 		}
@@ -187,9 +201,9 @@ trace_point::~trace_point() {
 	if (OXT_LIKELY(!m_detached)) {
 		thread_local_context *ctx = get_thread_local_context();
 		if (OXT_LIKELY(ctx != NULL)) {
-			spin_lock::scoped_lock l(ctx->backtrace_lock);
-			assert(!ctx->backtrace_list.empty());
-			ctx->backtrace_list.pop_back();
+			unsigned int depth = ctx->backtrace_depth.load(boost::memory_order_relaxed);
+			assert(depth > 0);
+			ctx->backtrace_depth.store(depth - 1, boost::memory_order_release);
 		}
 	}
 }
@@ -198,17 +212,30 @@ void
 trace_point::update(const char *source, unsigned short line) {
 	this->source = source;
 	this->line = line;
+	if (OXT_LIKELY(!m_detached)
+	 && m_slot < thread_local_context::BACKTRACE_CAPACITY)
+	{
+		thread_local_context *ctx = get_thread_local_context();
+		if (OXT_LIKELY(ctx != NULL)) {
+			ctx->backtrace_record_list[m_slot].source = source;
+			ctx->backtrace_record_list[m_slot].line = line;
+		}
+	}
 }
 
 
 tracable_exception::tracable_exception() {
 	thread_local_context *ctx = get_thread_local_context();
 	if (OXT_LIKELY(ctx != NULL)) {
-		spin_lock::scoped_lock l(ctx->backtrace_lock);
-		vector<trace_point *>::const_iterator it, end = ctx->backtrace_list.end();
-
-		backtrace_copy.reserve(ctx->backtrace_list.size());
-		for (it = ctx->backtrace_list.begin(); it != end; it++) {
+		unsigned int depth = std::min<unsigned int>(
+			ctx->backtrace_depth.load(boost::memory_order_acquire),
+			(unsigned int) thread_local_context::BACKTRACE_CAPACITY);
+		trace_point *const *begin = &ctx->backtrace_list[0];
+		trace_point *const *end = begin + depth;
+		trace_point *const *it;
+
+		backtrace_copy.reserve(depth);
+		for (it = begin; it != end; it++) {
 			trace_point *p;
 			if ((*it)->m_hasDataFunc) {
 				p = new trace_point(
@@ -313,6 +340,36 @@ format_backtrace(const Collection &backtrace_list) {
 	}
 }
 
+/* Like format_backtrace(), but over the by-value records that foreign
+ * threads are allowed to read. Data annotations aren't recorded (they
+ * may point into the owning thread's transient storage), so they don't
+ * appear here.
+ */
+static string
+format_backtrace_records(const vector<thread_local_context::trace_point_record> &records) {
+	if (records.empty()) {
+		return "     (empty)";
+	} else {
+		stringstream result;
+		vector<thread_local_context::trace_point_record>::const_reverse_iterator it;
+
+		for (it = records.rbegin(); it != records.rend(); it++) {
+			result << "     in '" << it->function << "'";
+			if (it->source != NULL) {
+				const char *source = strrchr(it->source, '/');
+				if (source != NULL) {
+					source++;
+				} else {
+					source = it->source;
+				}
+				result << " (" << source << ":" << it->line << ")";
+			}
+			result << endl;
+		}
+		return result.str();
+	}
+}
+
 string
 tracable_exception::backtrace() const throw() {
 	return format_backtrace< vector<trace_point *> >(backtrace_copy);
@@ -364,7 +421,7 @@ thread_local_context::thread_local_context()
 	#endif
 	syscall_interruption_lock.lock();
 	#ifdef OXT_BACKTRACE_IS_ENABLED
-		backtrace_list.reserve(50);
+		backtrace_depth.store(0, boost::memory_order_relaxed);
 	#endif
 }
 
@@ -431,8 +488,14 @@ thread::name() const throw() {
 std::string
 thread::backtrace() const throw() {
 	#ifdef OXT_BACKTRACE_IS_ENABLED
-		spin_lock::scoped_lock l(context->backtrace_lock);
-		return format_backtrace(context->backtrace_list);
+		thread_local_context *ctx = context.get();
+		std::vector<thread_local_context::trace_point_record> snapshot;
+		unsigned int depth = std::min<unsigned int>(
+			ctx->backtrace_depth.load(boost::memory_order_acquire),
+			(unsigned int) thread_local_context::BACKTRACE_CAPACITY);
+		snapshot.assign(&ctx->backtrace_record_list[0],
+			&ctx->backtrace_record_list[0] + depth);
+		return format_backtrace_records(snapshot);
 	#else
 		return "    (backtrace support disabled during compile time)";
 	#endif
@@ -458,8 +521,13 @@ thread::all_backtraces() throw() {
 				#endif
 				result << "):" << endl;
 
-				spin_lock::scoped_lock l(ctx->backtrace_lock);
-				std::string bt = format_backtrace(ctx->backtrace_list);
+				std::vector<thread_local_context::trace_point_record> snapshot;
+				unsigned int depth = std::min<unsigned int>(
+					ctx->backtrace_depth.load(boost::memory_order_acquire),
+					(unsigned int) thread_local_context::BACKTRACE_CAPACITY);
+				snapshot.assign(&ctx->backtrace_record_list[0],
+					&ctx->backtrace_record_list[0] + depth);
+				std::string bt = format_backtrace_records(snapshot);
 				result << bt;
 				if (bt.empty() || bt[bt.size() - 1] != '\n') {
 					result << endl;
@@ -480,8 +548,12 @@ thread::current_backtrace() throw() {
 	#ifdef OXT_BACKTRACE_IS_ENABLED
 		thread_local_context *ctx = get_thread_local_context();
 		if (OXT_LIKELY(ctx != NULL)) {
-			spin_lock::scoped_lock l(ctx->backtrace_lock);
-			return format_backtrace(ctx->backtrace_list);
+				std::vector<trace_point *> snapshot;
+			unsigned int depth = std::min<unsigned int>(
+				ctx->backtrace_depth.load(boost::memory_order_acquire),
+				(unsigned int) thread_local_context::BACKTRACE_CAPACITY);
+			snapshot.assign(&ctx->backtrace_list[0], &ctx->backtrace_list[0] + depth);
+			return format_backtrace(snapshot);
 		} else {
 			return "(OXT not initialized)";
 		}
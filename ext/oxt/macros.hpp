@@ -54,6 +54,18 @@
 	 */
 	#define OXT_FORCE_INLINE __attribute__((always_inline))
 
+	/**
+	 * Keep the given function out-of-line in profiling builds
+	 * (PASSENGER_PROFILING, set by the PROFILE=1 build flavor) so
+	 * that event-dispatch boundaries stay visible as stack frames in
+	 * perf output. Expands to nothing in normal builds.
+	 */
+	#ifdef PASSENGER_PROFILING
+		#define OXT_PROFILING_NOINLINE __attribute__((noinline))
+	#else
+		#define OXT_PROFILING_NOINLINE
+	#endif
+
 	#if __GNUC__ >= 4
 		#define OXT_RESTRICT __restrict__
 	#else
@@ -77,6 +89,7 @@
 	#define OXT_LIKELY(expr) expr
 	#define OXT_UNLIKELY(expr) expr
 	#define OXT_FORCE_INLINE
+	#define OXT_PROFILING_NOINLINE
 	#define restrict
 	#define restrict_ref
 #endif
@@ -115,6 +115,33 @@ shouldSimulateFailure() {
  * Passenger::syscalls
  *************************************/
 
+/*
+ * When OXT_DISABLE_SYSCALL_INTERRUPTION is defined, the oxt::syscalls
+ * wrappers degrade to plain EINTR-retry loops without any interruption
+ * bookkeeping (no thread-local context lookup and no spin lock
+ * acquisition around every call). Only build with this if nothing in
+ * the program relies on interrupting blocking system calls - thread
+ * shutdown in the agents does, so this is an experimentation/benchmark
+ * flag, not a production default.
+ */
+#ifdef OXT_DISABLE_SYSCALL_INTERRUPTION
+
+#define CHECK_INTERRUPTION(error_expression, allowSimulatingFailure, error_assignment, code) \
+	do { \
+		if (OXT_UNLIKELY(allowSimulatingFailure && shouldSimulateFailure())) { \
+			error_assignment; \
+			break; \
+		} \
+		int _my_errno; \
+		do { \
+			code; \
+			_my_errno = errno; \
+		} while ((error_expression) && _my_errno == EINTR); \
+		errno = _my_errno; \
+	} while (false)
+
+#else
+
 #define CHECK_INTERRUPTION(error_expression, allowSimulatingFailure, error_assignment, code) \
 	do { \
 		if (OXT_UNLIKELY(allowSimulatingFailure && shouldSimulateFailure())) { \
@@ -147,6 +174,8 @@ shouldSimulateFailure() {
 		errno = _my_errno; \
 	} while (false)
 
+#endif /* OXT_DISABLE_SYSCALL_INTERRUPTION */
+
 int
 syscalls::open(const char *path, int oflag) {
 	int ret;
@@ -72,6 +72,8 @@ module PhusionPassenger
     MESSAGE_SERVER_MAX_PASSWORD_SIZE = 100
     POOL_HELPER_THREAD_STACK_SIZE = 1024 * 256
     DEFAULT_MBUF_CHUNK_SIZE = 16 * 32
+    DEFAULT_MBUF_LARGE_CHUNK_SIZE = 1024 * 16
+    DEFAULT_FILE_BUFFERED_MEMORY_BUDGET = 64 * 1024 * 1024
     DEFAULT_FILE_BUFFERED_CHANNEL_THRESHOLD = 1024 * 128
     SERVER_KIT_MAX_SERVER_ENDPOINTS = 4
 
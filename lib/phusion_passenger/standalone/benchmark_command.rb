@@ -0,0 +1,213 @@
+#  Phusion Passenger - https://www.phusionpassenger.com/
+#  Copyright (c) 2015 Phusion
+#
+#  "Phusion Passenger" is a trademark of Hongli Lai & Ninh Bui.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy
+#  of this software and associated documentation files (the "Software"), to deal
+#  in the Software without restriction, including without limitation the rights
+#  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#  copies of the Software, and to permit persons to whom the Software is
+#  furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in
+#  all copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+#  THE SOFTWARE.
+
+require 'optparse'
+require 'socket'
+require 'fileutils'
+PhusionPassenger.require_passenger_lib 'constants'
+PhusionPassenger.require_passenger_lib 'standalone/command'
+PhusionPassenger.require_passenger_lib 'standalone/config_utils'
+
+module PhusionPassenger
+  module Standalone
+
+    # Boots a PassengerAgent in null-app benchmark mode and runs an
+    # embedded HTTP load generator against it, making agent-only proxy
+    # overhead measurements reproducible in one command. The agent's
+    # built-in `--benchmark after_accept` mode answers every request
+    # from the request handler itself, so no application or spawning is
+    # involved: the numbers isolate accept/parse/respond.
+    class BenchmarkCommand < Command
+      def run
+        @options = {
+          :port => 3100,
+          :duration => 10,
+          :concurrency => 8,
+          :threads => nil
+        }
+        parse_options
+        find_agent
+        begin
+          start_agent
+          report("keep-alive", run_load(true))
+          report("close per request", run_load(false))
+          print_agent_memory
+        ensure
+          stop_agent
+        end
+      end
+
+    private
+      def self.create_option_parser(options)
+        OptionParser.new do |opts|
+          nl = "\n" + ' ' * 37
+          opts.banner = "Usage: passenger benchmark [OPTIONS]\n"
+          opts.separator "Measures agent-only proxy throughput with the built-in null app."
+          opts.separator ""
+
+          opts.separator "Options:"
+          opts.on("-p", "--port NUMBER", Integer,
+            "Port to run the benchmark agent on.#{nl}" +
+            "Default: 3100") do |value|
+            options[:port] = value
+          end
+          opts.on("--duration SECONDS", Integer,
+            "Length of each load sweep. Default: 10") do |value|
+            options[:duration] = value
+          end
+          opts.on("--concurrency NUMBER", Integer,
+            "Concurrent load generator connections.#{nl}" +
+            "Default: 8") do |value|
+            options[:concurrency] = value
+          end
+          opts.on("--threads NUMBER", Integer,
+            "Agent worker threads. Default: the#{nl}" +
+            "agent's own default (CPU count)") do |value|
+            options[:threads] = value
+          end
+        end
+      end
+
+      def find_agent
+        @agent = PhusionPassenger.find_support_binary(AGENT_EXE)
+        if @agent.nil?
+          abort "ERROR: the #{AGENT_EXE} support binary could not be " +
+            "found. Build it with: rake buildout/support-binaries/#{AGENT_EXE}"
+        end
+      end
+
+      def start_agent
+        # Benchmark mode never contacts an app, but agent startup
+        # still autodetects one; point it at an empty Rack app in a
+        # temp dir.
+        require 'tmpdir'
+        @app_dir = Dir.mktmpdir("passenger-benchmark.")
+        File.open("#{@app_dir}/config.ru", "w") do |f|
+          f.write("run proc {}\n")
+        end
+
+        args = [@agent, "server",
+          "--passenger-root", PhusionPassenger.install_spec,
+          "--listen", "tcp://127.0.0.1:#{@options[:port]}",
+          "--benchmark", "after_accept"]
+        if @options[:threads]
+          args << "--threads" << @options[:threads].to_s
+        end
+        @agent_pid = Process.spawn(*args, :chdir => @app_dir,
+          :out => "/dev/null", :err => "/dev/null")
+        wait_until_agent_accepts
+      end
+
+      def wait_until_agent_accepts
+        deadline = Time.now + 10
+        begin
+          TCPSocket.new("127.0.0.1", @options[:port]).close
+        rescue SystemCallError
+          if Time.now > deadline
+            abort "ERROR: the benchmark agent did not come up within 10 seconds."
+          end
+          sleep 0.05
+          retry
+        end
+      end
+
+      def stop_agent
+        if @agent_pid
+          Process.kill("TERM", @agent_pid) rescue nil
+          Process.waitpid(@agent_pid) rescue nil
+        end
+        FileUtils.remove_entry_secure(@app_dir) if @app_dir
+      end
+
+      # A deliberately simple embedded generator: raw sockets, fixed
+      # concurrency, one counter and latency list per thread. It is not
+      # wrk, but it is always available, needs no dependencies, and is
+      # more than fast enough to saturate a single agent thread - which
+      # is what the sweeps compare.
+      def run_load(keepalive)
+        stop_at = Time.now + @options[:duration]
+        request = "GET / HTTP/1.1\r\nHost: benchmark\r\n" +
+          (keepalive ? "" : "Connection: close\r\n") + "\r\n"
+        threads = (1..@options[:concurrency]).map do
+          Thread.new do
+            count = 0
+            latencies = []
+            socket = nil
+            while Time.now < stop_at
+              begin
+                socket ||= TCPSocket.new("127.0.0.1", @options[:port])
+                started = Time.now
+                socket.write(request)
+                consume_response(socket)
+                latencies << (Time.now - started) * 1000
+                count += 1
+                if !keepalive
+                  socket.close
+                  socket = nil
+                end
+              rescue SystemCallError, IOError
+                socket.close rescue nil
+                socket = nil
+              end
+            end
+            socket.close rescue nil
+            [count, latencies]
+          end
+        end
+        counts = threads.map(&:value)
+        total = counts.map { |c| c[0] }.inject(0, :+)
+        latencies = counts.map { |c| c[1] }.flatten.sort
+        { :total => total, :latencies => latencies }
+      end
+
+      def consume_response(socket)
+        headers = socket.readline("\r\n\r\n")
+        if headers =~ /^Content-Length: (\d+)/i
+          socket.read($1.to_i)
+        end
+      end
+
+      def report(name, result)
+        latencies = result[:latencies]
+        pct = lambda do |p|
+          latencies.empty? ? 0 : latencies[(p / 100.0 * (latencies.size - 1)).floor]
+        end
+        puts "#{name}:"
+        puts "  Requests:    #{result[:total]} in #{@options[:duration]}s " +
+          "(#{result[:total] / @options[:duration]} req/s, " +
+          "#{@options[:concurrency]} connections)"
+        puts "  Latency p50: #{format('%.3f', pct.call(50))} ms"
+        puts "  Latency p99: #{format('%.3f', pct.call(99))} ms"
+        puts
+      end
+
+      def print_agent_memory
+        status = File.read("/proc/#{@agent_pid}/status") rescue nil
+        if status && status =~ /^VmRSS:\s+(\d+) kB/
+          puts "Agent peak RSS: #{$1.to_i / 1024} MB"
+        end
+      end
+    end
+
+  end # module Standalone
+end # module PhusionPassenger
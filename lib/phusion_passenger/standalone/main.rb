@@ -31,6 +31,7 @@ module PhusionPassenger
       ["start", "StartCommand"],
       ["stop", "StopCommand"],
       ["status", "StatusCommand"],
+      ["benchmark", "BenchmarkCommand"],
       ["version", "VersionCommand"]
     ]
 
@@ -62,6 +63,7 @@ module PhusionPassenger
       puts "  passenger start      Start #{PROGRAM_NAME} Standalone."
       puts "  passenger stop       Stop a #{PROGRAM_NAME} instance."
       puts "  passenger status     Show the status of a running #{PROGRAM_NAME} instance."
+      puts "  passenger benchmark  Measure agent-only proxy throughput with a null app."
       puts
       puts "Run 'passenger <COMMAND> --help' for more information about each command."
     end
@@ -26,6 +26,7 @@ namespace tut {
 			spawningKitConfig->finalize();
 
 			context.setSpawningKitFactory(boost::make_shared<SpawningKit::Factory>(spawningKitConfig));
+			context.initializeObjectPools(sizeof(Session), sizeof(Process));
 			context.finalize();
 
 			groupInfo.context = &context;
@@ -90,8 +91,9 @@ namespace tut {
 			result.adminSocket = adminSocket[0];
 			result.errorPipe = errorPipe[0];
 
-			ProcessPtr process(context.getProcessObjectPool().construct(
-				&groupInfo, result), false);
+			Process *p = (Process *) context.getProcessObjectPool().malloc();
+			p = new (p) Process(&groupInfo, result);
+			ProcessPtr process(p, false);
 			process->shutdownNotRequired();
 			return process;
 		}
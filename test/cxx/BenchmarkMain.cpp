@@ -0,0 +1,457 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2015 Phusion
+ *
+ *  "Phusion Passenger" is a trademark of Hongli Lai & Ninh Bui.
+ *
+ *  See LICENSE file for license information.
+ */
+
+/* Microbenchmarks for the ServerKit and MemoryKit primitives that sit
+ * on the request hot path. These are not correctness tests: they time
+ * tight loops over the primitives so that changes to the header parser,
+ * HeaderTable, LString or the mbuf pool can be measured instead of
+ * guessed at. Run through `rake benchmark:cxx`; pass --json for
+ * machine-readable output suitable for CI tracking.
+ *
+ * Each benchmark is auto-calibrated: the loop is repeated until it has
+ * run for at least MIN_MEASURE_TIME, so the reported per-iteration cost
+ * is averaged over enough work to drown out timer noise.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <ServerKit/http_parser.h>
+#include <ServerKit/HeaderTable.h>
+#include <MemoryKit/palloc.h>
+#include <Constants.h>
+#include <MemoryKit/mbuf.h>
+#include <DataStructures/LString.h>
+#include <DataStructures/HashedStaticString.h>
+#include <StaticString.h>
+
+using namespace Passenger;
+using namespace Passenger::ServerKit;
+using namespace std;
+
+static const unsigned long long MIN_MEASURE_TIME = 300000000ull; // 300 ms
+static bool jsonOutput = false;
+
+/* Process-wide allocation counting: malloc and friends are interposed
+ * (they forward to the real glibc implementations) so that each
+ * benchmark can report allocations per iteration, and so that the
+ * allocation-free invariants of the hot path can be asserted. This is
+ * the compiled-in equivalent of an LD_PRELOAD counter and only exists
+ * in this binary.
+ */
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t nmemb, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static volatile unsigned long long allocationCount = 0;
+
+extern "C" void *
+malloc(size_t size) {
+	allocationCount++;
+	return __libc_malloc(size);
+}
+
+extern "C" void *
+calloc(size_t nmemb, size_t size) {
+	allocationCount++;
+	return __libc_calloc(nmemb, size);
+}
+
+extern "C" void *
+realloc(void *ptr, size_t size) {
+	allocationCount++;
+	return __libc_realloc(ptr, size);
+}
+
+extern "C" void
+free(void *ptr) {
+	__libc_free(ptr);
+}
+
+static unsigned int budgetViolations = 0;
+
+/* Asserts that one run of `body` performs at most `budget` allocations.
+ * These budgets are living documentation of the fast path: a change
+ * that makes an allocation-free primitive allocate fails the
+ * benchmark run.
+ */
+template<typename Body>
+static void
+checkAllocationBudget(const char *name, unsigned long long budget,
+	const Body &body)
+{
+	unsigned long long before = allocationCount;
+	body();
+	unsigned long long used = allocationCount - before;
+
+	if (!jsonOutput) {
+		printf("%-40s %12llu allocs (budget %llu): %s\n", name,
+			used, budget, (used <= budget) ? "OK" : "EXCEEDED");
+	}
+	if (used > budget) {
+		budgetViolations++;
+	}
+}
+
+
+static unsigned long long
+monotonicNanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+struct BenchmarkResult {
+	string name;
+	unsigned long long iterations;
+	unsigned long long totalNanos;
+	unsigned long long bytesPerIteration;
+};
+
+static vector<BenchmarkResult> results;
+
+static void
+report(const string &name, unsigned long long iterations,
+	unsigned long long totalNanos, unsigned long long bytesPerIteration = 0)
+{
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = iterations;
+	result.totalNanos = totalNanos;
+	result.bytesPerIteration = bytesPerIteration;
+	results.push_back(result);
+
+	if (!jsonOutput) {
+		double nsPerIter = (double) totalNanos / iterations;
+		printf("%-40s %12llu iters %10.1f ns/iter", name.c_str(),
+			iterations, nsPerIter);
+		if (bytesPerIteration > 0) {
+			double mbPerSec = (double) bytesPerIteration * iterations
+				/ ((double) totalNanos / 1000000000.0) / (1024.0 * 1024.0);
+			printf(" %10.1f MB/s", mbPerSec);
+		}
+		printf("\n");
+	}
+}
+
+/* Runs `body` in a calibrated loop. `body` is a callable taking the
+ * iteration count for one batch and returning the number of iterations
+ * actually performed (so a batch can do several operations per call).
+ */
+template<typename Body>
+static void
+runBenchmark(const string &name, unsigned long long bytesPerIteration,
+	const Body &body)
+{
+	unsigned long long batch = 1024;
+	unsigned long long iterations = 0;
+	unsigned long long start = monotonicNanos();
+	unsigned long long now = start;
+
+	while (now - start < MIN_MEASURE_TIME) {
+		iterations += body(batch);
+		now = monotonicNanos();
+	}
+	report(name, iterations, now - start, bytesPerIteration);
+}
+
+
+/***** HTTP header parsing throughput *****/
+
+/* A realistic browser request: enough headers to exercise the bulk
+ * token/value scanning, with values of mixed lengths.
+ */
+static const char REQUEST_CORPUS[] =
+	"GET /products/4521/reviews?page=2&sort=helpful HTTP/1.1\r\n"
+	"Host: shop.example.com\r\n"
+	"Connection: keep-alive\r\n"
+	"Cache-Control: max-age=0\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,*/*;q=0.8\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+		"(KHTML, like Gecko) Chrome/40.0.2214.115 Safari/537.36\r\n"
+	"Accept-Encoding: gzip, deflate, sdch\r\n"
+	"Accept-Language: en-US,en;q=0.8,nl;q=0.6\r\n"
+	"Referer: https://shop.example.com/products/4521\r\n"
+	"Cookie: session=1caf9a3b2c4d5e6f708192a3b4c5d6e7; cart=9182736450; "
+		"_ga=GA1.2.1188261866.1423310541; _tracking=eyJhIjoxLCJiIjoyfQ\r\n"
+	"\r\n";
+
+static size_t parsedBytes;
+
+static int
+countData(http_parser *parser, const char *data, size_t len) {
+	parsedBytes += len;
+	return 0;
+}
+
+static int
+noopCallback(http_parser *parser) {
+	return 0;
+}
+
+static int
+onMessageComplete(http_parser *parser) {
+	http_parser_pause(parser, 1);
+	return 0;
+}
+
+static void
+benchmarkHttpParser(bool bytewise) {
+	http_parser parser;
+	http_parser_settings settings;
+	const size_t size = sizeof(REQUEST_CORPUS) - 1;
+
+	memset(&settings, 0, sizeof(settings));
+	settings.on_url = countData;
+	settings.on_header_field = countData;
+	settings.on_header_value = countData;
+	settings.on_message_begin = noopCallback;
+	settings.on_headers_complete = noopCallback;
+	settings.on_message_complete = onMessageComplete;
+
+	runBenchmark(
+		bytewise ? "http_parser request (bytewise feed)"
+			: "http_parser request (whole buffer)",
+		size,
+		[&parser, &settings, size, bytewise](unsigned long long batch)
+			-> unsigned long long
+		{
+			for (unsigned long long i = 0; i < batch; i++) {
+				http_parser_init(&parser, HTTP_REQUEST);
+				if (bytewise) {
+					for (size_t j = 0; j < size; j++) {
+						http_parser_execute(&parser, &settings,
+							REQUEST_CORPUS + j, 1);
+						if (HTTP_PARSER_ERRNO(&parser) == HPE_PAUSED) {
+							break;
+						}
+					}
+				} else {
+					http_parser_execute(&parser, &settings,
+						REQUEST_CORPUS, size);
+				}
+			}
+			return batch;
+		});
+}
+
+
+/***** HeaderTable insert/lookup *****/
+
+static const char *BENCH_HEADER_KEYS[] = {
+	"host", "connection", "cache-control", "accept",
+	"upgrade-insecure-requests", "user-agent", "accept-encoding",
+	"accept-language", "referer", "cookie", "x-request-id",
+	"x-forwarded-for"
+};
+static const unsigned int NUM_BENCH_HEADERS =
+	sizeof(BENCH_HEADER_KEYS) / sizeof(const char *);
+
+static Header *
+createBenchHeader(psg_pool_t *pool, const HashedStaticString &key) {
+	Header *header = (Header *) psg_palloc(pool, sizeof(Header));
+	psg_lstr_init(&header->key);
+	psg_lstr_init(&header->val);
+	psg_lstr_append(&header->key, pool, key.data(), key.size());
+	psg_lstr_append(&header->val, pool, "benchmark value", 15);
+	header->hash = key.hash();
+	return header;
+}
+
+static void
+benchmarkHeaderTable() {
+	vector<HashedStaticString> keys;
+	for (unsigned int i = 0; i < NUM_BENCH_HEADERS; i++) {
+		keys.push_back(HashedStaticString(BENCH_HEADER_KEYS[i],
+			strlen(BENCH_HEADER_KEYS[i])));
+	}
+	HashedStaticString missKey("x-definitely-not-present", 24);
+
+	runBenchmark("HeaderTable insert (12 headers)", 0,
+		[&keys](unsigned long long batch) -> unsigned long long {
+			for (unsigned long long i = 0; i < batch; i++) {
+				psg_pool_t *pool = psg_create_pool(PSG_DEFAULT_POOL_SIZE);
+				HeaderTable table;
+				for (unsigned int j = 0; j < NUM_BENCH_HEADERS; j++) {
+					Header *header = createBenchHeader(pool, keys[j]);
+					table.insert(&header, pool);
+				}
+				psg_destroy_pool(pool);
+			}
+			return batch;
+		});
+
+	psg_pool_t *pool = psg_create_pool(PSG_DEFAULT_POOL_SIZE);
+	HeaderTable table;
+	for (unsigned int j = 0; j < NUM_BENCH_HEADERS; j++) {
+		Header *header = createBenchHeader(pool, keys[j]);
+		table.insert(&header, pool);
+	}
+
+	runBenchmark("HeaderTable lookup hit", 0,
+		[&table, &keys](unsigned long long batch) -> unsigned long long {
+			for (unsigned long long i = 0; i < batch; i++) {
+				if (table.lookup(keys[i % NUM_BENCH_HEADERS]) == NULL) {
+					abort();
+				}
+			}
+			return batch;
+		});
+
+	runBenchmark("HeaderTable lookup miss", 0,
+		[&table, &missKey](unsigned long long batch) -> unsigned long long {
+			for (unsigned long long i = 0; i < batch; i++) {
+				if (table.lookup(missKey) != NULL) {
+					abort();
+				}
+			}
+			return batch;
+		});
+
+	psg_destroy_pool(pool);
+}
+
+
+/***** LString operations *****/
+
+static void
+benchmarkLString() {
+	runBenchmark("LString append x8 + make_contiguous", 0,
+		[](unsigned long long batch) -> unsigned long long {
+			psg_pool_t *pool = psg_create_pool(PSG_DEFAULT_POOL_SIZE);
+			for (unsigned long long i = 0; i < batch; i++) {
+				LString *str = (LString *) psg_palloc(pool, sizeof(LString));
+				psg_lstr_init(str);
+				for (unsigned int j = 0; j < 8; j++) {
+					psg_lstr_append(str, pool, "fragment", 8);
+				}
+				psg_lstr_make_contiguous(str, pool);
+				if (i % 1024 == 1023) {
+					psg_reset_pool(pool, PSG_DEFAULT_POOL_SIZE);
+				}
+			}
+			psg_destroy_pool(pool);
+			return batch;
+		});
+}
+
+
+/***** mbuf get/put *****/
+
+static void
+benchmarkMbuf() {
+	MemoryKit::mbuf_pool pool;
+
+	pool.mbuf_block_chunk_size = DEFAULT_MBUF_CHUNK_SIZE;
+	MemoryKit::mbuf_pool_init(&pool);
+	MemoryKit::mbuf_pool_init_size_classes(&pool, 0,
+		DEFAULT_MBUF_LARGE_CHUNK_SIZE);
+
+	runBenchmark("mbuf get/put (default class)", 0,
+		[&pool](unsigned long long batch) -> unsigned long long {
+			for (unsigned long long i = 0; i < batch; i++) {
+				MemoryKit::mbuf buf(MemoryKit::mbuf_get(&pool));
+			}
+			return batch;
+		});
+
+	runBenchmark("mbuf get/put (large class)", 0,
+		[&pool](unsigned long long batch) -> unsigned long long {
+			for (unsigned long long i = 0; i < batch; i++) {
+				MemoryKit::mbuf buf(MemoryKit::mbuf_get_with_size(&pool, 16384));
+			}
+			return batch;
+		});
+
+	MemoryKit::mbuf_pool_deinit(&pool);
+}
+
+
+/***** Main *****/
+
+static void
+printJson() {
+	printf("{\n  \"benchmarks\": [\n");
+	for (unsigned int i = 0; i < results.size(); i++) {
+		const BenchmarkResult &r = results[i];
+		double nsPerIter = (double) r.totalNanos / r.iterations;
+		printf("    {\"name\": \"%s\", \"iterations\": %llu, "
+			"\"ns_per_iteration\": %.1f",
+			r.name.c_str(), r.iterations, nsPerIter);
+		if (r.bytesPerIteration > 0) {
+			double mbPerSec = (double) r.bytesPerIteration * r.iterations
+				/ ((double) r.totalNanos / 1000000000.0) / (1024.0 * 1024.0);
+			printf(", \"mb_per_second\": %.1f", mbPerSec);
+		}
+		printf("}%s\n", (i == results.size() - 1) ? "" : ",");
+	}
+	printf("  ]\n}\n");
+}
+
+int
+main(int argc, char *argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--json") == 0) {
+			jsonOutput = true;
+		} else {
+			fprintf(stderr, "Usage: Benchmarks [--json]\n");
+			return 1;
+		}
+	}
+
+	benchmarkHttpParser(false);
+	benchmarkHttpParser(true);
+	benchmarkHeaderTable();
+	benchmarkLString();
+	benchmarkMbuf();
+
+	if (!jsonOutput) {
+		printf("\nAllocation budgets:\n");
+	}
+	checkAllocationBudget("http_parser parse request", 0, [] {
+		http_parser parser;
+		http_parser_settings settings;
+		memset(&settings, 0, sizeof(settings));
+		http_parser_init(&parser, HTTP_REQUEST);
+		http_parser_execute(&parser, &settings, REQUEST_CORPUS,
+			sizeof(REQUEST_CORPUS) - 1);
+	});
+	{
+		// Warm the freelist first: the steady state must be
+		// allocation-free, the first get legitimately allocates.
+		MemoryKit::mbuf_pool pool;
+		pool.mbuf_block_chunk_size = DEFAULT_MBUF_CHUNK_SIZE;
+		MemoryKit::mbuf_pool_init(&pool);
+		{
+			MemoryKit::mbuf warmup(MemoryKit::mbuf_get(&pool));
+		}
+		checkAllocationBudget("mbuf get/put steady state", 0, [&pool] {
+			for (unsigned int i = 0; i < 64; i++) {
+				MemoryKit::mbuf buf(MemoryKit::mbuf_get(&pool));
+			}
+		});
+		MemoryKit::mbuf_pool_deinit(&pool);
+	}
+
+	if (jsonOutput) {
+		printJson();
+	}
+	if (budgetViolations > 0) {
+		fprintf(stderr, "ERROR: %u allocation budget(s) exceeded.\n",
+			budgetViolations);
+		return 1;
+	}
+	return 0;
+}
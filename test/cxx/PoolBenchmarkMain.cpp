@@ -0,0 +1,232 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2015 Phusion
+ *
+ *  "Phusion Passenger" is a trademark of Hongli Lai & Ninh Bui.
+ *
+ *  See LICENSE file for license information.
+ */
+
+/* Pool contention simulator: drives Pool::get() from N synthetic
+ * threads against DummySpawner-backed groups, so pool locking and
+ * scheduling changes can be validated without real applications.
+ * Reports checkout latency percentiles, throughput, and the pool's
+ * own checkout lock statistics. Run through `rake benchmark:pool`,
+ * e.g.:
+ *
+ *   rake benchmark:pool OPTS="--threads 16 --groups 8 --spawn-time-ms 100"
+ *
+ * Spawn times are configurable so that both the steady state (all
+ * processes up, pure checkout contention) and the cold start (get
+ * waitlist, spawn scheduling) can be exercised; the warmup phase is
+ * excluded from the reported percentiles.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <signal.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <boost/make_shared.hpp>
+#include <oxt/thread.hpp>
+#include <oxt/initialize.hpp>
+#include <oxt/system_calls.hpp>
+
+#include <ApplicationPool2/Pool.h>
+#include <SpawningKit/Factory.h>
+#include <ResourceLocator.h>
+#include <Utils/SystemTime.h>
+#include <Logging.h>
+
+using namespace std;
+using namespace Passenger;
+using namespace Passenger::ApplicationPool2;
+
+struct SimulationConfig {
+	unsigned int threads;
+	unsigned int groups;
+	unsigned int spawnTimeMs;
+	unsigned int requestsPerThread;
+	unsigned int maxPoolSize;
+	unsigned int concurrency;
+	unsigned int workTimeUs;
+
+	SimulationConfig()
+		: threads(8),
+		  groups(4),
+		  spawnTimeMs(20),
+		  requestsPerThread(5000),
+		  maxPoolSize(12),
+		  concurrency(4),
+		  workTimeUs(0)
+		{ }
+};
+
+static SimulationConfig simConfig;
+static PoolPtr benchmarkPool;
+
+struct WorkerResult {
+	vector<unsigned long long> latenciesUsec;
+	unsigned long long errors;
+
+	WorkerResult()
+		: errors(0)
+		{ }
+};
+
+static Options
+createOptions(unsigned int group) {
+	Options options;
+	options.spawnMethod = "dummy";
+	options.appRoot = "stub/benchmark-" + toString(group);
+	options.appGroupName = "benchmark-" + toString(group);
+	options.startCommand = "true";
+	options.startupFile = "none";
+	options.loadShellEnvvars = false;
+	options.user = "nobody";
+	options.defaultUser = "nobody";
+	options.defaultGroup = "nogroup";
+	options.minProcesses = 1;
+	return options;
+}
+
+static void
+workerMain(unsigned int threadNumber, WorkerResult *result) {
+	Ticket ticket;
+	result->latenciesUsec.reserve(simConfig.requestsPerThread);
+
+	for (unsigned int i = 0; i < simConfig.requestsPerThread; i++) {
+		unsigned int group = (threadNumber + i) % simConfig.groups;
+		Options options = createOptions(group);
+
+		unsigned long long start = SystemTime::getMonotonicUsec();
+		try {
+			SessionPtr session = benchmarkPool->get(options, &ticket);
+			result->latenciesUsec.push_back(
+				SystemTime::getMonotonicUsec() - start);
+			if (simConfig.workTimeUs > 0) {
+				syscalls::usleep(simConfig.workTimeUs);
+			}
+			session.reset();
+		} catch (const tracable_exception &e) {
+			result->errors++;
+		}
+	}
+}
+
+static unsigned long long
+percentile(vector<unsigned long long> &sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t index = (size_t) (p / 100.0 * (sorted.size() - 1));
+	return sorted[index];
+}
+
+static void
+usage() {
+	printf("Usage: PoolBenchmark [OPTIONS]\n");
+	printf("  --threads N           Synthetic client threads (default: 8)\n");
+	printf("  --groups N            Distinct app groups (default: 4)\n");
+	printf("  --spawn-time-ms N     Simulated spawn time (default: 20)\n");
+	printf("  --requests N          Requests per thread (default: 5000)\n");
+	printf("  --max-pool-size N     Pool capacity (default: 12)\n");
+	printf("  --concurrency N       Per-process concurrency (default: 4)\n");
+	printf("  --work-time-us N      Simulated request work while holding\n");
+	printf("                        the session (default: 0)\n");
+}
+
+int
+main(int argc, char *argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			simConfig.threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--groups") == 0 && i + 1 < argc) {
+			simConfig.groups = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--spawn-time-ms") == 0 && i + 1 < argc) {
+			simConfig.spawnTimeMs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+			simConfig.requestsPerThread = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--max-pool-size") == 0 && i + 1 < argc) {
+			simConfig.maxPoolSize = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+			simConfig.concurrency = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--work-time-us") == 0 && i + 1 < argc) {
+			simConfig.workTimeUs = atoi(argv[++i]);
+		} else {
+			usage();
+			return (strcmp(argv[i], "--help") == 0
+				|| strcmp(argv[i], "-h") == 0) ? 0 : 1;
+		}
+	}
+
+	oxt::initialize();
+	oxt::setup_syscall_interruption_support();
+	signal(SIGPIPE, SIG_IGN);
+	setLogLevel(LVL_WARN);
+
+	ResourceLocator resourceLocator(".");
+	SpawningKit::ConfigPtr spawningKitConfig =
+		boost::make_shared<SpawningKit::Config>();
+	spawningKitConfig->resourceLocator = &resourceLocator;
+	spawningKitConfig->concurrency = simConfig.concurrency;
+	spawningKitConfig->spawnTime = simConfig.spawnTimeMs * 1000;
+	spawningKitConfig->finalize();
+
+	SpawningKit::FactoryPtr spawningKitFactory =
+		boost::make_shared<SpawningKit::Factory>(spawningKitConfig);
+	benchmarkPool = boost::make_shared<Pool>(spawningKitFactory);
+	benchmarkPool->initialize();
+	benchmarkPool->setMax(simConfig.maxPoolSize);
+
+	printf("Simulating: %u threads x %u requests, %u groups, "
+		"spawn %u ms, pool size %u, concurrency %u\n",
+		simConfig.threads, simConfig.requestsPerThread, simConfig.groups,
+		simConfig.spawnTimeMs, simConfig.maxPoolSize, simConfig.concurrency);
+
+	vector<WorkerResult> results(simConfig.threads);
+	vector<oxt::thread *> threads;
+	unsigned long long start = SystemTime::getMonotonicUsec();
+
+	for (unsigned int i = 0; i < simConfig.threads; i++) {
+		threads.push_back(new oxt::thread(
+			boost::bind(workerMain, i, &results[i]),
+			"Worker " + toString(i), 1024 * 512));
+	}
+	for (unsigned int i = 0; i < simConfig.threads; i++) {
+		threads[i]->join();
+		delete threads[i];
+	}
+
+	unsigned long long totalUsec = SystemTime::getMonotonicUsec() - start;
+
+	vector<unsigned long long> all;
+	unsigned long long errors = 0;
+	for (unsigned int i = 0; i < simConfig.threads; i++) {
+		all.insert(all.end(), results[i].latenciesUsec.begin(),
+			results[i].latenciesUsec.end());
+		errors += results[i].errors;
+	}
+	sort(all.begin(), all.end());
+
+	printf("\nCheckouts:       %llu (%llu errors)\n",
+		(unsigned long long) all.size(), errors);
+	printf("Throughput:      %.0f checkouts/sec\n",
+		(double) all.size() / ((double) totalUsec / 1000000.0));
+	printf("Latency p50:     %llu us\n", percentile(all, 50));
+	printf("Latency p90:     %llu us\n", percentile(all, 90));
+	printf("Latency p99:     %llu us\n", percentile(all, 99));
+	printf("Latency max:     %llu us\n", all.empty() ? 0 : all.back());
+	printf("Lock stats:      %llu acquisitions, %llu contended\n",
+		(unsigned long long) benchmarkPool->checkoutLockAcquisitions.load(
+			boost::memory_order_relaxed),
+		(unsigned long long) benchmarkPool->checkoutLockContentions.load(
+			boost::memory_order_relaxed));
+
+	benchmarkPool->destroy();
+	benchmarkPool.reset();
+	return 0;
+}
@@ -525,4 +525,283 @@ namespace tut {
 		ResponseCacheType::Entry entry2(responseCache.fetch(&req, time(NULL)));
 		ensure("(22)", !entry2.valid());
 	}
+
+	struct ThreadSafeCacheHammerContext {
+		ResponseCacheType *cache;
+		unsigned int writerId;
+		bool corruptionSeen;
+		boost::atomic<bool> *quit;
+	};
+
+	static void hammerThreadSafeCacheWriter(ThreadSafeCacheHammerContext *ctx) {
+		ResponseCacheTest helper;
+		string responseHeadersStr =
+			"content-length: 64\r\n"
+			"cache-control: public,max-age=99999\r\n";
+
+		while (!ctx->quit->load(boost::memory_order_relaxed)) {
+			psg_reset_pool(helper.req.pool, PSG_DEFAULT_POOL_SIZE);
+			helper.reset();
+			helper.initCacheableResponse();
+			helper.initResponseBody(string(64, 'x'));
+			if (!ctx->cache->prepareRequest(&helper, &helper.req)
+			 || !ctx->cache->prepareRequestForStoring(&helper.req))
+			{
+				continue;
+			}
+			ResponseCacheType::Entry entry(ctx->cache->store(&helper.req,
+				time(NULL), responseHeadersStr.size(), 64));
+			if (entry.valid()) {
+				// Fill header and body with a marker unique to this
+				// writer, like storeAppResponseInTurboCache() does,
+				// then publish.
+				memset(entry.body->httpHeaderData, 'A' + ctx->writerId,
+					responseHeadersStr.size());
+				memset(entry.body->httpBodyData, 'A' + ctx->writerId, 64);
+				ctx->cache->commitStore(entry);
+			}
+		}
+	}
+
+	static void hammerThreadSafeCacheReader(ThreadSafeCacheHammerContext *ctx) {
+		ResponseCacheTest helper;
+
+		while (!ctx->quit->load(boost::memory_order_relaxed)) {
+			psg_reset_pool(helper.req.pool, PSG_DEFAULT_POOL_SIZE);
+			helper.reset();
+			if (!ctx->cache->prepareRequest(&helper, &helper.req)) {
+				continue;
+			}
+			ResponseCacheType::Entry entry(ctx->cache->fetch(&helper.req,
+				time(NULL)));
+			if (entry.valid()) {
+				// A snapshot must be self-consistent: all bytes carry
+				// the same writer marker.
+				char marker = entry.body->httpBodyData[0];
+				for (unsigned int i = 0; i < entry.body->httpBodySize; i++) {
+					if (entry.body->httpBodyData[i] != marker) {
+						ctx->corruptionSeen = true;
+						return;
+					}
+				}
+				for (unsigned int i = 0; i < entry.body->httpHeaderSize; i++) {
+					if (entry.body->httpHeaderData[i] != marker) {
+						ctx->corruptionSeen = true;
+						return;
+					}
+				}
+			}
+		}
+	}
+
+	TEST_METHOD(63) {
+		set_test_name("Thread-safe mode: concurrent readers always see "
+			"self-consistent snapshots");
+		ResponseCacheType sharedCache(4, 1024, true);
+		boost::atomic<bool> quit(false);
+		ThreadSafeCacheHammerContext contexts[4];
+		oxt::thread *threads[4];
+
+		for (unsigned int i = 0; i < 4; i++) {
+			contexts[i].cache = &sharedCache;
+			contexts[i].writerId = i;
+			contexts[i].corruptionSeen = false;
+			contexts[i].quit = &quit;
+		}
+		threads[0] = new oxt::thread(boost::bind(hammerThreadSafeCacheWriter, &contexts[0]));
+		threads[1] = new oxt::thread(boost::bind(hammerThreadSafeCacheWriter, &contexts[1]));
+		threads[2] = new oxt::thread(boost::bind(hammerThreadSafeCacheReader, &contexts[2]));
+		threads[3] = new oxt::thread(boost::bind(hammerThreadSafeCacheReader, &contexts[3]));
+
+		syscalls::usleep(500000);
+		quit.store(true);
+		for (unsigned int i = 0; i < 4; i++) {
+			threads[i]->join();
+			delete threads[i];
+		}
+
+		ensure("no torn reads", !contexts[2].corruptionSeen && !contexts[3].corruptionSeen);
+	}
+
+	TEST_METHOD(64) {
+		set_test_name("stale-while-revalidate: one request revalidates, "
+			"others get the stale entry");
+		string responseHeadersStr =
+			"content-length: 5\r\n"
+			"cache-control: public,max-age=1,stale-while-revalidate=60\r\n";
+		string responseBodyStr = "hello";
+		time_t now = time(NULL);
+
+		insertAppResponseHeader(createHeader(
+			"cache-control", "public,max-age=1,stale-while-revalidate=60"),
+			req.pool);
+		initResponseBody(responseBodyStr);
+		ensure("(1)", responseCache.prepareRequest(this, &req));
+		ensure("(2)", responseCache.requestAllowsStoring(&req));
+		ensure("(3)", responseCache.prepareRequestForStoring(&req));
+		ResponseCacheType::Entry entry(responseCache.store(&req, now,
+			responseHeadersStr.size(), responseBodyStr.size()));
+		ensure("(4)", entry.valid());
+
+		// Still fresh.
+		reset();
+		ensure("(10)", responseCache.prepareRequest(this, &req));
+		ResponseCacheType::Entry entry2(responseCache.fetch(&req, now));
+		ensure("(11)", entry2.valid());
+		ensure("(12)", !entry2.stale);
+
+		// Expired, but within the stale-while-revalidate window:
+		// the first fetch claims the revalidation and gets a miss...
+		reset();
+		ensure("(20)", responseCache.prepareRequest(this, &req));
+		ResponseCacheType::Entry entry3(responseCache.fetch(&req, now + 5));
+		ensure("(21)", !entry3.valid());
+
+		// ...while subsequent fetches are served the stale copy.
+		reset();
+		ensure("(30)", responseCache.prepareRequest(this, &req));
+		ResponseCacheType::Entry entry4(responseCache.fetch(&req, now + 5));
+		ensure("(31)", entry4.valid());
+		ensure("(32)", entry4.stale);
+	}
+
+	TEST_METHOD(65) {
+		set_test_name("stale-while-revalidate: entries past the window "
+			"are normal misses");
+		string responseHeadersStr =
+			"content-length: 5\r\n"
+			"cache-control: public,max-age=1,stale-while-revalidate=10\r\n";
+		string responseBodyStr = "hello";
+		time_t now = time(NULL);
+
+		insertAppResponseHeader(createHeader(
+			"cache-control", "public,max-age=1,stale-while-revalidate=10"),
+			req.pool);
+		initResponseBody(responseBodyStr);
+		ensure("(1)", responseCache.prepareRequest(this, &req));
+		ensure("(2)", responseCache.requestAllowsStoring(&req));
+		ensure("(3)", responseCache.prepareRequestForStoring(&req));
+		ResponseCacheType::Entry entry(responseCache.store(&req, now,
+			responseHeadersStr.size(), responseBodyStr.size()));
+		ensure("(4)", entry.valid());
+
+		reset();
+		ensure("(10)", responseCache.prepareRequest(this, &req));
+		ResponseCacheType::Entry entry2(responseCache.fetch(&req, now + 60));
+		ensure("(11)", !entry2.valid());
+
+		reset();
+		ensure("(20)", responseCache.prepareRequest(this, &req));
+		ResponseCacheType::Entry entry3(responseCache.fetch(&req, now + 60));
+		ensure("(21)", !entry3.valid());
+	}
+
+	TEST_METHOD(66) {
+		set_test_name("File tier: bodies above the in-memory limit are "
+			"stored in and served from cache files");
+		ResponseCacheType fileCache(4, 16, false, 1024, "tmp.turbocache");
+		string responseHeadersStr =
+			"content-length: 64\r\n"
+			"cache-control: public,max-age=99999\r\n";
+		string responseBodyStr(64, 'z');
+
+		initCacheableResponse();
+		initResponseBody(responseBodyStr);
+		ensure("(1)", fileCache.prepareRequest(this, &req));
+		ensure("(2)", fileCache.requestAllowsStoring(&req));
+		ensure("(3)", fileCache.prepareRequestForStoring(&req));
+		ResponseCacheType::Entry entry(fileCache.store(&req, time(NULL),
+			responseHeadersStr.size(), responseBodyStr.size()));
+		ensure("(4)", entry.valid());
+		ensure("(5) body goes to the file tier", entry.body->bodyInFile);
+
+		LString bodyBuffer;
+		psg_lstr_init(&bodyBuffer);
+		psg_lstr_append(&bodyBuffer, req.pool, responseBodyStr.data(),
+			responseBodyStr.size());
+		ensure("(6)", fileCache.storeBodyToFile(entry, &bodyBuffer));
+		fileCache.commitStore(entry);
+
+		reset();
+		ensure("(10)", fileCache.prepareRequest(this, &req));
+		ResponseCacheType::Entry entry2(fileCache.fetch(&req, time(NULL)));
+		ensure("(11)", entry2.valid());
+		ensure("(12)", entry2.body->bodyInFile);
+		ensure_equals("(13)", entry2.body->httpBodySize, 64u);
+
+		char readBack[64];
+		ensure("(14)", fileCache.readBodyFromFile(entry2, readBack, 64));
+		ensure("(15)", memcmp(readBack, responseBodyStr.data(), 64) == 0);
+
+		unlink("tmp.turbocache/body-0");
+		rmdir("tmp.turbocache");
+	}
+
+	TEST_METHOD(67) {
+		set_test_name("Vary: variants by Accept-Encoding coexist");
+		string responseHeadersStr =
+			"content-length: 5\r\n"
+			"cache-control: public,max-age=99999\r\n"
+			"vary: Accept-Encoding\r\n";
+		string responseBodyStr = "hello";
+		time_t now = time(NULL);
+
+		// Store the gzip variant.
+		initCacheableResponse();
+		initResponseBody(responseBodyStr);
+		insertAppResponseHeader(createHeader("vary", "Accept-Encoding"), req.pool);
+		insertReqHeader(createHeader("accept-encoding", "gzip, deflate, br"), req.pool);
+		ensure("(1)", responseCache.prepareRequest(this, &req));
+		ensure("(2)", responseCache.requestAllowsStoring(&req));
+		ensure("(3)", responseCache.prepareRequestForStoring(&req));
+		ResponseCacheType::Entry gzipEntry(responseCache.store(&req, now,
+			responseHeadersStr.size(), responseBodyStr.size()));
+		ensure("(4)", gzipEntry.valid());
+		responseCache.commitStore(gzipEntry);
+
+		// A request with a cosmetically different Accept-Encoding value
+		// hits the gzip variant.
+		reset();
+		insertReqHeader(createHeader("accept-encoding", "gzip,deflate"), req.pool);
+		ensure("(10)", responseCache.prepareRequest(this, &req));
+		ResponseCacheType::Entry hit(responseCache.fetch(&req, now));
+		ensure("(11)", hit.valid());
+
+		// A request without Accept-Encoding misses (identity variant
+		// not stored yet)...
+		reset();
+		ensure("(20)", responseCache.prepareRequest(this, &req));
+		ResponseCacheType::Entry miss(responseCache.fetch(&req, now));
+		ensure("(21)", !miss.valid());
+
+		// ...and can store its own variant, which then coexists with
+		// the gzip one.
+		initCacheableResponse();
+		initResponseBody(responseBodyStr);
+		insertAppResponseHeader(createHeader("vary", "Accept-Encoding"), req.pool);
+		ensure("(22)", responseCache.prepareRequestForStoring(&req));
+		ResponseCacheType::Entry identityEntry(responseCache.store(&req, now,
+			responseHeadersStr.size(), responseBodyStr.size()));
+		ensure("(23)", identityEntry.valid());
+		ensure("(24) variants use distinct entries",
+			identityEntry.index != gzipEntry.index);
+		responseCache.commitStore(identityEntry);
+
+		reset();
+		insertReqHeader(createHeader("accept-encoding", "x-gzip, gzip"), req.pool);
+		ensure("(30)", responseCache.prepareRequest(this, &req));
+		ResponseCacheType::Entry hit2(responseCache.fetch(&req, now));
+		ensure("(31)", hit2.valid());
+		ensure_equals("(32)", hit2.index, gzipEntry.index);
+	}
+
+	TEST_METHOD(68) {
+		set_test_name("Vary: * remains uncacheable");
+		initCacheableResponse();
+		initResponseBody("hello");
+		insertAppResponseHeader(createHeader("vary", "*"), req.pool);
+		ensure("(1)", responseCache.prepareRequest(this, &req));
+		ensure("(2)", responseCache.requestAllowsStoring(&req));
+		ensure("(3)", !responseCache.prepareRequestForStoring(&req));
+	}
 }
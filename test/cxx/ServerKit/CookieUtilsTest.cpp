@@ -271,4 +271,40 @@ namespace tut {
 		ensure("(1)", result != NULL);
 		ensure("(2)", psg_lstr_cmp(result, &value));
 	}
+
+	TEST_METHOD(35) {
+		set_test_name("CookieIterator yields all name/value pairs");
+		CookieIterator it(P_STATIC_STRING("hello=world; foo=bar; a=b"));
+		StaticString cookieName, cookieValue;
+
+		ensure("(1)", it.next(cookieName, cookieValue));
+		ensure_equals("(2)", cookieName, P_STATIC_STRING("hello"));
+		ensure_equals("(3)", cookieValue, P_STATIC_STRING("world"));
+		ensure("(4)", it.next(cookieName, cookieValue));
+		ensure_equals("(5)", cookieName, P_STATIC_STRING("foo"));
+		ensure_equals("(6)", cookieValue, P_STATIC_STRING("bar"));
+		ensure("(7)", it.next(cookieName, cookieValue));
+		ensure_equals("(8)", cookieName, P_STATIC_STRING("a"));
+		ensure_equals("(9)", cookieValue, P_STATIC_STRING("b"));
+		ensure("(10)", !it.next(cookieName, cookieValue));
+	}
+
+	TEST_METHOD(36) {
+		set_test_name("CookieIterator on empty and degenerate headers");
+		StaticString cookieName, cookieValue;
+
+		CookieIterator empty(P_STATIC_STRING(""));
+		ensure("(1)", !empty.next(cookieName, cookieValue));
+
+		CookieIterator separatorsOnly(P_STATIC_STRING("; ; ;"));
+		ensure("(2)", !separatorsOnly.next(cookieName, cookieValue));
+
+		CookieIterator emptyValue(P_STATIC_STRING("foo=; a=b"));
+		ensure("(3)", emptyValue.next(cookieName, cookieValue));
+		ensure_equals("(4)", cookieName, P_STATIC_STRING("foo"));
+		ensure_equals("(5)", cookieValue, P_STATIC_STRING(""));
+		ensure("(6)", emptyValue.next(cookieName, cookieValue));
+		ensure_equals("(7)", cookieName, P_STATIC_STRING("a"));
+		ensure_equals("(8)", cookieValue, P_STATIC_STRING("b"));
+	}
 }
@@ -0,0 +1,252 @@
+#include <TestSupport.h>
+#include <ServerKit/http_parser.h>
+#include <Utils/IOUtils.h>
+#include <string>
+#include <vector>
+#include <dirent.h>
+
+using namespace Passenger;
+using namespace std;
+
+/* Differential corpus runner for the vendored (and locally modified)
+ * joyent HTTP parser. Every raw byte stream in
+ * test/cxx/ServerKit/http_corpus/ is parsed twice: fed as one whole
+ * buffer (which exercises the bulk scanning fast paths) and fed one
+ * byte at a time (the scalar reference path, since no fast path can
+ * span a feed boundary). The semantic output of both runs - the
+ * callback sequence, parsed element boundaries, flags and final error
+ * code - must be byte-identical. This makes "same semantics, faster"
+ * provable for parser optimizations, and catches silent behavior
+ * changes when the vendored parser is touched or upgraded.
+ *
+ * Corpus file naming: request_*.txt is parsed in HTTP_REQUEST mode,
+ * response_*.txt in HTTP_RESPONSE mode. Malformed inputs are corpus
+ * members too: for those, both runs must agree on the error.
+ */
+
+namespace tut {
+	struct ServerKit_HttpParserCorpusTest {
+		string trace;
+		const char *lastTag;
+
+		/* Consecutive data callbacks of the same kind are coalesced
+		 * into one trace segment: how the parser splits a URL or
+		 * header value across callbacks legitimately depends on feed
+		 * boundaries, only the concatenated bytes are semantic.
+		 */
+		static int traceData(http_parser *parser, const char *tag,
+			const char *data, size_t len)
+		{
+			ServerKit_HttpParserCorpusTest *self =
+				(ServerKit_HttpParserCorpusTest *) parser->data;
+			if (self->lastTag == tag && !self->trace.empty()) {
+				self->trace.erase(self->trace.size() - 1);
+			} else {
+				self->trace.append(tag);
+			}
+			self->trace.append(data, len);
+			self->trace.append("|");
+			self->lastTag = tag;
+			return 0;
+		}
+
+		static int onUrl(http_parser *parser, const char *data, size_t len) {
+			return traceData(parser, "U:", data, len);
+		}
+
+		static int onStatus(http_parser *parser, const char *data, size_t len) {
+			return traceData(parser, "S:", data, len);
+		}
+
+		static int onHeaderField(http_parser *parser, const char *data, size_t len) {
+			return traceData(parser, "F:", data, len);
+		}
+
+		static int onHeaderValue(http_parser *parser, const char *data, size_t len) {
+			return traceData(parser, "V:", data, len);
+		}
+
+		static int onBody(http_parser *parser, const char *data, size_t len) {
+			return traceData(parser, "B:", data, len);
+		}
+
+		static int onMessageBegin(http_parser *parser) {
+			ServerKit_HttpParserCorpusTest *self =
+				(ServerKit_HttpParserCorpusTest *) parser->data;
+			self->lastTag = NULL;
+			self->trace.append("BEGIN|");
+			return 0;
+		}
+
+		static int onHeadersComplete(http_parser *parser) {
+			ServerKit_HttpParserCorpusTest *self =
+				(ServerKit_HttpParserCorpusTest *) parser->data;
+			self->lastTag = NULL;
+			self->trace.append("HDRS(");
+			self->trace.append(toString(parser->http_major));
+			self->trace.append(".");
+			self->trace.append(toString(parser->http_minor));
+			self->trace.append(",m=");
+			self->trace.append(toString((int) parser->method));
+			self->trace.append(",s=");
+			self->trace.append(toString((int) parser->status_code));
+			self->trace.append(",u=");
+			self->trace.append(toString((int) parser->upgrade));
+			self->trace.append(")|");
+			return 0;
+		}
+
+		static int onMessageComplete(http_parser *parser) {
+			ServerKit_HttpParserCorpusTest *self =
+				(ServerKit_HttpParserCorpusTest *) parser->data;
+			self->lastTag = NULL;
+			self->trace.append("END(keepalive=");
+			self->trace.append(toString((int) http_should_keep_alive(parser)));
+			self->trace.append(")|");
+			return 0;
+		}
+
+		void initSettings(http_parser_settings &settings) {
+			memset(&settings, 0, sizeof(settings));
+			settings.on_message_begin = onMessageBegin;
+			settings.on_url = onUrl;
+			settings.on_status = onStatus;
+			settings.on_header_field = onHeaderField;
+			settings.on_header_value = onHeaderValue;
+			settings.on_headers_complete = onHeadersComplete;
+			settings.on_body = onBody;
+			settings.on_message_complete = onMessageComplete;
+		}
+
+		/* Parses `input` fed in chunks of `chunkSize` bytes (0 = the
+		 * whole buffer at once) and returns the semantic trace,
+		 * including the final parser error.
+		 */
+		string parse(const string &input, enum http_parser_type type,
+			size_t chunkSize)
+		{
+			http_parser parser;
+			http_parser_settings settings;
+			size_t pos = 0;
+
+			initSettings(settings);
+			http_parser_init(&parser, type);
+			parser.data = this;
+			trace.clear();
+			lastTag = NULL;
+
+			while (pos < input.size()) {
+				size_t len = (chunkSize == 0) ? input.size() - pos
+					: std::min(chunkSize, input.size() - pos);
+				size_t parsed = http_parser_execute(&parser, &settings,
+					input.data() + pos, len);
+				pos += parsed;
+				if (HTTP_PARSER_ERRNO(&parser) != HPE_OK) {
+					break;
+				}
+				if (parsed == 0) {
+					break;
+				}
+			}
+			if (HTTP_PARSER_ERRNO(&parser) == HPE_OK) {
+				// Signal EOF so body-until-EOF messages complete.
+				http_parser_execute(&parser, &settings, NULL, 0);
+			}
+
+			string result = trace;
+			result.append("ERRNO:");
+			result.append(http_errno_name(HTTP_PARSER_ERRNO(&parser)));
+			return result;
+		}
+
+		vector<string> listCorpusFiles(const string &prefix) {
+			vector<string> result;
+			DIR *dir = opendir("cxx/ServerKit/http_corpus");
+			struct dirent *entry;
+
+			ensure("corpus directory exists", dir != NULL);
+			while ((entry = readdir(dir)) != NULL) {
+				string name = entry->d_name;
+				if (name.size() > prefix.size()
+				 && name.compare(0, prefix.size(), prefix) == 0)
+				{
+					result.push_back("cxx/ServerKit/http_corpus/" + name);
+				}
+			}
+			closedir(dir);
+			std::sort(result.begin(), result.end());
+			return result;
+		}
+
+		/* For clean parses the traces must be identical. For errors,
+		 * upstream http_parser behavior makes the callbacks emitted
+		 * for bytes *before* the offending one feed-dependent (marked
+		 * data is only flushed at buffer boundaries, so a bytewise
+		 * feed flushes more of it than a whole-buffer feed). Both
+		 * feeds must still agree on the error code and on everything
+		 * up to the divergence: one trace must be a prefix of the
+		 * other.
+		 */
+		void ensureSemanticallyEqual(const string &message,
+			const string &a, const string &b)
+		{
+			if (a == b) {
+				return;
+			}
+
+			size_t aPos = a.rfind("ERRNO:");
+			size_t bPos = b.rfind("ERRNO:");
+			ensure(("traces end with an error code: " + message).c_str(),
+				aPos != string::npos && bPos != string::npos);
+			ensure_equals(("error codes match: " + message).c_str(),
+				a.substr(aPos), b.substr(bPos));
+			ensure(("traces agree on an error: " + message).c_str(),
+				a.substr(aPos) != "ERRNO:HPE_OK");
+
+			string aBody = a.substr(0, aPos);
+			string bBody = b.substr(0, bPos);
+			const string &shorter = (aBody.size() < bBody.size()) ? aBody : bBody;
+			const string &longer = (aBody.size() < bBody.size()) ? bBody : aBody;
+			ensure(("one error trace is a prefix of the other: " + message
+				+ ": '" + a + "' vs '" + b + "'").c_str(),
+				longer.compare(0, shorter.size(), shorter) == 0);
+		}
+
+		void runCorpus(const string &prefix, enum http_parser_type type) {
+			vector<string> files = listCorpusFiles(prefix);
+			ensure("corpus is not empty", !files.empty());
+
+			for (unsigned int i = 0; i < files.size(); i++) {
+				string input = readAll(files[i]);
+				string whole = parse(input, type, 0);
+				string bytewise = parse(input, type, 1);
+				ensureSemanticallyEqual("whole-buffer vs bytewise for "
+					+ files[i], whole, bytewise);
+
+				// A few awkward chunk sizes across the fast path's
+				// typical scan widths.
+				size_t chunkSizes[] = { 2, 3, 7, 16, 64 };
+				for (unsigned int j = 0; j < 5; j++) {
+					string chunked = parse(input, type, chunkSizes[j]);
+					ensureSemanticallyEqual("chunked ("
+						+ toString(chunkSizes[j]) + ") vs whole for "
+						+ files[i], chunked, whole);
+				}
+			}
+		}
+	};
+
+	DEFINE_TEST_GROUP(ServerKit_HttpParserCorpusTest);
+
+	TEST_METHOD(1) {
+		set_test_name("Request corpus: whole-buffer, bytewise and chunked "
+			"parses produce identical semantics");
+		runCorpus("request_", HTTP_REQUEST);
+	}
+
+	TEST_METHOD(2) {
+		set_test_name("Response corpus: whole-buffer, bytewise and chunked "
+			"parses produce identical semantics");
+		runCorpus("response_", HTTP_RESPONSE);
+	}
+}